@@ -123,6 +123,33 @@ typedef struct elab_event
     #error The current compiler is NOT supported!
 #endif
 
+/* Atomic access for the lock-free paths. The GNU builtins are supported by GCC
+   and the clang-based compilers (ARM Compiler 6 included). The others fall back
+   to plain access, in which the read-modify-write operations are NOT atomic. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define elab_atomic_load(_ptr)      __atomic_load_n((_ptr), __ATOMIC_ACQUIRE)
+    #define elab_atomic_store(_ptr, _val)                                      \
+                                        __atomic_store_n((_ptr), (_val), __ATOMIC_RELEASE)
+    #define elab_atomic_add(_ptr, _val) __atomic_add_fetch((_ptr), (_val), __ATOMIC_SEQ_CST)
+    #define elab_atomic_sub(_ptr, _val) __atomic_sub_fetch((_ptr), (_val), __ATOMIC_SEQ_CST)
+    #define elab_atomic_fence()         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+    #define elab_atomic_cas(_ptr, _expected, _val)                             \
+                                        __atomic_compare_exchange_n((_ptr),    \
+                                            (_expected), (_val), false,        \
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+    #define elab_atomic_load(_ptr)      (*(_ptr))
+    #define elab_atomic_store(_ptr, _val)                                      \
+                                        do { *(_ptr) = (_val); } while (0)
+    #define elab_atomic_add(_ptr, _val) (*(_ptr) += (_val))
+    #define elab_atomic_sub(_ptr, _val) (*(_ptr) -= (_val))
+    #define elab_atomic_fence()         do { } while (0)
+    #define elab_atomic_cas(_ptr, _expected, _val)                             \
+                                        ((*(_ptr) == *(_expected)) ?           \
+                                            (*(_ptr) = (_val), true) :         \
+                                            (*(_expected) = *(_ptr), false))
+#endif
+
 #ifdef __cplusplus
 }
 #endif
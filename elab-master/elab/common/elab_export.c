@@ -33,6 +33,26 @@ extern "C" {
 #endif
 
 #define ELAB_POLL_PERIOD_MAX                        (2592000000)    /* 30 days */
+#define ELAB_POLL_SLEEP_MAX                         (1000)
+
+/* The number of worker threads running the polling functions, and 0 means they
+   all run in the polling thread. */
+#if (ELAB_RTOS_CMSIS_OS_EN != 0)
+#ifndef ELAB_POLL_WORKER_NUM
+#define ELAB_POLL_WORKER_NUM                        (0)
+#endif
+#endif
+
+/* Run the INIT_EXPORT_PARALLEL functions of the same level in parallel threads,
+   only on the hosted builds with CMSIS-OS. */
+#if (ELAB_RTOS_CMSIS_OS_EN != 0) && (defined(__linux__) || defined(_WIN32))
+#ifndef ELAB_INIT_PARALLEL_EN
+#define ELAB_INIT_PARALLEL_EN                       (0)
+#endif
+#else
+#undef ELAB_INIT_PARALLEL_EN
+#define ELAB_INIT_PARALLEL_EN                       (0)
+#endif
 
 #if defined(__linux__)
 #define STR_ENTER                                   "\n"
@@ -42,19 +62,31 @@ extern "C" {
 
 /* private function prototype ----------------------------------------------- */
 static void module_null_init(void);
-static void _init_func_execute(int8_t level);
+static void _init_func_execute(int8_t level_min, int8_t level_max);
+static elab_export_init_data_t *_init_level_execute(elab_export_init_data_t *data);
+static void _init_run(elab_export_init_data_t *data);
+static elab_export_init_data_t *_init_list_sort(elab_export_init_data_t *list,
+                                                bool descending);
 static void _get_poll_export_table(void);
 static void _get_init_export_table(void);
 #if defined(__linux__) || defined(_WIN32)
 static void elab_exit(void);
-static void _exit_func_execute(int8_t level);
+#endif
+#if (ELAB_INIT_PARALLEL_EN != 0)
+static void _entry_init_parallel(void *para);
 #endif
 
 #if (ELAB_RTOS_CMSIS_OS_EN != 0 || ELAB_RTOS_BASIC_OS_EN != 0)
 static void _entry_start_poll(void *para);
 #endif
 
-static void _poll_func_execute(void);
+static uint32_t _poll_func_execute(void);
+static void _poll_insert(elab_export_poll_data_t *data);
+static void _poll_run(elab_export_poll_data_t *data, uint64_t time);
+static uint64_t _poll_time_ms(void);
+#if (ELAB_RTOS_CMSIS_OS_EN != 0 && ELAB_POLL_WORKER_NUM != 0)
+static void _entry_poll_worker(void *para);
+#endif
 
 /* private variables -------------------------------------------------------- */
 INIT_EXPORT(module_null_init, 0);
@@ -66,6 +98,16 @@ static elab_export_t *export_poll_table = NULL;
 static uint32_t count_export_poll = 0;
 static int8_t export_level_max = INT8_MIN;
 
+/* The initialization functions sorted by the level, the lowest first, and the
+   exiting ones the highest first. Both keep the link order in one level. */
+static elab_export_init_data_t *init_list = NULL;
+static elab_export_init_data_t *exit_list = NULL;
+
+/* The polling functions sorted by the deadline, the nearest first. */
+static elab_export_poll_data_t *poll_list = NULL;
+static uint32_t poll_time_last = 0;
+static uint64_t poll_time_high = 0;
+
 #if (ELAB_RTOS_CMSIS_OS_EN != 0)
 /**
  * @brief  The thread attribute for testing.
@@ -77,6 +119,30 @@ static const osThreadAttr_t thread_attr_export_poll =
     .priority = osPriorityNormal,
     .stack_size = 2048,
 };
+
+#if (ELAB_POLL_WORKER_NUM != 0)
+static const osThreadAttr_t thread_attr_poll_worker = 
+{
+    .name = "ThreadPollWorker",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+static osMessageQueueId_t mq_poll_worker = NULL;
+#endif
+
+#if (ELAB_INIT_PARALLEL_EN != 0)
+static const osThreadAttr_t thread_attr_init_parallel = 
+{
+    .name = "ThreadInitParallel",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+static osSemaphoreId_t sem_init_parallel = NULL;
+#endif
 #endif
 
 /* public function ---------------------------------------------------------- */
@@ -86,7 +152,7 @@ static const osThreadAttr_t thread_attr_export_poll =
   */
 void elab_unit_test(void)
 {
-    _init_func_execute(EXPORT_UNIT_TEST);
+    _init_func_execute(EXPORT_UNIT_TEST, EXPORT_UNIT_TEST);
 }
 
 #if defined(__linux__) || defined(_WIN32)
@@ -170,10 +236,7 @@ void elab_run(void)
     eos_run();
 #else
     /* Initialize all module in eLab. */
-    for (uint8_t level = 0; level <= export_level_max; level ++)
-    {
-        _init_func_execute(level);
-    }
+    _init_func_execute(0, export_level_max);
 
     /* Start polling function in metal eLab. */
     while (1)
@@ -183,6 +246,35 @@ void elab_run(void)
 #endif
 }
 
+/**
+  * @brief  Get the init export table in the link order, whose data has the
+  *         execution time.
+  * @param  count   Output, the number of the init and exit functions.
+  * @retval The init export table.
+  */
+const elab_export_t *elab_export_init_table(uint32_t *count)
+{
+    elab_assert(count != NULL);
+
+    *count = count_export_init;
+
+    return export_init_table;
+}
+
+/**
+  * @brief  Get the polling export table, whose data has the running statistics.
+  * @param  count   Output, the number of the polling functions.
+  * @retval The polling export table.
+  */
+const elab_export_t *elab_export_poll_table(uint32_t *count)
+{
+    elab_assert(count != NULL);
+
+    *count = count_export_poll;
+
+    return export_poll_table;
+}
+
 /* private function --------------------------------------------------------- */
 #if defined(__linux__) || defined(_WIN32)
 /**
@@ -191,10 +283,13 @@ void elab_run(void)
   */
 static void elab_exit(void)
 {
-    /* Initialize all module in eLab. */
-    for (int32_t level = export_level_max; level >= 0; level --)
+    /* Exit all module in eLab, the highest level first. */
+    elab_export_init_data_t *data = exit_list;
+    while (data != NULL && data->export->level >= 0)
     {
-        _exit_func_execute(level);
+        printf("Export exit %s." STR_ENTER, data->export->name);
+        _init_run(data);
+        data = data->next;
     }
 }
 #endif
@@ -220,6 +315,9 @@ static void _get_init_export_table(void)
     }
     export_init_table = func_block;
 
+    /* Link the functions in the link order, and then sort them by level. */
+    elab_export_init_data_t **init_tail = &init_list;
+    elab_export_init_data_t **exit_tail = &exit_list;
     uint32_t i = 0;
     while (1)
     {
@@ -230,6 +328,20 @@ static void _get_init_export_table(void)
             {
                 export_level_max = export_init_table[i].level;
             }
+            elab_export_init_data_t *data =
+                (elab_export_init_data_t *)export_init_table[i].data;
+            data->export = &export_init_table[i];
+            data->next = NULL;
+            if (export_init_table[i].exit)
+            {
+                *exit_tail = data;
+                exit_tail = &data->next;
+            }
+            else
+            {
+                *init_tail = data;
+                init_tail = &data->next;
+            }
             i ++;
         }
         else
@@ -238,6 +350,62 @@ static void _get_init_export_table(void)
         }
     }
     count_export_init = i;
+
+    init_list = _init_list_sort(init_list, false);
+    exit_list = _init_list_sort(exit_list, true);
+}
+
+/**
+  * @brief  Sort the init list by the level in merge sort, which is stable and
+  *         keeps the link order in one level.
+  * @param  list        The init list.
+  * @param  descending  The highest level first or not.
+  * @retval The sorted list.
+  */
+static elab_export_init_data_t *_init_list_sort(elab_export_init_data_t *list,
+                                                bool descending)
+{
+    if (list == NULL || list->next == NULL)
+    {
+        return list;
+    }
+
+    /* Split the list into two halves. */
+    elab_export_init_data_t *slow = list;
+    elab_export_init_data_t *fast = list->next;
+    while (fast != NULL && fast->next != NULL)
+    {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    elab_export_init_data_t *right = _init_list_sort(slow->next, descending);
+    slow->next = NULL;
+    elab_export_init_data_t *left = _init_list_sort(list, descending);
+
+    /* Merge them, and the left one goes first in the same level. */
+    elab_export_init_data_t *head = NULL;
+    elab_export_init_data_t **tail = &head;
+    while (left != NULL && right != NULL)
+    {
+        int8_t level_left = left->export->level;
+        int8_t level_right = right->export->level;
+        bool left_first = descending ?
+                            (level_left >= level_right) : (level_left <= level_right);
+        if (left_first)
+        {
+            *tail = left;
+            left = left->next;
+        }
+        else
+        {
+            *tail = right;
+            right = right->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = (left != NULL) ? left : right;
+
+    return head;
 }
 
 /**
@@ -262,6 +430,7 @@ static void _get_poll_export_table(void)
     export_poll_table = func_block;
 
     uint32_t i = 0;
+    uint64_t time = _poll_time_ms();
     while (1)
     {
         if (export_poll_table[i].magic_head == EXPORT_ID_POLL &&
@@ -271,7 +440,9 @@ static void _get_poll_export_table(void)
                         export_poll_table[i].name);
             elab_export_poll_data_t *data =
                 (elab_export_poll_data_t *)export_poll_table[i].data;
-            data->timeout_ms = elab_time_ms() + export_poll_table[i].period_ms;
+            data->export = &export_poll_table[i];
+            data->timeout_ms = time + export_poll_table[i].period_ms;
+            _poll_insert(data);
             i ++;
         }
         else
@@ -283,80 +454,204 @@ static void _get_poll_export_table(void)
 }
 
 /**
-  * @brief  eLab init exporting function executing.
+  * @brief  eLab init exporting function executing, in the given level range.
   * @retval None
   */
-static void _init_func_execute(int8_t level)
+static void _init_func_execute(int8_t level_min, int8_t level_max)
 {
-    /* Execute the poll function in the specific level. */
-    for (uint32_t i = 0; i < count_export_init; i ++)
+    elab_export_init_data_t *data = init_list;
+
+    while (data != NULL && data->export->level < level_min)
     {
-        if (export_init_table[i].level == level)
-        {
-            if (!export_init_table[i].exit)
-            {
-                if (level != EXPORT_UNIT_TEST)
-                {
-                    printf("Export init %s." STR_ENTER, export_init_table[i].name);
-                }
-                ((void (*)(void))export_init_table[i].func)();
-            }
-        }
+        data = data->next;
+    }
+    while (data != NULL && data->export->level <= level_max)
+    {
+        data = _init_level_execute(data);
     }
 }
 
-#if defined(__linux__) || defined(_WIN32)
 /**
-  * @brief  eLab exit exporting function executing.
-  * @retval None
+  * @brief  Execute the init functions in the level of the given one.
+  * @param  data    The first init function in the level.
+  * @retval The first init function in the next level.
   */
-static void _exit_func_execute(int8_t level)
+static elab_export_init_data_t *_init_level_execute(elab_export_init_data_t *data)
 {
-    /* Execute the poll function in the specific level. */
-    for (uint32_t i = 0; i < count_export_init; i ++)
+    int8_t level = data->export->level;
+
+#if (ELAB_INIT_PARALLEL_EN != 0)
+    /* Start the independent ones in their own threads, and run the others in
+       this thread meanwhile. */
+    uint32_t count_parallel = 0;
+    if (sem_init_parallel == NULL)
     {
-        if (export_init_table[i].level == level)
+        sem_init_parallel = osSemaphoreNew(count_export_init, 0, NULL);
+        elab_assert(sem_init_parallel != NULL);
+    }
+    for (elab_export_init_data_t *item = data;
+            item != NULL && item->export->level == level; item = item->next)
+    {
+        if (item->export->parallel)
         {
-            if (export_init_table[i].exit)
-            {
-                printf("Export exit %s." STR_ENTER, export_init_table[i].name);
-                ((void (*)(void))export_init_table[i].func)();
-            }
+            printf("Export init %s." STR_ENTER, item->export->name);
+            osThreadId_t thread = osThreadNew(_entry_init_parallel, item,
+                                                &thread_attr_init_parallel);
+            elab_assert(thread != NULL);
+            count_parallel ++;
         }
     }
+#endif
+
+    while (data != NULL && data->export->level == level)
+    {
+#if (ELAB_INIT_PARALLEL_EN != 0)
+        if (data->export->parallel)
+        {
+            data = data->next;
+            continue;
+        }
+#endif
+        if (level != EXPORT_UNIT_TEST)
+        {
+            printf("Export init %s." STR_ENTER, data->export->name);
+        }
+        _init_run(data);
+        data = data->next;
+    }
+
+#if (ELAB_INIT_PARALLEL_EN != 0)
+    /* The next level starts after all the ones in this level. */
+    for (uint32_t i = 0; i < count_parallel; i ++)
+    {
+        osStatus_t ret_os = osSemaphoreAcquire(sem_init_parallel, osWaitForever);
+        elab_assert(ret_os == osOK);
+    }
+#endif
+
+    return data;
+}
+
+/**
+  * @brief  Run the init or exit function, and record its execution time.
+  */
+static void _init_run(elab_export_init_data_t *data)
+{
+    uint32_t time = elab_time_ms();
+    ((void (*)(void))data->export->func)();
+    data->time_ms = elab_time_ms() - time;
+}
+
+#if (ELAB_INIT_PARALLEL_EN != 0)
+/**
+  * @brief  The thread running one independent init function.
+  */
+static void _entry_init_parallel(void *para)
+{
+    _init_run((elab_export_init_data_t *)para);
+    osSemaphoreRelease(sem_init_parallel);
 }
 #endif
 
 /**
-  * @brief  eLab polling exporting function executing.
-  * @retval None
+  * @brief  eLab polling exporting function executing. Only the due ones in the
+  *         head of the deadline-sorted list are checked.
+  * @retval The time in ms until the next deadline.
   */
-static void _poll_func_execute(void)
+static uint32_t _poll_func_execute(void)
 {
     elab_export_poll_data_t *data;
-    
-    /* Execute the poll function in the specific level. */
-    for (uint32_t i = 0; i < count_export_poll; i ++)
-    {
-        data = export_poll_table[i].data;
+    uint64_t time = _poll_time_ms();
 
-        while (1)
+    while (poll_list != NULL && poll_list->timeout_ms <= time)
+    {
+        data = poll_list;
+        poll_list = data->next;
+
+        /* The missed periods are caught up one by one as before, and each one
+           is counted as an overrun. */
+        uint64_t delay = time - data->timeout_ms;
+        bool overrun = (delay >= data->export->period_ms);
+        if (overrun)
         {
-            uint32_t _time = elab_time_ms();
-            if (((_time >= data->timeout_ms) &&
-                 (_time - data->timeout_ms < ELAB_POLL_PERIOD_MAX)) ||
-                ((_time < data->timeout_ms) &&
-                 (data->timeout_ms - _time > ELAB_POLL_PERIOD_MAX)))
-            {
-                data->timeout_ms += export_poll_table[i].period_ms;
-                ((void (*)(void))export_poll_table[i].func)();
-            }
-            else 
-            {
-                break;
-            }
+            data->overrun ++;
         }
+        if (delay > data->jitter_max_ms)
+        {
+            data->jitter_max_ms = (uint32_t)delay;
+        }
+        data->jitter_sum_ms += delay;
+        data->timeout_ms += data->export->period_ms;
+        _poll_insert(data);
+
+#if (ELAB_RTOS_CMSIS_OS_EN != 0 && ELAB_POLL_WORKER_NUM != 0)
+        /* Skip the function still running in one worker, counted as one
+           overrun of this period if it is not late. */
+        if (elab_atomic_load(&data->busy))
+        {
+            data->overrun += overrun ? 0 : 1;
+            continue;
+        }
+        elab_atomic_store(&data->busy, true);
+        osStatus_t ret_os = osMessageQueuePut(mq_poll_worker, &data, 0, 0);
+        elab_assert(ret_os == osOK);
+#else
+        _poll_run(data, time);
+        time = _poll_time_ms();
+#endif
     }
+
+    uint64_t time_sleep = poll_list->timeout_ms - time;
+
+    return (time_sleep > ELAB_POLL_SLEEP_MAX) ?
+                ELAB_POLL_SLEEP_MAX : (uint32_t)time_sleep;
+}
+
+/**
+  * @brief  Insert the polling function into the list in deadline order, and
+  *         after the ones with the same deadline.
+  */
+static void _poll_insert(elab_export_poll_data_t *data)
+{
+    elab_export_poll_data_t **next = &poll_list;
+
+    while (*next != NULL && (*next)->timeout_ms <= data->timeout_ms)
+    {
+        next = &(*next)->next;
+    }
+    data->next = *next;
+    *next = data;
+}
+
+/**
+  * @brief  Run the polling function, and record its execution time.
+  */
+static void _poll_run(elab_export_poll_data_t *data, uint64_t time)
+{
+    ((void (*)(void))data->export->func)();
+
+    uint32_t time_exec = elab_time_ms() - (uint32_t)time;
+    if (time_exec > data->time_max_ms)
+    {
+        data->time_max_ms = time_exec;
+    }
+    data->count ++;
+}
+
+/**
+  * @brief  Get the 64-bit time in ms, in case of the 32-bit time wrapping
+  *         around. It is called at least once in ELAB_POLL_SLEEP_MAX.
+  */
+static uint64_t _poll_time_ms(void)
+{
+    uint32_t time = elab_time_ms();
+    if (time < poll_time_last)
+    {
+        poll_time_high += ((uint64_t)1 << 32);
+    }
+    poll_time_last = time;
+
+    return (poll_time_high | time);
 }
 
 #if (ELAB_RTOS_CMSIS_OS_EN != 0 || ELAB_RTOS_BASIC_OS_EN != 0)
@@ -367,18 +662,51 @@ static void _poll_func_execute(void)
 static void _entry_start_poll(void *para)
 {
     /* Initialize all module in eLab. */
-    for (uint8_t level = 0; level <= export_level_max; level ++)
+    _init_func_execute(0, export_level_max);
+
+#if (ELAB_RTOS_CMSIS_OS_EN != 0 && ELAB_POLL_WORKER_NUM != 0)
+    mq_poll_worker = osMessageQueueNew(count_export_poll,
+                                        sizeof(elab_export_poll_data_t *), NULL);
+    elab_assert(mq_poll_worker != NULL);
+    for (uint32_t i = 0; i < ELAB_POLL_WORKER_NUM; i ++)
     {
-        _init_func_execute(level);
+        osThreadId_t thread = osThreadNew(_entry_poll_worker, NULL,
+                                            &thread_attr_poll_worker);
+        elab_assert(thread != NULL);
     }
+#endif
 
-    /* Start polling function in metal eLab. */
+    /* Start polling function, and sleep until the next deadline. */
     while (1)
     {
-        _poll_func_execute();
-#if (ELAB_RTOS_CMSIS_OS_EN != 0 || ELAB_RTOS_BASIC_OS_EN != 0)
-        osDelay(10);
+        uint32_t time_sleep = _poll_func_execute();
+#if (ELAB_RTOS_CMSIS_OS_EN != 0)
+        osDelay((time_sleep + ELAB_RTOS_TICK_MS - 1) / ELAB_RTOS_TICK_MS);
+#else
+        osDelay(time_sleep);
+#endif
+    }
+}
 #endif
+
+#if (ELAB_RTOS_CMSIS_OS_EN != 0 && ELAB_POLL_WORKER_NUM != 0)
+/**
+  * @brief  The worker thread running the polling functions.
+  */
+static void _entry_poll_worker(void *para)
+{
+    (void)para;
+
+    elab_export_poll_data_t *data = NULL;
+    osStatus_t ret_os = osOK;
+
+    while (1)
+    {
+        ret_os = osMessageQueueGet(mq_poll_worker, &data, NULL, osWaitForever);
+        elab_assert(ret_os == osOK);
+
+        _poll_run(data, elab_time_ms());
+        elab_atomic_store(&data->busy, false);
     }
 }
 #endif
@@ -34,9 +34,24 @@ enum elab_export_level
 };
 
 /* public typedef ----------------------------------------------------------- */
+typedef struct elab_export_init_data
+{
+    struct elab_export_init_data *next;     /* The next one in level order */
+    const struct elab_export *export;
+    uint32_t time_ms;                       /* Execution time */
+} elab_export_init_data_t;
+
 typedef struct elab_export_poll_data
 {
-    uint32_t timeout_ms;
+    struct elab_export_poll_data *next;     /* The next one in deadline order */
+    const struct elab_export *export;
+    uint64_t timeout_ms;                    /* The next deadline */
+    uint32_t count;                         /* Execution times */
+    uint32_t overrun;                       /* Times of missing a whole period */
+    uint32_t jitter_max_ms;                 /* Max delay from the deadline */
+    uint64_t jitter_sum_ms;                 /* Sum of the delay, for average */
+    uint32_t time_max_ms;                   /* Max execution time */
+    bool busy;                              /* Running in the worker thread */
 } elab_export_poll_data_t;
 
 typedef struct elab_export
@@ -48,6 +63,7 @@ typedef struct elab_export
     bool exit;
     int8_t level;
     uint8_t type;
+    bool parallel;
     uint32_t period_ms;
 #if defined(_WIN32)
     uint32_t temp[9];
@@ -60,25 +76,50 @@ typedef struct elab_export
 /* private function --------------------------------------------------------- */
 void elab_unit_test(void);
 void elab_run(void);
+const elab_export_t *elab_export_init_table(uint32_t *count);
+const elab_export_t *elab_export_poll_table(uint32_t *count);
 
 /* public export ------------------------------------------------------------ */
 /**
-  * @brief  Initialization function exporting macro.
-  * @param  _func   The initialization function.
-  * @param  _level  The export level, [0, 127].
-  * @retval None.
+  * @brief  Initialization and exiting function defining macro, not for users.
   */
-#define INIT_EXPORT(_func, _level)                                             \
-    ELAB_USED const elab_export_t init_##_func ELAB_SECTION("elab_export") =   \
+#define EXPORT_INIT_DEFINE(_prefix, _func, _level, _exit, _parallel)           \
+    static elab_export_init_data_t _prefix##_func##_data =                     \
+    {                                                                          \
+        .next = NULL,                                                          \
+    };                                                                         \
+    ELAB_USED const elab_export_t _prefix##_func ELAB_SECTION("elab_export") = \
     {                                                                          \
         .name = #_func,                                                        \
         .func = (void *)&_func,                                                \
+        .data = (void *)&_prefix##_func##_data,                                \
         .level = _level,                                                       \
-        .exit = false,                                                         \
+        .exit = _exit,                                                         \
+        .parallel = _parallel,                                                 \
         .magic_head = EXPORT_ID_INIT,                                          \
         .magic_tail = EXPORT_ID_INIT,                                          \
     }
 
+/**
+  * @brief  Initialization function exporting macro.
+  * @param  _func   The initialization function.
+  * @param  _level  The export level, [0, 127].
+  * @retval None.
+  */
+#define INIT_EXPORT(_func, _level)                                             \
+    EXPORT_INIT_DEFINE(init_, _func, _level, false, false)
+
+/**
+  * @brief  Initialization function exporting macro, for the function which is
+  *         independent of the others in the same level. It may run in parallel
+  *         with them on the hosted builds, if ELAB_INIT_PARALLEL_EN is set.
+  * @param  _func   The initialization function.
+  * @param  _level  The export level, [0, 127].
+  * @retval None.
+  */
+#define INIT_EXPORT_PARALLEL(_func, _level)                                    \
+    EXPORT_INIT_DEFINE(init_, _func, _level, false, true)
+
 /**
   * @brief  Exiting function exporting macro.
   * @param  _func   The polling function.
@@ -86,15 +127,7 @@ void elab_run(void);
   * @retval None.
   */
 #define EXIT_EXPORT(_func, _level)                                             \
-    ELAB_USED const elab_export_t exit_##_func ELAB_SECTION("elab_export") =   \
-    {                                                                          \
-        .name = #_func,                                                        \
-        .func = (void *)&_func,                                                \
-        .level = _level,                                                       \
-        .exit = true,                                                          \
-        .magic_head = EXPORT_ID_INIT,                                          \
-        .magic_tail = EXPORT_ID_INIT,                                          \
-    }
+    EXPORT_INIT_DEFINE(exit_, _func, _level, true, false)
 
 /**
   * @brief  Unit test function exporting macro.
@@ -117,7 +150,7 @@ void elab_run(void);
     };                                                                         \
     ELAB_USED const elab_export_t poll_##_func ELAB_SECTION("expoll") =        \
     {                                                                          \
-        .name = "poll",                                                        \
+        .name = #_func,                                                        \
         .func = &_func,                                                        \
         .data = (void *)&poll_##_func##_data,                                  \
         .level = EXPORT_POLL,                                                  \
@@ -6,10 +6,13 @@
 /* include ------------------------------------------------------------------ */
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
 #include "elab_log.h"
 #include "elab_assert.h"
 #include "elab_common.h"
 #include "elab_config.h"
+#include "elab_def.h"
 #if (ELAB_RTOS_CMSIS_OS_EN != 0)
 #include "../os/cmsis_os.h"
 #endif
@@ -21,7 +24,27 @@ extern "C" {
 /* private config ----------------------------------------------------------- */
 #define ELAB_LOG_BUFF_SIZE                          (256)
 
+#if (ELOG_ASYNC_ENABLE != 0) && (ELAB_RTOS_CMSIS_OS_EN != 0)
+#define ELOG_ASYNC_EN                               (1)
+#else
+#define ELOG_ASYNC_EN                               (0)
+#endif
+
+#define ELOG_ASYNC_RECORD_NUM                       (128)   /* Power of 2 */
+#define ELOG_ASYNC_TEXT_SIZE                        (112)
+#define ELOG_ASYNC_LINE_SIZE                        (ELOG_ASYNC_TEXT_SIZE + 64)
+#define ELOG_ASYNC_BATCH_NUM                        (16)
+#define ELOG_ASYNC_PERIOD_MS                        (10)
+
+#define ELOG_BINARY_SYNC                            (0xA5)
+#define ELOG_BINARY_HEAD_SIZE                       (9)
+#define ELOG_BINARY_STRING_MAX                      (32)
+
+#define ELOG_TAG_CACHE_SIZE                         (64)
+
 /* private defines ---------------------------------------------------------- */
+ELAB_TAG("eLog");
+
 /* define printf color */
 #define NONE                                        "\033[0;0m"
 #define LIGHT_RED                                   "\033[1;31m"
@@ -29,6 +52,83 @@ extern "C" {
 #define LIGHT_BLUE                                  "\033[1;34m"
 #define GREEN                                       "\033[0;32m"
 
+/* private typedef ---------------------------------------------------------- */
+/* The per-tag configuration. The rate is limited by the generic cell rate
+   algorithm, the token bucket kept in one theoretical arrival time, so it is
+   updated by one CAS. */
+typedef struct elog_tag
+{
+    const char *name;
+    uint8_t level;
+    uint32_t interval;              /* The time in ms per log, 0 for no limit */
+    uint32_t tolerance;             /* The burst time in ms */
+    uint32_t time_tat;
+    uint32_t dropped;
+} elog_tag_t;
+
+/* The tag resolved by the logging thread, cached by the TAG pointer, so the
+   names are compared only once for every file instead of every log. The slot
+   is guarded by its sequence, which is odd when it is being written. */
+typedef struct elog_tag_cache
+{
+    uint32_t seq;
+    const char *tag;
+    elog_tag_t *entry;              /* NULL for not configured */
+    uint32_t count;                 /* The tag count when it is resolved */
+} elog_tag_cache_t;
+
+#if (ELOG_ASYNC_EN != 0)
+typedef struct elog_record
+{
+    uint32_t seq;                   /* The position it can be put or got at */
+    uint32_t time;
+    const char *tag;                /* NULL for the binary record */
+    uint8_t level;
+    uint8_t size;                   /* The binary record size */
+    int16_t id;                     /* The binary record format ID */
+    char text[ELOG_ASYNC_TEXT_SIZE];
+} elog_record_t;
+
+typedef struct elog_async
+{
+    elog_record_t *ring;
+    uint32_t head;                  /* The position to put by the loggers */
+    uint32_t tail;                  /* The position to get by the drain thread */
+    uint32_t users;                 /* The loggers in the async path */
+    osThreadId_t thread;
+    uint8_t policy;
+    bool enabled;
+    bool running;
+    bool draining;
+    elog_async_stat_t stat;
+} elog_async_t;
+#endif
+
+/* private function prototype ----------------------------------------------- */
+static bool _elog_filter(const char *tag, uint8_t level);
+static elog_tag_t *_elog_tag_find(const char *tag);
+static elog_tag_t *_elog_tag_lookup(const char *tag, uint32_t count);
+static elog_tag_t *_elog_tag_get(const char *tag);
+static void _elog_lock(void);
+static void _elog_unlock(void);
+static void _elog_sink_output(uint8_t level, const char *buff, uint32_t size,
+                                bool text);
+static void _elog_sink_level_update(void);
+static void _elog_console_write(elog_sink_t *me, const char *buff, uint32_t size);
+static void _elog_console_flush(elog_sink_t *me);
+static void _elog_sync_vprintf(const char *name, uint8_t level,
+                                const char *s_format, va_list param_list);
+#if (ELOG_ASYNC_EN != 0)
+static uint32_t _elog_binary_encode(uint8_t *buff, uint32_t size,
+                                    const char *s_format, va_list param_list);
+static uint8_t _elog_binary_check(const uint8_t *head);
+static elog_record_t *_elog_async_claim(uint32_t *pos);
+static elog_record_t *_elog_async_get(uint32_t *pos);
+static bool _elog_async_discard(void);
+static void _elog_sink_flush(void);
+static void _entry_elog_async(void *para);
+#endif
+
 /* private variables -------------------------------------------------------- */
 #if (ELAB_RTOS_CMSIS_OS_EN != 0)
 static const osMutexAttr_t mutex_attr_elog =
@@ -58,53 +158,968 @@ static const char elog_level_lable[ELOG_LEVEL_MAX] =
 
 static char _buff[ELAB_LOG_BUFF_SIZE];
 
+/* The tags are only added, and published by the count. */
+static elog_tag_t elog_tag_table[ELOG_TAG_NUM_MAX];
+static uint32_t elog_tag_count = 0;
+static elog_tag_cache_t elog_tag_cache[ELOG_TAG_CACHE_SIZE];
+
+static const elog_sink_ops_t elog_sink_ops_console =
+{
+    .write = _elog_console_write,
+    .flush = _elog_console_flush,
+};
+
+static elog_sink_t elog_sink_console =
+{
+    .next = NULL,
+    .name = "console",
+    .ops = &elog_sink_ops_console,
+    .level = ELOG_LEVEL_DEBUG,
+    .color = (ELOG_COLOR_ENABLE != 0),
+};
+
+/* The sink list is used with the mutex, and only the maximum level of all the
+   sinks is read by the logging threads. */
+static elog_sink_t *elog_sink_list = &elog_sink_console;
+static uint8_t elog_sink_level = ELOG_LEVEL_DEBUG;
+
+/* The base of the binary log format IDs. */
+ELAB_USED const elog_fmt_t elog_fmt_base ELAB_SECTION("elog_fmt") =
+{
+    "eLog", "elog binary base", 0,
+};
+
+#if (ELOG_ASYNC_EN != 0)
+static elog_async_t elog_async;
+
+static const osThreadAttr_t thread_attr_elog_async =
+{
+    .name = "ThreadElogAsync",
+    .attr_bits = osThreadJoinable,
+    .priority = osPriorityLow,
+    .stack_size = 2048,
+};
+#endif
+
 /* public function ---------------------------------------------------------- */
 void elog_level_set(uint8_t level)
 {
     elog_level = level;
 }
 
+/**
+  * @brief  Set the level of one tag, over the global level.
+  * @param  tag     The tag name.
+  * @param  level   The level, or ELOG_LEVEL_GLOBAL to follow the global one.
+  * @retval None.
+  */
+void elog_tag_level_set(const char *tag, uint8_t level)
+{
+    elab_assert(level < ELOG_LEVEL_MAX || level == ELOG_LEVEL_GLOBAL);
+
+    _elog_lock();
+    elab_atomic_store(&_elog_tag_get(tag)->level, level);
+    _elog_unlock();
+}
+
+/**
+  * @brief  Set the rate limit of one tag. The logs over the limit are dropped.
+  * @param  tag     The tag name.
+  * @param  rate    The logs per second, 0 for no limit. At most 1000.
+  * @param  burst   The logs can be printed at once.
+  * @retval None.
+  */
+void elog_tag_rate_set(const char *tag, uint32_t rate, uint32_t burst)
+{
+    elab_assert(rate <= 1000);
+    elab_assert(rate == 0 || burst > 0);
+
+    _elog_lock();
+    elog_tag_t *_tag = _elog_tag_get(tag);
+    uint32_t interval = (rate == 0) ? 0 : (1000 / rate);
+    elab_atomic_store(&_tag->interval, 0);
+    elab_atomic_store(&_tag->tolerance, (rate == 0) ? 0 : (interval * (burst - 1)));
+    elab_atomic_store(&_tag->time_tat, elab_time_ms());
+    elab_atomic_store(&_tag->interval, interval);
+    _elog_unlock();
+}
+
+/**
+  * @brief  Get the count of the logs dropped by the rate limit of one tag.
+  * @param  tag     The tag name.
+  * @retval The dropped count.
+  */
+uint32_t elog_tag_dropped(const char *tag)
+{
+    elog_tag_t *_tag = _elog_tag_find(tag);
+
+    return (_tag == NULL) ? 0 : elab_atomic_load(&_tag->dropped);
+}
+
+/**
+  * @brief  Register one log sink, added to the end of the sink list.
+  * @param  me      The sink handle.
+  * @param  name    The sink name.
+  * @param  ops     The sink operations.
+  * @param  level   The sink level, 0 for disabled.
+  * @param  color   The text logs are colored or not.
+  * @retval None.
+  */
+void elog_sink_register(elog_sink_t *me, const char *name,
+                        const elog_sink_ops_t *ops, uint8_t level, bool color)
+{
+    elab_assert(me != NULL);
+    elab_assert(name != NULL);
+    elab_assert(ops != NULL && ops->write != NULL);
+    elab_assert(level < ELOG_LEVEL_MAX);
+    elab_assert(elog_sink_find(name) == NULL);
+
+    me->next = NULL;
+    me->name = name;
+    me->ops = ops;
+    me->level = level;
+    me->color = color;
+
+    _elog_lock();
+    elog_sink_t **sink = &elog_sink_list;
+    while (*sink != NULL)
+    {
+        sink = &(*sink)->next;
+    }
+    *sink = me;
+    _elog_sink_level_update();
+    _elog_unlock();
+}
+
+/**
+  * @brief  Unregister one log sink.
+  * @param  me      The sink handle.
+  * @retval None.
+  */
+void elog_sink_unregister(elog_sink_t *me)
+{
+    elab_assert(me != NULL);
+
+    _elog_lock();
+    elog_sink_t **sink = &elog_sink_list;
+    while (*sink != NULL && *sink != me)
+    {
+        sink = &(*sink)->next;
+    }
+    elab_assert(*sink == me);
+    *sink = me->next;
+    me->next = NULL;
+    _elog_sink_level_update();
+    _elog_unlock();
+}
+
+/**
+  * @brief  Find one log sink by its name.
+  * @param  name    The sink name.
+  * @retval The sink handle, or NULL if not found.
+  */
+elog_sink_t *elog_sink_find(const char *name)
+{
+    elog_sink_t *sink = NULL;
+
+    _elog_lock();
+    for (sink = elog_sink_list; sink != NULL; sink = sink->next)
+    {
+        if (strcmp(sink->name, name) == 0)
+        {
+            break;
+        }
+    }
+    _elog_unlock();
+
+    return sink;
+}
+
+/**
+  * @brief  Set the level of one log sink.
+  * @param  me      The sink handle.
+  * @param  level   The sink level, 0 for disabled.
+  * @retval None.
+  */
+void elog_sink_level_set(elog_sink_t *me, uint8_t level)
+{
+    elab_assert(me != NULL);
+    elab_assert(level < ELOG_LEVEL_MAX);
+
+    _elog_lock();
+    me->level = level;
+    _elog_sink_level_update();
+    _elog_unlock();
+}
+
+/**
+  * @brief  Lock the sinks against the logging, for the sink implementations
+  *         reading or clearing their own buffers.
+  * @retval None.
+  */
+void elog_sink_lock(void)
+{
+    _elog_lock();
+}
+
+/**
+  * @brief  Unlock the sinks.
+  * @retval None.
+  */
+void elog_sink_unlock(void)
+{
+    _elog_unlock();
+}
+
 void _elog_printf(const char *name, uint8_t level, const char * s_format, ...)
 {
-#if (ELAB_RTOS_CMSIS_OS_EN != 0)
-    if (mutex_elog == NULL)
+    if (!_elog_filter(name, level))
     {
-        mutex_elog = osMutexNew(&mutex_attr_elog);
+        return;
     }
-    osMutexAcquire(mutex_elog, osWaitForever);
-#endif
 
-    if (elog_level >= level)
+    va_list param_list;
+    va_start(param_list, s_format);
+
+#if (ELOG_ASYNC_EN != 0)
+    /* The async path, without the mutex and the console I/O. */
+    elab_atomic_add(&elog_async.users, 1);
+    if (elab_atomic_load(&elog_async.enabled))
     {
-#if (ELAB_RTOS_CMSIS_OS_EN == 0 && ELAB_RTOS_BASIC_OS_EN == 0)
-        printf("%s[%c/%s %u] ", elog_color_table[level],
-                                elog_level_lable[level], name, elab_time_ms());
-        va_list param_list;
-        va_start(param_list, s_format);
-        int count = vsnprintf(_buff, (ELAB_LOG_BUFF_SIZE - 1), s_format, param_list);
+        uint32_t pos = 0;
+        elog_record_t *record = _elog_async_claim(&pos);
+        if (record != NULL)
+        {
+            record->time = elab_time_ms();
+            record->tag = name;
+            record->level = level;
+            vsnprintf(record->text, ELOG_ASYNC_TEXT_SIZE, s_format, param_list);
+            elab_atomic_store(&record->seq, pos + 1);
+        }
+        elab_atomic_sub(&elog_async.users, 1);
         va_end(param_list);
-        _buff[count] = 0;
-        printf("%s", _buff);
-        printf("\r\n");
-#endif
-#if (ELAB_RTOS_CMSIS_OS_EN != 0 || ELAB_RTOS_BASIC_OS_EN != 0)
-        printf("%s[%c/%s %u] ", elog_color_table[level],
-                                elog_level_lable[level], name, elab_time_ms());
-        va_list param_list;
-        va_start(param_list, s_format);
-        int count = vsnprintf(_buff, (ELAB_LOG_BUFF_SIZE - 1), s_format, param_list);
+        return;
+    }
+    elab_atomic_sub(&elog_async.users, 1);
+#endif
+
+    _elog_sync_vprintf(name, level, s_format, param_list);
+    va_end(param_list);
+}
+
+/**
+  * @brief  The binary log, recording the format ID, the time and the raw
+  *         arguments in the async mode, without formatting.
+  * @param  fmt     The format in the section elog_fmt.
+  * @retval None.
+  */
+void _elog_binary(const elog_fmt_t *fmt, ...)
+{
+    if (!_elog_filter(fmt->tag, fmt->level))
+    {
+        return;
+    }
+
+    va_list param_list;
+    va_start(param_list, fmt);
+
+#if (ELOG_ASYNC_EN != 0)
+    elab_atomic_add(&elog_async.users, 1);
+    if (elab_atomic_load(&elog_async.enabled))
+    {
+        uint32_t pos = 0;
+        elog_record_t *record = _elog_async_claim(&pos);
+        if (record != NULL)
+        {
+            record->time = elab_time_ms();
+            record->tag = NULL;
+            record->level = fmt->level;
+            record->id = (int16_t)(((intptr_t)fmt - (intptr_t)&elog_fmt_base) / 4);
+            record->size = _elog_binary_encode((uint8_t *)record->text,
+                                                ELOG_ASYNC_TEXT_SIZE,
+                                                fmt->format, param_list);
+            elab_atomic_store(&record->seq, pos + 1);
+        }
+        elab_atomic_sub(&elog_async.users, 1);
         va_end(param_list);
-        _buff[count] = 0;
-        printf("%s", _buff);
-        printf(NONE "\r\n");
+        return;
+    }
+    elab_atomic_sub(&elog_async.users, 1);
+#endif
+
+    _elog_sync_vprintf(fmt->tag, fmt->level, fmt->format, param_list);
+    va_end(param_list);
+}
+
+#if (ELOG_ASYNC_EN != 0)
+/**
+  * @brief  Start the async mode of elog.
+  * @param  policy  The policy when the ring buffer is full.
+  * @retval None.
+  */
+void elog_async_start(uint8_t policy)
+{
+    elab_assert(policy < ELOG_ASYNC_POLICY_MAX);
+    elab_assert(!elog_async.enabled);
+
+    /* The memory is kept after stopping, as loggers may be still reading. */
+    if (elog_async.ring == NULL)
+    {
+        elog_async.ring = elab_malloc(sizeof(elog_record_t) * ELOG_ASYNC_RECORD_NUM);
+        elab_assert(elog_async.ring != NULL);
+    }
+    for (uint32_t i = 0; i < ELOG_ASYNC_RECORD_NUM; i ++)
+    {
+        elog_async.ring[i].seq = i;
+    }
+    elog_async.head = 0;
+    elog_async.tail = 0;
+    elog_async.policy = policy;
+    elog_async.draining = false;
+    memset(&elog_async.stat, 0, sizeof(elog_async_stat_t));
+
+    elog_async.running = true;
+    elog_async.thread = osThreadNew(_entry_elog_async, NULL, &thread_attr_elog_async);
+    elab_assert(elog_async.thread != NULL);
+    elab_atomic_store(&elog_async.enabled, true);
+}
+
+/**
+  * @brief  Stop the async mode of elog, after all the records are written.
+  * @retval None.
+  */
+void elog_async_stop(void)
+{
+    elab_assert(elog_async.enabled);
+
+    /* The new logs go to the sync path, and the ones on the way are waited. */
+    elab_atomic_store(&elog_async.enabled, false);
+    while (elab_atomic_load(&elog_async.users) != 0)
+    {
+        osDelay(1);
+    }
+    elog_async_flush();
+
+    elab_atomic_store(&elog_async.running, false);
+    osThreadJoin(elog_async.thread);
+    elog_async.thread = NULL;
+}
+
+/**
+  * @brief  Wait until all the records in the ring buffer are written.
+  * @retval None.
+  */
+void elog_async_flush(void)
+{
+    while (elab_atomic_load(&elog_async.tail) != elab_atomic_load(&elog_async.head) ||
+            elab_atomic_load(&elog_async.draining))
+    {
+        osDelay(1);
+    }
+}
+
+/**
+  * @brief  Get the statistics of the async mode.
+  * @param  stat    The statistics output.
+  * @retval None.
+  */
+void elog_async_stat(elog_async_stat_t *stat)
+{
+    elab_assert(stat != NULL);
+
+    stat->written = elab_atomic_load(&elog_async.stat.written);
+    stat->dropped = elab_atomic_load(&elog_async.stat.dropped);
+    stat->overwritten = elab_atomic_load(&elog_async.stat.overwritten);
+}
+
 #endif
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Check the log by the levels and the rate limit of its tag, before
+  *         it is formatted. No lock is taken here.
+  * @retval True if the log is to be printed.
+  */
+static bool _elog_filter(const char *tag, uint8_t level)
+{
+    if (level > elab_atomic_load(&elog_sink_level))
+    {
+        return false;
     }
-    
+
+    elog_tag_t *_tag = _elog_tag_find(tag);
+    uint8_t level_tag = (_tag == NULL) ?
+                        ELOG_LEVEL_GLOBAL : elab_atomic_load(&_tag->level);
+    if (level > ((level_tag == ELOG_LEVEL_GLOBAL) ? elog_level : level_tag))
+    {
+        return false;
+    }
+
+    uint32_t interval = (_tag == NULL) ? 0 : elab_atomic_load(&_tag->interval);
+    if (interval == 0)
+    {
+        return true;
+    }
+
+    /* One log takes the interval from the theoretical arrival time, and it is
+       dropped if the time is ahead of now over the burst tolerance. */
+    uint32_t tolerance = elab_atomic_load(&_tag->tolerance);
+    uint32_t time = elab_time_ms();
+    uint32_t time_tat = elab_atomic_load(&_tag->time_tat);
+    while (1)
+    {
+        int32_t diff = (int32_t)(time_tat - time);
+        uint32_t time_tat_new = time_tat;
+        if (diff < 0 || diff > (int32_t)(tolerance + interval))
+        {
+            /* Idle, or the time overflowed since the last log. */
+            time_tat_new = time;
+            diff = 0;
+        }
+        if (diff > (int32_t)tolerance)
+        {
+            elab_atomic_add(&_tag->dropped, 1);
+            return false;
+        }
+        if (elab_atomic_cas(&_tag->time_tat, &time_tat, time_tat_new + interval))
+        {
+            return true;
+        }
+    }
+}
+
+/**
+  * @brief  Find the tag by its name, without any lock. The result is cached by
+  *         the tag pointer. The configured tag is never removed, so the cached
+  *         one is always valid, and the cached miss is valid until one tag is
+  *         added.
+  * @retval The tag, or NULL if not configured.
+  */
+static elog_tag_t *_elog_tag_find(const char *tag)
+{
+    uint32_t count = elab_atomic_load(&elog_tag_count);
+    elog_tag_cache_t *cache =
+        &elog_tag_cache[((uintptr_t)tag >> 2) % ELOG_TAG_CACHE_SIZE];
+
+    uint32_t seq = elab_atomic_load(&cache->seq);
+    if ((seq & 1) == 0 && elab_atomic_load(&cache->tag) == tag)
+    {
+        elog_tag_t *entry = elab_atomic_load(&cache->entry);
+        uint32_t count_cache = elab_atomic_load(&cache->count);
+        elab_atomic_fence();
+        if (elab_atomic_load(&cache->seq) == seq &&
+            (entry != NULL || count_cache == count))
+        {
+            return entry;
+        }
+    }
+
+    elog_tag_t *entry = _elog_tag_lookup(tag, count);
+
+    /* Not cached if another thread is writing the slot. */
+    if ((seq & 1) == 0 && elab_atomic_cas(&cache->seq, &seq, seq + 1))
+    {
+        elab_atomic_store(&cache->tag, tag);
+        elab_atomic_store(&cache->entry, entry);
+        elab_atomic_store(&cache->count, count);
+        elab_atomic_store(&cache->seq, seq + 2);
+    }
+
+    return entry;
+}
+
+/**
+  * @brief  Look the tag up by its name in the published ones of the table.
+  * @retval The tag, or NULL if not configured.
+  */
+static elog_tag_t *_elog_tag_lookup(const char *tag, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        if (elog_tag_table[i].name == tag || strcmp(elog_tag_table[i].name, tag) == 0)
+        {
+            return &elog_tag_table[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Get the tag by its name, added if not configured. The mutex should
+  *         be taken.
+  */
+static elog_tag_t *_elog_tag_get(const char *tag)
+{
+    elab_assert(tag != NULL);
+
+    elog_tag_t *_tag = _elog_tag_find(tag);
+    if (_tag == NULL)
+    {
+        elab_assert(elog_tag_count < ELOG_TAG_NUM_MAX);
+
+        _tag = &elog_tag_table[elog_tag_count];
+        _tag->name = tag;
+        _tag->level = ELOG_LEVEL_GLOBAL;
+        _tag->interval = 0;
+        _tag->tolerance = 0;
+        _tag->time_tat = 0;
+        _tag->dropped = 0;
+        elab_atomic_store(&elog_tag_count, elog_tag_count + 1);
+    }
+
+    return _tag;
+}
+
+/**
+  * @brief  Lock the sinks, the tag table and the sync log buffer.
+  */
+static void _elog_lock(void)
+{
+#if (ELAB_RTOS_CMSIS_OS_EN != 0)
+    if (mutex_elog == NULL)
+    {
+        mutex_elog = osMutexNew(&mutex_attr_elog);
+        elab_assert(mutex_elog != NULL);
+    }
+    osMutexAcquire(mutex_elog, osWaitForever);
+#endif
+}
+
+/**
+  * @brief  Unlock the sinks, the tag table and the sync log buffer.
+  */
+static void _elog_unlock(void)
+{
 #if (ELAB_RTOS_CMSIS_OS_EN != 0)
     osMutexRelease(mutex_elog);
 #endif
 }
 
+/**
+  * @brief  Write one text line or one binary frame into the sinks of the level.
+  *         The text line ends with "\r\n". The mutex should be taken.
+  */
+static void _elog_sink_output(uint8_t level, const char *buff, uint32_t size,
+                                bool text)
+{
+    for (elog_sink_t *sink = elog_sink_list; sink != NULL; sink = sink->next)
+    {
+        if (sink->level < level)
+        {
+            continue;
+        }
+#if (ELOG_COLOR_ENABLE != 0)
+        if (text && sink->color)
+        {
+            const char *color = elog_color_table[level];
+            sink->ops->write(sink, color, strlen(color));
+            sink->ops->write(sink, buff, size - 2);
+            sink->ops->write(sink, NONE "\r\n", strlen(NONE "\r\n"));
+            continue;
+        }
+#else
+        (void)text;
+#endif
+        sink->ops->write(sink, buff, size);
+    }
+}
+
+/**
+  * @brief  Update the maximum level of all the sinks. The mutex should be
+  *         taken.
+  */
+static void _elog_sink_level_update(void)
+{
+    uint8_t level = 0;
+
+    for (elog_sink_t *sink = elog_sink_list; sink != NULL; sink = sink->next)
+    {
+        level = (sink->level > level) ? sink->level : level;
+    }
+    elab_atomic_store(&elog_sink_level, level);
+}
+
+/**
+  * @brief  The write function of the console sink.
+  */
+static void _elog_console_write(elog_sink_t *me, const char *buff, uint32_t size)
+{
+    (void)me;
+
+    fwrite(buff, 1, size, stdout);
+}
+
+/**
+  * @brief  The flush function of the console sink.
+  */
+static void _elog_console_flush(elog_sink_t *me)
+{
+    (void)me;
+
+    fflush(stdout);
+}
+
+/**
+  * @brief  Print the log into the sinks in the calling thread.
+  */
+static void _elog_sync_vprintf(const char *name, uint8_t level,
+                                const char *s_format, va_list param_list)
+{
+    _elog_lock();
+
+    /* The room of "\r\n" is kept at the end. */
+    int len = snprintf(_buff, (ELAB_LOG_BUFF_SIZE - 2), "[%c/%s %u] ",
+                        elog_level_lable[level], name, elab_time_ms());
+    len = (len < 0) ? 0 : len;
+    len = (len > (ELAB_LOG_BUFF_SIZE - 3)) ? (ELAB_LOG_BUFF_SIZE - 3) : len;
+    int ret = vsnprintf(&_buff[len], (ELAB_LOG_BUFF_SIZE - 2 - len),
+                        s_format, param_list);
+    if (ret > 0)
+    {
+        len += (ret < (ELAB_LOG_BUFF_SIZE - 2 - len)) ?
+                ret : (ELAB_LOG_BUFF_SIZE - 3 - len);
+    }
+    _buff[len ++] = '\r';
+    _buff[len ++] = '\n';
+    _elog_sink_output(level, _buff, len, true);
+
+    _elog_unlock();
+}
+
+#if (ELOG_ASYNC_EN != 0)
+/**
+  * @brief  Get the check byte of the binary frame head, from the size to the
+  *         time. The same one is in tools/elog_decode.
+  */
+static uint8_t _elog_binary_check(const uint8_t *head)
+{
+    uint8_t check = ELOG_BINARY_SYNC;
+
+    for (uint32_t i = 1; i < (ELOG_BINARY_HEAD_SIZE - 1); i ++)
+    {
+        check = (uint8_t)((check << 1) | (check >> 7)) ^ head[i];
+    }
+
+    return check;
+}
+
+/**
+  * @brief  Encode the raw arguments of the binary log by the format, each one
+  *         in its size in the C ABI, and the strings with their length ahead.
+  *         The arguments out of the buffer are left, as "?" in the decoder.
+  * @retval The encoded size.
+  */
+static uint32_t _elog_binary_encode(uint8_t *buff, uint32_t size,
+                                    const char *s_format, va_list param_list)
+{
+#define ELOG_BINARY_PUT(_type)                                                 \
+    do                                                                         \
+    {                                                                          \
+        _type _value = va_arg(param_list, _type);                              \
+        if ((len + sizeof(_type)) > size)                                      \
+        {                                                                      \
+            return len;                                                        \
+        }                                                                      \
+        memcpy(&buff[len], &_value, sizeof(_type));                            \
+        len += sizeof(_type);                                                  \
+    } while (0)
+
+    uint32_t len = 0;
+    const char *p = s_format;
+
+    while ((p = strchr(p, '%')) != NULL)
+    {
+        p ++;
+
+        /* The flags, the width and the precision. */
+        for (; *p != 0; p ++)
+        {
+            if (*p == '*')
+            {
+                ELOG_BINARY_PUT(int);
+            }
+            else if (strchr("-+ #0123456789.", *p) == NULL)
+            {
+                break;
+            }
+        }
+
+        /* The length: 0 - int, 1 - long, 2 - long long, 3 - size_t. */
+        uint8_t length = 0;
+        bool length_double = false;
+        for (; *p != 0; p ++)
+        {
+            if (*p == 'l')
+            {
+                length ++;
+            }
+            else if (*p == 'j')
+            {
+                length = 2;
+            }
+            else if (*p == 'z' || *p == 't')
+            {
+                length = 3;
+            }
+            else if (*p == 'L')
+            {
+                length_double = true;
+            }
+            else if (*p != 'h')
+            {
+                break;
+            }
+        }
+
+        if (*p == 0)
+        {
+            break;
+        }
+        else if (strchr("diuxXoc", *p) != NULL)
+        {
+            if (length == 0)
+            {
+                ELOG_BINARY_PUT(int);
+            }
+            else if (length == 1)
+            {
+                ELOG_BINARY_PUT(long);
+            }
+            else if (length == 2)
+            {
+                ELOG_BINARY_PUT(long long);
+            }
+            else
+            {
+                ELOG_BINARY_PUT(size_t);
+            }
+        }
+        else if (strchr("fFeEgGaA", *p) != NULL)
+        {
+            double value = length_double ?
+                            (double)va_arg(param_list, long double) :
+                            va_arg(param_list, double);
+            if ((len + sizeof(double)) > size)
+            {
+                break;
+            }
+            memcpy(&buff[len], &value, sizeof(double));
+            len += sizeof(double);
+        }
+        else if (*p == 's')
+        {
+            const char *str = va_arg(param_list, const char *);
+            str = (str == NULL) ? "(null)" : str;
+            uint32_t len_str = strlen(str);
+            len_str = len_str > ELOG_BINARY_STRING_MAX ?
+                        ELOG_BINARY_STRING_MAX : len_str;
+            if ((len + 1 + len_str) > size)
+            {
+                break;
+            }
+            buff[len ++] = (uint8_t)len_str;
+            memcpy(&buff[len], str, len_str);
+            len += len_str;
+        }
+        else if (*p == 'p')
+        {
+            ELOG_BINARY_PUT(void *);
+        }
+        else if (*p != '%')
+        {
+            /* Not supported, like %n. */
+            break;
+        }
+        p ++;
+    }
+
+    return len;
+
+#undef ELOG_BINARY_PUT
+}
+
+/**
+  * @brief  Claim one slot in the ring buffer by CAS on the head. The slot is
+  *         published by its sequence number after being filled, so the loggers
+  *         never wait for each other.
+  * @param  pos     The position of the slot, to publish it.
+  * @retval The slot, or NULL if the record is dropped.
+  */
+static elog_record_t *_elog_async_claim(uint32_t *pos)
+{
+    elog_record_t *record = NULL;
+    uint32_t _pos = elab_atomic_load(&elog_async.head);
+
+    while (1)
+    {
+        record = &elog_async.ring[_pos & (ELOG_ASYNC_RECORD_NUM - 1)];
+        int32_t diff = (int32_t)(elab_atomic_load(&record->seq) - _pos);
+        if (diff == 0)
+        {
+            if (elab_atomic_cas(&elog_async.head, &_pos, _pos + 1))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The ring buffer is full. */
+            if (elog_async.policy == ELOG_ASYNC_OVERWRITE && _elog_async_discard())
+            {
+                elab_atomic_add(&elog_async.stat.overwritten, 1);
+            }
+            else
+            {
+                elab_atomic_add(&elog_async.stat.dropped, 1);
+                return NULL;
+            }
+            _pos = elab_atomic_load(&elog_async.head);
+        }
+        else
+        {
+            _pos = elab_atomic_load(&elog_async.head);
+        }
+    }
+    *pos = _pos;
+
+    return record;
+}
+
+/**
+  * @brief  Get the oldest published record from the ring buffer.
+  * @param  pos     The position of the record, to release it.
+  * @retval The record, or NULL if none is published.
+  */
+static elog_record_t *_elog_async_get(uint32_t *pos)
+{
+    elog_record_t *record = NULL;
+    uint32_t _pos = elab_atomic_load(&elog_async.tail);
+
+    while (1)
+    {
+        record = &elog_async.ring[_pos & (ELOG_ASYNC_RECORD_NUM - 1)];
+        int32_t diff = (int32_t)(elab_atomic_load(&record->seq) - (_pos + 1));
+        if (diff == 0)
+        {
+            if (elab_atomic_cas(&elog_async.tail, &_pos, _pos + 1))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return NULL;
+        }
+        else
+        {
+            _pos = elab_atomic_load(&elog_async.tail);
+        }
+    }
+    *pos = _pos;
+
+    return record;
+}
+
+/**
+  * @brief  Drop the oldest record to make room for the new one.
+  * @retval False if the oldest one is still being formatted.
+  */
+static bool _elog_async_discard(void)
+{
+    uint32_t pos = 0;
+    elog_record_t *record = _elog_async_get(&pos);
+    if (record != NULL)
+    {
+        elab_atomic_store(&record->seq, pos + ELOG_ASYNC_RECORD_NUM);
+    }
+
+    return (record != NULL);
+}
+
+/**
+  * @brief  Flush all the sinks. The mutex should be taken.
+  */
+static void _elog_sink_flush(void)
+{
+    for (elog_sink_t *sink = elog_sink_list; sink != NULL; sink = sink->next)
+    {
+        if (sink->ops->flush != NULL)
+        {
+            sink->ops->flush(sink);
+        }
+    }
+}
+
+/**
+  * @brief  The drain thread, writing the records into the sinks in batches.
+  */
+static void _entry_elog_async(void *para)
+{
+    (void)para;
+
+    char line[ELOG_ASYNC_LINE_SIZE];
+
+    while (elab_atomic_load(&elog_async.running))
+    {
+        elab_atomic_store(&elog_async.draining, true);
+
+        uint32_t count = 0;
+        uint32_t pos = 0;
+        elog_record_t *record = NULL;
+        _elog_lock();
+        while (count < ELOG_ASYNC_BATCH_NUM &&
+                (record = _elog_async_get(&pos)) != NULL)
+        {
+            if (record->tag == NULL)
+            {
+                /* The binary frame: sync, size, ID, time, the head check and
+                   the arguments. The check lets the decoder tell the frame
+                   from the sync byte in the text, like the UTF-8 ones. */
+                line[0] = (char)ELOG_BINARY_SYNC;
+                line[1] = (char)record->size;
+                memcpy(&line[2], &record->id, sizeof(int16_t));
+                memcpy(&line[4], &record->time, sizeof(uint32_t));
+                line[8] = (char)_elog_binary_check((const uint8_t *)line);
+                memcpy(&line[ELOG_BINARY_HEAD_SIZE], record->text, record->size);
+                _elog_sink_output(record->level, line,
+                                    ELOG_BINARY_HEAD_SIZE + record->size, false);
+            }
+            else
+            {
+                int len = snprintf(line, ELOG_ASYNC_LINE_SIZE, "[%c/%s %u] %s\r\n",
+                                    elog_level_lable[record->level],
+                                    record->tag, record->time, record->text);
+                if (len > 0)
+                {
+                    if (len >= ELOG_ASYNC_LINE_SIZE)
+                    {
+                        len = ELOG_ASYNC_LINE_SIZE - 1;
+                        line[len - 2] = '\r';
+                        line[len - 1] = '\n';
+                    }
+                    _elog_sink_output(record->level, line, len, true);
+                }
+            }
+            elab_atomic_store(&record->seq, pos + ELOG_ASYNC_RECORD_NUM);
+            count ++;
+        }
+        if (count > 0)
+        {
+            _elog_sink_flush();
+            elab_atomic_add(&elog_async.stat.written, count);
+        }
+        _elog_unlock();
+
+        elab_atomic_store(&elog_async.draining, false);
+        if (count == 0)
+        {
+            osDelay(ELOG_ASYNC_PERIOD_MS);
+        }
+    }
+}
+#endif
+
 #if !defined(__x86_64__)
 
 #if defined(__CC_ARM) || defined(__CLANG_ARM)
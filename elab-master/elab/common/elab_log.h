@@ -8,6 +8,8 @@
 
 /* includes ----------------------------------------------------------------- */
 #include <stdint.h>
+#include <stdbool.h>
+#include "elab_def.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,6 +17,9 @@ extern "C" {
 
 /* public config ------------------------------------------------------------ */
 #define ELOG_COLOR_ENABLE                           (1)
+#define ELOG_ASYNC_ENABLE                           (1)     /* CMSIS OS only */
+#define ELOG_BINARY_ENABLE                          (0)
+#define ELOG_TAG_NUM_MAX                            (16)
 
 /* public defines ----------------------------------------------------------- */
 /* debug level */
@@ -28,19 +33,114 @@ enum elog_level_enum
     ELOG_LEVEL_MAX,
 };
 
+/* The tag level following elog_level_set(). */
+#define ELOG_LEVEL_GLOBAL                           (0xFF)
+
+#if (ELOG_ASYNC_ENABLE != 0)
+/* The policy when the async ring buffer is full. */
+enum elog_async_policy
+{
+    ELOG_ASYNC_DROP_NEW = 0,                        /* Drop the new record */
+    ELOG_ASYNC_OVERWRITE,                           /* Drop the oldest record */
+
+    ELOG_ASYNC_POLICY_MAX,
+};
+
+typedef struct elog_async_stat
+{
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t overwritten;
+} elog_async_stat_t;
+#endif
+
+/* The format of one binary log, kept in the section elog_fmt. Its ID in the
+   binary record is its offset to elog_fmt_base in 4 bytes. */
+typedef struct elog_fmt
+{
+    const char *tag;
+    const char *format;
+    uint32_t level;
+} elog_fmt_t;
+
+/* One output of the log, like the console, one file or one RAM ring. Each one
+   has its own level, and 0 for disabled. */
+typedef struct elog_sink
+{
+    struct elog_sink *next;
+    const char *name;
+    const struct elog_sink_ops *ops;
+    uint8_t level;
+    bool color;
+} elog_sink_t;
+
+typedef struct elog_sink_ops
+{
+    void (* write)(elog_sink_t *me, const char *buff, uint32_t size);
+    void (* flush)(elog_sink_t *me);                /* Optional */
+} elog_sink_ops_t;
+
 /* public functions --------------------------------------------------------- */
-#define ELAB_TAG(_tag)                  static const char *TAG = _tag
+#define ELAB_TAG(_tag)                  static const char TAG[] ELAB_USED = _tag
 
 void elog_level_set(uint8_t level);
 
+/* The per-tag level and rate limit, looked up by the tag name without any lock
+   in the logging thread, and cached by the TAG pointer. The name is kept, not
+   copied. The rate is in logs per second, and 0 for no limit. */
+void elog_tag_level_set(const char *tag, uint8_t level);
+void elog_tag_rate_set(const char *tag, uint32_t rate, uint32_t burst);
+uint32_t elog_tag_dropped(const char *tag);
+
+/* The sinks, the built-in "console" one printing into stdout. */
+void elog_sink_register(elog_sink_t *me, const char *name,
+                        const elog_sink_ops_t *ops, uint8_t level, bool color);
+void elog_sink_unregister(elog_sink_t *me);
+elog_sink_t *elog_sink_find(const char *name);
+void elog_sink_level_set(elog_sink_t *me, uint8_t level);
+void elog_sink_lock(void);
+void elog_sink_unlock(void);
+
+#if (ELOG_ASYNC_ENABLE != 0)
+/* The async mode, in which the log is formatted into one lock-free ring buffer
+   by the logging thread, and written into the console by one drain thread. */
+void elog_async_start(uint8_t policy);
+void elog_async_stop(void);
+void elog_async_flush(void);
+void elog_async_stat(elog_async_stat_t *stat);
+#endif
+
 #ifndef ELOG_DISABLE
 void _elog_printf(const char *tag, uint8_t level, const char * s_format, ...);
-
+void _elog_binary(const elog_fmt_t *fmt, ...);
+
+extern const elog_fmt_t elog_fmt_base;
+
+/* The binary log, in which only the format ID, the time and the raw arguments
+   are recorded in the async mode, and decoded by tools/elog_decode with the
+   ELF file. Without the async mode, it is printed as the text log. */
+#define elog_binary(_level, _format, ...)                                      \
+    do                                                                         \
+    {                                                                          \
+        ELAB_USED static const elog_fmt_t _elog_fmt ELAB_SECTION("elog_fmt") = \
+        {                                                                      \
+            TAG, _format, _level,                                              \
+        };                                                                     \
+        _elog_binary(&_elog_fmt, ##__VA_ARGS__);                               \
+    } while (0)
+
+#if (ELOG_BINARY_ENABLE == 0)
 /* Enable error level debug message */
 #define elog_error(...)     _elog_printf(TAG, ELOG_LEVEL_ERROR, __VA_ARGS__)
 #define elog_warn(...)      _elog_printf(TAG, ELOG_LEVEL_WARNING, __VA_ARGS__)
 #define elog_info(...)      _elog_printf(TAG, ELOG_LEVEL_INFO, __VA_ARGS__)
 #define elog_debug(...)     _elog_printf(TAG, ELOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define elog_error(...)     elog_binary(ELOG_LEVEL_ERROR, __VA_ARGS__)
+#define elog_warn(...)      elog_binary(ELOG_LEVEL_WARNING, __VA_ARGS__)
+#define elog_info(...)      elog_binary(ELOG_LEVEL_INFO, __VA_ARGS__)
+#define elog_debug(...)     elog_binary(ELOG_LEVEL_DEBUG, __VA_ARGS__)
+#endif
 
 #else
 
@@ -0,0 +1,229 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* include ------------------------------------------------------------------ */
+#include <string.h>
+#include "elab_log_sink.h"
+#include "elab_assert.h"
+
+ELAB_TAG("eLogSink");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define ELOG_SINK_RAM_MAGIC                         (0xE10C5A4DU)
+#define ELOG_SINK_RAM_HEAD_SIZE                     (8)
+
+/* private function prototype ----------------------------------------------- */
+static void _ram_write(elog_sink_t *me, const char *buff, uint32_t size);
+#if defined(__linux__)
+static void _file_write(elog_sink_t *me, const char *buff, uint32_t size);
+static void _file_flush(elog_sink_t *me);
+#endif
+
+/* private variables -------------------------------------------------------- */
+static const elog_sink_ops_t elog_sink_ops_ram =
+{
+    .write = _ram_write,
+    .flush = NULL,
+};
+
+#if defined(__linux__)
+static const elog_sink_ops_t elog_sink_ops_file =
+{
+    .write = _file_write,
+    .flush = _file_flush,
+};
+#endif
+
+/* public functions --------------------------------------------------------- */
+/**
+  * @brief  Initialize the RAM ring sink. The logs in the buffer are kept if it
+  *         is initialized by one RAM sink before.
+  * @param  me      The RAM sink handle.
+  * @param  name    The sink name.
+  * @param  buff    The buffer, 4 bytes aligned.
+  * @param  size    The buffer size.
+  * @param  level   The sink level.
+  * @retval None.
+  */
+void elog_sink_ram_init(elog_sink_ram_t *me, const char *name,
+                        void *buff, uint32_t size, uint8_t level)
+{
+    elab_assert(me != NULL);
+    elab_assert(buff != NULL && ((uintptr_t)buff % 4) == 0);
+    elab_assert(size > ELOG_SINK_RAM_HEAD_SIZE);
+
+    me->head = (uint32_t *)buff;
+    me->data = (char *)buff + ELOG_SINK_RAM_HEAD_SIZE;
+    me->size = size - ELOG_SINK_RAM_HEAD_SIZE;
+    if (me->head[0] != ELOG_SINK_RAM_MAGIC)
+    {
+        elog_sink_ram_clear(me);
+    }
+
+    elog_sink_register(&me->super, name, &elog_sink_ops_ram, level, false);
+}
+
+/**
+  * @brief  Unregister the RAM ring sink. The logs are kept in the buffer.
+  * @param  me      The RAM sink handle.
+  * @retval None.
+  */
+void elog_sink_ram_deinit(elog_sink_ram_t *me)
+{
+    elab_assert(me != NULL);
+
+    elog_sink_unregister(&me->super);
+}
+
+/**
+  * @brief  Read the latest logs in the RAM ring sink, in the written order.
+  * @param  me      The RAM sink handle.
+  * @param  buff    The output buffer.
+  * @param  size    The output buffer size.
+  * @retval The read size.
+  */
+uint32_t elog_sink_ram_read(elog_sink_ram_t *me, void *buff, uint32_t size)
+{
+    elab_assert(me != NULL);
+    elab_assert(buff != NULL);
+
+    /* The drain thread or the logging ones write the ring in the lock. */
+    elog_sink_lock();
+    uint32_t count = me->head[1];
+    uint32_t len = (count < me->size) ? count : me->size;
+    len = (len < size) ? len : size;
+
+    uint32_t start = (count - len) % me->size;
+    uint32_t len_first = me->size - start;
+    if (len_first >= len)
+    {
+        memcpy(buff, &me->data[start], len);
+    }
+    else
+    {
+        memcpy(buff, &me->data[start], len_first);
+        memcpy((char *)buff + len_first, me->data, len - len_first);
+    }
+    elog_sink_unlock();
+
+    return len;
+}
+
+/**
+  * @brief  Clear the logs in the RAM ring sink.
+  * @param  me      The RAM sink handle.
+  * @retval None.
+  */
+void elog_sink_ram_clear(elog_sink_ram_t *me)
+{
+    elab_assert(me != NULL);
+
+    elog_sink_lock();
+    me->head[0] = ELOG_SINK_RAM_MAGIC;
+    me->head[1] = 0;
+    elog_sink_unlock();
+}
+
+#if defined(__linux__)
+/**
+  * @brief  Initialize the file sink, appending the logs into the file.
+  * @param  me      The file sink handle.
+  * @param  name    The sink name.
+  * @param  path    The file path.
+  * @param  level   The sink level.
+  * @retval See elab_err_t.
+  */
+elab_err_t elog_sink_file_init(elog_sink_file_t *me, const char *name,
+                                const char *path, uint8_t level)
+{
+    elab_assert(me != NULL);
+    elab_assert(path != NULL);
+
+    me->fp = fopen(path, "ab");
+    if (me->fp == NULL)
+    {
+        return ELAB_ERR_IO;
+    }
+
+    /* The sync logs are written line by line. */
+    setvbuf(me->fp, NULL, _IOLBF, BUFSIZ);
+    elog_sink_register(&me->super, name, &elog_sink_ops_file, level, false);
+
+    return ELAB_OK;
+}
+
+/**
+  * @brief  Unregister the file sink and close the file.
+  * @param  me      The file sink handle.
+  * @retval None.
+  */
+void elog_sink_file_deinit(elog_sink_file_t *me)
+{
+    elab_assert(me != NULL && me->fp != NULL);
+
+    elog_sink_unregister(&me->super);
+    fclose(me->fp);
+    me->fp = NULL;
+}
+#endif
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  The write function of the RAM ring sink.
+  */
+static void _ram_write(elog_sink_t *me, const char *buff, uint32_t size)
+{
+    elog_sink_ram_t *sink = (elog_sink_ram_t *)me;
+
+    /* Only the tail of the data is kept if it is larger than the ring. */
+    uint32_t count = sink->head[1];
+    if (size > sink->size)
+    {
+        count += size - sink->size;
+        buff += size - sink->size;
+        size = sink->size;
+    }
+
+    uint32_t start = count % sink->size;
+    uint32_t len_first = sink->size - start;
+    if (len_first >= size)
+    {
+        memcpy(&sink->data[start], buff, size);
+    }
+    else
+    {
+        memcpy(&sink->data[start], buff, len_first);
+        memcpy(sink->data, &buff[len_first], size - len_first);
+    }
+    sink->head[1] = count + size;
+}
+
+#if defined(__linux__)
+/**
+  * @brief  The write function of the file sink.
+  */
+static void _file_write(elog_sink_t *me, const char *buff, uint32_t size)
+{
+    fwrite(buff, 1, size, ((elog_sink_file_t *)me)->fp);
+}
+
+/**
+  * @brief  The flush function of the file sink.
+  */
+static void _file_flush(elog_sink_t *me)
+{
+    fflush(((elog_sink_file_t *)me)->fp);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
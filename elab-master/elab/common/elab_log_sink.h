@@ -0,0 +1,61 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#ifndef ELAB_LOG_SINK_H_
+#define ELAB_LOG_SINK_H_
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include "elab_def.h"
+#include "elab_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* public typedef ----------------------------------------------------------- */
+/* The RAM ring sink, keeping the latest logs. Its head is kept in the buffer
+   too, so the logs before one reset are kept if the buffer is not cleared by
+   the startup code, like in one .noinit section. */
+typedef struct elog_sink_ram
+{
+    elog_sink_t super;
+
+    uint32_t *head;                 /* The magic and the written count */
+    char *data;
+    uint32_t size;
+} elog_sink_ram_t;
+
+#if defined(__linux__)
+/* The file sink on the hosted platforms. */
+typedef struct elog_sink_file
+{
+    elog_sink_t super;
+
+    FILE *fp;
+} elog_sink_file_t;
+#endif
+
+/* public functions --------------------------------------------------------- */
+void elog_sink_ram_init(elog_sink_ram_t *me, const char *name,
+                        void *buff, uint32_t size, uint8_t level);
+void elog_sink_ram_deinit(elog_sink_ram_t *me);
+uint32_t elog_sink_ram_read(elog_sink_ram_t *me, void *buff, uint32_t size);
+void elog_sink_ram_clear(elog_sink_ram_t *me);
+
+#if defined(__linux__)
+elab_err_t elog_sink_file_init(elog_sink_file_t *me, const char *name,
+                                const char *path, uint8_t level);
+void elog_sink_file_deinit(elog_sink_file_t *me);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ELAB_LOG_SINK_H_ */
+
+/* ----------------------------- end of file -------------------------------- */
@@ -7,6 +7,7 @@
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,8 @@ ELAB_TAG("Bsp-Serial-Linux");
 static elab_err_t _enable(elab_serial_t *serial, bool status);
 static int32_t _read(elab_serial_t *serial, void *buffer, uint32_t size);
 static int32_t _write(elab_serial_t *serial, const void *buffer, uint32_t size);
+static int32_t _writev(elab_serial_t *serial,
+                        const elab_serial_iovec_t *iov, uint32_t iovcnt);
 static void _set_tx(elab_serial_t *serial, bool status);
 static elab_err_t _config(elab_serial_t *serial, elab_serial_config_t *config);
 static bool _checkout_name_valid(char *name);
@@ -33,6 +36,7 @@ static elab_serial_ops_t _serial_ops =
     .enable = _enable,
     .read = _read,
     .write = _write,
+    .writev = _writev,
     .set_tx = _set_tx,
     .config = _config,
 };
@@ -128,6 +132,39 @@ static int32_t _write(elab_serial_t *serial, const void *buffer, uint32_t size)
     else
     {
         ret = ret_w;
+        elab_serial_tx_end(serial);
+    }
+
+    return ret;
+}
+
+static int32_t _writev(elab_serial_t *serial,
+                        const elab_serial_iovec_t *iov, uint32_t iovcnt)
+{
+    elab_assert(iovcnt <= ELAB_SERIAL_IOV_MAX);
+
+    driver_uart_t *driver = (driver_uart_t *)serial->super.user_data;
+    struct iovec _iov[ELAB_SERIAL_IOV_MAX];
+    for (uint32_t i = 0; i < iovcnt; i ++)
+    {
+        _iov[i].iov_base = (void *)iov[i].buff;
+        _iov[i].iov_len = iov[i].size;
+    }
+
+    int32_t ret = ELAB_OK;
+    int32_t ret_w = writev(driver->serial_fd, _iov, iovcnt);
+    /* Wait the data transmitted completely. */
+#if defined(__x86_64__) || defined(__i386__)
+    tcdrain(driver->serial_fd);
+#endif
+    if (ret_w < 0)
+    {
+        ret = ELAB_ERROR;
+    }
+    else
+    {
+        ret = ret_w;
+        elab_serial_tx_end(serial);
     }
 
     return ret;
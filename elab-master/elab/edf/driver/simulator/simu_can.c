@@ -0,0 +1,645 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* include ------------------------------------------------------------------ */
+#include <string.h>
+#include <time.h>
+#include "simu_can.h"
+#include "../../../common/elab_def.h"
+#include "../../../elib/hash_table.h"
+#include "../../normal/elab_can.h"
+#include "../../../common/elab_common.h"
+#include "../../../common/elab_assert.h"
+#include "../../../common/elab_export.h"
+
+ELAB_TAG("CanDriverSimu");
+
+/* Private config ----------------------------------------------------------- */
+#define SIMU_CAN_HASH_TABLE_SIZE            (16)
+#define SIMU_CAN_BUFF_SIZE                  (64)        /* In messages */
+#define SIMU_CAN_PERIOD_MS                  (10)
+
+/* Private defines ---------------------------------------------------------- */
+#define SIMU_CAN_FRAME_BITS_MAX             (160)
+#define SIMU_CAN_CRC_POLY                   (0x4599)
+/* The CRC delimiter, the ACK slot and delimiter, the EOF and the IFS. */
+#define SIMU_CAN_TAIL_BITS                  (1 + 2 + 7 + 3)
+/* The error flag, the error delimiter and the IFS. */
+#define SIMU_CAN_ERROR_BITS                 (6 + 8 + 3)
+
+/* Private typedef ---------------------------------------------------------- */
+typedef struct simu_can_node
+{
+    elab_can_t device;
+
+    const char *name;
+    struct simu_can_bus *bus;
+    struct simu_can_node *next;
+    bool enable;
+    bool loopback;
+
+    /* The only mailbox, written by the sending thread when it is empty, and
+       emptied by the bus thread. */
+    bool pending;
+    elab_can_msg_t msg;
+    uint64_t time_queued;
+
+    simu_can_node_stat_t stat;
+} simu_can_node_t;
+
+typedef struct simu_can_bus
+{
+    const char *name;
+    uint32_t bitrate;
+    simu_can_node_t *node_list;
+    simu_can_node_t *node_sending;          /* The node of the frame on the bus */
+
+    osMutexId_t mutex;
+    osSemaphoreId_t sem;
+    osThreadId_t thread;
+    bool running;
+    bool hold;
+
+    uint32_t error_ppm;
+    uint32_t error_inject;
+    uint32_t seed;
+
+    uint64_t time_ns;                       /* The end of the last frame */
+    uint64_t time_reset_ns;
+    simu_can_bus_stat_t stat;
+} simu_can_bus_t;
+
+/* Private function prototype ----------------------------------------------- */
+static elab_err_t _enable(elab_can_t * const me, bool status);
+static elab_err_t _config(elab_can_t * const me, elab_can_config_t *config);
+static void _send(elab_can_t * const me, const elab_can_msg_t *msg);
+static void _entry_bus(void *para);
+static uint32_t _frame_bits(const elab_can_msg_t *msg);
+static uint32_t _frame_arbitration(const elab_can_msg_t *msg);
+static uint32_t _random(simu_can_bus_t *bus);
+static uint64_t _time_ns(void);
+static simu_can_bus_t *_bus_get(const char *name);
+
+/* Private variables -------------------------------------------------------- */
+static hash_table_t *ht_simu_can = NULL;
+
+static const struct elab_can_ops _can_ops =
+{
+    .send_busy = NULL,
+    .enable = _enable,
+    .config = _config,
+    .send = _send,
+    .recv = NULL,
+    .config_filter = NULL,
+};
+
+static const osMutexAttr_t mutex_attr_simu_can =
+{
+    "MutexSimuCan",
+    osMutexRecursive | osMutexPrioInherit,
+    NULL,
+    0U
+};
+
+static const osThreadAttr_t thread_attr_simu_can =
+{
+    .name = "ThreadSimuCanBus",
+    .attr_bits = osThreadJoinable,
+    .priority = osPriorityRealtime,
+    .stack_size = 2048,
+};
+
+/* Public function ---------------------------------------------------------- */
+static void simu_can_export(void)
+{
+    if (ht_simu_can == NULL)
+    {
+        ht_simu_can = hash_table_new(SIMU_CAN_HASH_TABLE_SIZE);
+        elab_assert(ht_simu_can != NULL);
+    }
+}
+INIT_EXPORT(simu_can_export, EXPORT_LEVEL_HW_INDEPNEDENT);
+
+/**
+  * @brief  Newly create one simulated CAN bus.
+  * @param  name        Name of the CAN bus.
+  * @param  bitrate     The bit rate in bits/s, for all the nodes on it.
+  * @retval None.
+  */
+void simu_can_bus_new(const char *name, uint32_t bitrate)
+{
+    elab_assert(name != NULL);
+    elab_assert(bitrate != 0);
+    simu_can_export();
+    assert_name(!hash_table_existent(ht_simu_can, (char *)name), name);
+
+    simu_can_bus_t *bus = elab_malloc(sizeof(simu_can_bus_t));
+    assert_name(bus != NULL, name);
+    memset(bus, 0, sizeof(simu_can_bus_t));
+
+    bus->name = name;
+    bus->bitrate = bitrate;
+    bus->seed = 0x12345678;
+    bus->time_ns = _time_ns();
+    bus->time_reset_ns = bus->time_ns;
+    bus->mutex = osMutexNew(&mutex_attr_simu_can);
+    assert_name(bus->mutex != NULL, name);
+    bus->sem = osSemaphoreNew(1, 0, NULL);
+    assert_name(bus->sem != NULL, name);
+
+    elab_err_t ret = hash_table_add(ht_simu_can, (char *)name, bus);
+    assert_name(ret == ELAB_OK, name);
+
+    bus->running = true;
+    bus->thread = osThreadNew(_entry_bus, bus, &thread_attr_simu_can);
+    assert_name(bus->thread != NULL, name);
+}
+
+/**
+  * @brief  Destroy one simulated CAN bus, after all its nodes are destroyed.
+  * @param  name        Name of the CAN bus.
+  * @retval None.
+  */
+void simu_can_bus_destroy(const char *name)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+    assert_name(bus->node_list == NULL, name);
+
+    elab_atomic_store(&bus->running, false);
+    osSemaphoreRelease(bus->sem);
+    osThreadJoin(bus->thread);
+
+    osStatus_t ret_os = osMutexDelete(bus->mutex);
+    elab_assert(ret_os == osOK);
+    ret_os = osSemaphoreDelete(bus->sem);
+    elab_assert(ret_os == osOK);
+
+    elab_assert(hash_table_remove(ht_simu_can, (char *)name) == ELAB_OK);
+    elab_free(bus);
+}
+
+/**
+  * @brief  Hold the bus busy, so the frames are queued to contend for the bus
+  *         when it is released.
+  * @param  name        Name of the CAN bus.
+  * @param  status      Hold or release.
+  * @retval None.
+  */
+void simu_can_bus_hold(const char *name, bool status)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    bus->hold = status;
+    osMutexRelease(bus->mutex);
+    osSemaphoreRelease(bus->sem);
+}
+
+/**
+  * @brief  Set the rate of the random errors. The error frame is sent at one
+  *         random bit of the frame, and the frame is sent again.
+  * @param  name        Name of the CAN bus.
+  * @param  ppm         The error frames in one million frames.
+  * @retval None.
+  */
+void simu_can_bus_error_rate(const char *name, uint32_t ppm)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+    assert_name(ppm <= 1000000, name);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    bus->error_ppm = ppm;
+    osMutexRelease(bus->mutex);
+}
+
+/**
+  * @brief  Make the next frames on the bus broken.
+  * @param  name        Name of the CAN bus.
+  * @param  count       The count of the broken frames.
+  * @retval None.
+  */
+void simu_can_bus_error_inject(const char *name, uint32_t count)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    bus->error_inject += count;
+    osMutexRelease(bus->mutex);
+}
+
+/**
+  * @brief  Get the statistics of the bus since the last reset.
+  * @param  name        Name of the CAN bus.
+  * @param  stat        The statistics output.
+  * @retval None.
+  */
+void simu_can_bus_stat(const char *name, simu_can_bus_stat_t *stat)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+    assert_name(stat != NULL, name);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    *stat = bus->stat;
+    uint64_t time_end = _time_ns();
+    time_end = (bus->time_ns > time_end) ? bus->time_ns : time_end;
+    osMutexRelease(bus->mutex);
+
+    stat->time_total_us = (time_end - bus->time_reset_ns) / 1000;
+    stat->load = (stat->time_total_us == 0) ? 0 :
+                    (uint32_t)(stat->time_busy_us * 10000 / stat->time_total_us);
+}
+
+/**
+  * @brief  Reset the statistics of the bus and its nodes.
+  * @param  name        Name of the CAN bus.
+  * @retval None.
+  */
+void simu_can_bus_stat_reset(const char *name)
+{
+    simu_can_bus_t *bus = _bus_get(name);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    memset(&bus->stat, 0, sizeof(simu_can_bus_stat_t));
+    bus->time_reset_ns = _time_ns();
+    bus->time_reset_ns = (bus->time_ns > bus->time_reset_ns) ?
+                            bus->time_ns : bus->time_reset_ns;
+    for (simu_can_node_t *node = bus->node_list; node != NULL; node = node->next)
+    {
+        memset(&node->stat, 0, sizeof(simu_can_node_stat_t));
+    }
+    osMutexRelease(bus->mutex);
+}
+
+/**
+  * @brief  Newly create one simulated CAN node on the bus.
+  * @param  name        Name of the CAN node.
+  * @param  name_bus    Name of the CAN bus.
+  * @retval None.
+  */
+void simu_can_new(const char *name, const char *name_bus)
+{
+    elab_assert(name != NULL);
+    simu_can_bus_t *bus = _bus_get(name_bus);
+
+    simu_can_node_t *node = elab_malloc(sizeof(simu_can_node_t));
+    assert_name(node != NULL, name);
+    memset(node, 0, sizeof(simu_can_node_t));
+    node->name = name;
+    node->bus = bus;
+
+    elab_can_attr_t attr =
+    {
+        .user_data = node,
+        .buff_size_send = SIMU_CAN_BUFF_SIZE,
+        .buff_size_recv = SIMU_CAN_BUFF_SIZE,
+    };
+    node->device.ops = &_can_ops;
+    elab_can_register(&node->device, name, &attr, node);
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    node->next = bus->node_list;
+    bus->node_list = node;
+    osMutexRelease(bus->mutex);
+}
+
+/**
+  * @brief  Destroy one simulated CAN node. It should be closed.
+  * @param  name        Name of the CAN node.
+  * @retval None.
+  */
+void simu_can_destroy(const char *name)
+{
+    elab_device_t *dev = elab_device_find(name);
+    assert_name(dev != NULL, name);
+    simu_can_node_t *node = (simu_can_node_t *)dev->user_data;
+    simu_can_bus_t *bus = node->bus;
+
+    osMutexAcquire(bus->mutex, osWaitForever);
+    simu_can_node_t **link = &bus->node_list;
+    while (*link != node)
+    {
+        link = &(*link)->next;
+    }
+    *link = node->next;
+    if (bus->node_sending == node)
+    {
+        bus->node_sending = NULL;
+    }
+    osMutexRelease(bus->mutex);
+
+    elab_can_unregister(&node->device);
+    elab_free(node);
+}
+
+/**
+  * @brief  Get the statistics of one CAN node since the last reset of its bus.
+  * @param  name        Name of the CAN node.
+  * @param  stat        The statistics output.
+  * @retval None.
+  */
+void simu_can_stat(const char *name, simu_can_node_stat_t *stat)
+{
+    elab_device_t *dev = elab_device_find(name);
+    assert_name(dev != NULL, name);
+    assert_name(stat != NULL, name);
+    simu_can_node_t *node = (simu_can_node_t *)dev->user_data;
+
+    osMutexAcquire(node->bus->mutex, osWaitForever);
+    *stat = node->stat;
+    osMutexRelease(node->bus->mutex);
+}
+
+/* Private functions -------------------------------------------------------- */
+static elab_err_t _enable(elab_can_t * const me, bool status)
+{
+    simu_can_node_t *node = (simu_can_node_t *)me->super.user_data;
+
+    /* Called in registering, before the user data is set. */
+    if (node != NULL)
+    {
+        osMutexAcquire(node->bus->mutex, osWaitForever);
+        node->enable = status;
+        node->pending = false;
+        if (node->bus->node_sending == node)
+        {
+            node->bus->node_sending = NULL;
+        }
+        osMutexRelease(node->bus->mutex);
+    }
+
+    return ELAB_OK;
+}
+
+static elab_err_t _config(elab_can_t * const me, elab_can_config_t *config)
+{
+    simu_can_node_t *node = (simu_can_node_t *)me->super.user_data;
+
+    /* The bit rate is the one of the bus. */
+    if (node != NULL)
+    {
+        node->loopback = (config->mode == ELAB_CAN_MODE_LOOPBACK);
+    }
+
+    return ELAB_OK;
+}
+
+static void _send(elab_can_t * const me, const elab_can_msg_t *msg)
+{
+    simu_can_node_t *node = (simu_can_node_t *)me->super.user_data;
+
+    /* Only called when the mailbox is empty, so no lock is needed. */
+    node->msg = *msg;
+    node->time_queued = _time_ns();
+    elab_atomic_store(&node->pending, true);
+    osSemaphoreRelease(node->bus->sem);
+}
+
+/**
+  * @brief  The bus thread, sending the frames one by one in the bus time. The
+  *         bus time is kept ahead of the real time by the frame time, and it is
+  *         waited for when it is ahead over one tick.
+  */
+static void _entry_bus(void *para)
+{
+    simu_can_bus_t *bus = (simu_can_bus_t *)para;
+
+    while (elab_atomic_load(&bus->running))
+    {
+        osMutexAcquire(bus->mutex, osWaitForever);
+
+        /* The arbitration, the lowest value wins. */
+        simu_can_node_t *winner = NULL;
+        uint32_t arbitration = 0;
+        uint32_t count_contend = 0;
+        uint32_t count_enable = 0;
+        for (simu_can_node_t *node = bus->node_list; node != NULL; node = node->next)
+        {
+            count_enable += node->enable ? 1 : 0;
+            if (bus->hold || !node->enable || !elab_atomic_load(&node->pending))
+            {
+                continue;
+            }
+            count_contend ++;
+            uint32_t value = _frame_arbitration(&node->msg);
+            if (winner == NULL || value < arbitration)
+            {
+                winner = node;
+                arbitration = value;
+            }
+        }
+        if (winner == NULL)
+        {
+            osMutexRelease(bus->mutex);
+            osSemaphoreAcquire(bus->sem, SIMU_CAN_PERIOD_MS);
+            continue;
+        }
+        for (simu_can_node_t *node = bus->node_list; node != NULL; node = node->next)
+        {
+            if (node != winner && node->enable && elab_atomic_load(&node->pending))
+            {
+                node->stat.arbitration_lost ++;
+            }
+        }
+        bus->stat.arbitration_lost += count_contend - 1;
+
+        /* The frame starts when the bus is idle. */
+        uint64_t time_now = _time_ns();
+        bus->time_ns = (bus->time_ns > time_now) ? bus->time_ns : time_now;
+
+        /* Without any receiver, the ACK slot is recessive. */
+        uint32_t bits = _frame_bits(&winner->msg);
+        bool error = false;
+        if (count_enable < 2 && !winner->loopback)
+        {
+            error = true;
+            bits = bits - SIMU_CAN_TAIL_BITS + 2 + SIMU_CAN_ERROR_BITS;
+        }
+        else if (bus->error_inject > 0 ||
+                    (bus->error_ppm != 0 && (_random(bus) % 1000000) < bus->error_ppm))
+        {
+            bus->error_inject -= (bus->error_inject > 0) ? 1 : 0;
+            error = true;
+            bits = 1 + (_random(bus) % (bits - SIMU_CAN_TAIL_BITS)) + SIMU_CAN_ERROR_BITS;
+        }
+        uint64_t time = (uint64_t)bits * 1000000000ULL / bus->bitrate;
+        bus->time_ns += time;
+        bus->stat.bits += bits;
+        bus->stat.time_busy_us = bus->stat.bits * 1000000ULL / bus->bitrate;
+
+        /* Wait for the real time without the lock, so the users of the bus are
+           not blocked for the frame time. The frame is dropped if its node is
+           disabled or destroyed in the meantime. */
+        bus->node_sending = winner;
+        time_now = _time_ns();
+        if (bus->time_ns > (time_now + 1000000))
+        {
+            osMutexRelease(bus->mutex);
+            osDelay((uint32_t)((bus->time_ns - time_now) / 1000000));
+            osMutexAcquire(bus->mutex, osWaitForever);
+        }
+        if (bus->node_sending != winner)
+        {
+            osMutexRelease(bus->mutex);
+            continue;
+        }
+        bus->node_sending = NULL;
+
+        if (error)
+        {
+            bus->stat.errors ++;
+            winner->stat.errors ++;
+            osMutexRelease(bus->mutex);
+            continue;
+        }
+
+        bus->stat.frames ++;
+        winner->stat.sent ++;
+        uint32_t latency = (uint32_t)((bus->time_ns - winner->time_queued) / 1000);
+        winner->stat.latency_total_us += latency;
+        if (latency > winner->stat.latency_max_us)
+        {
+            winner->stat.latency_max_us = latency;
+        }
+
+        elab_can_msg_t msg = winner->msg;
+        elab_atomic_store(&winner->pending, false);
+        for (simu_can_node_t *node = bus->node_list; node != NULL; node = node->next)
+        {
+            if (node->enable && (node != winner || node->loopback))
+            {
+                elab_can_isr_recv(&node->device, &msg);
+            }
+        }
+
+        /* The next frame of the node may be put into the mailbox. */
+        elab_can_isr_send_end(&winner->device);
+        osMutexRelease(bus->mutex);
+    }
+}
+
+/**
+  * @brief  The bits of the frame on the bus, with the stuff bits, from the SOF
+  *         to the end of the IFS.
+  */
+static uint32_t _frame_bits(const elab_can_msg_t *msg)
+{
+    uint8_t bits[SIMU_CAN_FRAME_BITS_MAX];
+    uint32_t count = 0;
+
+#define FRAME_PUT(_value, _width)                                              \
+    do                                                                         \
+    {                                                                          \
+        for (int32_t _i = (_width) - 1; _i >= 0; _i --)                        \
+        {                                                                      \
+            bits[count ++] = (uint8_t)(((_value) >> _i) & 1);                  \
+        }                                                                      \
+    } while (0)
+
+    /* SOF, arbitration field and control field. */
+    FRAME_PUT(0, 1);
+    if (msg->ide == 0)
+    {
+        FRAME_PUT(msg->id, 11);
+        FRAME_PUT(msg->rtr, 1);
+        FRAME_PUT(0, 2);                                /* IDE, r0 */
+    }
+    else
+    {
+        FRAME_PUT(msg->id >> 18, 11);
+        FRAME_PUT(3, 2);                                /* SRR, IDE */
+        FRAME_PUT(msg->id, 18);
+        FRAME_PUT(msg->rtr, 1);
+        FRAME_PUT(0, 2);                                /* r1, r0 */
+    }
+    uint32_t length = (msg->length > 8) ? 8 : msg->length;
+    FRAME_PUT(length, 4);
+    for (uint32_t i = 0; msg->rtr == 0 && i < length; i ++)
+    {
+        FRAME_PUT(msg->data[i], 8);
+    }
+
+    /* CRC-15 */
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        uint32_t bit = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        crc ^= bit ? SIMU_CAN_CRC_POLY : 0;
+    }
+    FRAME_PUT(crc, 15);
+
+#undef FRAME_PUT
+
+    /* One stuff bit after 5 same bits, which starts the next run. */
+    uint32_t count_stuff = 0;
+    uint32_t run = 1;
+    uint8_t last = bits[0];
+    for (uint32_t i = 1; i < count; i ++)
+    {
+        run = (bits[i] == last) ? (run + 1) : 1;
+        last = bits[i];
+        if (run == 5)
+        {
+            count_stuff ++;
+            last = !last;
+            run = 1;
+        }
+    }
+
+    return count + count_stuff + SIMU_CAN_TAIL_BITS;
+}
+
+/**
+  * @brief  The arbitration value of the frame, the bits in the order on the
+  *         bus: the base ID, the RTR or SRR, the IDE, the extended ID and the
+  *         RTR of the extended frame.
+  */
+static uint32_t _frame_arbitration(const elab_can_msg_t *msg)
+{
+    if (msg->ide == 0)
+    {
+        return ((msg->id & 0x7FF) << 21) | (msg->rtr << 20);
+    }
+
+    return (((msg->id >> 18) & 0x7FF) << 21) | (3 << 19) |
+            ((msg->id & 0x3FFFF) << 1) | msg->rtr;
+}
+
+/**
+  * @brief  The xorshift random number, repeatable for the same bus.
+  */
+static uint32_t _random(simu_can_bus_t *bus)
+{
+    bus->seed ^= bus->seed << 13;
+    bus->seed ^= bus->seed >> 17;
+    bus->seed ^= bus->seed << 5;
+
+    return bus->seed;
+}
+
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+static simu_can_bus_t *_bus_get(const char *name)
+{
+    elab_assert(name != NULL);
+    elab_assert(ht_simu_can != NULL);
+
+    simu_can_bus_t *bus = hash_table_get(ht_simu_can, (char *)name);
+    assert_name(bus != NULL, name);
+
+    return bus;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,64 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(_WIN32) || defined(__linux__)
+
+#ifndef DRV_SIMU_CAN_H
+#define DRV_SIMU_CAN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported typedef ----------------------------------------------------------*/
+typedef struct simu_can_bus_stat
+{
+    uint32_t frames;                        /* The frames sent successfully */
+    uint32_t errors;                        /* The error frames */
+    uint32_t arbitration_lost;
+    uint64_t bits;                          /* The bits on the bus */
+    uint64_t time_busy_us;
+    uint64_t time_total_us;                 /* Since the last reset */
+    uint32_t load;                          /* The bus load in 0.01% */
+} simu_can_bus_stat_t;
+
+typedef struct simu_can_node_stat
+{
+    uint32_t sent;
+    uint32_t errors;
+    uint32_t arbitration_lost;
+    uint32_t latency_max_us;                /* From sending to the frame end */
+    uint64_t latency_total_us;
+} simu_can_node_stat_t;
+
+/* Exported function ---------------------------------------------------------*/
+/* The virtual CAN bus, on which the nodes send the frames by the arbitration
+   of the IDs, in the time of the bit rate with the stuff bits. */
+void simu_can_bus_new(const char *name, uint32_t bitrate);
+void simu_can_bus_destroy(const char *name);
+void simu_can_bus_hold(const char *name, bool status);
+void simu_can_bus_error_rate(const char *name, uint32_t ppm);
+void simu_can_bus_error_inject(const char *name, uint32_t count);
+void simu_can_bus_stat(const char *name, simu_can_bus_stat_t *stat);
+void simu_can_bus_stat_reset(const char *name);
+
+/* The CAN node, registered as one elab_can device with the same name. */
+void simu_can_new(const char *name, const char *name_bus);
+void simu_can_destroy(const char *name);
+void simu_can_stat(const char *name, simu_can_node_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DRV_SIMU_CAN_H */
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
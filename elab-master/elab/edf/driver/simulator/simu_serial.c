@@ -49,6 +49,9 @@ static int32_t _write(elab_serial_t *serial, const void *buffer, uint32_t size);
 static elab_err_t _config(elab_serial_t *puart_dev,
                                 elab_serial_config_t *pcfg);
 static void _set_tx(elab_serial_t *serial, bool status);
+static void _queue_put(osMessageQueueId_t queue, const void *buffer, uint32_t size);
+static uint32_t _queue_get(osMessageQueueId_t queue, void *buffer,
+                            uint32_t size, uint32_t timeout_ms);
 
 /* Private variables -------------------------------------------------------- */
 hash_table_t *ht_simu = NULL;
@@ -234,13 +237,7 @@ void simu_serial_make_rx_data(const char *name, void *buffer, uint32_t size)
     elab_assert(serial->mode == SIMU_SERIAL_MODE_SINGLE);
 
 #if defined(__linux__) || defined(_WIN32)
-    osStatus_t ret_os = osOK;
-    uint8_t *buff = (uint8_t *)buffer;
-    for (uint32_t i = 0; i < size; i ++)
-    {
-        ret_os = osMessageQueuePut(serial->queue_rx, &buff[i], 0, osWaitForever);
-        elab_assert(ret_os == osOK);
-    }
+    _queue_put(serial->queue_rx, buffer, size);
 #else
     dev_serial_isr_rx(&serial->device, buffer, size);
 #endif
@@ -287,38 +284,10 @@ int32_t simu_serial_read_tx_data(const char *name,
     int32_t ret = ELAB_ERR_TIMEOUT;
     elab_assert(serial->mode == SIMU_SERIAL_MODE_SINGLE);
 
-    ret = ELAB_ERR_TIMEOUT;
-    osStatus_t ret_os = osOK;
-
-    uint8_t *buff = (uint8_t *)buffer;
-    uint32_t time_start = osKernelGetTickCount();
-    uint32_t time = timeout_ms;
-    for (uint32_t i = 0; i < size; i ++)
+    uint32_t count = _queue_get(serial->queue_tx, buffer, size, timeout_ms);
+    if (count > 0)
     {
-        if (timeout_ms != osWaitForever && timeout_ms != 0)
-        {
-            if ((osKernelGetTickCount() - time_start) < timeout_ms)
-            {
-                time = time_start + timeout_ms - osKernelGetTickCount();
-            }
-            else
-            {
-                break;
-            }
-        }
-        ret_os = osMessageQueueGet(serial->queue_tx, &buff[i], NULL, time);
-        if (ret_os == osOK)
-        {
-            ret = (ret == ELAB_ERR_TIMEOUT) ? 1 : (ret + 1);
-        }
-        else if (ret_os == osErrorTimeout)
-        {
-            break;
-        }
-        else
-        {
-            elab_assert(false);
-        }
+        ret = (int32_t)count;
     }
 
 exit:
@@ -359,26 +328,9 @@ static elab_err_t _enable(elab_serial_t *serial, bool status)
   */
 static int32_t _read(elab_serial_t *serial, void *pbuf, uint32_t size)
 {
-    osStatus_t ret = osOK;
-
     simu_serial_t *simu_serial = container_of(serial, simu_serial_t, device);
 
-    uint32_t read_cnt = 0;
-    uint8_t *buffer = (uint8_t *)pbuf;
-    buffer[0] = 0;
-    for (uint32_t i = 0; i < size; i ++)
-    {
-        ret = osMessageQueueGet(simu_serial->queue_rx,
-                                &buffer[i], NULL, osWaitForever);
-        if (ret != osOK)
-        {
-            break;
-        }
-        read_cnt ++;
-    }
-
-exit:
-    return read_cnt;
+    return _queue_get(simu_serial->queue_rx, pbuf, size, osWaitForever);
 }
 #endif
 
@@ -402,13 +354,7 @@ static int32_t _write(elab_serial_t *serial, const void *pbuf, uint32_t size)
     if (simu_serial->mode == SIMU_SERIAL_MODE_SINGLE)
     {
         /* Write the buffer data into message queue. */
-        uint8_t *buffer = (uint8_t *)pbuf;
-        for (uint32_t i = 0; i < size; i ++)
-        {
-            ret = osMessageQueuePut(simu_serial->queue_tx,
-                                    &buffer[i], 0, osWaitForever);
-            elab_assert(ret == osOK);
-        }
+        _queue_put(simu_serial->queue_tx, pbuf, size);
     }
     else if (simu_serial->mode == SIMU_SERIAL_MODE_UART ||
              simu_serial->mode == SIMU_SERIAL_MODE_485_S)
@@ -418,12 +364,7 @@ static int32_t _write(elab_serial_t *serial, const void *pbuf, uint32_t size)
         elab_assert(ret == osOK);
 
         /* Write the buffer data into message queue. */
-        uint8_t *buffer = (uint8_t *)pbuf;
-        for (uint32_t i = 0; i < size; i ++)
-        {
-            ret = osMessageQueuePut(partner->queue_rx, &buffer[i], 0, osWaitForever);
-            elab_assert(ret == osOK);
-        }
+        _queue_put(partner->queue_rx, pbuf, size);
 
         ret = osMutexRelease(partner->mutex);
         elab_assert(ret == osOK);
@@ -438,12 +379,7 @@ static int32_t _write(elab_serial_t *serial, const void *pbuf, uint32_t size)
             elab_assert(ret == osOK);
 
             /* Write the buffer data into message queue. */
-            uint8_t *buffer = (uint8_t *)pbuf;
-            for (uint32_t i = 0; i < size; i ++)
-            {
-                ret = osMessageQueuePut(slave->queue_rx, &buffer[i], 0, osWaitForever);
-                elab_assert(ret == osOK);
-            }
+            _queue_put(slave->queue_rx, pbuf, size);
 
             ret = osMutexRelease(slave->mutex);
             elab_assert(ret == osOK);
@@ -483,6 +419,77 @@ static void _set_tx(elab_serial_t *serial, bool status)
     (void)status;
 }
 
+/**
+  * @brief  Put the data into the message queue of the simulated serial port.
+  * @param  queue   The message queue.
+  * @param  buffer  The data buffer.
+  * @param  size    The buffer size.
+  * @retval None.
+  */
+static void _queue_put(osMessageQueueId_t queue, const void *buffer, uint32_t size)
+{
+#if defined(__linux__)
+    /* All the data is put in batches, waking up the reader once per batch. */
+    int32_t ret = osMessageQueuePutN(queue, buffer, size, 0, osWaitForever);
+    elab_assert(ret == (int32_t)size);
+#else
+    osStatus_t ret_os = osOK;
+    const uint8_t *buff = (const uint8_t *)buffer;
+    for (uint32_t i = 0; i < size; i ++)
+    {
+        ret_os = osMessageQueuePut(queue, &buff[i], 0, osWaitForever);
+        elab_assert(ret_os == osOK);
+    }
+#endif
+}
+
+/**
+  * @brief  Get the data from the message queue of the simulated serial port.
+  * @param  queue       The message queue.
+  * @param  buffer      The data buffer.
+  * @param  size        The buffer size.
+  * @param  timeout_ms  Timeout of the whole getting in mili-second.
+  * @retval The actual got data size.
+  */
+static uint32_t _queue_get(osMessageQueueId_t queue, void *buffer,
+                            uint32_t size, uint32_t timeout_ms)
+{
+    uint8_t *buff = (uint8_t *)buffer;
+    uint32_t time_start = osKernelGetTickCount();
+    uint32_t time = timeout_ms;
+    uint32_t count = 0;
+    int32_t ret = 0;
+
+    while (count < size)
+    {
+        if (timeout_ms != osWaitForever && timeout_ms != 0)
+        {
+            if ((osKernelGetTickCount() - time_start) < timeout_ms)
+            {
+                time = time_start + timeout_ms - osKernelGetTickCount();
+            }
+            else
+            {
+                break;
+            }
+        }
+#if defined(__linux__)
+        ret = osMessageQueueGetN(queue, &buff[count], (size - count), NULL, time);
+#else
+        ret = (int32_t)osMessageQueueGet(queue, &buff[count], NULL, time);
+        ret = (ret == osOK) ? 1 : ret;
+#endif
+        if (ret == osErrorTimeout || ret == osErrorResource)
+        {
+            break;
+        }
+        elab_assert(ret > 0);
+        count += ret;
+    }
+
+    return count;
+}
+
 #endif
 
 /* ----------------------------- end of file -------------------------------- */
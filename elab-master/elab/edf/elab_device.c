@@ -7,20 +7,52 @@
 #include "elab_device.h"
 #include "elab_device_def.h"
 #include "../common/elab_assert.h"
+#include "../common/elab_common.h"
 #include "../common/elab_log.h"
 #include "../os/cmsis_os.h"
 
 ELAB_TAG("EdfDevice");
 
+/* private config ----------------------------------------------------------- */
+#define ELAB_DEV_INDEX_CAPACITY_MIN     (ELAB_DEV_NUM_MAX * 2)
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct elab_dev_slot
+{
+    uint32_t hash;
+    elab_device_t *device;
+} elab_dev_slot_t;
+
+/**
+ * The device name index, in open addressing and linear probing. The capacity is
+ * always the power of 2, and at least half of the slots are kept empty.
+ */
+typedef struct elab_dev_index
+{
+    struct elab_dev_index *next;                /* The next retired index */
+    uint32_t capacity;
+    uint32_t count_used;                        /* Devices and deleted slots */
+    elab_dev_slot_t slot[];
+} elab_dev_index_t;
+
 /* private function prototypes ---------------------------------------------- */
 static void _add_device(elab_device_t *me);
+static elab_dev_slot_t *_find_slot(elab_device_t *me);
+static elab_dev_index_t *_index_rebuild(uint32_t count);
+static void _index_reclaim(void);
+static uint32_t _hash_name(const char *name);
 static osMutexId_t _edf_mutex(void);
 
 /* private variables -------------------------------------------------------- */
 static uint32_t _edf_device_count = 0;
-static elab_device_t *_edf_table[ELAB_DEV_NUM_MAX];
+static elab_dev_index_t *_edf_index = NULL;
+static elab_dev_index_t *_edf_index_retired = NULL;
+static uint32_t _edf_readers = 0;
+static uint8_t _edf_slot_deleted;
 static osMutexId_t _mutex_edf = NULL;
 
+#define ELAB_DEV_SLOT_DELETED           ((elab_device_t *)&_edf_slot_deleted)
+
 /**
  * The edf global mutex attribute.
  */
@@ -44,7 +76,6 @@ void elab_device_register(elab_device_t *me, elab_device_attr_t *attr)
     assert(me != NULL);
     assert(attr != NULL);
     assert(attr->name != NULL);
-    assert_name(elab_device_find(attr->name) == NULL, attr->name);
 
     /* Edf mutex locking. */
     osStatus_t ret = osOK;
@@ -56,11 +87,11 @@ void elab_device_register(elab_device_t *me, elab_device_attr_t *attr)
     memcpy(&me->attr, attr, sizeof(elab_device_attr_t));
     me->enable_count = 0;
     me->lock_count = 0;
+    me->thread_test = NULL;
     me->mutex = osMutexNew(&_mutex_attr_edf);
     assert(me->mutex != NULL);
 
-    /* Add the device the edf table. */
-    memcpy(&me->attr, attr, sizeof(elab_device_attr_t));
+    /* Add the device the edf index. */
     _add_device(me);
 
     /* Edf mutex unlocking. */
@@ -84,18 +115,19 @@ void elab_device_unregister(elab_device_t *me)
     ret = osMutexAcquire(mutex, osWaitForever);
     assert(ret == osOK);
 
-    for (uint32_t i = 0; i < ELAB_DEV_NUM_MAX; i ++)
+    elab_dev_slot_t *slot = _find_slot(me);
+    if (slot != NULL)
     {
-        if (_edf_table[i] == me)
-        {
-            osStatus_t ret = osMutexDelete(me->mutex);
-            elab_assert(ret == osOK);
-            me->mutex = NULL;
-            _edf_table[i] = NULL;
-            _edf_device_count --;
-            break;
-        }
+        osStatus_t ret = osMutexDelete(me->mutex);
+        elab_assert(ret == osOK);
+        me->mutex = NULL;
+
+        /* The slot is marked as deleted but not empty, to keep the probing
+           sequences of the other devices unbroken. */
+        elab_atomic_store(&slot->device, ELAB_DEV_SLOT_DELETED);
+        elab_atomic_store(&_edf_device_count, _edf_device_count - 1);
     }
+    _index_reclaim();
 
     /* Edf mutex unlocking. */
     ret = osMutexRelease(mutex);
@@ -108,21 +140,7 @@ void elab_device_unregister(elab_device_t *me)
  */
 uint32_t elab_device_get_number(void)
 {
-    uint32_t num = 0;
-
-    /* Edf mutex locking. */
-    osStatus_t ret = osOK;
-    osMutexId_t mutex = _edf_mutex();
-    ret = osMutexAcquire(mutex, osWaitForever);
-    assert(ret == osOK);
-
-    num = _edf_device_count;
-
-    /* Edf mutex unlocking. */
-    ret = osMutexRelease(mutex);
-    assert(ret == osOK);
-
-    return num;
+    return elab_atomic_load(&_edf_device_count);
 }
 
 /**
@@ -133,56 +151,58 @@ uint32_t elab_device_get_number(void)
  */
 bool elab_device_of_name(elab_device_t *me, const char *name)
 {
-    bool of_the_name = false;
-
-    elab_device_lock(me);
-    if (strcmp(me->attr.name, name) == 0)
-    {
-        of_the_name = true;
-    }
-    elab_device_unlock(me);
-
-    return of_the_name;
+    /* The attribute is never changed after registering. */
+    return (strcmp(me->attr.name, name) == 0) ? true : false;
 }
 
 /**
- * This function finds a device driver by specified name.
+ * This function finds a device driver by specified name. The lookup is lock-free
+ * and does not block the device registering or unregistering.
  * @param name  Device name.
  * @return Device handle. If not found, return NULL.
  */
 elab_device_t *elab_device_find(const char *name)
 {
-    if (_edf_table[0] != NULL)
-    assert_name(_edf_table[0]->attr.name != NULL, name);
     assert(name != NULL);
-    
-    /* Edf mutex locking. */
-    osStatus_t ret = osOK;
-    osMutexId_t mutex = _edf_mutex();
-    ret = osMutexAcquire(mutex, osWaitForever);
-    assert(ret == osOK);
 
-    /* Find the device */
     elab_device_t *me = NULL;
-    for (uint32_t i = 0; i < ELAB_DEV_NUM_MAX; i++)
+    elab_device_t *device = NULL;
+    uint32_t hash = _hash_name(name);
+
+    /* The reader counting prevents the index from being freed in the lookup. */
+    elab_atomic_add(&_edf_readers, 1);
+
+    elab_dev_index_t *index = elab_atomic_load(&_edf_index);
+    if (index == NULL)
     {
-        /* No device yet in the device table. */
-        if (_edf_table[i] == NULL)
+        goto exit;
+    }
+
+    uint32_t mask = index->capacity - 1;
+    for (uint32_t i = (hash & mask), n = 0; n < index->capacity;
+            i = ((i + 1) & mask), n ++)
+    {
+        device = elab_atomic_load(&index->slot[i].device);
+        /* No device with the given name in the index. */
+        if (device == NULL)
         {
             break;
         }
-        elab_assert(_edf_table[i]->attr.name != NULL);
+        if (device == ELAB_DEV_SLOT_DELETED)
+        {
+            continue;
+        }
         /* Device matching */
-        if (strcmp(_edf_table[i]->attr.name, name) == 0)
+        if (elab_atomic_load(&index->slot[i].hash) == hash &&
+            strcmp(device->attr.name, name) == 0)
         {
-            me = _edf_table[i];
+            me = device;
             break;
         }
     }
 
-    /* Edf mutex unlocking. */
-    ret = osMutexRelease(mutex);
-    assert(ret == osOK);
+exit:
+    elab_atomic_sub(&_edf_readers, 1);
 
     return me;
 }
@@ -204,11 +224,8 @@ bool elab_device_valid(const char *name)
  */
 bool elab_device_is_sole(elab_device_t *me)
 {
-    elab_device_lock(me);
-    bool enable_status = me->attr.sole;
-    elab_device_unlock(me);
-
-    return enable_status;
+    /* The attribute is never changed after registering. */
+    return me->attr.sole;
 }
 
 /**
@@ -218,7 +235,7 @@ bool elab_device_is_sole(elab_device_t *me)
  */
 bool elab_device_is_test_mode(elab_device_t *dev)
 {
-    return (dev->thread_test != NULL) ? true : false;
+    return (elab_atomic_load(&dev->thread_test) != NULL) ? true : false;
 }
 
 /**
@@ -230,9 +247,7 @@ void elab_device_set_test_mode(elab_device_t *dev)
 {
     elab_assert(dev != NULL);
 
-    elab_device_lock(dev);
-    dev->thread_test = osThreadGetId();
-    elab_device_unlock(dev);
+    elab_atomic_store(&dev->thread_test, osThreadGetId());
 }
 
 /**
@@ -244,9 +259,7 @@ void elab_device_set_normal_mode(elab_device_t *dev)
 {
     elab_assert(dev != NULL);
 
-    elab_device_lock(dev);
-    dev->thread_test = NULL;
-    elab_device_unlock(dev);
+    elab_atomic_store(&dev->thread_test, NULL);
 }
 
 /**
@@ -258,11 +271,7 @@ bool elab_device_is_enabled(elab_device_t *me)
 {
     assert(me != NULL);
 
-    elab_device_lock(me);
-    bool enable_status = me->enable_count > 0 ? true : false;
-    elab_device_unlock(me);
-
-    return enable_status;
+    return (elab_atomic_load(&me->enable_count) > 0) ? true : false;
 }
 
 /**
@@ -319,16 +328,26 @@ elab_err_t __device_enable(elab_device_t *me, bool status)
         assert_name(me->enable_count < UINT8_MAX, me->attr.name);
     }
     
+    /* Published after the driver enabling, and before the driver disabling,
+       see the device state contract. */
     elab_err_t ret = ELAB_OK;
-    if (status && me->enable_count == 0)
+    if (status)
     {
-        ret = me->ops->enable(me, true);
+        if (me->enable_count == 0)
+        {
+            ret = me->ops->enable(me, true);
+        }
+        elab_atomic_store(&me->enable_count, me->enable_count + 1);
     }
-    else if (!status && me->enable_count == 1)
+    else
     {
-        ret = me->ops->enable(me, false);
+        uint8_t count = me->enable_count - 1;
+        elab_atomic_store(&me->enable_count, count);
+        if (count == 0)
+        {
+            ret = me->ops->enable(me, false);
+        }
     }
-    me->enable_count = status ? (me->enable_count + 1) : (me->enable_count - 1);
 
     elab_device_unlock(me);
 
@@ -349,12 +368,12 @@ int32_t elab_device_read(elab_device_t *me,
                             uint32_t pos, void *buffer, uint32_t size)
 {
     assert(me != NULL);
-    assert(me->enable_count != 0);
+    assert(elab_atomic_load(&me->enable_count) != 0);
     assert(me->ops != NULL);
     assert(me->ops->read != NULL);
 
     int32_t ret = 0;
-    if (elab_device_is_test_mode(me))
+    if (elab_atomic_load(&me->thread_test) != NULL)
     {
         ret = ELAB_OK;
         goto exit;
@@ -380,12 +399,12 @@ int32_t elab_device_write(elab_device_t *me,
                             uint32_t pos, const void *buffer, uint32_t size)
 {
     assert(me != NULL);
-    assert(me->enable_count != 0);
+    assert(elab_atomic_load(&me->enable_count) != 0);
     assert(me->ops != NULL);
     assert(me->ops->write != NULL);
 
     int32_t ret = 0;
-    if (elab_device_is_test_mode(me))
+    if (elab_atomic_load(&me->thread_test) != NULL)
     {
         ret = ELAB_OK;
         goto exit;
@@ -409,18 +428,192 @@ static osMutexId_t _edf_mutex(void)
     return _mutex_edf;
 }
 
+/**
+ * @brief Add the device into the edf index, in which the edf mutex is locked.
+ * @param me    Device handle.
+ * @retval None.
+ */
 static void _add_device(elab_device_t *me)
 {
-    assert(_edf_device_count < ELAB_DEV_NUM_MAX);
+    uint32_t hash = _hash_name(me->attr.name);
+    elab_dev_index_t *index = _edf_index;
+    elab_dev_slot_t *slot_free = NULL;
+    elab_device_t *device = NULL;
+
+    /* Keep at least half of the slots empty, or the index is rebuilt. */
+    if (index == NULL || ((index->count_used + 1) * 2) > index->capacity)
+    {
+        index = _index_rebuild(_edf_device_count + 1);
+    }
 
-    if (_edf_device_count == 0)
+    uint32_t mask = index->capacity - 1;
+    for (uint32_t i = (hash & mask); ; i = ((i + 1) & mask))
     {
-        for (uint32_t i = 0; i < ELAB_DEV_NUM_MAX; i ++)
+        device = index->slot[i].device;
+        if (device == NULL)
         {
-            _edf_table[i] = NULL;
+            if (slot_free == NULL)
+            {
+                slot_free = &index->slot[i];
+                index->count_used ++;
+            }
+            break;
+        }
+        if (device == ELAB_DEV_SLOT_DELETED)
+        {
+            /* The first deleted slot is reused. */
+            if (slot_free == NULL)
+            {
+                slot_free = &index->slot[i];
+            }
+            continue;
+        }
+        assert_name(index->slot[i].hash != hash ||
+                    strcmp(device->attr.name, me->attr.name) != 0,
+                    me->attr.name);
+    }
+
+    /* The hash value is published before the device, the lookup reading the
+       device then gets the right hash value. */
+    elab_atomic_store(&slot_free->hash, hash);
+    elab_atomic_store(&slot_free->device, me);
+    elab_atomic_store(&_edf_device_count, _edf_device_count + 1);
+}
+
+/**
+ * @brief Find the index slot of the given device, in which the edf mutex is
+ *        locked.
+ * @param me    Device handle.
+ * @retval The slot, or NULL if not found.
+ */
+static elab_dev_slot_t *_find_slot(elab_device_t *me)
+{
+    elab_dev_slot_t *slot = NULL;
+    elab_dev_index_t *index = _edf_index;
+    if (index == NULL)
+    {
+        goto exit;
+    }
+
+    uint32_t mask = index->capacity - 1;
+    for (uint32_t i = (_hash_name(me->attr.name) & mask), n = 0;
+            n < index->capacity; i = ((i + 1) & mask), n ++)
+    {
+        if (index->slot[i].device == NULL)
+        {
+            break;
+        }
+        if (index->slot[i].device == me)
+        {
+            slot = &index->slot[i];
+            break;
+        }
+    }
+
+exit:
+    return slot;
+}
+
+/**
+ * @brief Rebuild the edf index with the capacity for the given device number,
+ *        and the deleted slots are dropped. The new index is published to the
+ *        lookup, and the old one is retired.
+ * @param count     The device number.
+ * @retval The new index.
+ */
+static elab_dev_index_t *_index_rebuild(uint32_t count)
+{
+    elab_dev_index_t *index_old = _edf_index;
+    elab_dev_index_t *index = NULL;
+    elab_device_t *device = NULL;
+    uint32_t capacity = 16;
+    uint32_t i = 0;
+
+    while (capacity < ELAB_DEV_INDEX_CAPACITY_MIN || capacity < (count * 4))
+    {
+        capacity <<= 1;
+    }
+    index = elab_malloc(sizeof(elab_dev_index_t) +
+                        sizeof(elab_dev_slot_t) * capacity);
+    elab_assert(index != NULL);
+    memset(index, 0, sizeof(elab_dev_index_t) +
+                        sizeof(elab_dev_slot_t) * capacity);
+    index->capacity = capacity;
+
+    if (index_old != NULL)
+    {
+        for (uint32_t j = 0; j < index_old->capacity; j ++)
+        {
+            device = index_old->slot[j].device;
+            if (device == NULL || device == ELAB_DEV_SLOT_DELETED)
+            {
+                continue;
+            }
+            i = index_old->slot[j].hash & (capacity - 1);
+            while (index->slot[i].device != NULL)
+            {
+                i = (i + 1) & (capacity - 1);
+            }
+            index->slot[i] = index_old->slot[j];
+            index->count_used ++;
         }
     }
-    _edf_table[_edf_device_count ++] = me;
+
+    elab_atomic_store(&_edf_index, index);
+
+    if (index_old != NULL)
+    {
+        index_old->next = _edf_index_retired;
+        _edf_index_retired = index_old;
+    }
+    _index_reclaim();
+
+    return index;
+}
+
+/**
+ * @brief Free the retired indexes if no lookup is ongoing. The lookup started
+ *        before the new index publishing may be still walking on them, so they
+ *        are kept until the next chance otherwise.
+ * @retval None.
+ */
+static void _index_reclaim(void)
+{
+    elab_dev_index_t *index = NULL;
+
+    elab_atomic_fence();
+    if (elab_atomic_load(&_edf_readers) != 0)
+    {
+        goto exit;
+    }
+
+    while (_edf_index_retired != NULL)
+    {
+        index = _edf_index_retired;
+        _edf_index_retired = index->next;
+        elab_free(index);
+    }
+
+exit:
+    return;
+}
+
+/**
+ * @brief The FNV-1a hash function for the device name.
+ * @param name  Device name.
+ * @retval The hash value.
+ */
+static uint32_t _hash_name(const char *name)
+{
+    uint32_t hash = 2166136261U;
+
+    while (*name != 0)
+    {
+        hash ^= (uint8_t)(*name ++);
+        hash *= 16777619U;
+    }
+
+    return hash;
 }
 
 /* ----------------------------- end of file -------------------------------- */
@@ -18,6 +18,8 @@ extern "C" {
 #endif
 
 /* public config ------------------------------------------------------------ */
+/* The initial capacity of the device registry, which is NOT the upper limit
+   of the device number. The registry grows when more devices are registered. */
 #define ELAB_DEV_NUM_MAX                (64)
 #define ELAB_DEV_PALTFORM               ELAB_PALTFORM_RTOS
 
@@ -82,6 +84,18 @@ typedef struct elab_driver
     bool enabled;
 } elab_driver_t;
 
+/**
+ * The device state memory-ordering contract:
+ * 1. attr is written before the device is published in the registry, and never
+ *    changed after that, so it is read without any locking.
+ * 2. enable_count is only changed in opening and closing, under the device
+ *    mutex. It is stored in release order after the driver enabling, and
+ *    before the driver disabling in the last closing. The read in acquire
+ *    order sees the driver in the enabled state if it is non-zero.
+ * 3. thread_test is stored in release and loaded in acquire order.
+ * So the state querying functions and the reading/writing dispatch are
+ * wait-free, and the device mutex is only for the opening/closing transitions.
+ */
 typedef struct elab_device
 {
     elab_device_attr_t attr;
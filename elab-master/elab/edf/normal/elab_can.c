@@ -7,6 +7,7 @@
 #include <string.h>
 #include "elab_can.h"
 #include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,10 +15,39 @@ extern "C" {
 
 ELAB_TAG("Edf_CAN");
 
+/* private config ----------------------------------------------------------- */
+#define ELAB_CAN_FILTER_LIST_MIN                (8)     /* Power of 2 */
+
+/* private defines ---------------------------------------------------------- */
+#define ELAB_CAN_KEY_IDE                        (1U << 29)
+#define ELAB_CAN_KEY_EMPTY                      (0xFFFFFFFFU)
+
+/* private typedef ---------------------------------------------------------- */
+/* The filter key is the CAN ID with the IDE bit. The list mode keys are kept
+   in one hash set by linear probing, and the mask mode ones in one table of
+   the key and mask pairs. */
+struct elab_can_filter_set
+{
+    uint32_t *list;
+    uint32_t list_mask;
+    uint32_t list_shift;
+    uint32_t *mask;
+    uint32_t count_mask;
+};
+
 /* private function prototype ----------------------------------------------- */
+void elab_device_unregister(elab_device_t *me);
+
 /* Interface functions. */
 static elab_err_t _can_enable(elab_device_t * const me, bool status);
 
+static bool _can_filter_pass(elab_can_t * const me, const elab_can_msg_t *msg);
+static void _can_filter_compile(elab_can_t * const me);
+static void _can_send_kick(elab_can_t * const me);
+#if defined(__linux__) || defined(_WIN32)
+static void _thread_entry_recv(void *parameter);
+#endif
+
 /* private variables -------------------------------------------------------- */
 static const elab_dev_ops_t can_ops =
 {
@@ -29,6 +59,16 @@ static const elab_dev_ops_t can_ops =
 #endif
 };
 
+#if defined(__linux__) || defined(_WIN32)
+static const osThreadAttr_t thread_attr_can_recv =
+{
+    .name = "ThreadCanRecv",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityRealtime,
+    .stack_size = 2048,
+};
+#endif
+
 /* public function ---------------------------------------------------------- */
 void elab_can_register(elab_can_t * const me, const char * name,
                         elab_can_attr_t *attr, void *user_data)
@@ -38,15 +78,30 @@ void elab_can_register(elab_can_t * const me, const char * name,
     assert_name(me != NULL, name);
     assert_name(attr != NULL, name);
     assert_name(me->ops != NULL, name);
+    assert_name(me->ops->send != NULL, name);
     assert_name(attr->buff_size_send != 0, name);
     assert_name(attr->buff_size_recv != 0, name);
 
-    /* The message queue initializations. */
-#if !defined(__linux__) && !defined(_WIN32)
-    me->mq_recv = osMessageQueueNew(attr->buff_size_recv,
-                                    sizeof(elab_can_msg_t), NULL);
-    elab_assert(me->mq_recv != NULL);
-#endif
+    /* The ring buffers initializations. The lwrb ring buffer always keeps one
+       byte empty. */
+    uint32_t size_recv = attr->buff_size_recv * sizeof(elab_can_msg_t) + 1;
+    uint32_t size_send = attr->buff_size_send * sizeof(elab_can_msg_t) + 1;
+    me->buff_recv = elab_malloc(size_recv);
+    assert_name(me->buff_recv != NULL, name);
+    lwrb_init(&me->rb_recv, me->buff_recv, size_recv);
+    me->buff_send = elab_malloc(size_send);
+    assert_name(me->buff_send != NULL, name);
+    lwrb_init(&me->rb_send, me->buff_send, size_send);
+    me->sem_recv = osSemaphoreNew(1, 0, NULL);
+    assert_name(me->sem_recv != NULL, name);
+    me->mutex_send = osMutexNew(NULL);
+    assert_name(me->mutex_send != NULL, name);
+
+    me->filter_list = NULL;
+    me->filter_set = NULL;
+    me->filter_users = 0;
+    me->sending = false;
+    memset(&me->stat, 0, sizeof(elab_can_stat_t));
 
     /* Configure CAN bus as default and disable the ISR. */
     const elab_can_config_t config_default =
@@ -68,81 +123,136 @@ void elab_can_register(elab_can_t * const me, const char * name,
     };
     elab_device_register(&me->super, &can_device_attr);
     me->super.user_data = user_data;
+
+#if defined(__linux__) || defined(_WIN32)
+    me->thread_recv = NULL;
+    if (me->ops->recv != NULL)
+    {
+        me->thread_recv = osThreadNew(_thread_entry_recv, me, &thread_attr_can_recv);
+        assert_name(me->thread_recv != NULL, name);
+    }
+#endif
 }
 
-#if !defined(__linux__) && !defined(_WIN32)
+void elab_can_unregister(elab_can_t * const me)
+{
+    elab_assert(me != NULL);
+    elab_assert(!elab_device_is_enabled(&me->super));
+
+    osStatus_t ret_os = osOK;
+
+#if defined(__linux__) || defined(_WIN32)
+    if (me->thread_recv != NULL)
+    {
+        ret_os = osThreadTerminate(me->thread_recv);
+        elab_assert(ret_os == osOK);
+        me->thread_recv = NULL;
+    }
+#endif
+
+    elab_device_lock(me);
+
+    ret_os = osSemaphoreDelete(me->sem_recv);
+    elab_assert(ret_os == osOK);
+    me->sem_recv = NULL;
+    ret_os = osMutexDelete(me->mutex_send);
+    elab_assert(ret_os == osOK);
+    me->mutex_send = NULL;
+
+    lwrb_free(&me->rb_recv);
+    lwrb_free(&me->rb_send);
+    elab_free(me->buff_recv);
+    me->buff_recv = NULL;
+    elab_free(me->buff_send);
+    me->buff_send = NULL;
+
+    if (me->filter_set != NULL)
+    {
+        elab_free(me->filter_set);
+        me->filter_set = NULL;
+    }
+    me->filter_list = NULL;
+
+    elab_device_unlock(me);
+
+    elab_device_unregister(&me->super);
+}
+
+/**
+  * @brief  Put one received message into the rx ring buffer, called in the
+  *         ISR of the driver, or in the driver thread on the hosted platforms.
+  *         The message is dropped if it does not pass the software filters or
+  *         the rx ring buffer is full.
+  * @param  me      CAN device handle.
+  * @param  msg     The received message.
+  * @retval None.
+  */
 void elab_can_isr_recv(elab_can_t * const me, elab_can_msg_t *msg)
 {
     /* Check the parameters are valid or not. */
     elab_assert(me != NULL);
-    assert_name(msg != NULL, me->super.name);
-    assert_name(me->ops != NULL, me->super.name);
-    assert_name(me->ops->isr_enable != NULL, me->super.name);
+    assert_name(msg != NULL, me->super.attr.name);
 
-    /* Check the filter. */
-    bool valid = false;
-    if (me->ops->config_filter == NULL)         /* If soft filter. */
+    if (!elab_device_is_enabled(&me->super))
     {
-        elab_can_filter_t *filter = me->filter_list;
-        while (filter != NULL)
-        {
-            if ((filter->id & filter->mask) == (msg->id & filter->mask))
-            {
-                valid = true;
-                break;
-            }
-            filter = filter->next;
-        }
+        return;
     }
 
-    if (valid)
+    if (!_can_filter_pass(me, msg))
     {
-        /* Push the CAN message into buffer. */
-        eio_can_buff_t *buff = &me->buff_receive;
-        me->ops->isr_enable(me, false);
-        assert_name(_buff_remaining(buff) > 0, me->super.name);
-        buff->msg[buff->head] = *msg;
-        buff->head = (buff->head + 1) % buff->size;
-        me->ops->isr_enable(me, true);
-
-        /* Send the event of message received. */
-        eio_event_publish(&me->super, EIO_CAN_EVT_MESSAGE_RECEIVED);
+        elab_atomic_add(&me->stat.filtered, 1);
+    }
+    else if (lwrb_get_free(&me->rb_recv) < sizeof(elab_can_msg_t))
+    {
+        elab_atomic_add(&me->stat.overrun, 1);
+    }
+    else
+    {
+        /* The message is published at once by the writing pointer. The
+           semaphore is binary, so releasing it again is harmless. */
+        lwrb_write(&me->rb_recv, msg, sizeof(elab_can_msg_t));
+        elab_atomic_add(&me->stat.recv, 1);
+        osSemaphoreRelease(me->sem_recv);
     }
 }
 
+/**
+  * @brief  Inform the CAN device that the sending message is sent, and send
+  *         the next ones in the tx ring buffer.
+  * @param  me      CAN device handle.
+  * @retval None.
+  */
 void elab_can_isr_send_end(elab_can_t * const me)
 {
     /* Check the parameters are valid or not. */
     elab_assert(me != NULL);
-    assert_name(me->ops != NULL);
-    assert_name(me->ops->isr_enable != NULL);
-    assert_name(me->ops->send != NULL);
+    assert_name(me->ops != NULL, me->super.attr.name);
+
+    elab_can_msg_t msg;
 
+    /* The sending flag is held until the tx ring buffer is empty. */
     while (1)
     {
-        eio_can_buff_t *buff = &me->buff_send;
-        if (_buff_empty(buff))
+        if (lwrb_read(&me->rb_send, &msg, sizeof(elab_can_msg_t)) !=
+            sizeof(elab_can_msg_t))
         {
-            me->sending = false;
+            elab_atomic_store(&me->sending, false);
+
+            /* One message may be put just before the flag is cleared. */
+            _can_send_kick(me);
             break;
         }
 
-        /* Get one message from the sending buffer and send it. */
-        me->ops->send(me, &buff->msg[buff->tail]);
-        buff->tail = (buff->tail + 1) % buff->size;
+        me->ops->send(me, &msg);
+        elab_atomic_add(&me->stat.sent, 1);
 
-        /* Check the CAN bus is busy. */
-        if (me->ops->send_busy == NULL)
-        {
-            break;
-        }
-        if (me->ops->send_busy(me))
+        /* Fill the other mailboxes if the CAN bus is not busy. */
+        if (me->ops->send_busy == NULL || me->ops->send_busy(me))
         {
             break;
         }
     }
 }
-#endif
 
 void elab_can_config(elab_device_t * const me, elab_can_config_t *config)
 {
@@ -164,50 +274,124 @@ void elab_can_config(elab_device_t * const me, elab_can_config_t *config)
     }
 }
 
-void elab_can_send(elab_device_t * const me, const elab_can_msg_t *msg)
+/**
+  * @brief  Put one message into the tx ring buffer, and start sending if the
+  *         CAN bus is idle.
+  * @param  me      CAN device handle.
+  * @param  msg     The message.
+  * @retval ELAB_OK, or ELAB_ERR_FULL if the tx ring buffer is full.
+  */
+elab_err_t elab_can_send(elab_device_t * const me, const elab_can_msg_t *msg)
 {
-    int32_t ret = 0;
-    
+    elab_err_t ret = ELAB_OK;
+
     /* Check the parameters are valid or not. */
-    assert_name(me != NULL, me->attr.name);
+    elab_assert(me != NULL);
     assert_name(msg != NULL, me->attr.name);
+    assert_name(msg->length <= 8, me->attr.name);
 
     /* CAN type cast. */
     elab_can_t *can = (elab_can_t *)me;
     assert_name(can->ops != NULL, me->attr.name);
 
-#if !defined(__linux__) && !defined(_WIN32)
+    /* The threads are the producers of the tx ring buffer one by one. */
+    osStatus_t ret_os = osMutexAcquire(can->mutex_send, osWaitForever);
+    elab_assert(ret_os == osOK);
+    if (lwrb_get_free(&can->rb_send) < sizeof(elab_can_msg_t))
+    {
+        elab_atomic_add(&can->stat.dropped, 1);
+        ret = ELAB_ERR_FULL;
+    }
+    else
+    {
+        lwrb_write(&can->rb_send, msg, sizeof(elab_can_msg_t));
+    }
+    ret_os = osMutexRelease(can->mutex_send);
+    elab_assert(ret_os == osOK);
 
-#else
-    can->ops->send(can, msg);
-#endif
+    _can_send_kick(can);
+
+    return ret;
 }
 
 int32_t elab_can_recv(elab_device_t * const me, elab_can_msg_t *msg)
 {
-    int32_t ret = 0;
-    
+    return elab_can_recv_n(me, msg, 1, osWaitForever);
+}
+
+/**
+  * @brief  Read the received messages in batch. It waits for the first one,
+  *         and returns all the ones already received. Only one thread may read
+  *         one CAN device at the same time.
+  * @param  me      CAN device handle.
+  * @param  msg     The message buffer.
+  * @param  count   The message buffer size in messages.
+  * @param  timeout The timeout of waiting for the first message.
+  * @retval The read count, or ELAB_ERR_TIMEOUT.
+  */
+int32_t elab_can_recv_n(elab_device_t * const me, elab_can_msg_t *msg,
+                        uint32_t count, uint32_t timeout)
+{
     /* Check the parameters are valid or not. */
-    assert_name(me != NULL, me->attr.name);
+    elab_assert(me != NULL);
     assert_name(msg != NULL, me->attr.name);
+    assert_name(count != 0, me->attr.name);
 
     /* CAN type cast. */
     elab_can_t *can = (elab_can_t *)me;
-    assert_name(can->ops != NULL, me->attr.name);
 
-#if !defined(__linux__) && !defined(_WIN32)
-    osStatus_t ret_os = osOK;
-    ret_os = osMessageQueueGet(&can->mq_recv, msg, NULL, osWaitForever);
-    elab_assert(ret_os == osOK);
-    ret = 1;
-#else
-    ret = can->ops->recv(can, msg);
-#endif
+    int32_t ret = 0;
+    uint32_t time_start = osKernelGetTickCount();
+    uint32_t time = timeout;
+    uint32_t time_elapsed = 0;
+
+    while (1)
+    {
+        /* The messages are always written and read as a whole. */
+        ret = (int32_t)(lwrb_read(&can->rb_recv, msg,
+                                    count * sizeof(elab_can_msg_t)) /
+                        sizeof(elab_can_msg_t));
+        if (ret > 0 || timeout == 0)
+        {
+            break;
+        }
+
+        if (timeout != osWaitForever)
+        {
+            time_elapsed = osKernelGetTickCount() - time_start;
+            if (time_elapsed >= timeout)
+            {
+                break;
+            }
+            time = timeout - time_elapsed;
+        }
+
+        if (osSemaphoreAcquire(can->sem_recv, time) == osErrorTimeout)
+        {
+            ret = (int32_t)(lwrb_read(&can->rb_recv, msg,
+                                        count * sizeof(elab_can_msg_t)) /
+                            sizeof(elab_can_msg_t));
+            break;
+        }
+    }
+
+    if (ret == 0)
+    {
+        ret = ELAB_ERR_TIMEOUT;
+    }
 
     return ret;
 }
 
-elab_err_t eio_can_config_filter(elab_device_t * const me, elab_can_filter_t *filter)
+/**
+  * @brief  Add one filter of the CAN device. It is set into the hardware if
+  *         the driver supports, or else it is compiled into the software
+  *         filters. Without any filter, all the messages are received.
+  * @param  me      CAN device handle.
+  * @param  filter  The filter, kept by the device.
+  * @retval See elab_err_t.
+  */
+elab_err_t elab_can_config_filter(elab_device_t * const me, elab_can_filter_t *filter)
 {
     elab_err_t ret = ELAB_OK;
 
@@ -219,6 +403,8 @@ elab_err_t eio_can_config_filter(elab_device_t * const me, elab_can_filter_t *fi
     elab_can_t *can = (elab_can_t *)me;
     assert_name(can->ops != NULL, me->attr.name);
 
+    elab_device_lock(me);
+
     /* Set the hardware CAN filter. */
     if (can->ops->config_filter != NULL)
     {
@@ -230,11 +416,36 @@ elab_err_t eio_can_config_filter(elab_device_t * const me, elab_can_filter_t *fi
     {
         filter->next = can->filter_list;
         can->filter_list = filter;
+        if (can->ops->config_filter == NULL)
+        {
+            _can_filter_compile(can);
+        }
     }
 
+    elab_device_unlock(me);
+
     return ret;
 }
 
+/**
+  * @brief  Get the counters of the CAN device.
+  * @param  me      CAN device handle.
+  * @param  stat    The counters output.
+  * @retval None.
+  */
+void elab_can_get_stat(elab_device_t * const me, elab_can_stat_t *stat)
+{
+    elab_assert(me != NULL);
+    assert_name(stat != NULL, me->attr.name);
+
+    elab_can_t *can = (elab_can_t *)me;
+    stat->recv = elab_atomic_load(&can->stat.recv);
+    stat->filtered = elab_atomic_load(&can->stat.filtered);
+    stat->overrun = elab_atomic_load(&can->stat.overrun);
+    stat->sent = elab_atomic_load(&can->stat.sent);
+    stat->dropped = elab_atomic_load(&can->stat.dropped);
+}
+
 /* private function --------------------------------------------------------- */
 static elab_err_t _can_enable(elab_device_t * const me, bool status)
 {
@@ -243,12 +454,198 @@ static elab_err_t _can_enable(elab_device_t * const me, bool status)
     assert_name(can->ops != NULL, me->attr.name);
     assert_name(can->ops->enable != NULL, me->attr.name);
 
+    /* The messages of the last opening are cleared. */
+    if (status)
+    {
+        lwrb_reset(&can->rb_recv);
+        lwrb_reset(&can->rb_send);
+        elab_atomic_store(&can->sending, false);
+    }
+
     /* Enable the CAN device driver. */
     can->ops->enable(can, status);
 
     return ELAB_OK;
 }
 
+/**
+  * @brief  Check the message by the software filters, without any lock.
+  * @retval True if the message is accepted.
+  */
+static bool _can_filter_pass(elab_can_t * const me, const elab_can_msg_t *msg)
+{
+    bool pass = true;
+
+    /* The compiled filters are not freed while being used here. */
+    elab_atomic_add(&me->filter_users, 1);
+    struct elab_can_filter_set *set = elab_atomic_load(&me->filter_set);
+    if (set != NULL)
+    {
+        uint32_t key = msg->id | (msg->ide ? ELAB_CAN_KEY_IDE : 0);
+        pass = false;
+
+        if (set->list != NULL)
+        {
+            uint32_t index = (key * 0x9E3779B1U) >> set->list_shift;
+            while (set->list[index] != ELAB_CAN_KEY_EMPTY)
+            {
+                if (set->list[index] == key)
+                {
+                    pass = true;
+                    break;
+                }
+                index = (index + 1) & set->list_mask;
+            }
+        }
+
+        for (uint32_t i = 0; !pass && i < set->count_mask; i ++)
+        {
+            pass = ((key & set->mask[i * 2 + 1]) == set->mask[i * 2]);
+        }
+    }
+    elab_atomic_sub(&me->filter_users, 1);
+
+    return pass;
+}
+
+/**
+  * @brief  Compile the filter list into the hash set and the mask table, and
+  *         replace the old ones. The device should be locked.
+  */
+static void _can_filter_compile(elab_can_t * const me)
+{
+    uint32_t count_list = 0;
+    uint32_t count_mask = 0;
+    for (elab_can_filter_t *filter = me->filter_list;
+            filter != NULL; filter = filter->next)
+    {
+        if (filter->mode == ELAB_CAN_FILTER_MODE_LIST)
+        {
+            count_list ++;
+        }
+        else
+        {
+            count_mask ++;
+        }
+    }
+
+    /* The hash set is kept at most half full. */
+    uint32_t size_list = 0;
+    uint32_t shift = 32;
+    if (count_list > 0)
+    {
+        size_list = ELAB_CAN_FILTER_LIST_MIN;
+        shift -= 3;
+        while (size_list < count_list * 2)
+        {
+            size_list *= 2;
+            shift --;
+        }
+    }
+
+    struct elab_can_filter_set *set =
+        elab_malloc(sizeof(struct elab_can_filter_set) +
+                    (size_list + count_mask * 2) * sizeof(uint32_t));
+    assert_name(set != NULL, me->super.attr.name);
+    set->list = (size_list == 0) ? NULL : (uint32_t *)&set[1];
+    set->list_mask = size_list - 1;
+    set->list_shift = shift;
+    set->mask = &((uint32_t *)&set[1])[size_list];
+    set->count_mask = 0;
+    for (uint32_t i = 0; i < size_list; i ++)
+    {
+        set->list[i] = ELAB_CAN_KEY_EMPTY;
+    }
+
+    for (elab_can_filter_t *filter = me->filter_list;
+            filter != NULL; filter = filter->next)
+    {
+        uint32_t key = filter->id | (filter->ide ? ELAB_CAN_KEY_IDE : 0);
+        if (filter->mode == ELAB_CAN_FILTER_MODE_LIST)
+        {
+            uint32_t index = (key * 0x9E3779B1U) >> set->list_shift;
+            while (set->list[index] != ELAB_CAN_KEY_EMPTY &&
+                    set->list[index] != key)
+            {
+                index = (index + 1) & set->list_mask;
+            }
+            set->list[index] = key;
+        }
+        else
+        {
+            /* The IDE bit is always compared. */
+            uint32_t mask = filter->mask | ELAB_CAN_KEY_IDE;
+            set->mask[set->count_mask * 2] = key & mask;
+            set->mask[set->count_mask * 2 + 1] = mask;
+            set->count_mask ++;
+        }
+    }
+
+    /* Publish the new filters, and free the old ones after the readers. */
+    struct elab_can_filter_set *set_old = me->filter_set;
+    elab_atomic_store(&me->filter_set, set);
+    while (elab_atomic_load(&me->filter_users) != 0)
+    {
+        osDelay(1);
+    }
+    if (set_old != NULL)
+    {
+        elab_free(set_old);
+    }
+}
+
+/**
+  * @brief  Start sending if the CAN bus is idle. The holder of the sending
+  *         flag is the only consumer of the tx ring buffer.
+  */
+static void _can_send_kick(elab_can_t * const me)
+{
+    elab_can_msg_t msg;
+    bool sending = false;
+
+    while (lwrb_get_full(&me->rb_send) >= sizeof(elab_can_msg_t) &&
+            elab_atomic_cas(&me->sending, &sending, true))
+    {
+        if (lwrb_read(&me->rb_send, &msg, sizeof(elab_can_msg_t)) ==
+            sizeof(elab_can_msg_t))
+        {
+            me->ops->send(me, &msg);
+            elab_atomic_add(&me->stat.sent, 1);
+            break;
+        }
+
+        /* Taken by elab_can_isr_send_end() before the flag was cleared. */
+        elab_atomic_store(&me->sending, false);
+        sending = false;
+    }
+}
+
+#if defined(__linux__) || defined(_WIN32)
+/**
+  * @brief  The entry function for the CAN device with the blocking reading.
+  */
+static void _thread_entry_recv(void *parameter)
+{
+    elab_can_t *can = (elab_can_t *)parameter;
+    elab_assert(can != NULL);
+
+    elab_can_msg_t msg;
+
+    while (1)
+    {
+        if (elab_device_is_enabled(&can->super) &&
+            can->ops->recv(can, &msg) == 1)
+        {
+            elab_can_isr_recv(can, &msg);
+        }
+        else
+        {
+            osDelay(10);
+        }
+    }
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,7 @@
 /* include ------------------------------------------------------------------ */
 #include "../elab_device.h"
 #include "../../os/cmsis_os.h"
+#include "../../3rd/lwrb/lwrb.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +56,7 @@ typedef struct elab_can_msg
     uint8_t length;
 } elab_can_msg_t;
 
+/* The sizes of the sending and receiving ring buffers, in messages. */
 typedef struct elab_can_attribute
 {
     void *user_data;
@@ -62,14 +64,6 @@ typedef struct elab_can_attribute
     uint16_t buff_size_recv;
 } elab_can_attr_t;
 
-typedef struct elab_can_buff
-{
-    elab_can_msg_t *msg;
-    uint8_t size;
-    uint8_t head;
-    uint8_t tail;
-} elab_can_buff_t;
-
 typedef struct elab_can_filter
 {
     struct elab_can_filter *next;
@@ -80,48 +74,78 @@ typedef struct elab_can_filter
     uint32_t rtr            : 1;
 } elab_can_filter_t;
 
+typedef struct elab_can_stat
+{
+    uint32_t recv;                                  /* Put into the rx ring */
+    uint32_t filtered;                              /* Dropped by the filters */
+    uint32_t overrun;                               /* Dropped, rx ring full */
+    uint32_t sent;                                  /* Given to the driver */
+    uint32_t dropped;                               /* Dropped, tx ring full */
+} elab_can_stat_t;
+
+/* The software filters compiled from the filter list. */
+struct elab_can_filter_set;
+
 typedef struct elab_can
 {
     elab_device_t super;
 
     const struct elab_can_ops * ops;
-#if !defined(__linux__) && !defined(_WIN32)
-    osMessageQueueId_t mq_recv;
+#if defined(__linux__) || defined(_WIN32)
+    osThreadId_t thread_recv;
 #endif
+    /* The rx ring is written by the ISR and read by one thread, and the tx
+       ring is written by the threads with the mutex and read by the holder of
+       the sending flag, so both are single-producer and single-consumer. */
+    lwrb_t rb_recv;
+    lwrb_t rb_send;
+    uint8_t *buff_recv;
+    uint8_t *buff_send;
+    osSemaphoreId_t sem_recv;
+    osMutexId_t mutex_send;
+
     elab_can_config_t config;
     elab_can_filter_t *filter_list;
+    struct elab_can_filter_set *filter_set;
+    uint32_t filter_users;
+    elab_can_stat_t stat;
     bool sending;
 } elab_can_t;
 
+/* The driver starts sending one message by send, and calls
+   elab_can_isr_send_end() when it is sent, never inside send. */
 struct elab_can_ops
 {
-#if !defined(__linux__) && !defined(_WIN32)
-    bool (* send_busy)(elab_can_t * const me);
-#endif
+    bool (* send_busy)(elab_can_t * const me);      /* Optional */
 
     elab_err_t (* enable)(elab_can_t * const me, bool en_status);
     elab_err_t (* config)(elab_can_t * const me, elab_can_config_t * config);
     void (* send)(elab_can_t * const me, const elab_can_msg_t *msg);
 #if defined(__linux__) || defined(_WIN32)
+    /* Optional, the blocking reading instead of elab_can_isr_recv(). */
     int32_t (* recv)(elab_can_t * const me, elab_can_msg_t *msg);
 #endif
     elab_err_t (* config_filter)(elab_can_t * const me, elab_can_filter_t *filter);
 };
 
+#define ELAB_CAN_CAST(_dev)             ((elab_can_t *)_dev)
+
 /* public function ---------------------------------------------------------- */
 /* For the driver layer. */
 void elab_can_register(elab_can_t * const me, const char * name,
                         elab_can_attr_t *attr, void *user_data);
-#if !defined(__linux__) && !defined(_WIN32)
+void elab_can_unregister(elab_can_t * const me);
 void elab_can_isr_recv(elab_can_t * const me, elab_can_msg_t *msg);
 void elab_can_isr_send_end(elab_can_t * const me);
-#endif
 
 /* For the upper layers. */
 void elab_can_config(elab_device_t * const me, elab_can_config_t *config);
-void elab_can_send(elab_device_t * const me, const elab_can_msg_t *msg);
+elab_err_t elab_can_send(elab_device_t * const me, const elab_can_msg_t *msg);
 int32_t elab_can_recv(elab_device_t * const me, elab_can_msg_t *msg);
+int32_t elab_can_recv_n(elab_device_t * const me, elab_can_msg_t *msg,
+                        uint32_t count, uint32_t timeout);
 elab_err_t elab_can_config_filter(elab_device_t * const me, elab_can_filter_t *filter);
+void elab_can_get_stat(elab_device_t * const me, elab_can_stat_t *stat);
 
 #ifdef __cplusplus
 }
@@ -6,6 +6,7 @@
 /* includes ----------------------------------------------------------------- */
 #include "elab_serial.h"
 #include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,6 +17,19 @@ ELAB_TAG("Edf_Serial");
 /* public function prototypes ----------------------------------------------- */
 void elab_device_unregister(elab_device_t *me);
 
+/* private config ----------------------------------------------------------- */
+#define ELAB_SERIAL_TX_QUEUE_SIZE               (8)
+#define ELAB_SERIAL_TX_MERGE_SIZE               (256)
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct elab_serial_tx_req
+{
+    elab_serial_iovec_t iov[ELAB_SERIAL_IOV_MAX];
+    uint32_t iovcnt;                            /* 0 to stop the tx thread */
+    elab_serial_tx_cb_t cb;
+    void *para;
+} elab_serial_tx_req_t;
+
 /* private function prototypes ---------------------------------------------- */
 static elab_err_t _device_enable(elab_device_t *me, bool status);
 static int32_t _device_read(elab_device_t *me,
@@ -23,6 +37,12 @@ static int32_t _device_read(elab_device_t *me,
 static int32_t _device_write(elab_device_t *me,
                                 uint32_t pos, const void *buffer, uint32_t size);
 static void _thread_entry(void *parameter);
+static void _thread_entry_tx(void *parameter);
+static int32_t _read_queue(elab_serial_t *serial, uint8_t *buff,
+                            uint32_t size, uint32_t timeout, bool chunk);
+static int32_t _read_stream(elab_serial_t *serial, uint8_t *buff,
+                            uint32_t size, uint32_t timeout, bool chunk);
+static void _tx_queue_fail(elab_serial_t *serial);
 
 #if (ELAB_DEV_PALTFORM == ELAB_PALTFORM_POLL)
 static void _device_poll(elab_device_t *me);
@@ -55,6 +75,14 @@ static const osThreadAttr_t thread_attr_serial_rx =
     .stack_size = 2048,
 };
 
+static const osThreadAttr_t thread_attr_serial_tx = 
+{
+    .name = "ThreadSerailTx",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityHigh,
+    .stack_size = 2048,
+};
+
 /* public functions --------------------------------------------------------- */
 /**
   * @brief  Register elab serial device to edf framework.
@@ -105,8 +133,20 @@ void elab_serial_register(elab_serial_t *serial, const char *name,
     elab_assert(serial->mutex_tx != NULL);
     serial->sem_tx = osSemaphoreNew(1, 0, NULL);
     elab_assert(serial->sem_tx != NULL);
-    serial->queue_rx = osMessageQueueNew(serial->attr.rx_bufsz, 1, NULL);
-    elab_assert(serial->queue_rx != NULL);
+    if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
+    {
+        /* The lwrb ring buffer always keeps one byte empty. */
+        serial->buff_rx = elab_malloc(serial->attr.rx_bufsz + 1);
+        elab_assert(serial->buff_rx != NULL);
+        lwrb_init(&serial->rb_rx, serial->buff_rx, serial->attr.rx_bufsz + 1);
+        serial->sem_rx = osSemaphoreNew(1, 0, NULL);
+        elab_assert(serial->sem_rx != NULL);
+    }
+    else
+    {
+        serial->queue_rx = osMessageQueueNew(serial->attr.rx_bufsz, 1, NULL);
+        elab_assert(serial->queue_rx != NULL);
+    }
 
     /* The super class data */
     elab_device_t *device = &(serial->super);
@@ -151,6 +191,28 @@ void elab_serial_unregister(elab_serial_t *serial)
     serial->thread_rx = NULL;
 #endif
 
+    if (serial->thread_tx != NULL)
+    {
+        /* Stop the tx thread by the request with no buffer, after which it
+           holds no lock, and wait for it by one semaphore, as the FreeRTOS
+           ports do not support joining the thread. */
+        elab_serial_tx_req_t req;
+        memset(&req, 0, sizeof(elab_serial_tx_req_t));
+        req.para = osSemaphoreNew(1, 0, NULL);
+        elab_assert(req.para != NULL);
+        ret_os = osMessageQueuePut(serial->queue_tx, &req, 0, osWaitForever);
+        elab_assert(ret_os == osOK);
+        ret_os = osSemaphoreAcquire(req.para, osWaitForever);
+        elab_assert(ret_os == osOK);
+        ret_os = osSemaphoreDelete(req.para);
+        elab_assert(ret_os == osOK);
+        serial->thread_tx = NULL;
+
+        ret_os = osMessageQueueDelete(serial->queue_tx);
+        elab_assert(ret_os == osOK);
+        serial->queue_tx = NULL;
+    }
+
     elab_device_lock(ELAB_DEVICE_CAST(serial));
 
     /* The serial tx mutex creating. */
@@ -162,9 +224,21 @@ void elab_serial_unregister(elab_serial_t *serial)
     elab_assert(ret_os == osOK);
     serial->sem_tx = NULL;
 
-    ret_os = osMessageQueueDelete(serial->queue_rx);
-    elab_assert(ret_os == osOK);
-    serial->queue_rx = NULL;
+    if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
+    {
+        ret_os = osSemaphoreDelete(serial->sem_rx);
+        elab_assert(ret_os == osOK);
+        serial->sem_rx = NULL;
+        lwrb_free(&serial->rb_rx);
+        elab_free(serial->buff_rx);
+        serial->buff_rx = NULL;
+    }
+    else
+    {
+        ret_os = osMessageQueueDelete(serial->queue_rx);
+        elab_assert(ret_os == osOK);
+        serial->queue_rx = NULL;
+    }
 
     elab_device_unlock(ELAB_DEVICE_CAST(serial));
 
@@ -201,14 +275,25 @@ void elab_serial_isr_rx(elab_serial_t *serial, void *buffer, uint32_t size)
 
     osStatus_t ret_os = osOK;
     uint8_t *buff = (uint8_t *)buffer;
-    if (!device_is_test_mode(&serial->parent))
+    if (!elab_device_is_test_mode(&serial->super))
     {
         if (elab_device_is_enabled(&serial->super))
         {
-            for (uint32_t i = 0; i < size; i ++)
+            if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
             {
-                ret_os = osMessageQueuePut(serial->queue_rx, &buff[i], 0, 0);
-                elab_assert(ret_os == osOK);
+                /* Copy the whole chunk, and wake up the reader only once. The
+                   semaphore is binary, so releasing it again is harmless. */
+                uint32_t size_write = lwrb_write(&serial->rb_rx, buff, size);
+                elab_assert(size_write == size);
+                osSemaphoreRelease(serial->sem_rx);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < size; i ++)
+                {
+                    ret_os = osMessageQueuePut(serial->queue_rx, &buff[i], 0, 0);
+                    elab_assert(ret_os == osOK);
+                }
             }
         }
     }
@@ -227,9 +312,37 @@ int32_t elab_serial_write(elab_device_t * const me, void *buff, uint32_t size)
     elab_assert(me != NULL);
     elab_assert(buff != NULL);
     elab_assert(size != 0);
+
+    elab_serial_iovec_t iov =
+    {
+        .buff = buff,
+        .size = size,
+    };
+
+    return elab_serial_writev(me, &iov, 1);
+}
+
+/**
+  * @brief  elab serial device scatter/gather write function. All the buffers
+  *         are sent as one frame, without being copied together if the driver
+  *         has the writev function. Otherwise they are merged into one driver
+  *         writing if ELAB_SERIAL_TX_MERGE_SIZE bytes at most, to keep no gap
+  *         in the frame.
+  * @param  me      The elab device handle.
+  * @param  iov     The buffer array.
+  * @param  iovcnt  The buffer number.
+  * @retval Auctual write length or error ID.
+  */
+int32_t elab_serial_writev(elab_device_t * const me,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt)
+{
+    elab_assert(me != NULL);
+    elab_assert(iov != NULL);
+    elab_assert(iovcnt != 0);
     elab_assert(elab_device_is_enabled(me));
 
     int32_t ret = ELAB_OK;
+    int32_t ret_write = 0;
     osStatus_t ret_os = osOK;
     elab_serial_t *serial = (elab_serial_t *)me;
     elab_assert(serial->ops != NULL);
@@ -253,17 +366,68 @@ int32_t elab_serial_write(elab_device_t * const me, void *buff, uint32_t size)
             serial->ops->set_tx(serial, true);
         }
 
-        /* Send data by the low level serial write function in non-block mode. */
-        ret = serial->ops->write(serial, buff, size);
-        if (ret < 0)
+        if (serial->ops->writev != NULL && iovcnt <= ELAB_SERIAL_IOV_MAX)
         {
-            goto exit;
+            /* Send all the buffers by the low level serial writev function in
+               non-block mode. */
+            ret = serial->ops->writev(serial, iov, iovcnt);
+            if (ret < 0)
+            {
+                goto exit;
+            }
+
+            /* Wait the send process to be completed, which is released in the
+               function elab_serial_tx_end. */
+            ret_os = osSemaphoreAcquire(serial->sem_tx, osWaitForever);
+            elab_assert(ret_os == osOK);
         }
+        else
+        {
+            /* Merge the buffers, as the gap between the driver writings may
+               break one frame, like the Modbus RTU one. */
+            uint8_t buff[ELAB_SERIAL_TX_MERGE_SIZE];
+            elab_serial_iovec_t iov_merge = { .buff = buff, .size = 0, };
+            for (uint32_t i = 0; iovcnt > 1 && i < iovcnt; i ++)
+            {
+                if (iov_merge.size + iov[i].size > ELAB_SERIAL_TX_MERGE_SIZE)
+                {
+                    iov_merge.size = 0;
+                    break;
+                }
+                if (iov[i].size != 0)
+                {
+                    elab_assert(iov[i].buff != NULL);
+                    memcpy(&buff[iov_merge.size], iov[i].buff, iov[i].size);
+                    iov_merge.size += iov[i].size;
+                }
+            }
+            if (iov_merge.size != 0)
+            {
+                iov = &iov_merge;
+                iovcnt = 1;
+            }
 
-        /* Wait the send process to be completed, which is released in the function
-           dev_serial_tx_end. */
-        ret_os = osSemaphoreAcquire(serial->sem_tx, osWaitForever);
-        elab_assert(ret_os == osOK);
+            /* Send the buffers one by one, still in the same tx process. */
+            for (uint32_t i = 0; i < iovcnt; i ++)
+            {
+                if (iov[i].size == 0)
+                {
+                    continue;
+                }
+                elab_assert(iov[i].buff != NULL);
+
+                ret_write = serial->ops->write(serial, iov[i].buff, iov[i].size);
+                if (ret_write < 0)
+                {
+                    ret = ret_write;
+                    goto exit;
+                }
+
+                ret_os = osSemaphoreAcquire(serial->sem_tx, osWaitForever);
+                elab_assert(ret_os == osOK);
+                ret += ret_write;
+            }
+        }
 
 exit:
         /* If RS485 mode, set to rx mode. */
@@ -277,10 +441,78 @@ exit:
         elab_assert(ret_os == osOK);
     }
 
-exit1:
     return ret;
 }
 
+/**
+  * @brief  Check the serial driver sends the scatter/gather buffers directly,
+  *         without merging them by copying.
+  * @param  me      The elab device handle.
+  * @retval True if the driver has the writev function.
+  */
+bool elab_serial_has_writev(elab_device_t * const me)
+{
+    elab_assert(me != NULL);
+    elab_assert(ELAB_SERIAL_CAST(me)->ops != NULL);
+
+    return (ELAB_SERIAL_CAST(me)->ops->writev != NULL);
+}
+
+/**
+  * @brief  elab serial device asynchronous write function. The writing request
+  *         is queued and sent by the serial tx thread, and the callback is
+  *         invoked in the tx thread when the sending is completed. The buffers
+  *         are NOT copied, so they should be kept valid until the callback.
+  *         The requests not sent yet when the device is closed are completed
+  *         with ELAB_ERROR, in the closing thread if still queued.
+  * @param  me      The elab device handle.
+  * @param  iov     The buffer array, at most ELAB_SERIAL_IOV_MAX buffers.
+  * @param  iovcnt  The buffer number.
+  * @param  cb      The completion callback, NULL is allowed.
+  * @param  para    The parameter of the callback.
+  * @retval See elab_err_t.
+  */
+elab_err_t elab_serial_write_async(elab_device_t * const me,
+                                    const elab_serial_iovec_t *iov,
+                                    uint32_t iovcnt,
+                                    elab_serial_tx_cb_t cb, void *para)
+{
+    elab_assert(me != NULL);
+    elab_assert(iov != NULL);
+    elab_assert(iovcnt != 0 && iovcnt <= ELAB_SERIAL_IOV_MAX);
+    elab_assert(elab_device_is_enabled(me));
+
+    osStatus_t ret_os = osOK;
+    elab_serial_t *serial = ELAB_SERIAL_CAST(me);
+
+    /* The tx queue and thread are created at the first asynchronous writing. */
+    elab_device_lock(serial);
+    if (serial->queue_tx == NULL)
+    {
+        serial->queue_tx = osMessageQueueNew(ELAB_SERIAL_TX_QUEUE_SIZE,
+                                                sizeof(elab_serial_tx_req_t),
+                                                NULL);
+        elab_assert(serial->queue_tx != NULL);
+        serial->thread_tx = osThreadNew(_thread_entry_tx, serial,
+                                        &thread_attr_serial_tx);
+        elab_assert(serial->thread_tx != NULL);
+    }
+    elab_device_unlock(serial);
+
+    elab_serial_tx_req_t req;
+    memset(&req, 0, sizeof(elab_serial_tx_req_t));
+    memcpy(req.iov, iov, sizeof(elab_serial_iovec_t) * iovcnt);
+    req.iovcnt = iovcnt;
+    req.cb = cb;
+    req.para = para;
+
+    /* Block the caller when the tx queue is full. */
+    ret_os = osMessageQueuePut(serial->queue_tx, &req, 0, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    return ELAB_OK;
+}
+
 /**
   * @brief  elab device read function
   * @param  me      The elab device handle.
@@ -297,7 +529,6 @@ int32_t elab_serial_read(elab_device_t * const me, void *buff,
     elab_assert(elab_device_is_enabled(me));
 
     int32_t ret = ELAB_OK;
-    osStatus_t ret_os = osOK;
     elab_serial_t *serial = (elab_serial_t *)me;
     elab_assert(serial->ops != NULL);
     elab_assert(serial->ops->read != NULL);
@@ -305,57 +536,28 @@ int32_t elab_serial_read(elab_device_t * const me, void *buff,
     /* If not in testing mode. */
     if (!elab_device_is_test_mode(&serial->super))
     {
-        uint32_t time_start = osKernelGetTickCount();
-        uint32_t time = timeout;
-        for (uint32_t i = 0; i < size; i ++)
+        if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
         {
-            if (timeout != osWaitForever && timeout != 0)
-            {
-                if ((osKernelGetTickCount() - time_start) < timeout)
-                {
-                    time = time_start + timeout - osKernelGetTickCount();
-                }
-                else
-                {
-                    if (ret == ELAB_OK)
-                    {
-                        ret = ELAB_ERR_TIMEOUT;
-                    }
-                    break;
-                }
-            }
-
-            ret_os = osMessageQueueGet(serial->queue_rx,
-                                        &((uint8_t *)buff)[i], 0U, time);
-            if (ret_os == osErrorTimeout)
-            {
-                if (ret == ELAB_OK)
-                {
-                    ret = ELAB_ERR_TIMEOUT;
-                }
-                break;
-            }
-            if (ret_os == osOK)
-            {
-                ret ++;
-                if (ret >= size)
-                {
-                    break;
-                }
-                else
-                {
-                    continue;
-                }
-            }
-            elab_assert(false);
+            ret = _read_stream(serial, buff, size, timeout, false);
+        }
+        else
+        {
+            ret = _read_queue(serial, buff, size, timeout, false);
         }
     }
     else
     {
 #if !defined(__linux__) && !defined(_WIN32)
         /* Clear the queue for rx. */
-        ret_os = osMessageQueueReset(serial->queue_rx);
-        elab_assert(ret_os == osOK);
+        if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
+        {
+            lwrb_reset(&serial->rb_rx);
+        }
+        else
+        {
+            osStatus_t ret_os = osMessageQueueReset(serial->queue_rx);
+            elab_assert(ret_os == osOK);
+        }
 #endif
         if (timeout == osWaitForever)
         {
@@ -379,6 +581,46 @@ exit:
     return ret;
 }
 
+/**
+  * @brief  elab serial device chunk read function. It waits for the first
+  *         byte, then copies out all the bytes already received in one block.
+  * @param  me      The elab device handle.
+  * @param  buff    The pointer of buffer
+  * @param  size    The buffer size, the max read length.
+  * @param  timeout The timeout for the first byte.
+  * @retval Auctual read length or error ID.
+  */
+int32_t elab_serial_read_chunk(elab_device_t * const me, void *buff,
+                                uint32_t size, uint32_t timeout)
+{
+    elab_assert(me != NULL);
+    elab_assert(buff != NULL);
+    elab_assert(size != 0);
+    elab_assert(elab_device_is_enabled(me));
+
+    int32_t ret = ELAB_ERR_TIMEOUT;
+    elab_serial_t *serial = (elab_serial_t *)me;
+
+    /* If not in testing mode. */
+    if (!elab_device_is_test_mode(&serial->super))
+    {
+        if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
+        {
+            ret = _read_stream(serial, buff, size, timeout, true);
+        }
+        else
+        {
+            ret = _read_queue(serial, buff, size, timeout, true);
+        }
+    }
+    else
+    {
+        ret = elab_serial_read(me, buff, size, timeout);
+    }
+
+    return ret;
+}
+
 /**
   * @brief  Set the attribute of the elab serial device
   * @param  serial      elab serial device handle
@@ -398,6 +640,7 @@ void elab_serial_set_attr(elab_device_t *me, elab_serial_attr_t *attr)
     elab_device_lock(serial);
     elab_assert(attr->mode == serial->attr.mode);
     elab_assert(attr->rx_bufsz == serial->attr.rx_bufsz);
+    elab_assert(attr->rx_mode == serial->attr.rx_mode);
     /* Set the config data of serial device. */
     if (memcmp(&serial->attr, attr, sizeof(elab_serial_attr_t)) != 0)
     {
@@ -524,6 +767,7 @@ exit:
 static elab_err_t _device_enable(elab_device_t *me, bool status)
 {
     elab_err_t ret = ELAB_OK;
+    osStatus_t ret_os = osOK;
 
     elab_assert(me != NULL);
 
@@ -531,6 +775,17 @@ static elab_err_t _device_enable(elab_device_t *me, bool status)
     elab_assert(serial->ops != NULL);
     elab_assert(serial->ops->enable != NULL);
 
+    /* Already published as closed, so wait for the request being sent, and
+       fail the others. */
+    if (!status && serial->queue_tx != NULL)
+    {
+        ret_os = osMutexAcquire(serial->mutex_tx, osWaitForever);
+        elab_assert(ret_os == osOK);
+        _tx_queue_fail(serial);
+        ret_os = osMutexRelease(serial->mutex_tx);
+        elab_assert(ret_os == osOK);
+    }
+
     return serial->ops->enable(serial, status);
 }
 
@@ -567,6 +822,187 @@ static int32_t _device_write(elab_device_t *me,
 }
 
 
+/**
+  * @brief  Read data from the rx message queue, one byte per message.
+  * @param  serial  elab serial device handle.
+  * @param  buff    The pointer of buffer
+  * @param  size    Expected read length
+  * @param  timeout The timeout of the whole reading.
+  * @param  chunk   Return once any data is received or not.
+  * @retval Auctual read length or error ID.
+  */
+static int32_t _read_queue(elab_serial_t *serial, uint8_t *buff,
+                            uint32_t size, uint32_t timeout, bool chunk)
+{
+    int32_t ret = ELAB_ERR_TIMEOUT;
+    int32_t ret_get = 0;
+    uint32_t count = 0;
+    uint32_t time_start = osKernelGetTickCount();
+    uint32_t time = timeout;
+
+    while (count < size)
+    {
+        if (chunk && count > 0)
+        {
+            /* Only the data already in the queue is copied out. */
+            time = 0;
+        }
+        else if (timeout != osWaitForever && timeout != 0)
+        {
+            if ((osKernelGetTickCount() - time_start) < timeout)
+            {
+                time = time_start + timeout - osKernelGetTickCount();
+            }
+            else
+            {
+                break;
+            }
+        }
+
+#if defined(__linux__)
+        /* Copy out all the queued data at one wake-up. */
+        ret_get = osMessageQueueGetN(serial->queue_rx,
+                                        &buff[count], (size - count), NULL, time);
+#else
+        ret_get = (int32_t)osMessageQueueGet(serial->queue_rx,
+                                                &buff[count], NULL, time);
+        ret_get = (ret_get == osOK) ? 1 : ret_get;
+#endif
+        if (ret_get == osErrorTimeout || ret_get == osErrorResource)
+        {
+            break;
+        }
+        elab_assert(ret_get > 0);
+        count += ret_get;
+    }
+    if (count > 0)
+    {
+        ret = (int32_t)count;
+    }
+
+    return ret;
+}
+
+/**
+  * @brief  Read data from the rx ring buffer in blocks. The ring buffer is
+  *         single-producer and single-consumer, so only one thread may read
+  *         one stream mode serial port at the same time.
+  * @param  serial  elab serial device handle.
+  * @param  buff    The pointer of buffer
+  * @param  size    Expected read length
+  * @param  timeout The timeout of the whole reading.
+  * @param  chunk   Return once any data is received or not.
+  * @retval Auctual read length or error ID.
+  */
+static int32_t _read_stream(elab_serial_t *serial, uint8_t *buff,
+                            uint32_t size, uint32_t timeout, bool chunk)
+{
+    int32_t ret = 0;
+    osStatus_t ret_os = osOK;
+    uint32_t time_start = osKernelGetTickCount();
+    uint32_t time = timeout;
+    uint32_t time_elapsed = 0;
+
+    while (1)
+    {
+        ret += (int32_t)lwrb_read(&serial->rb_rx, &buff[ret], size - ret);
+        if (ret >= size || (chunk && ret > 0) || timeout == 0)
+        {
+            break;
+        }
+
+        if (timeout != osWaitForever)
+        {
+            time_elapsed = osKernelGetTickCount() - time_start;
+            if (time_elapsed >= timeout)
+            {
+                break;
+            }
+            time = timeout - time_elapsed;
+        }
+
+        /* One wake-up is given for every received chunk. */
+        ret_os = osSemaphoreAcquire(serial->sem_rx, time);
+        if (ret_os == osErrorTimeout)
+        {
+            ret += (int32_t)lwrb_read(&serial->rb_rx, &buff[ret], size - ret);
+            break;
+        }
+    }
+
+    if (ret == 0)
+    {
+        ret = ELAB_ERR_TIMEOUT;
+    }
+
+    return ret;
+}
+
+/**
+  * @brief  Complete all the queued asynchronous writing requests with the
+  *         error, when the serial device is closed.
+  */
+static void _tx_queue_fail(elab_serial_t *serial)
+{
+    elab_serial_tx_req_t req;
+
+    while (osMessageQueueGet(serial->queue_tx, &req, NULL, 0) == osOK)
+    {
+        /* The stopping request is only sent after closing. */
+        elab_assert(req.iovcnt != 0);
+        if (req.cb != NULL)
+        {
+            req.cb(ELAB_DEVICE_CAST(serial), ELAB_ERROR, req.para);
+        }
+    }
+}
+
+/**
+  * @brief  The entry function for serial device asynchronous data sending.
+  */
+static void _thread_entry_tx(void *parameter)
+{
+    elab_serial_t *serial = (elab_serial_t *)parameter;
+    elab_assert(serial != NULL);
+
+    elab_serial_tx_req_t req;
+    int32_t ret = 0;
+    osStatus_t ret_os = osOK;
+
+    while (1)
+    {
+        ret_os = osMessageQueueGet(serial->queue_tx, &req, NULL, osWaitForever);
+        elab_assert(ret_os == osOK);
+        if (req.iovcnt == 0)
+        {
+            /* Stopped, with the exiting semaphore in the parameter. */
+            ret_os = osSemaphoreRelease(req.para);
+            elab_assert(ret_os == osOK);
+            break;
+        }
+
+        /* The device may be closed after the request is got. Closing waits
+           for the tx mutex, so the request checked open is sent completely. */
+        ret_os = osMutexAcquire(serial->mutex_tx, osWaitForever);
+        elab_assert(ret_os == osOK);
+        ret = ELAB_ERROR;
+        if (elab_device_is_enabled(ELAB_DEVICE_CAST(serial)))
+        {
+            ret = elab_serial_writev(ELAB_DEVICE_CAST(serial),
+                                        req.iov, req.iovcnt);
+        }
+        ret_os = osMutexRelease(serial->mutex_tx);
+        elab_assert(ret_os == osOK);
+
+        if (req.cb != NULL)
+        {
+            req.cb(ELAB_DEVICE_CAST(serial), ret, req.para);
+        }
+    }
+
+    osThreadExit();
+}
+
 /**
   * @brief  The entry function for serial device data receiving.
   */
@@ -589,8 +1025,22 @@ static void _thread_entry(void *parameter)
         {
             ret = serial->ops->read(serial, &data, 1);
             elab_assert(ret == 1);
-            ret_os = osMessageQueuePut(serial->queue_rx, &data, 0, osWaitForever);
-            elab_assert(ret_os == osOK);
+            if (serial->attr.rx_mode == ELAB_SERIAL_RX_MODE_STREAM)
+            {
+                /* Wait for the reader, instead of dropping the data. */
+                while (lwrb_get_free(&serial->rb_rx) == 0)
+                {
+                    osDelay(1);
+                }
+                lwrb_write(&serial->rb_rx, &data, 1);
+                osSemaphoreRelease(serial->sem_rx);
+            }
+            else
+            {
+                ret_os = osMessageQueuePut(serial->queue_rx,
+                                            &data, 0, osWaitForever);
+                elab_assert(ret_os == osOK);
+            }
         }
         else
         {
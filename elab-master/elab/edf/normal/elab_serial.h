@@ -9,6 +9,7 @@
 /* includes ----------------------------------------------------------------- */
 #include "../elab_device.h"
 #include "../../os/cmsis_os.h"
+#include "../../3rd/lwrb/lwrb.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,15 @@ enum elab_serail_mode
     ELAB_SERIAL_MODE_HALF_DUPLEX,
 };
 
+enum elab_serial_rx_mode
+{
+    ELAB_SERIAL_RX_MODE_QUEUE = 0,                  /* One message per byte */
+    ELAB_SERIAL_RX_MODE_STREAM,                     /* SPSC byte ring buffer */
+};
+
+/* The max buffer number of one scatter/gather writing. */
+#define ELAB_SERIAL_IOV_MAX                     (4)
+
 /* Default config for elab_serial_config_t */
 #define ELAB_SERIAL_ATTR_DEFAULT                                               \
 {                                                                              \
@@ -50,6 +60,7 @@ enum elab_serail_mode
     ELAB_SERIAL_STOP_BITS_1,                        /* 1 stopbit */            \
     ELAB_SERIAL_PARITY_NONE,                        /* No parity  */           \
     ELAB_SERIAL_MODE_FULL_DUPLEX,                   /* Full / half duplex */   \
+    ELAB_SERIAL_RX_MODE_QUEUE,                      /* Rx queue / stream */    \
     0,                                                                         \
     256,                                            /* rx buffer size */       \
 }
@@ -62,7 +73,8 @@ typedef struct elab_serial_attr
     uint32_t stop_bits                  : 2;
     uint32_t parity                     : 2;
     uint32_t mode                       : 1;
-    uint32_t reserved                   : 7;
+    uint32_t rx_mode                    : 1;
+    uint32_t reserved                   : 6;
     uint32_t rx_bufsz                   : 16;
 } elab_serial_attr_t;
 
@@ -73,9 +85,19 @@ typedef struct elab_serial_config
     uint32_t stop_bits                  : 2;
     uint32_t parity                     : 2;
     uint32_t mode                       : 1;
-    uint32_t reserved                   : 7;
+    uint32_t rx_mode                    : 1;
+    uint32_t reserved                   : 6;
 } elab_serial_config_t;
 
+typedef struct elab_serial_iovec
+{
+    const void *buff;
+    uint32_t size;
+} elab_serial_iovec_t;
+
+typedef void (* elab_serial_tx_cb_t)(elab_device_t *me,
+                                        int32_t result, void *para);
+
 typedef struct elab_serail
 {
     elab_device_t super;
@@ -85,7 +107,12 @@ typedef struct elab_serail
 #endif
     osMutexId_t mutex_tx;
     osSemaphoreId_t sem_tx;
+    osThreadId_t thread_tx;
+    osMessageQueueId_t queue_tx;
     osMessageQueueId_t queue_rx;
+    osSemaphoreId_t sem_rx;
+    lwrb_t rb_rx;
+    uint8_t *buff_rx;
 
     const struct elab_serial_ops *ops;
     elab_serial_attr_t attr;
@@ -98,6 +125,8 @@ typedef struct elab_serial_ops
     int32_t (* read)(elab_serial_t *serial, void *buffer, uint32_t size);
     int32_t (* write)(elab_serial_t *serial, const void *buffer, uint32_t size);
 #endif
+    int32_t (* writev)(elab_serial_t *serial,
+                        const elab_serial_iovec_t *iov, uint32_t iovcnt);
     void (* set_tx)(elab_serial_t *serial, bool status);
     elab_err_t (* config)(elab_serial_t *serial, elab_serial_config_t *config);
 } elab_serial_ops_t;
@@ -118,8 +147,17 @@ void elab_serial_isr_rx(elab_serial_t *serial, void *buffer, uint32_t size);
 
 /* For high level program. */
 int32_t elab_serial_write(elab_device_t * const me, void *buff, uint32_t size);
+int32_t elab_serial_writev(elab_device_t * const me,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt);
+bool elab_serial_has_writev(elab_device_t * const me);
+elab_err_t elab_serial_write_async(elab_device_t * const me,
+                                    const elab_serial_iovec_t *iov,
+                                    uint32_t iovcnt,
+                                    elab_serial_tx_cb_t cb, void *para);
 int32_t elab_serial_read(elab_device_t * const me, void *buff,
                             uint32_t size, uint32_t timeout);
+int32_t elab_serial_read_chunk(elab_device_t * const me, void *buff,
+                                uint32_t size, uint32_t timeout);
 void elab_serial_set_baudrate(elab_device_t * const me, uint32_t baudrate);
 void elab_serial_set_attr(elab_device_t * const me, elab_serial_attr_t *attr);
 elab_serial_attr_t elab_serial_get_attr(elab_device_t * const me);
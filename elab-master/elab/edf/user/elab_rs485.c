@@ -136,6 +136,45 @@ int32_t rs485_write(rs485_t *me, const void *pbuf, uint32_t size)
     return ret;
 }
 
+/**
+  * @brief  RS485 scatter/gather write function, all the buffers are sent in one
+  *         tx process.
+  * @param  me      The RS485 handle
+  * @param  iov     The buffer array
+  * @param  iovcnt  The buffer number
+  * @retval Auctual write length
+  */
+int32_t rs485_writev(rs485_t *me, const elab_serial_iovec_t *iov, uint32_t iovcnt)
+{
+    osStatus_t ret_os = osOK;
+    ret_os = osMutexAcquire(me->mutex, osWaitForever);
+    assert_name(ret_os == osOK, me->serial->attr.name);
+
+    elab_serial_t *serial = (elab_serial_t *)me->serial;
+    elab_assert(serial->attr.mode == ELAB_SERIAL_MODE_HALF_DUPLEX);
+
+    /* Set the rx485 to sending mode. */
+    rs485_tx_active(me, true);
+
+    int32_t ret = elab_serial_writev(me->serial, iov, iovcnt);
+
+    /*  The same as rs485_write, wait the data to be sent out on actual boards. */
+#if defined(__arm__) && (EALB_SIMU_EN == 0)
+    if (ret > 0)
+    {
+        osDelayUs((ret * 10000000 / serial->attr.baud_rate) + 1000);
+    }
+#endif
+
+    /* Set the rx485 to receiving mode. */
+    rs485_tx_active(me, false);
+
+    ret_os = osMutexRelease(me->mutex);
+    assert_name(ret_os == osOK, me->serial->attr.name);
+
+    return ret;
+}
+
 int32_t rs485_write_time(rs485_t *me, const void *pbuf, uint32_t size, uint32_t time)
 {
     osStatus_t ret_os = osOK;
@@ -10,6 +10,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "../elab_device.h"
 #include "../../os/cmsis_os.h"
+#include "../normal/elab_serial.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +37,7 @@ elab_device_t *rs485_get_serial(rs485_t *me);
 
 int32_t rs485_read(rs485_t *me, void *pbuf, uint32_t size);
 int32_t rs485_write(rs485_t *me, const void *pbuf, uint32_t size);
+int32_t rs485_writev(rs485_t *me, const elab_serial_iovec_t *iov, uint32_t iovcnt);
 int32_t rs485_write_time(rs485_t *me, const void *pbuf, uint32_t size, uint32_t time);
 
 #ifdef __cplusplus
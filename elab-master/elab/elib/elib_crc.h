@@ -14,6 +14,9 @@
 extern "C" {
 #endif
 
+/* public define ------------------------------------------------------------ */
+#define ELIB_CRC16_MODBUS_INIT              (0xFFFF)
+
 /* public functions --------------------------------------------------------- */
 /**
   * @brief  Private function calculating CRC32 value of one memory.
@@ -24,6 +27,24 @@ extern "C" {
   */
 uint32_t elib_crc32(uint32_t crc, void *data, uint32_t size);
 
+/**
+  * @brief  Calculating CRC16/MODBUS value of one memory, which can be done in
+  *         several pieces by passing the former value.
+  * @param  crc   The former CRC16 value, ELIB_CRC16_MODBUS_INIT at first.
+  * @param  data  Data buffer to be calculated.
+  * @param  size  Size of the buffer.
+  * @retval CRC16 value.
+  */
+uint16_t elib_crc16_modbus(uint16_t crc, const void *data, uint32_t size);
+
+/**
+  * @brief  Updating CRC16/MODBUS value with one byte.
+  * @param  crc   The former CRC16 value, ELIB_CRC16_MODBUS_INIT at first.
+  * @param  data  The byte to be calculated.
+  * @retval CRC16 value.
+  */
+uint16_t elib_crc16_modbus_byte(uint16_t crc, uint8_t data);
+
 #ifdef __cplusplus
 }
 #endif
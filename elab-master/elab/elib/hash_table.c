@@ -5,21 +5,48 @@
 
 /* Includes ----------------------------------------------------------------- */
 #include <stdlib.h>
+#include <string.h>
 #include "hash_table.h"
 #include "../common/elab_assert.h"
 #include "../common/elab_common.h"
 
 ELAB_TAG("HashTable");
 
+/* Private config ----------------------------------------------------------- */
+/* The load factor in 1/8, over which the table from hash_table_new grows. */
+#define HASH_TABLE_LOAD_MAX                 (7)
+
 /* Private function prototypes ---------------------------------------------- */
-static uint32_t _get_prime_max(uint32_t capacity);
-static uint32_t _hash_time33(char *str);
-static uint32_t _hash_bkdr(char *str);
-static uint32_t _hash_elf(char *str);
+static uint32_t _hash(const char *str, uint32_t *p_len);
+static int32_t _find(hash_table_t * const me, const char *name,
+                        uint32_t hash, uint32_t len);
+static void _insert(hash_table_t * const me, hash_table_data_t *slot);
+static void _resize(hash_table_t * const me, uint32_t capacity);
+
+/* Private inline functions ------------------------------------------------- */
+/**
+  * @brief  The home slot of the hash, mapped into the capacity by multiplying
+  *         instead of dividing.
+  */
+static inline uint32_t _home(hash_table_t * const me, uint32_t hash)
+{
+    return (uint32_t)(((uint64_t)hash * me->capacity) >> 32);
+}
+
+/**
+  * @brief  The distance of the slot from its home slot.
+  */
+static inline uint32_t _distance(hash_table_t * const me, uint32_t index)
+{
+    uint32_t home = _home(me, me->table[index].hash);
+
+    return (index >= home) ? (index - home) : (index + me->capacity - home);
+}
 
 /* Exported functions ------------------------------------------------------- */
 /**
-  * @brief  Newly create one hash table in the given capacity.
+  * @brief  Newly create one hash table in the given capacity, which grows when
+  *         the table gets crowded.
   * @param  size    The given capacity size.
   * @retval The hash table handle.
   */
@@ -35,6 +62,7 @@ hash_table_t *hash_table_new(uint32_t capacity)
     elab_assert(table != NULL);
 
     hash_table_init(me, table, capacity);
+    me->resizable = true;
 
     return me;
 }
@@ -53,7 +81,8 @@ void hash_table_destroy(hash_table_t * const me)
 }
 
 /**
-  * @brief  Initialize one hash table in the static mode.
+  * @brief  Initialize one hash table in the static mode, which can be filled
+  *         up to its capacity.
   * @param  me          The hash table handle.
   * @param  data        The hash table data.
   * @param  capacity    The hash table capacity.
@@ -63,61 +92,50 @@ void hash_table_init(hash_table_t * const me,
                         hash_table_data_t *data,
                         uint32_t capacity)
 {
+    elab_assert(capacity > 0);
+
     me->table = data;
     me->capacity = capacity;
-
-    for (uint32_t i = 0; i < capacity; i ++)
-    {
-        me->table[i].hash_time33 = UINT32_MAX;
-        me->table[i].hash_elf = UINT32_MAX;
-        me->table[i].hash_bkdr = UINT32_MAX;
-        me->table[i].data = NULL;
-    }
-
-    me->prime_max = _get_prime_max(capacity);
+    me->count = 0;
+    me->resizable = false;
+    memset(data, 0, sizeof(hash_table_data_t) * capacity);
 }
 
 /**
-  * @brief  Add one data block into hash table by the given name .
+  * @brief  Add one data block into hash table by the given name. The name is
+  *         kept by the pointer, not copied.
   * @param  me          The hash table handle.
   * @param  name        The given key name.
   * @param  data        The data block.
-  * @retval See elab_err_t.
+  * @retval See elab_err_t. ELAB_ERROR if the name exists.
   */
-elab_err_t hash_table_add(hash_table_t * const me, char *name, void *data)
+elab_err_t hash_table_add(hash_table_t * const me, const char *name, void *data)
 {
-    elab_err_t ret = ELAB_ERR_FULL;
+    hash_table_data_t slot;
 
-    uint32_t hash_time33 = _hash_time33(name);
-    uint32_t hash_elf = _hash_elf(name);
-    uint32_t hash_bkdr = _hash_bkdr(name);
+    slot.hash = _hash(name, &slot.len);
+    slot.key = name;
+    slot.data = data;
 
-    uint32_t index_start = hash_time33 % me->prime_max;
-    uint32_t index;
-    uint32_t times_count = 0;
-    for (uint32_t i = 0; i < me->capacity; i ++)
+    if (_find(me, name, slot.hash, slot.len) >= 0)
     {
-        index = (index_start + i) % me->capacity;
-        if (me->table[index].data == NULL)
-        {
-            me->table[index].data = data;
-            me->table[index].hash_time33 = hash_time33;
-            me->table[index].hash_elf = hash_elf;
-            me->table[index].hash_bkdr = hash_bkdr;
-            ret = ELAB_OK;
-            break;
-        }
-        else
-        {
-            times_count ++;
-            if (times_count > HASH_SEEK_TIMES_MAX)
-            {
-                break;
-            }
-        }
+        return ELAB_ERROR;
     }
 
-    return ret;
+    if (me->resizable &&
+        (me->count + 1) * 8 > me->capacity * HASH_TABLE_LOAD_MAX)
+    {
+        _resize(me, me->capacity * 2);
+    }
+    if (me->count >= me->capacity)
+    {
+        return ELAB_ERR_FULL;
+    }
+
+    _insert(me, &slot);
+    me->count ++;
+
+    return ELAB_OK;
 }
 
 /**
@@ -126,17 +144,32 @@ elab_err_t hash_table_add(hash_table_t * const me, char *name, void *data)
   * @param  name        The given key name.
   * @retval See elab_err_t.
   */
-elab_err_t hash_table_remove(hash_table_t * const me, char *name)
+elab_err_t hash_table_remove(hash_table_t * const me, const char *name)
 {
-    elab_err_t ret = hash_table_index(me, name);
+    uint32_t len;
+    uint32_t hash = _hash(name, &len);
+    int32_t index = _find(me, name, hash, len);
+    if (index < 0)
+    {
+        return ELAB_ERROR;
+    }
 
-    if (ret != ELAB_ERROR)
+    /* Shift the following slots back, without leaving any tombstone. */
+    uint32_t i = (uint32_t)index;
+    while (1)
     {
-        me->table[ret].data = NULL;
-        ret = ELAB_OK;
+        uint32_t next = (i + 1 == me->capacity) ? 0 : (i + 1);
+        if (me->table[next].hash == 0 || _distance(me, next) == 0)
+        {
+            break;
+        }
+        me->table[i] = me->table[next];
+        i = next;
     }
+    memset(&me->table[i], 0, sizeof(hash_table_data_t));
+    me->count --;
 
-    return ret;
+    return ELAB_OK;
 }
 
 /**
@@ -145,11 +178,13 @@ elab_err_t hash_table_remove(hash_table_t * const me, char *name)
   * @param  name        The given key name.
   * @retval The data block pointer.
   */
-void *hash_table_get(hash_table_t * const me, char *name)
+void *hash_table_get(hash_table_t * const me, const char *name)
 {
-    uint32_t ret = hash_table_index(me, name);
+    uint32_t len;
+    uint32_t hash = _hash(name, &len);
+    int32_t index = _find(me, name, hash, len);
 
-    return ret == ELAB_ERROR ? NULL : me->table[ret].data;
+    return (index < 0) ? NULL : me->table[index].data;
 }
 
 /**
@@ -159,147 +194,132 @@ void *hash_table_get(hash_table_t * const me, char *name)
   * @param  name        The given key name.
   * @retval True or false.
   */
-bool hash_table_existent(hash_table_t * const me, char *name)
+bool hash_table_existent(hash_table_t * const me, const char *name)
 {
-    return hash_table_index(me, name) == ELAB_ERROR ? false : true;
+    return (hash_table_index(me, name) >= 0);
 }
 
 /**
-  * @brief  Get the data block's index from hash table by the given name.
+  * @brief  Get the data block's index from hash table by the given name. The
+  *         index changes when other names are added or removed.
   * @param  me          The hash table handle.
   * @param  name        The given key name.
-  * @retval The data block pointer.
+  * @retval The index, or ELAB_ERROR if not found.
   */
-int32_t hash_table_index(hash_table_t * const me, char *name)
+int32_t hash_table_index(hash_table_t * const me, const char *name)
 {
-    int32_t ret = ELAB_ERROR;
-    uint32_t hash_time33 = _hash_time33(name);
-    uint32_t hash_elf = _hash_elf(name);
-    uint32_t hash_bkdr = _hash_bkdr(name);
-
-    uint32_t index_start = hash_time33 % me->prime_max;
-    uint32_t index;
-    uint32_t times_count = 0;
-    for (uint32_t i = 0; i < me->capacity; i ++)
-    {
-        index = (index_start + i) % me->capacity;
-        if (me->table[index].data == NULL)
-        {
-            continue;
-        }
-        else 
-        if (me->table[index].hash_time33 == hash_time33 &&
-                    me->table[index].hash_elf == hash_elf &&
-                    me->table[index].hash_bkdr == hash_bkdr)
-        {
-            ret = index;
-            break;
-        }
-        else
-        {
-            times_count ++;
-            if (times_count > HASH_SEEK_TIMES_MAX)
-            {
-                break;
-            }
-        }
-    }
+    uint32_t len;
+    uint32_t hash = _hash(name, &len);
+    int32_t index = _find(me, name, hash, len);
 
-    return ret;
+    return (index < 0) ? ELAB_ERROR : index;
 }
 
 /* Private functions -------------------------------------------------------- */
 /**
-  * @brief  Get the maximum prime number in the specific range.
-  * @param  capacity  The given range size.
-  * @retval The maximum prime number.
+  * @brief  FNV-1a hash of the string, with the bits mixed at last as MurmurHash3
+  *         does, since the home slot is taken from the high bits.
+  * @param  str     The input string.
+  * @param  p_len   The string length output.
+  * @retval The hash value, never 0.
   */
-static uint32_t _get_prime_max(uint32_t capacity)
+static uint32_t _hash(const char *str, uint32_t *p_len)
 {
-    uint32_t prime_max = 0;
+    const char *p = str;
+    uint32_t hash = 2166136261U;
 
-    for (int64_t i = capacity; i > 0; i --)
+    while (*p != 0)
     {
-        bool is_prime = true;
-        for (uint32_t j = 2; j < capacity; j++)
-        {
-            if (i <= j)
-            {
-                break;
-            }
-            if ((i % j) == 0)
-            {
-                is_prime = false;
-                break;
-            }
-        }
-        if (is_prime)
-        {
-            prime_max = i;
-            break;
-        }
+        hash ^= (uint8_t)*p ++;
+        hash *= 16777619U;
     }
+    *p_len = (uint32_t)(p - str);
 
-    return prime_max;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+
+    return (hash == 0) ? 1 : hash;
 }
 
 /**
-  * @brief  Calculate the time33 hash value of one string.
-  * @param  str  The input string.
-  * @retval The time33 hash value.
+  * @brief  Find the slot of the name. The probing stops at the empty slot, or
+  *         at the slot nearer to its home than the name would be, as the names
+  *         are kept in the Robin Hood order.
+  * @retval The index, or -1 if not found.
   */
-static uint32_t _hash_time33(char *str)
-{  
-    uint32_t hash = 5381;
+static int32_t _find(hash_table_t * const me, const char *name,
+                        uint32_t hash, uint32_t len)
+{
+    uint32_t index = _home(me, hash);
 
-    while (*str)
+    for (uint32_t distance = 0; distance < me->capacity; distance ++)
     {
-        /* hash *= 33 */
-        hash = (*str++) + (hash << 5) + hash;
+        hash_table_data_t *slot = &me->table[index];
+        if (slot->hash == 0 || _distance(me, index) < distance)
+        {
+            break;
+        }
+        if (slot->hash == hash && slot->len == len &&
+            memcmp(slot->key, name, len) == 0)
+        {
+            return (int32_t)index;
+        }
+        index = (index + 1 == me->capacity) ? 0 : (index + 1);
     }
 
-    return hash;
+    return -1;
 }
 
 /**
-  * @brief  Calculate the ELF hash value of one string.
-  * @param  str  The input string.
-  * @retval The ELF hash value.
+  * @brief  Insert the slot, taking the place of the one nearer to its home, and
+  *         moving that one on. The table is not full.
   */
-uint32_t _hash_elf(char *str)
+static void _insert(hash_table_t * const me, hash_table_data_t *slot)
 {
-    uint32_t hash = 0;
-    uint32_t x	= 0;
- 
-    while (*str)
+    hash_table_data_t temp;
+    uint32_t index = _home(me, slot->hash);
+    uint32_t distance = 0;
+
+    while (me->table[index].hash != 0)
     {
-        hash = (hash << 4) + (*str++);
-        if ((x = hash & 0xF0000000L) != 0)
+        uint32_t distance_slot = _distance(me, index);
+        if (distance_slot < distance)
         {
-            hash ^= (x >> 24);
-            hash &= ~x;
+            temp = me->table[index];
+            me->table[index] = *slot;
+            *slot = temp;
+            distance = distance_slot;
         }
+        index = (index + 1 == me->capacity) ? 0 : (index + 1);
+        distance ++;
     }
- 
-    return (hash & 0x7FFFFFFF);
+    me->table[index] = *slot;
 }
 
 /**
-  * @brief  Calculate the BKDR hash value of one string.
-  * @param  str  The input string.
-  * @retval The BKDR hash value.
+  * @brief  Move all the slots into the new table in the given capacity.
   */
-uint32_t _hash_bkdr(char *str)
+static void _resize(hash_table_t * const me, uint32_t capacity)
 {
-    uint32_t seed = 131; /* 31 131 1313 13131 131313 etc.. */
-    uint32_t hash = 0;
- 
-    while (*str)
+    hash_table_data_t *table_old = me->table;
+    uint32_t capacity_old = me->capacity;
+
+    me->table = elab_malloc(sizeof(hash_table_data_t) * capacity);
+    elab_assert(me->table != NULL);
+    memset(me->table, 0, sizeof(hash_table_data_t) * capacity);
+    me->capacity = capacity;
+
+    for (uint32_t i = 0; i < capacity_old; i ++)
     {
-        hash = hash * seed + (*str++);
+        if (table_old[i].hash != 0)
+        {
+            _insert(me, &table_old[i]);
+        }
     }
- 
-    return (hash & 0x7FFFFFFF);
+    elab_free(table_old);
 }
 
 /* ----------------------------- end of file -------------------------------- */
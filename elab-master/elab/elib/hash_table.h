@@ -15,21 +15,21 @@ extern "C" {
 #endif
 
 /* public typedef ----------------------------------------------------------- */
-#define HASH_SEEK_TIMES_MAX                (32)
-
-/* public typedef ----------------------------------------------------------- */
+/* One slot, keeping the name by the pointer, which should be valid until it is
+   removed. Hash 0 means the slot is empty. */
 typedef struct hash_table_data
 {
-    uint32_t hash_time33;
-    uint32_t hash_elf;
-    uint32_t hash_bkdr;
+    uint32_t hash;
+    uint32_t len;
+    const char *key;
     void *data;
 } hash_table_data_t;
 
 typedef struct hash_table
 {
     uint32_t capacity;
-    uint32_t prime_max;
+    uint32_t count;
+    bool resizable;                             /* Created by hash_table_new */
     hash_table_data_t *table;
 } hash_table_t;
 
@@ -39,11 +39,11 @@ void hash_table_destroy(hash_table_t * const me);
 void hash_table_init(hash_table_t * const me,
                             hash_table_data_t *table,
                             uint32_t capacity);
-elab_err_t hash_table_add(hash_table_t * const me, char *name, void *data);
-elab_err_t hash_table_remove(hash_table_t * const me, char *name);
-void *hash_table_get(hash_table_t * const me, char *name);
-bool hash_table_existent(hash_table_t * const me, char *name);
-int32_t hash_table_index(hash_table_t * const me, char *name);
+elab_err_t hash_table_add(hash_table_t * const me, const char *name, void *data);
+elab_err_t hash_table_remove(hash_table_t * const me, const char *name);
+void *hash_table_get(hash_table_t * const me, const char *name);
+bool hash_table_existent(hash_table_t * const me, const char *name);
+int32_t hash_table_index(hash_table_t * const me, const char *name);
 
 #ifdef __cplusplus
 }
@@ -9,424 +9,977 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <ctype.h>
 #include "edb.h"
 #include "../../common/elab_assert.h"
-#include "../../os/cmsis_os.h"
+
+#if (EDB_SNAPSHOT_EN != 0)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 ELAB_TAG("edb");
 
 /* private config ----------------------------------------------------------- */
-#define EDB_BUFFER_SIZE                         (256)
+#define EDB_BUCKET_NUM_MIN                      (16)
+#define EDB_INDEX_NONE                          (UINT32_MAX)
+#define EDB_IMAGE_MAGIC                         (0x31424445U)   /* "EDB1" */
+#define EDB_IMAGE_VERSION                       (1)
+#define EDB_IMAGE_ALIGN(x)                      (((x) + 7U) & ~7U)
+
+/* ASCII lower case, for the names are compared case insensitively. */
+#define EDB_LOWER(c)                            \
+    ((uint8_t)(((c) >= 'A' && (c) <= 'Z') ? ((c) | 0x20) : (c)))
 
 /* private typedef ---------------------------------------------------------- */
-struct ini_t
+enum edb_key_flag
 {
-    char *data;
-    char *end;
+    EDB_KEY_FLAG_BOOL = 0x01,                   /* The value is true or false */
+    EDB_KEY_FLAG_TRUE = 0x02,
 };
 
-/* private function prototypes ---------------------------------------------- */
-static int32_t _get_string_index(char *buff_line, uint8_t index,
-                                    char *str, uint32_t size);
-static uint32_t _get_string(const char *section,
-                            const char *key,
-                            char *str,
-                            uint32_t size);
+/* The image, built from the INI text in loading, or mapped from the snapshot
+   compiled before. All the references in it are offsets from its start, and
+   the values are converted into all the types once in building. */
+typedef struct edb_image_head
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t head_size;
+    uint32_t size;                              /* Of the whole image */
+    uint32_t checksum;                          /* FNV-1a of all, as 0 here */
+    uint64_t source_size;                       /* Of the INI file */
+    int64_t source_mtime;                       /* Of the INI file */
+    uint32_t key_num;
+    uint32_t section_num;
+    uint32_t bucket_num;
+    uint32_t sub_num;
+    uint32_t offset_keys;
+    uint32_t offset_sections;
+    uint32_t offset_section_keys;               /* Key IDs grouped by section */
+    uint32_t offset_bucket;
+    uint32_t offset_subs;
+    uint32_t offset_strings;
+} edb_image_head_t;
+
+/* One key in the image, in the file order. */
+struct edb_key
+{
+    uint32_t key;                               /* Offsets in the strings */
+    uint32_t value;
+    uint32_t hash;
+    uint32_t next;                              /* Next key in the bucket */
+    uint32_t section;                           /* Section ID */
+    uint32_t sub;                               /* The first sub string ID */
+    uint16_t sub_num;
+    uint8_t flags;                              /* EDB_KEY_FLAG_xx */
+    uint8_t reserved;
+    uint32_t hex32;
+    float f;
+    uint64_t u64;
+    int64_t s64;
+    double d;
+};
+
+typedef struct edb_section
+{
+    uint32_t name;                              /* Offset in the strings */
+    uint32_t hash;
+    uint32_t offset;                            /* In the section keys */
+    uint32_t count;
+} edb_section_t;
+
+/* One sub string of the value split by ','. */
+typedef struct edb_sub
+{
+    uint32_t offset;                            /* In the strings */
+    uint32_t len;
+    int32_t s32;
+    float f;
+} edb_sub_t;
 
+/* private function prototypes ---------------------------------------------- */
 typedef struct ini_t ini_t;
 
+static edb_key_t *_key_get(const char *section, const char *key);
+static uint32_t _copy_string(const char *src, uint32_t len,
+                                char *str, uint32_t size);
+static uint32_t _hash(uint32_t hash, const char *str);
+static uint32_t _checksum(const edb_image_head_t *head);
+static int strcmpci(const char *a, const char *b);
+static char* next(ini_t *ini, char *p);
+static edb_image_head_t *_image_build(ini_t *ini);
+static uint32_t _image_string(edb_image_head_t *head, uint32_t *p_len,
+                                const char *str);
+static void _image_key_convert(edb_image_head_t *head, edb_key_t *key);
+static edb_key_t *_image_find(const edb_image_head_t *head,
+                                const char *section, const char *key);
+static edb_section_t *_image_find_section(const edb_image_head_t *head,
+                                            const char *section);
+#if (EDB_SNAPSHOT_EN != 0)
+static edb_image_head_t *_image_map(const char *path, struct stat *st_ini);
+static bool _image_write(edb_image_head_t *head, const char *path);
+static bool _image_table_valid(const edb_image_head_t *head, uint32_t offset,
+                                uint32_t count, uint32_t entry_size);
+#endif
+
 ini_t*      ini_load_file(const char *filename);
 ini_t*      ini_load_string(const char *str);
 void        ini_free(ini_t *ini);
-const char* ini_get(ini_t *ini, const char *section, const char *key);
-int         ini_sget(ini_t *ini, const char *section, const char *key, const char *scanfmt, void *dst);
-const char* int_get_key(ini_t *ini, const char *section, uint32_t index);
-int         int_get_section_size(ini_t *ini, const char *section);
+
+struct ini_t
+{
+    char *data;
+    char *end;
+};
 
 /* private variables -------------------------------------------------------- */
-static ini_t *edb_ini = NULL;
-static osMutexId_t *mutex_edb = NULL;
-static char buff_line[EDB_BUFFER_SIZE];
+static edb_image_head_t *edb_image = NULL;
+static bool edb_image_mapped = false;
 
-/**
- * The edb global mutex attribute.
- */
-static const osMutexAttr_t mutex_attr_edb =
+/* private inline functions ------------------------------------------------- */
+static inline edb_key_t *_image_keys(const edb_image_head_t *head)
 {
-    "mutex_edb", osMutexRecursive | osMutexPrioInherit, NULL, 0U 
-};
+    return (edb_key_t *)((uint8_t *)head + head->offset_keys);
+}
+
+static inline edb_section_t *_image_sections(const edb_image_head_t *head)
+{
+    return (edb_section_t *)((uint8_t *)head + head->offset_sections);
+}
+
+static inline uint32_t *_image_section_keys(const edb_image_head_t *head)
+{
+    return (uint32_t *)((uint8_t *)head + head->offset_section_keys);
+}
+
+static inline uint32_t *_image_bucket(const edb_image_head_t *head)
+{
+    return (uint32_t *)((uint8_t *)head + head->offset_bucket);
+}
+
+static inline edb_sub_t *_image_subs(const edb_image_head_t *head)
+{
+    return (edb_sub_t *)((uint8_t *)head + head->offset_subs);
+}
+
+static inline char *_image_strings(const edb_image_head_t *head)
+{
+    return (char *)head + head->offset_strings;
+}
 
 /* public function ---------------------------------------------------------- */
 void edb_init(uint8_t mode, const char *path_or_str)
 {
     elab_assert(mode == EDB_LOAD_MODE_FILE || mode == EDB_LOAD_MODE_STRING);
+    elab_assert(edb_image == NULL);
 
+    ini_t *ini = NULL;
     if (mode == EDB_LOAD_MODE_FILE)
     {
-        edb_ini = ini_load_file(path_or_str);
+        ini = ini_load_file(path_or_str);
     }
     else
     {
-        edb_ini = ini_load_string(path_or_str);
+        ini = ini_load_string(path_or_str);
     }
-    elab_assert(edb_ini != NULL);
+    elab_assert(ini != NULL);
 
-    mutex_edb = osMutexNew(&mutex_attr_edb);
-    elab_assert(mutex_edb != NULL);
+    edb_image = _image_build(ini);
+    edb_image_mapped = false;
+    ini_free(ini);
 }
 
-uint32_t edb_get_key_num(const char *section)
+#if (EDB_SNAPSHOT_EN != 0)
+/**
+ * @brief  Load the snapshot compiled from the INI file, mapping it read-only
+ *         with no parsing and no heap. If the snapshot is missing, broken or
+ *         older than the INI file, the INI file is parsed instead, and the
+ *         snapshot is compiled again for the next time.
+ * @param  path_ini         The INI file, which may be absent if the snapshot
+ *                          is deployed alone.
+ * @param  path_snapshot    The snapshot file.
+ * @retval True if loaded from the snapshot.
+ */
+bool edb_init_snapshot(const char *path_ini, const char *path_snapshot)
 {
-    osStatus_t ret_os = osOK;
+    elab_assert(edb_image == NULL);
+    elab_assert(path_ini != NULL && path_snapshot != NULL);
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    struct stat st_ini;
+    bool ini_exist = (stat(path_ini, &st_ini) == 0);
 
-    int ret_ini = 0;
-    ret_ini = int_get_section_size(edb_ini, section);
-    elab_assert(ret_ini >= 0);
+    edb_image = _image_map(path_snapshot, ini_exist ? &st_ini : NULL);
+    if (edb_image != NULL)
+    {
+        edb_image_mapped = true;
+        return true;
+    }
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+    elog_warn("Snapshot %s is not valid, %s is parsed.", path_snapshot, path_ini);
+    elab_assert(ini_exist);
+    edb_init(EDB_LOAD_MODE_FILE, path_ini);
+    edb_image->source_size = (uint64_t)st_ini.st_size;
+    edb_image->source_mtime = (int64_t)st_ini.st_mtime;
+    edb_image->checksum = _checksum(edb_image);
+    if (!_image_write(edb_image, path_snapshot))
+    {
+        elog_warn("Snapshot %s is not written.", path_snapshot);
+    }
 
-    return (uint32_t)ret_ini;
+    return false;
 }
 
-const char *edb_get_key(const char *section, uint32_t index)
+/**
+ * @brief  Compile the INI file into the snapshot, offline or in the first boot.
+ * @param  path_ini         The INI file.
+ * @param  path_snapshot    The snapshot file.
+ * @retval True if compiled.
+ */
+bool edb_compile(const char *path_ini, const char *path_snapshot)
 {
-    osStatus_t ret_os = osOK;
-    char *key = NULL;
+    elab_assert(path_ini != NULL && path_snapshot != NULL);
+
+    struct stat st_ini;
+    if (stat(path_ini, &st_ini) != 0)
+    {
+        return false;
+    }
+    ini_t *ini = ini_load_file(path_ini);
+    if (ini == NULL)
+    {
+        return false;
+    }
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    edb_image_head_t *head = _image_build(ini);
+    ini_free(ini);
+    head->source_size = (uint64_t)st_ini.st_size;
+    head->source_mtime = (int64_t)st_ini.st_mtime;
+    head->checksum = _checksum(head);
+    bool ret = _image_write(head, path_snapshot);
+    free(head);
 
-    key = (char *)int_get_key(edb_ini, section, index);
+    return ret;
+}
+#endif
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+/**
+ * @brief  Free the loaded data, after which the key handles are invalid.
+ */
+void edb_deinit(void)
+{
+    elab_assert(edb_image != NULL);
 
-    return (const char *)key;
+#if (EDB_SNAPSHOT_EN != 0)
+    if (edb_image_mapped)
+    {
+        int ret = munmap(edb_image, edb_image->size);
+        elab_assert(ret == 0);
+    }
+    else
+#endif
+    {
+        free(edb_image);
+    }
+    edb_image = NULL;
 }
 
-uint32_t edb_get_hex32(const char *section, const char *key)
+uint32_t edb_get_key_num(const char *section)
 {
-    uint32_t value_u32 = 0;
-    osStatus_t ret_os = osOK;
+    if (section == NULL)
+    {
+        return edb_image->key_num;
+    }
+
+    edb_section_t *sec = _image_find_section(edb_image, section);
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    return (sec == NULL) ? 0 : sec->count;
+}
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%x", &value_u32);
-    elab_assert(ret_ini == 1);
+const char *edb_get_key(const char *section, uint32_t index)
+{
+    uint32_t id = index;
+
+    if (section == NULL)
+    {
+        elab_assert(index < edb_image->key_num);
+    }
+    else
+    {
+        edb_section_t *sec = _image_find_section(edb_image, section);
+        elab_assert(sec != NULL && index < sec->count);
+        id = _image_section_keys(edb_image)[sec->offset + index];
+    }
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+    return &_image_strings(edb_image)[_image_keys(edb_image)[id].key];
+}
 
-    return value_u32;
+uint32_t edb_get_hex32(const char *section, const char *key)
+{
+    return edb_key_get_hex32(_key_get(section, key));
 }
 
 uint32_t edb_get_u32(const char *section, const char *key)
 {
-    uint32_t value_u32 = 0;
-    osStatus_t ret_os = osOK;
+    return edb_key_get_u32(_key_get(section, key));
+}
+
+int32_t edb_get_s32(const char *section, const char *key)
+{
+    return edb_key_get_s32(_key_get(section, key));
+}
+
+uint64_t edb_get_u64(const char *section, const char *key)
+{
+    return edb_key_get_u64(_key_get(section, key));
+}
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+int64_t edb_get_s64(const char *section, const char *key)
+{
+    return edb_key_get_s64(_key_get(section, key));
+}
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%u", &value_u32);
-    elab_assert(ret_ini == 1);
+bool edb_get_bool(const char *section, const char *key)
+{
+    return edb_key_get_bool(_key_get(section, key));
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+float edb_get_float(const char *section, const char *key)
+{
+    return edb_key_get_float(_key_get(section, key));
+}
 
-    return value_u32;
+double edb_get_double(const char *section, const char *key)
+{
+    return edb_key_get_double(_key_get(section, key));
 }
 
-int32_t edb_get_s32(const char *section, const char *key)
+uint32_t edb_get_string(const char *section,
+                        const char *key,
+                        char *str,
+                        uint32_t size)
 {
-    int32_t value_s32 = 0;
-    osStatus_t ret_os = osOK;
+    return edb_key_get_string(_key_get(section, key), str, size);
+}
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+bool edb_str_cmp(const char *section, const char *key, const char *str)
+{
+    edb_key_t *_key = _key_get(section, key);
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%d", &value_s32);
-    elab_assert(ret_ini == 1);
+    return (strcmp(&_image_strings(edb_image)[_key->value], str) == 0);
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+uint32_t edb_get_sub_u32(const char *section, const char *key, uint8_t index)
+{
+    return edb_key_get_sub_u32(_key_get(section, key), index);
+}
 
-    return value_s32;
+float edb_get_sub_float(const char *section, const char *key, uint8_t index)
+{
+    return edb_key_get_sub_float(_key_get(section, key), index);
 }
 
-uint64_t edb_get_u64(const char *section, const char *key)
+uint32_t edb_get_sub_string(const char *section,
+                            const char *key,
+                            uint8_t index,
+                            char *str, uint32_t size)
 {
-    uint32_t value_u64 = 0;
-    osStatus_t ret_os = osOK;
+    return edb_key_get_sub_string(_key_get(section, key), index, str, size);
+}
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+/**
+ * @brief  Resolve the key once, to be read many times by the handle.
+ * @param  section  The section name, or NULL for the key in any section.
+ * @param  key      The key name.
+ * @retval The key handle, or NULL if not found.
+ */
+edb_key_t *edb_key_find(const char *section, const char *key)
+{
+    elab_assert(edb_image != NULL);
+    elab_assert(key != NULL);
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%lu", &value_u64);
-    elab_assert(ret_ini == 1);
+    return _image_find(edb_image, section, key);
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+uint32_t edb_key_get_hex32(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    return value_u64;
+    return key->hex32;
 }
 
-int64_t edb_get_s64(const char *section, const char *key)
+uint32_t edb_key_get_u32(edb_key_t *key)
 {
-    uint32_t value_s64 = 0;
-    osStatus_t ret_os = osOK;
+    elab_assert(key != NULL);
+
+    return (uint32_t)key->u64;
+}
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+int32_t edb_key_get_s32(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%ld", &value_s64);
-    elab_assert(ret_ini == 1);
+    return (int32_t)key->s64;
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+uint64_t edb_key_get_u64(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    return value_s64;
+    return key->u64;
 }
 
-bool edb_get_bool(const char *section, const char *key)
+int64_t edb_key_get_s64(edb_key_t *key)
 {
-    bool value = false;
-    osStatus_t ret_os = osOK;
+    elab_assert(key != NULL);
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    return key->s64;
+}
 
-    const char *str = ini_get(edb_ini, section, key);
-    elab_assert(str != NULL);
+bool edb_key_get_bool(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    if (strncmp(str, "true", 4) == 0)
+    if ((key->flags & EDB_KEY_FLAG_BOOL) == 0)
     {
-        value = true;
-    }
-    else if (strncmp(str, "false", 5) == 0)
-    {
-        value = false;
-    }
-    else
-    {
-        printf("%s.\n", str);
+        printf("%s.\n", &_image_strings(edb_image)[key->value]);
         elab_assert(false);
     }
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
-
-    return value;
+    return ((key->flags & EDB_KEY_FLAG_TRUE) != 0);
 }
 
-float edb_get_float(const char *section, const char *key)
+float edb_key_get_float(edb_key_t *key)
 {
-    float value = 0;
-    osStatus_t ret_os = osOK;
-
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    elab_assert(key != NULL);
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%f", &value);
-    elab_assert(ret_ini == 1);
+    return key->f;
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+double edb_key_get_double(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    return value;
+    return key->d;
 }
 
-double edb_get_double(const char *section, const char *key)
+uint32_t edb_key_get_string(edb_key_t *key, char *str, uint32_t size)
 {
-    double value = 0;
-    osStatus_t ret_os = osOK;
+    elab_assert(key != NULL);
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    const char *value = &_image_strings(edb_image)[key->value];
 
-    int ret_ini = 0;
-    ret_ini = ini_sget(edb_ini, section, key, "%lf", &value);
-    elab_assert(ret_ini == 1);
+    return _copy_string(value, strlen(value), str, size);
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+/**
+ * @brief  Get the number of the sub strings split by ',' in the value.
+ */
+uint32_t edb_key_get_sub_num(edb_key_t *key)
+{
+    elab_assert(key != NULL);
 
-    return value;
+    return key->sub_num;
 }
 
-uint32_t edb_get_string(const char *section,
-                        const char *key,
-                        char *str,
-                        uint32_t size)
+uint32_t edb_key_get_sub_u32(edb_key_t *key, uint8_t index)
 {
-    osStatus_t ret_os = osOK;
+    elab_assert(key != NULL);
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    if (index >= key->sub_num)
+    {
+        elog_error("Value %s has not so much intervals.",
+                    &_image_strings(edb_image)[key->value]);
+        return 0;
+    }
 
-    uint32_t size_cp = _get_string(section, key, str, size);
+    return (uint32_t)_image_subs(edb_image)[key->sub + index].s32;
+}
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+float edb_key_get_sub_float(edb_key_t *key, uint8_t index)
+{
+    elab_assert(key != NULL);
 
-    return size_cp;
+    if (index >= key->sub_num)
+    {
+        elog_error("Value %s has not so much intervals.",
+                    &_image_strings(edb_image)[key->value]);
+        return 0;
+    }
+
+    return _image_subs(edb_image)[key->sub + index].f;
 }
 
-bool edb_str_cmp(const char *section, const char *key, const char *str)
+uint32_t edb_key_get_sub_string(edb_key_t *key, uint8_t index,
+                                char *str, uint32_t size)
 {
-    bool ret = false;
-
-    osStatus_t ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    elab_assert(key != NULL);
 
-    uint32_t size_cp = _get_string(section, key, buff_line, (EDB_BUFFER_SIZE - 1));
-    if (strcmp(buff_line, str) == 0)
+    if (index >= key->sub_num)
     {
-        ret = true;
+        elog_error("Value %s has not so much intervals.",
+                    &_image_strings(edb_image)[key->value]);
+        str[0] = 0;
+        return 0;
     }
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+    edb_sub_t *sub = &_image_subs(edb_image)[key->sub + index];
 
-    return ret;
+    return _copy_string(&_image_strings(edb_image)[sub->offset], sub->len,
+                        str, size);
 }
 
-uint32_t edb_get_sub_u32(const char *section, const char *key, uint8_t index)
+/* private function --------------------------------------------------------- */
+static edb_key_t *_key_get(const char *section, const char *key)
 {
-    uint32_t value = 0;
+    edb_key_t *_key = edb_key_find(section, key);
+    if (_key == NULL)
+    {
+        elog_error("Key %s in section %s is not found.",
+                    key, (section == NULL) ? "" : section);
+    }
+    elab_assert(_key != NULL);
 
-    #define EDB_BUFF_SIZE_U32                   (12)
+    return _key;
+}
 
-    char buff[EDB_BUFF_SIZE_U32];
-    memset(buff, 0, EDB_BUFF_SIZE_U32);
-    edb_get_sub_string(section, key, index, buff, EDB_BUFF_SIZE_U32);
-    value = atoi(buff);
+static uint32_t _copy_string(const char *src, uint32_t len,
+                                char *str, uint32_t size)
+{
+    elab_assert(str != NULL && size > 0);
 
-    #undef EDB_BUFF_SIZE_U32
+    uint32_t size_cp = ((size - 1) < len) ? (size - 1) : len;
+    memcpy(str, src, size_cp);
+    str[size_cp] = 0;
 
-    return value;
+    return size_cp;
 }
 
-float edb_get_sub_float(const char *section, const char *key, uint8_t index)
+/**
+ * @brief  FNV-1a hash of the string, case insensitive.
+ */
+static uint32_t _hash(uint32_t hash, const char *str)
 {
-    float value = 0;
+    while (*str != 0)
+    {
+        hash ^= EDB_LOWER(*str);
+        str ++;
+        hash *= 16777619U;
+    }
 
-    #define EDB_BUFF_SIZE_FLOAT                   (12)
+    /* The terminator, to tell "ab" + "c" from "a" + "bc". */
+    return hash * 16777619U;
+}
 
-    char buff[EDB_BUFF_SIZE_FLOAT];
-    memset(buff, 0, EDB_BUFF_SIZE_FLOAT);
-    edb_get_sub_string(section, key, index, buff, EDB_BUFF_SIZE_FLOAT);
-    value = atof(buff);
+/**
+ * @brief  FNV-1a hash of the whole image with its head, word by word, as the
+ *         image is 8 bytes aligned. The checksum field is taken as 0.
+ */
+static uint32_t _checksum(const edb_image_head_t *head)
+{
+    const uint32_t *data = (const uint32_t *)head;
+    const uint32_t index_checksum = offsetof(edb_image_head_t, checksum) / 4;
+    uint32_t hash = 2166136261U;
 
-    #undef EDB_BUFF_SIZE_U32
+    for (uint32_t i = 0; i < head->size / 4; i ++)
+    {
+        hash ^= (i == index_checksum) ? 0 : data[i];
+        hash *= 16777619U;
+    }
 
-    return value;
+    return hash;
 }
 
-uint32_t edb_get_sub_string(const char *section,
-                            const char *key,
-                            uint8_t index,
-                            char *str, uint32_t size)
+/**
+ * @brief  Build the image of the split data, with the sections and keys
+ *         indexed, and the values converted. The first one of the duplicated
+ *         keys in one section is found, as the linear scan did.
+ */
+static edb_image_head_t *_image_build(ini_t *ini)
 {
-    uint32_t ret_size = 0;
-    osStatus_t ret_os = osOK;
+    const char *current_section = "";
+    char *p = ini->data;
+    uint32_t key_num = 0;
+    uint32_t section_num = 1;
+    uint32_t sub_num = 0;
+    uint32_t strings_size = 1;
 
-    ret_os = osMutexAcquire(mutex_edb, osWaitForever);
-    elab_assert(ret_os == osOK);
+    /* Count the keys, the section headers, the sub strings and the strings. */
+    if (*p == '\0')
+    {
+        p = next(ini, p);
+    }
+    while (p < ini->end)
+    {
+        if (*p == '[')
+        {
+            section_num ++;
+            strings_size += strlen(p + 1) + 1;
+        }
+        else
+        {
+            key_num ++;
+            strings_size += strlen(p) + 1;
+            p = next(ini, p);
+            strings_size += strlen(p) + 1;
+            sub_num ++;
+            for (const char *c = p; *c != 0; c ++)
+            {
+                sub_num += (*c == ',') ? 1 : 0;
+            }
+        }
+        p = next(ini, p);
+    }
+
+    uint32_t bucket_num = EDB_BUCKET_NUM_MIN;
+    while (bucket_num < key_num * 2)
+    {
+        bucket_num <<= 1;
+    }
+
+    /* Lay out the image. */
+    uint32_t size = EDB_IMAGE_ALIGN(sizeof(edb_image_head_t));
+    uint32_t offset_keys = size;
+    size = EDB_IMAGE_ALIGN(size + key_num * sizeof(edb_key_t));
+    uint32_t offset_sections = size;
+    size = EDB_IMAGE_ALIGN(size + section_num * sizeof(edb_section_t));
+    uint32_t offset_section_keys = size;
+    size = EDB_IMAGE_ALIGN(size + key_num * sizeof(uint32_t));
+    uint32_t offset_bucket = size;
+    size = EDB_IMAGE_ALIGN(size + bucket_num * sizeof(uint32_t));
+    uint32_t offset_subs = size;
+    size = EDB_IMAGE_ALIGN(size + sub_num * sizeof(edb_sub_t));
+    uint32_t offset_strings = size;
+    size = EDB_IMAGE_ALIGN(size + strings_size);
+
+    edb_image_head_t *head = malloc(size);
+    elab_assert(head != NULL);
+    memset(head, 0, size);
+    head->magic = EDB_IMAGE_MAGIC;
+    head->version = EDB_IMAGE_VERSION;
+    head->head_size = sizeof(edb_image_head_t);
+    head->size = size;
+    head->bucket_num = bucket_num;
+    head->offset_keys = offset_keys;
+    head->offset_sections = offset_sections;
+    head->offset_section_keys = offset_section_keys;
+    head->offset_bucket = offset_bucket;
+    head->offset_subs = offset_subs;
+    head->offset_strings = offset_strings;
+    memset(_image_bucket(head), 0xff, bucket_num * sizeof(uint32_t));
+
+    /* Index the keys in the file order, the sections merged by the name. The
+       string at offset 0 is the empty one. */
+    uint32_t strings_len = 1;
+    edb_section_t *section = NULL;
+    p = ini->data;
+    if (*p == '\0')
+    {
+        p = next(ini, p);
+    }
+    while (p < ini->end)
+    {
+        if (*p == '[')
+        {
+            current_section = p + 1;
+            section = NULL;
+        }
+        else
+        {
+            if (section == NULL)
+            {
+                section = _image_find_section(head, current_section);
+            }
+            if (section == NULL)
+            {
+                section = &_image_sections(head)[head->section_num ++];
+                section->name = _image_string(head, &strings_len,
+                                                current_section);
+                section->hash = _hash(2166136261U, current_section);
+            }
 
-    uint32_t size_cp = _get_string(section, key, buff_line, (EDB_BUFFER_SIZE - 1));
-    ret_size = _get_string_index(buff_line, index, str, (size - 1));
+            edb_key_t *key = &_image_keys(head)[head->key_num];
+            key->key = _image_string(head, &strings_len, p);
+            p = next(ini, p);
+            key->value = _image_string(head, &strings_len, p);
+            key->section = (uint32_t)(section - _image_sections(head));
+            key->hash = _hash(section->hash, &_image_strings(head)[key->key]);
+            key->next = EDB_INDEX_NONE;
+            section->count ++;
+            _image_key_convert(head, key);
+
+            if (_image_find(head, &_image_strings(head)[section->name],
+                            &_image_strings(head)[key->key]) == NULL)
+            {
+                uint32_t *bucket = &_image_bucket(head)[key->hash &
+                                                        (bucket_num - 1)];
+                key->next = *bucket;
+                *bucket = head->key_num;
+            }
+            head->key_num ++;
+        }
+        p = next(ini, p);
+    }
 
-    ret_os = osMutexRelease(mutex_edb);
-    elab_assert(ret_os == osOK);
+    /* Group the keys by the section, in the file order. */
+    edb_section_t *sections = _image_sections(head);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < head->section_num; i ++)
+    {
+        sections[i].offset = offset;
+        offset += sections[i].count;
+        sections[i].count = 0;
+    }
+    for (uint32_t i = 0; i < head->key_num; i ++)
+    {
+        edb_section_t *sec = &sections[_image_keys(head)[i].section];
+        _image_section_keys(head)[sec->offset + sec->count ++] = i;
+    }
 
-    return ret_size;
+    return head;
 }
 
-/* private function --------------------------------------------------------- */
-static uint32_t _get_string(const char *section,
-                            const char *key,
-                            char *str,
-                            uint32_t size)
+/**
+ * @brief  Append the string into the image, the one same as the last one
+ *         shared.
+ * @retval The offset of the string.
+ */
+static uint32_t _image_string(edb_image_head_t *head, uint32_t *p_len,
+                                const char *str)
 {
-    const char *_str = ini_get(edb_ini, section, key);
-    elab_assert(str != NULL);
+    char *strings = _image_strings(head);
+    uint32_t len = strlen(str) + 1;
 
-    uint32_t size_cp = strlen(_str);
-    size_cp = ((size - 1) < size_cp) ? (size - 1) : size_cp;
-    memcpy(str, _str, size_cp);
-    str[size_cp] = 0;
+    if (len == 1)
+    {
+        return 0;
+    }
+    memcpy(&strings[*p_len], str, len);
+    *p_len += len;
 
-    return size_cp;
+    return *p_len - len;
+}
+
+/**
+ * @brief  Convert the value of the key into all the types, and split it into
+ *         the sub strings.
+ */
+static void _image_key_convert(edb_image_head_t *head, edb_key_t *key)
+{
+    const char *value = &_image_strings(head)[key->value];
+
+    key->u64 = strtoull(value, NULL, 10);
+    key->s64 = strtoll(value, NULL, 10);
+    key->hex32 = (uint32_t)strtoul(value, NULL, 16);
+    key->f = strtof(value, NULL);
+    key->d = strtod(value, NULL);
+    if (strncmp(value, "true", 4) == 0)
+    {
+        key->flags = EDB_KEY_FLAG_BOOL | EDB_KEY_FLAG_TRUE;
+    }
+    else if (strncmp(value, "false", 5) == 0)
+    {
+        key->flags = EDB_KEY_FLAG_BOOL;
+    }
+
+    key->sub = head->sub_num;
+    const char *start = value;
+    while (1)
+    {
+        edb_sub_t *sub = &_image_subs(head)[head->sub_num ++];
+        sub->offset = key->value + (uint32_t)(start - value);
+        sub->len = strcspn(start, ",\r\n");
+        sub->s32 = atoi(start);
+        sub->f = atof(start);
+        key->sub_num ++;
+
+        start = strchr(start, ',');
+        if (start == NULL)
+        {
+            break;
+        }
+        start ++;
+    }
 }
 
-static int32_t _get_string_index(char *buff_line, uint8_t index,
-                                    char *str, uint32_t size)
+static edb_key_t *_image_find(const edb_image_head_t *head,
+                                const char *section, const char *key)
 {
-    int32_t ret = 0;
-    char *str_start = buff_line;
-    uint32_t count_cp = 0;
+    edb_key_t *keys = _image_keys(head);
+    const char *strings = _image_strings(head);
 
-    if (index > 0)
+    /* The key in any section, in the file order. */
+    if (section == NULL)
     {
-        uint8_t interval_count = 0;
-        bool existent = false;
-        for (uint32_t i = 0; i < strlen(buff_line); i ++)
+        for (uint32_t i = 0; i < head->key_num; i ++)
         {
-            if (buff_line[i] == ',')
+            if (strcmpci(&strings[keys[i].key], key) == 0)
             {
-                interval_count ++;
-                if (interval_count == index)
-                {
-                    str_start = &buff_line[i + 1];
-                    existent = true;
-                    break;
-                }
+                return &keys[i];
             }
         }
 
-        if (!existent)
+        return NULL;
+    }
+
+    uint32_t hash = _hash(_hash(2166136261U, section), key);
+    uint32_t id = _image_bucket(head)[hash & (head->bucket_num - 1)];
+    while (id != EDB_INDEX_NONE)
+    {
+        edb_key_t *_key = &keys[id];
+        if (_key->hash == hash && strcmpci(&strings[_key->key], key) == 0 &&
+            strcmpci(&strings[_image_sections(head)[_key->section].name],
+                        section) == 0)
         {
-            ret = -1;
-            elog_error("Buffer %s has not so much intervals.", buff_line);
-            goto exit;
+            return _key;
         }
+        id = _key->next;
     }
 
-    while (1)
+    return NULL;
+}
+
+static edb_section_t *_image_find_section(const edb_image_head_t *head,
+                                            const char *section)
+{
+    edb_section_t *sections = _image_sections(head);
+    uint32_t hash = _hash(2166136261U, section);
+
+    for (uint32_t i = 0; i < head->section_num; i ++)
     {
-        str[count_cp] = str_start[count_cp];
-        count_cp ++;
-        if (count_cp > size || str_start[count_cp] == '\n' ||
-            str_start[count_cp] == '\r' || str_start[count_cp] == ',')
+        if (sections[i].hash == hash &&
+            strcmpci(&_image_strings(head)[sections[i].name], section) == 0)
         {
-            break;
+            return &sections[i];
         }
     }
 
+    return NULL;
+}
+
+#if (EDB_SNAPSHOT_EN != 0)
+/**
+ * @brief  Map the snapshot read-only, and check it is complete and not older
+ *         than the INI file.
+ * @param  path     The snapshot file.
+ * @param  st_ini   The status of the INI file, or NULL if absent.
+ * @retval The image, or NULL if not valid.
+ */
+static edb_image_head_t *_image_map(const char *path, struct stat *st_ini)
+{
+    struct stat st;
+    edb_image_head_t *head = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(edb_image_head_t))
+    {
+        goto exit;
+    }
+
+    head = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (head == MAP_FAILED)
+    {
+        head = NULL;
+        goto exit;
+    }
+
+    bool valid = (head->magic == EDB_IMAGE_MAGIC &&
+                    head->version == EDB_IMAGE_VERSION &&
+                    head->head_size == sizeof(edb_image_head_t) &&
+                    head->size == (uint32_t)st.st_size &&
+                    (head->size % 8) == 0);
+    if (valid)
+    {
+        /* All the tables in the image, and the strings ending in it. */
+        valid = (_image_table_valid(head, head->offset_keys,
+                                    head->key_num, sizeof(edb_key_t)) &&
+                 _image_table_valid(head, head->offset_sections,
+                                    head->section_num, sizeof(edb_section_t)) &&
+                 _image_table_valid(head, head->offset_section_keys,
+                                    head->key_num, sizeof(uint32_t)) &&
+                 _image_table_valid(head, head->offset_bucket,
+                                    head->bucket_num, sizeof(uint32_t)) &&
+                 _image_table_valid(head, head->offset_subs,
+                                    head->sub_num, sizeof(edb_sub_t)) &&
+                 _image_table_valid(head, head->offset_strings, 1, 1) &&
+                 head->bucket_num != 0 &&
+                 (head->bucket_num & (head->bucket_num - 1)) == 0 &&
+                 ((const char *)head)[head->size - 1] == '\0');
+    }
+    if (valid && st_ini != NULL)
+    {
+        valid = (head->source_size == (uint64_t)st_ini->st_size &&
+                    head->source_mtime == (int64_t)st_ini->st_mtime);
+    }
+    if (valid)
+    {
+        valid = (head->checksum == _checksum(head));
+    }
+    if (!valid)
+    {
+        munmap(head, st.st_size);
+        head = NULL;
+    }
+
 exit:
-    return ret;
+    close(fd);
+
+    return head;
 }
 
+/**
+ * @brief  Check one table of the mapped image is aligned, and lies after the
+ *         head and within the image.
+ */
+static bool _image_table_valid(const edb_image_head_t *head, uint32_t offset,
+                                uint32_t count, uint32_t entry_size)
+{
+    return (offset >= head->head_size &&
+            (offset % 8) == 0 &&
+            (uint64_t)offset + (uint64_t)count * entry_size <= head->size);
+}
+
+/**
+ * @brief  Write the image into the snapshot file, replacing the old one at
+ *         once in the end.
+ */
+static bool _image_write(edb_image_head_t *head, const char *path)
+{
+    bool ret = false;
+    char *path_tmp = malloc(strlen(path) + 5);
+    elab_assert(path_tmp != NULL);
+    sprintf(path_tmp, "%s.tmp", path);
+
+    FILE *fp = fopen(path_tmp, "wb");
+    if (fp != NULL)
+    {
+        ret = (fwrite(head, 1, head->size, fp) == head->size);
+        ret = (fclose(fp) == 0) && ret;
+        ret = ret && (rename(path_tmp, path) == 0);
+        if (!ret)
+        {
+            remove(path_tmp);
+        }
+    }
+    free(path_tmp);
+
+    return ret;
+}
+#endif
 
 /* Case insensitive string compare */
 static int strcmpci(const char *a, const char *b)
 {
     for (;;)
     {
-        int d = tolower(*a) - tolower(*b);
+        int d = EDB_LOWER(*a) - EDB_LOWER(*b);
         if (d != 0 || !*a)
         {
             return d;
@@ -661,142 +1214,4 @@ void ini_free(ini_t *ini)
     free(ini);
 }
 
-
-const char* ini_get(ini_t *ini, const char *section, const char *key)
-{
-    char *current_section = "";
-    char *val = NULL;
-    char *p = ini->data;
-
-    if (*p == '\0')
-    {
-        p = next(ini, p);
-    }
-
-    while (p < ini->end)
-    {
-        if (*p == '[')
-        {
-            /* Handle section */
-            current_section = p + 1;
-        }
-        else
-        {
-            /* Handle key */
-            val = next(ini, p);
-            if (!section || !strcmpci(section, current_section))
-            {
-                if (!strcmpci(p, key))
-                {
-                    return val;
-                }
-            }
-            p = val;
-        }
-
-        p = next(ini, p);
-    }
-
-    return NULL;
-}
-
-int int_get_section_size(ini_t *ini, const char *section)
-{
-    char *current_section = "";
-    char *val = NULL;
-    char *p = ini->data;
-    int count = 0;
-
-    if (*p == '\0')
-    {
-        p = next(ini, p);
-    }
-
-    while (p < ini->end)
-    {
-        if (*p == '[')
-        {
-            /* Handle section */
-            current_section = p + 1;
-        }
-        else
-        {
-            /* Handle key */
-            val = next(ini, p);
-            if (!section || !strcmpci(section, current_section))
-            {
-                count ++;
-            }
-            p = val;
-        }
-
-        p = next(ini, p);
-    }
-
-    return count;
-}
-
-const char* int_get_key(ini_t *ini, const char *section, uint32_t index)
-{
-    int size = int_get_section_size(ini, section);
-    assert(index < size);
-
-    char *current_section = "";
-    char *val = NULL;
-    char *p = ini->data;
-    int count = 0;
-
-    if (*p == '\0')
-    {
-        p = next(ini, p);
-    }
-
-    while (p < ini->end)
-    {
-        if (*p == '[')
-        {
-            /* Handle section */
-            current_section = p + 1;
-        }
-        else
-        {
-            /* Handle key */
-            if (!section || !strcmpci(section, current_section))
-            {
-                if (count == index)
-                {
-                    return p;
-                }
-                count ++;
-            }
-            val = next(ini, p);
-            p = val;
-        }
-
-        p = next(ini, p);
-    }
-
-    return NULL;
-}
-
-int ini_sget(ini_t *ini, const char *section, const char *key,
-                const char *scanfmt, void *dst)
-{
-    const char *val = ini_get(ini, section, key);
-    if (!val)
-    {
-        return 0;
-    }
-    if (scanfmt)
-    {
-        sscanf(val, scanfmt, dst);
-    }
-    else
-    {
-        *((const char**) dst) = val;
-    }
-
-    return 1;
-}
-
 /* ----------------------------- end of file -------------------------------- */
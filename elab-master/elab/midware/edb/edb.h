@@ -18,8 +18,26 @@ enum edb_load_mode
     EDB_LOAD_MODE_STRING,
 };
 
+/* public config ------------------------------------------------------------ */
+/* The binary snapshot, mapped by mmap. */
+#ifndef EDB_SNAPSHOT_EN
+#if defined(__linux__)
+#define EDB_SNAPSHOT_EN                         (1)
+#else
+#define EDB_SNAPSHOT_EN                         (0)
+#endif
+#endif
+
+/* public typedef ----------------------------------------------------------- */
+typedef struct edb_key edb_key_t;
+
 /* public define ------------------------------------------------------------ */
 void edb_init(uint8_t mode, const char *path_or_str);
+void edb_deinit(void);
+#if (EDB_SNAPSHOT_EN != 0)
+bool edb_init_snapshot(const char *path_ini, const char *path_snapshot);
+bool edb_compile(const char *path_ini, const char *path_snapshot);
+#endif
 uint32_t edb_get_hex32(const char *section, const char *key);
 uint32_t edb_get_u32(const char *section, const char *key);
 int32_t edb_get_s32(const char *section, const char *key);
@@ -44,6 +62,24 @@ uint32_t edb_get_sub_string(const char *section,
                             uint8_t index,
                             char *str, uint32_t size);
 
+/* Key handles, resolved once and read many times, with the values converted
+   once in loading. */
+edb_key_t *edb_key_find(const char *section, const char *key);
+uint32_t edb_key_get_hex32(edb_key_t *key);
+uint32_t edb_key_get_u32(edb_key_t *key);
+int32_t edb_key_get_s32(edb_key_t *key);
+uint64_t edb_key_get_u64(edb_key_t *key);
+int64_t edb_key_get_s64(edb_key_t *key);
+bool edb_key_get_bool(edb_key_t *key);
+float edb_key_get_float(edb_key_t *key);
+double edb_key_get_double(edb_key_t *key);
+uint32_t edb_key_get_string(edb_key_t *key, char *str, uint32_t size);
+uint32_t edb_key_get_sub_num(edb_key_t *key);
+uint32_t edb_key_get_sub_u32(edb_key_t *key, uint8_t index);
+float edb_key_get_sub_float(edb_key_t *key, uint8_t index);
+uint32_t edb_key_get_sub_string(edb_key_t *key, uint8_t index,
+                                char *str, uint32_t size);
+
 #endif
 
 /* ----------------------------- end of file -------------------------------- */
\ No newline at end of file
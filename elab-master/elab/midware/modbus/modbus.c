@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include "../../common/elab_assert.h"
 #include "../../common/elab_common.h"
+#include "../../elib/elib_crc.h"
 #include "modbus.h"
 
 ELAB_TAG("Modbus");
@@ -30,6 +31,11 @@ bool mb_rtu_rx(mb_channel_t *pch);
 void mb_rtu_tx(mb_channel_t *pch);
 #endif
 
+#if (MODBUS_CFG_TCP_EN != 0)
+uint16_t mb_tcp_rx_blocking(mb_channel_t *pch);
+void mb_tcp_destroy(mb_channel_t *pch);
+#endif
+
 #if (MODBUS_CFG_SLAVE_EN != 0)
 void mbs_rx_task(mb_channel_t *pch);
 #endif
@@ -108,20 +114,19 @@ mb_channel_t *mb_channel_create(const char *serial,
 #endif
 
 #if (MODBUS_CFG_SLAVE_EN != 0)
-    if (pch->m_or_s == MODBUS_SLAVE)
-    {
-        pch->thread_slave = osThreadNew(entry_slave_rx, pch, &mb_thread_rx_attr);
-        elab_assert(pch->thread_slave != NULL);
-    }
-
-    /* Freq * 5 char * 10 bits/char * 1 / baud_rate */
+    /* The RTU frame gap of 3.5 char * 11 bits/char in ms, rounded up. It is
+       not shorter than 5 ms, as the OS tick jitter would break the frames in
+       high baud rates. The requests to this node are ended by their sizes
+       before it. It is set before the slave thread starts, which reads it as
+       its rx timeout in the frame. */
     elab_serial_attr_t config = elab_serial_get_attr(pch->serial);
-    uint16_t cnts = ((uint32_t)1000 * 5L * 10L) / config.baud_rate;
-    if (cnts <= 1)
+    uint32_t cnts = ((uint32_t)1000 * 35L * 11L / 10 + config.baud_rate - 1) /
+                        config.baud_rate;
+    if (cnts < 5)
     {
         cnts = 5;
     }
-    pch->rtu_timeout = cnts;
+    pch->rtu_timeout = (uint16_t)cnts;
 
     pch->cb.coil_read = NULL;
     pch->cb.coil_write = NULL;
@@ -132,6 +137,12 @@ mb_channel_t *mb_channel_create(const char *serial,
     pch->cb.holding_reg_read_fp = NULL;
     pch->cb.holding_reg_write = NULL;
     pch->cb.holding_reg_write_fp = NULL;
+
+    if (pch->m_or_s == MODBUS_SLAVE)
+    {
+        pch->thread_slave = osThreadNew(entry_slave_rx, pch, &mb_thread_rx_attr);
+        elab_assert(pch->thread_slave != NULL);
+    }
 #endif
 
     return pch;
@@ -161,6 +172,14 @@ void mb_channel_destroy(mb_channel_t *pch)
     osStatus_t ret_os = osOK;
     elab_err_t ret = ELAB_OK;
 
+#if (MODBUS_CFG_TCP_EN != 0)
+    if (pch->mode == MODBUS_MODE_TCP)
+    {
+        mb_tcp_destroy(pch);
+        return;
+    }
+#endif
+
 #if (MODBUS_CFG_SLAVE_EN != 0)
     if (pch->m_or_s == MODBUS_SLAVE)
     {
@@ -304,7 +323,7 @@ bool mb_ascii_rx(mb_channel_t *pch)
     /* Message should have an ODD nbr of bytes. */
     if ((rx_size & 0x01) &&
         /* Check if message is long enough. */
-        (rx_size > MODBUS_ASCII_MIN_MSG_SIZE) &&
+        (rx_size >= MODBUS_ASCII_MIN_MSG_SIZE) &&
         /* Check the first char. */
         (pmsg[0] == MODBUS_ASCII_START_FRAME_CHAR) &&
         /* Check the last two. */
@@ -404,6 +423,20 @@ void mb_rtu_rx_byte(mb_channel_t *pch, uint8_t rx_byte)
         *pch->p_rx_buff++ = rx_byte;
         /* Increment byte counter to see if we have Rx activity. */
         pch->rx_buff_byte_count++;
+
+        /* Update the CRC as the bytes arrive. It lags two bytes behind, so it
+           is the CRC of the frame without the CRC bytes at the end. */
+        if (pch->rx_buff_byte_count == 1)
+        {
+            pch->rx_crc = ELIB_CRC16_MODBUS_INIT;
+            pch->rx_crc_count = 0;
+        }
+        else if (pch->rx_buff_byte_count >= 3)
+        {
+            pch->rx_crc = elib_crc16_modbus_byte(pch->rx_crc,
+                                    pch->rx_buff[pch->rx_buff_byte_count - 3]);
+            pch->rx_crc_count ++;
+        }
     }
 }
 #endif
@@ -444,32 +477,50 @@ bool mb_rtu_rx(mb_channel_t *pch)
 #if (MODBUS_CFG_RTU_EN != 0)
 void mb_rtu_tx(mb_channel_t *pch)
 {
-    elab_err_t ret = ELAB_OK;
+    int32_t ret = ELAB_OK;
+    uint8_t crc[2];
 
-    /* Include the actual data in the buffer. */
-    pch->tx_buff_byte_count = (uint8_t)pch->tx_frame_ndata_bytes + 2;
-    memcpy(pch->tx_buff, pch->tx_frame_data, pch->tx_buff_byte_count);
     /* Save the calculated CRC in the channel. */
     pch->tx_frame_crc = mb_rtu_tx_calc_crc(pch);
-    /* Add in the CRC checksum.  Low byte first! */
-    pch->tx_buff[pch->tx_buff_byte_count ++] = (uint8_t)(pch->tx_frame_crc & 0x00FF);
-    pch->tx_buff[pch->tx_buff_byte_count ++] = (uint8_t)(pch->tx_frame_crc >> 8);
+    /* The CRC checksum, low byte first! */
+    crc[0] = (uint8_t)(pch->tx_frame_crc & 0x00FF);
+    crc[1] = (uint8_t)(pch->tx_frame_crc >> 8);
+    /* Address, function code, data and CRC. */
+    pch->tx_buff_byte_count = (uint8_t)pch->tx_frame_ndata_bytes + 4;
 
-    /* Send it out the communication driver. */
-    ret = elab_serial_write(pch->serial, pch->tx_buff, pch->tx_buff_byte_count);
+    if (elab_serial_has_writev(pch->serial))
+    {
+        /* Send the frame data and the CRC out the communication driver
+           directly, without copying them into the tx buffer. */
+        elab_serial_iovec_t iov[2] =
+        {
+            { .buff = pch->tx_frame_data, .size = pch->tx_frame_ndata_bytes + 2, },
+            { .buff = crc, .size = 2, },
+        };
+        ret = elab_serial_writev(pch->serial, iov, 2);
+    }
+    else
+    {
+        /* Copy the whole frame into the tx buffer, and send it at one driver
+           writing, as a gap in the frame breaks it. */
+        memcpy(pch->tx_buff, pch->tx_frame_data, pch->tx_frame_ndata_bytes + 2);
+        pch->tx_buff[pch->tx_frame_ndata_bytes + 2] = crc[0];
+        pch->tx_buff[pch->tx_frame_ndata_bytes + 3] = crc[1];
+        ret = elab_serial_write(pch->serial, pch->tx_buff, pch->tx_buff_byte_count);
+    }
     elab_assert(ret == pch->tx_buff_byte_count);
 
 #if 0
     printf("Tx %u.\n", pch->tx_buff_byte_count);
-    for (uint32_t i = 0; i < pch->tx_buff_byte_count; i ++)
+    for (uint32_t i = 0; i < pch->tx_frame_ndata_bytes + 2; i ++)
     {
-        printf("0x%02x ", pch->tx_buff[i]);
+        printf("0x%02x ", pch->tx_frame_data[i]);
         if ((i + 1) % 16 == 0)
         {
             printf("\n");
         }
     }
-    printf("\n");
+    printf("0x%02x 0x%02x\n", crc[0], crc[1]);
 #endif
 }
 #endif
@@ -485,6 +536,13 @@ uint16_t mbm_rx_blocking(mb_channel_t *pch)
     elab_err_t ret = ELAB_OK;
     uint16_t error_id = MODBUS_ERR_NONE;
 
+#if (MODBUS_CFG_TCP_EN != 0)
+    if (pch->mode == MODBUS_MODE_TCP)
+    {
+        return mb_tcp_rx_blocking(pch);
+    }
+#endif
+
     ret = elab_serial_read(pch->serial,
                             pch->rx_buff, pch->size_expect, pch->rx_timeout);
     if (ret == ELAB_ERR_TIMEOUT || (ret >= 0 && ret < pch->size_expect))
@@ -499,6 +557,10 @@ uint16_t mbm_rx_blocking(mb_channel_t *pch)
     {
         pch->rx_buff_byte_count = ret;
     }
+#if (MODBUS_CFG_RTU_EN != 0)
+    /* Bulk-received bytes did not update the running CRC, so reset the cache. */
+    pch->rx_crc_count = 0;
+#endif
 
     return error_id;
 }
@@ -13,6 +13,19 @@
 #include "../../os/cmsis_os.h"
 #include "../../edf/normal/elab_serial.h"
 
+/* Exported config -----------------------------------------------------------*/
+#ifndef MODBUS_CFG_TCP_EN
+#if defined(__linux__)
+#define MODBUS_CFG_TCP_EN                       1
+#else
+#define MODBUS_CFG_TCP_EN                       0
+#endif
+#endif
+
+#ifndef MODBUS_CFG_TCP_CLIENT_MAX
+#define MODBUS_CFG_TCP_CLIENT_MAX               8
+#endif
+
 /* Exported typedef ----------------------------------------------------------*/
 typedef struct mb_channel_cb
 {
@@ -28,6 +41,27 @@ typedef struct mb_channel_cb
     void (* holding_reg_write_fp)(uint16_t reg, float reg_val_fp, uint16_t *perr);
 } mb_channel_cb_t;
 
+/* The block of contiguous registers mapped to one application array. */
+typedef struct mb_reg_map
+{
+    struct mb_reg_map *next;
+    uint8_t type;                               /* MB_REG_MAP_xx */
+    uint8_t access;                             /* MB_REG_ACCESS_xx */
+    uint16_t start_addr;
+    uint16_t nbr_regs;
+    void *data;                                 /* uint16_t array in host order,
+                                                   or float array if starting in
+                                                   the FP registers */
+
+    /* Called in the slave thread before the registers are read, and after they
+       are written, with the accessed range. NULL if not needed. */
+    void (* read_hook)(struct mb_reg_map *map, uint16_t start_addr,
+                        uint16_t nbr_regs);
+    void (* write_hook)(struct mb_reg_map *map, uint16_t start_addr,
+                        uint16_t nbr_regs);
+    void *user_data;
+} mb_reg_map_t;
+
 typedef struct mb_channel
 {
     bool write_en;                              /* MODBUS writing enable */
@@ -56,6 +90,15 @@ typedef struct mb_channel
     uint16_t rx_frame_ndata_bytes;
     uint16_t rx_frame_crc;
     uint16_t rx_frame_crc_calc;
+#if (MODBUS_CFG_RTU_EN != 0)
+    uint16_t rx_crc;                            /* CRC updated on receiving */
+    uint16_t rx_crc_count;                      /* Bytes in the CRC above */
+#endif
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+    mb_reg_map_t *map;                          /* Register maps of the slave */
+    struct mb_gateway *gateway;                 /* Gateway of the slave, or NULL */
+#endif
 
     uint8_t tx_frame_data[MODBUS_CFG_BUF_SIZE];
     uint16_t tx_frame_ndata_bytes;
@@ -68,6 +111,9 @@ typedef struct mb_channel
 #endif
 
     elab_device_t *serial;
+#if (MODBUS_CFG_TCP_EN != 0)
+    void *tcp;                                  /* Modbus TCP transport */
+#endif
 } mb_channel_t;
 
 /*
@@ -80,9 +126,15 @@ typedef struct mb_channel
 mb_channel_t *mb_channel_create(const char *serial,
                                 uint8_t node_addr, uint8_t master_slave,
                                 uint16_t rx_timeout, uint8_t modbus_mode);
+#if (MODBUS_CFG_TCP_EN != 0)
+mb_channel_t *mb_channel_create_tcp(const char *host, uint16_t port,
+                                    uint8_t node_addr, uint8_t master_slave,
+                                    uint16_t rx_timeout);
+#endif
 void mb_channel_destroy(mb_channel_t *pch);
 void mb_slave_set_cb(mb_channel_t *pch, mb_channel_cb_t *cb);
 void mb_slave_write_enable(mb_channel_t *pch, bool status);
+void mb_slave_add_map(mb_channel_t *pch, mb_reg_map_t *map);
 
 /*
 ********************************************************************************
@@ -205,6 +257,124 @@ uint16_t mbm_fc16_holding_reg_write_fp(mb_channel_t *pch,
 
 #endif
 
+/*
+********************************************************************************
+*                         MODBUS MASTER POLLING
+*                       GLOBAL FUNCTION PROTOTYPES
+*                           (modbus_poll.c)
+********************************************************************************
+*/
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+
+typedef struct mbm_poll mbm_poll_t;
+
+typedef struct mbm_poll_stats
+{
+    uint32_t requests;                          /* Requests sent */
+    uint32_t errors;                            /* Requests failed */
+    uint32_t regs;                              /* Registers read */
+    uint32_t time_busy_ms;                      /* Time of the bus in requests */
+    uint32_t time_total_ms;                     /* Time since the engine starts */
+    uint16_t utilization;                       /* Bus utilization in 0.1% */
+} mbm_poll_stats_t;
+
+mbm_poll_t *mbm_poll_create(mb_channel_t *pch, uint32_t range_max);
+void mbm_poll_destroy(mbm_poll_t *poll);
+uint16_t mbm_poll_add(mbm_poll_t *poll, uint8_t slave_node, uint8_t fc,
+                        uint16_t start_addr, uint16_t nbr_regs,
+                        uint32_t period_ms);
+uint16_t mbm_poll_read(mbm_poll_t *poll, uint8_t slave_node, uint8_t fc,
+                        uint16_t start_addr, uint16_t *p_reg_tbl,
+                        uint16_t nbr_regs, uint32_t *age_ms);
+void mbm_poll_get_stats(mbm_poll_t *poll, mbm_poll_stats_t *stats);
+
+#endif
+
+/*
+********************************************************************************
+*                      MODBUS MASTER ASYNC REQUESTS
+*                       GLOBAL FUNCTION PROTOTYPES
+*                           (modbus_async.c)
+********************************************************************************
+*/
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+
+enum mbm_async_prio
+{
+    MBM_ASYNC_PRIO_HIGH = 0,                    /* Control writes */
+    MBM_ASYNC_PRIO_NORMAL,
+    MBM_ASYNC_PRIO_LOW,                         /* Bulk telemetry reads */
+
+    MBM_ASYNC_PRIO_MAX,
+};
+
+typedef struct mbm_async mbm_async_t;
+typedef struct mbm_async_req mbm_async_req_t;
+
+typedef void (* mbm_async_cb_t)(uint16_t err, void *para);
+
+typedef struct mbm_async_attr
+{
+    uint8_t slave_node;
+    uint8_t fc;                                 /* MODBUS_FCxx */
+    uint8_t prio;                               /* MBM_ASYNC_PRIO_xx */
+    uint16_t start_addr;
+    uint16_t nbr;                               /* Number of registers or coils */
+    void *p_data;                               /* uint16_t registers, uint8_t
+                                                   coil bits, or bool of FC05 */
+    mbm_async_cb_t cb;                          /* NULL if waited for */
+    void *para;
+} mbm_async_attr_t;
+
+mbm_async_t *mbm_async_create(mb_channel_t *pch, uint32_t req_max);
+void mbm_async_destroy(mbm_async_t *async);
+void mbm_async_set_timeout(mbm_async_t *async, uint8_t slave_node,
+                            uint16_t timeout_ms);
+bool mbm_async_slave_alive(mbm_async_t *async, uint8_t slave_node);
+mbm_async_req_t *mbm_async_submit(mbm_async_t *async,
+                                    const mbm_async_attr_t *attr);
+uint16_t mbm_async_wait(mbm_async_t *async, mbm_async_req_t *req,
+                        uint32_t timeout_ms);
+
+#endif
+
+/*
+********************************************************************************
+*                             MODBUS GATEWAY
+*                       GLOBAL FUNCTION PROTOTYPES
+*                           (modbus_gateway.c)
+********************************************************************************
+*/
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+typedef struct mb_gateway mb_gateway_t;
+
+typedef struct mb_gateway_stats
+{
+    uint32_t requests;                          /* Requests routed */
+    uint32_t cache_hits;                        /* Reads served by the cache */
+    uint32_t coalesced;                         /* Reads served by the same one
+                                                   in flight */
+    uint32_t forwarded;                         /* Requests sent downstream */
+    uint32_t errors;                            /* Downstream requests failed */
+    uint16_t hit_rate;                          /* Requests not forwarded in
+                                                   0.1% */
+    uint32_t latency_avg_ms;                    /* Of the downstream requests */
+    uint32_t latency_max_ms;
+} mb_gateway_stats_t;
+
+mb_gateway_t *mb_gateway_create(uint32_t cache_ttl_ms);
+void mb_gateway_destroy(mb_gateway_t *gw);
+void mb_gateway_attach(mb_gateway_t *gw, mb_channel_t *pch);
+void mb_gateway_add_route(mb_gateway_t *gw, uint8_t unit,
+                            mb_channel_t *pch, uint8_t slave_node);
+void mb_gateway_get_stats(mb_gateway_t *gw, mb_gateway_stats_t *stats);
+
+#endif
+
 #endif /* MODBUS_H */
 
 /* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,532 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
+#include "modbus.h"
+
+ELAB_TAG("ModbusAsync");
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define MBM_ASYNC_DEAD_FAILS                    (3)
+#define MBM_ASYNC_BACKOFF_MIN                   (100)
+#define MBM_ASYNC_BACKOFF_MAX                   (5000)
+
+/* Private typedef -----------------------------------------------------------*/
+struct mbm_async_req
+{
+    struct mbm_async_req *next;
+    mbm_async_attr_t attr;
+    osSemaphoreId_t sem;                        /* Released when it completes */
+    uint16_t err;
+};
+
+/* The state of one slave node. */
+typedef struct mbm_async_slave
+{
+    uint16_t timeout_ms;                        /* 0 for the channel's one */
+    uint8_t fails;                              /* Timeouts in succession */
+    uint32_t time_retry;                        /* End of the backoff */
+} mbm_async_slave_t;
+
+struct mbm_async
+{
+    mb_channel_t *pch;
+    osThreadId_t thread;
+    osMutexId_t mutex;
+    osSemaphoreId_t sem_wake;
+    osSemaphoreId_t sem_exit;
+    bool running;
+
+    mbm_async_req_t *req;
+    mbm_async_req_t *req_free;
+    mbm_async_req_t *head[MBM_ASYNC_PRIO_MAX];
+    mbm_async_req_t *tail[MBM_ASYNC_PRIO_MAX];
+    uint32_t req_max;
+
+    mbm_async_slave_t slave[MODBUS_NODE_ADDR_MAX + 1];
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void _entry_async(void *para);
+static mbm_async_req_t *_async_pop(mbm_async_t *async);
+static uint16_t _async_execute(mbm_async_t *async, mbm_async_attr_t *attr,
+                                uint16_t timeout_ms);
+static void _async_complete(mbm_async_t *async, mbm_async_req_t *req,
+                            uint16_t err);
+static bool _slave_dead(mbm_async_slave_t *slave, uint32_t time);
+static void _slave_update(mbm_async_slave_t *slave, uint16_t err, uint32_t time);
+
+/* Private variables ---------------------------------------------------------*/
+static const osMutexAttr_t mutex_attr_mbm_async =
+{
+    "mutex_modbus_async",
+    osMutexRecursive | osMutexPrioInherit,
+    NULL,
+    0U
+};
+
+static const osThreadAttr_t mbm_thread_async_attr =
+{
+    .name = "mbm_thread_async",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityAboveNormal,
+    .stack_size = 2048,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Create the asynchronous request queue on the Modbus master channel.
+ *         The requests are sent one by one in their priority lanes, and the
+ *         clients are not blocked by the round trips of the others.
+ * @param  pch          Modbus master channel handle.
+ * @param  req_max      The max number of the pending requests.
+ * @retval The asynchronous request queue handle.
+ */
+mbm_async_t *mbm_async_create(mb_channel_t *pch, uint32_t req_max)
+{
+    elab_assert(pch != NULL);
+    elab_assert(pch->m_or_s == MODBUS_MASTER);
+    elab_assert(req_max > 0);
+
+    mbm_async_t *async = elab_malloc(sizeof(mbm_async_t));
+    elab_assert(async != NULL);
+    memset(async, 0, sizeof(mbm_async_t));
+
+    async->pch = pch;
+    async->req_max = req_max;
+    async->req = elab_malloc(sizeof(mbm_async_req_t) * req_max);
+    elab_assert(async->req != NULL);
+    memset(async->req, 0, sizeof(mbm_async_req_t) * req_max);
+    for (uint32_t i = 0; i < req_max; i ++)
+    {
+        async->req[i].sem = osSemaphoreNew(1, 0, NULL);
+        elab_assert(async->req[i].sem != NULL);
+        async->req[i].next = async->req_free;
+        async->req_free = &async->req[i];
+    }
+
+    async->mutex = osMutexNew(&mutex_attr_mbm_async);
+    elab_assert(async->mutex != NULL);
+    async->sem_wake = osSemaphoreNew(1, 0, NULL);
+    elab_assert(async->sem_wake != NULL);
+    async->sem_exit = osSemaphoreNew(1, 0, NULL);
+    elab_assert(async->sem_exit != NULL);
+
+    async->running = true;
+    async->thread = osThreadNew(_entry_async, async, &mbm_thread_async_attr);
+    elab_assert(async->thread != NULL);
+
+    return async;
+}
+
+/**
+ * @brief  Destroy the asynchronous request queue, and the Modbus channel is
+ *         kept. The queued requests are completed with MODBUS_ERR_CANCELED,
+ *         and none of them should be waited for any more.
+ * @param  async    The asynchronous request queue handle.
+ * @retval None.
+ */
+void mbm_async_destroy(mbm_async_t *async)
+{
+    elab_assert(async != NULL);
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    async->running = false;
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+
+    /* Wait for the thread finishing its current request. */
+    osSemaphoreRelease(async->sem_wake);
+    ret_os = osSemaphoreAcquire(async->sem_exit, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    mbm_async_req_t *req = NULL;
+    while ((req = _async_pop(async)) != NULL)
+    {
+        _async_complete(async, req, MODBUS_ERR_CANCELED);
+    }
+
+    for (uint32_t i = 0; i < async->req_max; i ++)
+    {
+        osSemaphoreDelete(async->req[i].sem);
+    }
+    osSemaphoreDelete(async->sem_exit);
+    osSemaphoreDelete(async->sem_wake);
+    osMutexDelete(async->mutex);
+    elab_free(async->req);
+    elab_free(async);
+}
+
+/**
+ * @brief  Set the response timeout of one slave node.
+ * @param  async        The asynchronous request queue handle.
+ * @param  slave_node   The slave node address.
+ * @param  timeout_ms   The timeout in ms, or 0 for the one of the channel.
+ * @retval None.
+ */
+void mbm_async_set_timeout(mbm_async_t *async, uint8_t slave_node,
+                            uint16_t timeout_ms)
+{
+    elab_assert(async != NULL);
+    elab_assert(slave_node > 0 && slave_node <= MODBUS_NODE_ADDR_MAX);
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    async->slave[slave_node].timeout_ms = timeout_ms;
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+}
+
+/**
+ * @brief  Check the slave node is alive or not. The slave is taken as dead
+ *         after some timeouts in succession, and its requests fail at once in
+ *         the backoff time, which is doubled every time it keeps silent.
+ * @param  async        The asynchronous request queue handle.
+ * @param  slave_node   The slave node address.
+ * @retval True if alive, false if in the backoff time.
+ */
+bool mbm_async_slave_alive(mbm_async_t *async, uint8_t slave_node)
+{
+    elab_assert(async != NULL);
+    elab_assert(slave_node > 0 && slave_node <= MODBUS_NODE_ADDR_MAX);
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    bool alive = !_slave_dead(&async->slave[slave_node], elab_time_ms());
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+
+    return alive;
+}
+
+/**
+ * @brief  Submit one request to the queue without blocking. With the callback,
+ *         the request is released after the callback is called, and it should
+ *         not be waited for. Without the callback, it must be waited for by
+ *         mbm_async_wait to get the result and to be released.
+ * @param  async    The asynchronous request queue handle.
+ * @param  attr     The request attribute, whose data buffer should be kept
+ *                  until the request completes.
+ * @retval The request handle, or NULL if the queue is full.
+ */
+mbm_async_req_t *mbm_async_submit(mbm_async_t *async,
+                                    const mbm_async_attr_t *attr)
+{
+    elab_assert(async != NULL);
+    elab_assert(attr != NULL);
+    elab_assert(attr->slave_node > 0 && attr->slave_node <= MODBUS_NODE_ADDR_MAX);
+    elab_assert(attr->prio < MBM_ASYNC_PRIO_MAX);
+    elab_assert(attr->p_data != NULL);
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    mbm_async_req_t *req = async->req_free;
+    if (req != NULL)
+    {
+        async->req_free = req->next;
+        req->next = NULL;
+        req->attr = *attr;
+        req->err = MODBUS_ERR_PENDING;
+
+        /* Append the request to the tail of its lane. */
+        if (async->tail[attr->prio] == NULL)
+        {
+            async->head[attr->prio] = req;
+        }
+        else
+        {
+            async->tail[attr->prio]->next = req;
+        }
+        async->tail[attr->prio] = req;
+    }
+
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+    if (req != NULL)
+    {
+        osSemaphoreRelease(async->sem_wake);
+    }
+
+    return req;
+}
+
+/**
+ * @brief  Wait for the request submitted without the callback, and release it
+ *         when it completes.
+ * @param  async        The asynchronous request queue handle.
+ * @param  req          The request handle.
+ * @param  timeout_ms   The waiting time in ms.
+ * @retval The result of the request, or MODBUS_ERR_PENDING if it has not
+ *         completed in the waiting time, which can be waited for again.
+ */
+uint16_t mbm_async_wait(mbm_async_t *async, mbm_async_req_t *req,
+                        uint32_t timeout_ms)
+{
+    elab_assert(async != NULL);
+    elab_assert(req != NULL);
+    elab_assert(req->attr.cb == NULL);
+
+    if (osSemaphoreAcquire(req->sem, timeout_ms) != osOK)
+    {
+        return MODBUS_ERR_PENDING;
+    }
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    uint16_t err = req->err;
+    req->next = async->req_free;
+    async->req_free = req;
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+
+    return err;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  The thread sending the requests in the order of their lanes, and the
+ *         ones of the dead slaves fail without being sent.
+ * @param  para     The asynchronous request queue handle.
+ * @retval None.
+ */
+static void _entry_async(void *para)
+{
+    mbm_async_t *async = (mbm_async_t *)para;
+    osStatus_t ret_os = osOK;
+
+    while (1)
+    {
+        ret_os = osMutexAcquire(async->mutex, osWaitForever);
+        elab_assert(ret_os == osOK);
+        if (!async->running)
+        {
+            ret_os = osMutexRelease(async->mutex);
+            elab_assert(ret_os == osOK);
+            break;
+        }
+
+        mbm_async_req_t *req = _async_pop(async);
+        if (req == NULL)
+        {
+            ret_os = osMutexRelease(async->mutex);
+            elab_assert(ret_os == osOK);
+            osSemaphoreAcquire(async->sem_wake, osWaitForever);
+            continue;
+        }
+
+        mbm_async_slave_t *slave = &async->slave[req->attr.slave_node];
+        bool dead = _slave_dead(slave, elab_time_ms());
+        uint16_t timeout_ms = slave->timeout_ms;
+        ret_os = osMutexRelease(async->mutex);
+        elab_assert(ret_os == osOK);
+
+        uint16_t err = MODBUS_ERR_SLAVE_DEAD;
+        if (!dead)
+        {
+            err = _async_execute(async, &req->attr, timeout_ms);
+
+            ret_os = osMutexAcquire(async->mutex, osWaitForever);
+            elab_assert(ret_os == osOK);
+            _slave_update(slave, err, elab_time_ms());
+            ret_os = osMutexRelease(async->mutex);
+            elab_assert(ret_os == osOK);
+        }
+
+        _async_complete(async, req, err);
+    }
+
+    osSemaphoreRelease(async->sem_exit);
+}
+
+/**
+ * @brief  Pop the first request of the highest lane, in the locking.
+ * @param  async    The asynchronous request queue handle.
+ * @retval The request, or NULL if none.
+ */
+static mbm_async_req_t *_async_pop(mbm_async_t *async)
+{
+    for (uint32_t i = 0; i < MBM_ASYNC_PRIO_MAX; i ++)
+    {
+        mbm_async_req_t *req = async->head[i];
+        if (req != NULL)
+        {
+            async->head[i] = req->next;
+            if (async->head[i] == NULL)
+            {
+                async->tail[i] = NULL;
+            }
+            req->next = NULL;
+
+            return req;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Send the request by the blocking master functions, in the timeout of
+ *         the slave. The channel mutex is recursive, so the timeout is kept
+ *         in the round trip of the master function.
+ * @param  async        The asynchronous request queue handle.
+ * @param  attr         The request attribute.
+ * @param  timeout_ms   The response timeout, or 0 for the one of the channel.
+ * @retval The result of the master function.
+ */
+static uint16_t _async_execute(mbm_async_t *async, mbm_async_attr_t *attr,
+                                uint16_t timeout_ms)
+{
+    mb_channel_t *pch = async->pch;
+    uint16_t err = MODBUS_ERR_FC;
+
+    osStatus_t ret_os = osMutexAcquire(pch->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    uint16_t rx_timeout = pch->rx_timeout;
+    if (timeout_ms != 0)
+    {
+        pch->rx_timeout = timeout_ms;
+    }
+
+    switch (attr->fc)
+    {
+#if (MODBUS_CFG_FC01_EN != 0)
+    case MODBUS_FC01_COIL_RD:
+        err = mbm_fc01_coil_read(pch, attr->slave_node, attr->start_addr,
+                                    (uint8_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+#if (MODBUS_CFG_FC02_EN != 0)
+    case MODBUS_FC02_DI_RD:
+        err = mbm_fc02_di_read(pch, attr->slave_node, attr->start_addr,
+                                (uint8_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+#if (MODBUS_CFG_FC03_EN != 0)
+    case MODBUS_FC03_HOLDING_REG_RD:
+        err = mbm_fc03_holding_reg_read(pch, attr->slave_node, attr->start_addr,
+                                        (uint16_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+#if (MODBUS_CFG_FC04_EN != 0)
+    case MODBUS_FC04_IN_REG_RD:
+        err = mbm_fc04_in_reg_read(pch, attr->slave_node, attr->start_addr,
+                                    (uint16_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+#if (MODBUS_CFG_FC05_EN != 0)
+    case MODBUS_FC05_COIL_WR:
+        err = mbm_fc05_wirte_coil(pch, attr->slave_node, attr->start_addr,
+                                    *(bool *)attr->p_data);
+        break;
+#endif
+#if (MODBUS_CFG_FC06_EN != 0)
+    case MODBUS_FC06_HOLDING_REG_WR:
+        err = mbm_fc06_holding_reg_write(pch, attr->slave_node, attr->start_addr,
+                                            *(uint16_t *)attr->p_data);
+        break;
+#endif
+#if (MODBUS_CFG_FC15_EN != 0)
+    case MODBUS_FC15_COIL_WR_MULTIPLE:
+        err = mbm_fc15_coil_write(pch, attr->slave_node, attr->start_addr,
+                                    (uint8_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+#if (MODBUS_CFG_FC16_EN != 0)
+    case MODBUS_FC16_HOLDING_REG_WR_MULTIPLE:
+        err = mbm_fc16_holding_reg_write(pch, attr->slave_node, attr->start_addr,
+                                            (uint16_t *)attr->p_data, attr->nbr);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    pch->rx_timeout = rx_timeout;
+    ret_os = osMutexRelease(pch->mutex);
+    elab_assert(ret_os == osOK);
+
+    return err;
+}
+
+/**
+ * @brief  Complete the request, by calling its callback and releasing it, or
+ *         by waking up its waiter.
+ * @param  async    The asynchronous request queue handle.
+ * @param  req      The request.
+ * @param  err      The result of the request.
+ * @retval None.
+ */
+static void _async_complete(mbm_async_t *async, mbm_async_req_t *req,
+                            uint16_t err)
+{
+    if (req->attr.cb == NULL)
+    {
+        req->err = err;
+        osSemaphoreRelease(req->sem);
+        return;
+    }
+
+    req->attr.cb(err, req->attr.para);
+
+    osStatus_t ret_os = osMutexAcquire(async->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    req->next = async->req_free;
+    async->req_free = req;
+    ret_os = osMutexRelease(async->mutex);
+    elab_assert(ret_os == osOK);
+}
+
+/**
+ * @brief  Check the slave is in its backoff time or not, in the locking.
+ */
+static bool _slave_dead(mbm_async_slave_t *slave, uint32_t time)
+{
+    return (slave->fails >= MBM_ASYNC_DEAD_FAILS &&
+            (int32_t)(slave->time_retry - time) > 0);
+}
+
+/**
+ * @brief  Update the slave state by the result of its request, in the locking.
+ *         Any response makes the slave alive, and the backoff time is doubled
+ *         by every timeout after it is taken as dead.
+ */
+static void _slave_update(mbm_async_slave_t *slave, uint16_t err, uint32_t time)
+{
+    if (err != MODBUS_ERR_TIMED_OUT)
+    {
+        slave->fails = 0;
+        return;
+    }
+
+    if (slave->fails < UINT8_MAX)
+    {
+        slave->fails ++;
+    }
+    if (slave->fails >= MBM_ASYNC_DEAD_FAILS)
+    {
+        uint32_t backoff = MBM_ASYNC_BACKOFF_MIN;
+        for (uint32_t i = MBM_ASYNC_DEAD_FAILS;
+                i < slave->fails && backoff < MBM_ASYNC_BACKOFF_MAX; i ++)
+        {
+            backoff *= 2;
+        }
+        if (backoff > MBM_ASYNC_BACKOFF_MAX)
+        {
+            backoff = MBM_ASYNC_BACKOFF_MAX;
+        }
+        slave->time_retry = time + backoff;
+    }
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -13,6 +13,7 @@
 */
 #define MODBUS_MODE_ASCII                          1
 #define MODBUS_MODE_RTU                            0
+#define MODBUS_MODE_TCP                            2
 
 #define MODBUS_SLAVE                               0
 #define MODBUS_MASTER                              1
@@ -32,6 +33,16 @@
 #define MODBUS_FC15_COIL_WR_MULTIPLE              15   /* Set multiple COIL values. */
 #define MODBUS_FC16_HOLDING_REG_WR_MULTIPLE       16   /* Holding registers */
 
+#define MB_REG_MAP_HOLDING                         0   /* FC03, FC06 and FC16. */
+#define MB_REG_MAP_INPUT                           1   /* FC04. */
+
+#define MB_REG_ACCESS_RD                        0x01
+#define MB_REG_ACCESS_WR                        0x02
+#define MB_REG_ACCESS_RW                        (MB_REG_ACCESS_RD | MB_REG_ACCESS_WR)
+
+#define MODBUS_TCP_PORT                          502   /* Default Modbus TCP port. */
+#define MODBUS_TCP_UNIT_SELF                    0xFF   /* Unit of the TCP server itself. */
+
 /*
 ********************************************************************************
 *                               ERROR CODES
@@ -44,6 +55,8 @@
 #define MODBUS_ERR_ILLEGAL_DATA_ADDR               2
 #define MODBUS_ERR_ILLEGAL_DATA_QTY                3
 #define MODBUS_ERR_ILLEGAL_DATA_VAL                4
+#define MODBUS_ERR_GATEWAY_PATH                 0x0A   /* No route to the unit. */
+#define MODBUS_ERR_GATEWAY_TARGET               0x0B   /* The unit failed to respond. */
 
 #define MODBUS_ERR_FC01_01                       101
 #define MODBUS_ERR_FC01_02                       102
@@ -93,6 +106,10 @@
 #define MODBUS_ERR_WR                           5010
 
 #define MODBUS_ERR_RX                           6000
+#define MODBUS_ERR_NO_DATA                      6001
+#define MODBUS_ERR_PENDING                      6002
+#define MODBUS_ERR_SLAVE_DEAD                   6003
+#define MODBUS_ERR_CANCELED                     6004
 
 #endif
 
@@ -0,0 +1,544 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
+#include "modbus.h"
+
+ELAB_TAG("ModbusGateway");
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define MB_GATEWAY_ENTRY_MAX                    (16)
+#define MB_GATEWAY_WAITERS_MAX                  (16)
+#define MB_GATEWAY_KEY_SIZE                     (5)     /* FC, start, quantity */
+
+/* Private typedef -----------------------------------------------------------*/
+enum mb_gateway_entry_state
+{
+    MB_GATEWAY_ENTRY_FREE = 0,
+    MB_GATEWAY_ENTRY_PENDING,                   /* The read is in flight */
+    MB_GATEWAY_ENTRY_DONE,
+};
+
+typedef struct mb_gateway_route
+{
+    mb_channel_t *pch;                          /* Downstream master channel */
+    uint8_t slave_node;
+    uint32_t generation;                        /* Bumped by the invalidating */
+} mb_gateway_route_t;
+
+/* One read, in flight or with its response kept in the cache. */
+typedef struct mb_gateway_entry
+{
+    uint8_t state;
+    uint8_t unit;
+    uint8_t key[MB_GATEWAY_KEY_SIZE];
+    bool cached;                                /* Valid to be served */
+    uint32_t generation;                        /* Of the unit when forwarded */
+    uint16_t waiters;                           /* Coalesced reads waiting */
+    osSemaphoreId_t sem;                        /* Released to the waiters */
+    uint16_t err;
+    uint32_t time;                              /* When the response came */
+    uint16_t size_rsp;
+    uint8_t rsp[MODBUS_CFG_BUF_SIZE];
+} mb_gateway_entry_t;
+
+struct mb_gateway
+{
+    osMutexId_t mutex;
+    uint32_t cache_ttl_ms;
+    mb_gateway_route_t route[UINT8_MAX + 1];
+    mb_gateway_entry_t entry[MB_GATEWAY_ENTRY_MAX];
+    mb_gateway_stats_t stats;
+    uint32_t latency_total_ms;
+};
+
+/* Exported function prototypes ----------------------------------------------*/
+bool mbs_gateway_routed(mb_gateway_t *gw, uint8_t unit);
+bool mbs_gateway_handler(mb_gateway_t *gw, mb_channel_t *pch);
+uint16_t mbm_pdu_request(mb_channel_t *pch, uint8_t slave_node,
+                            const uint8_t *p_pdu, uint16_t size,
+                            uint16_t size_rsp,
+                            uint8_t *p_rsp, uint16_t *p_size_rsp);
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _gateway_read(mb_gateway_t *gw, uint8_t unit,
+                                const uint8_t *pdu, uint16_t size,
+                                uint16_t size_rsp,
+                                uint8_t *rsp, uint16_t *p_size_rsp);
+static uint16_t _gateway_forward(mb_gateway_t *gw, uint8_t unit,
+                                    const uint8_t *pdu, uint16_t size,
+                                    uint16_t size_rsp,
+                                    uint8_t *rsp, uint16_t *p_size_rsp);
+static void _gateway_invalidate(mb_gateway_t *gw, uint8_t unit);
+static mb_gateway_entry_t *_entry_find(mb_gateway_t *gw, uint8_t unit,
+                                        const uint8_t *pdu);
+static mb_gateway_entry_t *_entry_alloc(mb_gateway_t *gw);
+static uint16_t _rsp_size(const uint8_t *pdu, uint16_t size);
+
+/* Private variables ---------------------------------------------------------*/
+static const osMutexAttr_t mutex_attr_mb_gateway =
+{
+    "mutex_modbus_gateway",
+    osMutexRecursive | osMutexPrioInherit,
+    NULL,
+    0U
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Create the Modbus gateway, which routes the requests received by its
+ *         slave channels to the master channels by the unit ID. The identical
+ *         reads at the same time are sent downstream only once, and the read
+ *         responses are kept in the cache for the given time. The requests are
+ *         handled in the receiving thread of each slave channel, so the reads
+ *         are only coalesced across the slave channels attached. All the
+ *         clients of one TCP slave are served one by one in its only thread,
+ *         and they share the cache but are not coalesced with each other.
+ * @param  cache_ttl_ms The time the read responses are served from the cache,
+ *                      0 for no cache.
+ * @retval The gateway handle.
+ */
+mb_gateway_t *mb_gateway_create(uint32_t cache_ttl_ms)
+{
+    mb_gateway_t *gw = elab_malloc(sizeof(mb_gateway_t));
+    elab_assert(gw != NULL);
+    memset(gw, 0, sizeof(mb_gateway_t));
+
+    gw->cache_ttl_ms = cache_ttl_ms;
+    for (uint32_t i = 0; i < MB_GATEWAY_ENTRY_MAX; i ++)
+    {
+        gw->entry[i].sem = osSemaphoreNew(MB_GATEWAY_WAITERS_MAX, 0, NULL);
+        elab_assert(gw->entry[i].sem != NULL);
+    }
+    gw->mutex = osMutexNew(&mutex_attr_mb_gateway);
+    elab_assert(gw->mutex != NULL);
+
+    return gw;
+}
+
+/**
+ * @brief  Destroy the Modbus gateway. The slave channels attached should be
+ *         destroyed before it, and the master channels are kept.
+ * @param  gw       The gateway handle.
+ * @retval None.
+ */
+void mb_gateway_destroy(mb_gateway_t *gw)
+{
+    elab_assert(gw != NULL);
+
+    for (uint32_t i = 0; i < MB_GATEWAY_ENTRY_MAX; i ++)
+    {
+        elab_assert(gw->entry[i].state != MB_GATEWAY_ENTRY_PENDING);
+        osStatus_t ret_os = osSemaphoreDelete(gw->entry[i].sem);
+        elab_assert(ret_os == osOK);
+    }
+    osStatus_t ret_os = osMutexDelete(gw->mutex);
+    elab_assert(ret_os == osOK);
+
+    elab_free(gw);
+}
+
+/**
+ * @brief  Attach the slave channel to the gateway as one upstream. The requests
+ *         to the routed units are handled by the gateway, and the others by the
+ *         slave itself as before.
+ * @param  gw       The gateway handle.
+ * @param  pch      Modbus slave channel handle.
+ * @retval None.
+ */
+void mb_gateway_attach(mb_gateway_t *gw, mb_channel_t *pch)
+{
+    elab_assert(gw != NULL);
+    elab_assert(pch != NULL);
+    elab_assert(pch->m_or_s == MODBUS_SLAVE);
+
+    elab_atomic_store(&pch->gateway, gw);
+}
+
+/**
+ * @brief  Route the requests to the unit to the slave on the master channel.
+ * @param  gw           The gateway handle.
+ * @param  unit         The unit ID in the upstream requests.
+ * @param  pch          Modbus master channel handle of the downstream.
+ * @param  slave_node   The slave node on the downstream.
+ * @retval None.
+ */
+void mb_gateway_add_route(mb_gateway_t *gw, uint8_t unit,
+                            mb_channel_t *pch, uint8_t slave_node)
+{
+    elab_assert(gw != NULL);
+    elab_assert(pch != NULL);
+    elab_assert(pch->m_or_s == MODBUS_MASTER);
+    elab_assert(unit != 0 && unit != MODBUS_TCP_UNIT_SELF);
+    elab_assert(slave_node > 0 && slave_node <= MODBUS_NODE_ADDR_MAX);
+
+    osStatus_t ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    gw->route[unit].slave_node = slave_node;
+    elab_atomic_store(&gw->route[unit].pch, pch);
+    _gateway_invalidate(gw, unit);
+
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+}
+
+/**
+ * @brief  Get the statistics of the gateway.
+ * @param  gw       The gateway handle.
+ * @param  stats    The statistics output.
+ * @retval None.
+ */
+void mb_gateway_get_stats(mb_gateway_t *gw, mb_gateway_stats_t *stats)
+{
+    elab_assert(gw != NULL);
+    elab_assert(stats != NULL);
+
+    osStatus_t ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    *stats = gw->stats;
+    if (stats->requests > 0)
+    {
+        stats->hit_rate = (uint16_t)((uint64_t)(stats->cache_hits +
+                                        stats->coalesced) * 1000 /
+                                        stats->requests);
+    }
+    if (stats->forwarded > 0)
+    {
+        stats->latency_avg_ms = gw->latency_total_ms / stats->forwarded;
+    }
+
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+}
+
+/**
+ * @brief  Check if the unit is routed by the gateway.
+ * @param  gw       The gateway handle, or NULL.
+ * @param  unit     The unit ID.
+ * @retval True if routed.
+ */
+bool mbs_gateway_routed(mb_gateway_t *gw, uint8_t unit)
+{
+    return (gw != NULL && elab_atomic_load(&gw->route[unit].pch) != NULL);
+}
+
+/**
+ * @brief  Handle the request received by the slave channel to the routed unit,
+ *         and set the response from the downstream into its tx frame.
+ * @param  gw       The gateway handle attached to the channel.
+ * @param  pch      Modbus slave channel handle.
+ * @retval True if a response needs to be sent.
+ */
+bool mbs_gateway_handler(mb_gateway_t *gw, mb_channel_t *pch)
+{
+    uint8_t unit = pch->rx_frame_data[0];
+    const uint8_t *pdu = &pch->rx_frame_data[1];
+    uint16_t size = pch->rx_frame_ndata_bytes + 1;
+    uint8_t *rsp = &pch->tx_frame_data[1];
+    uint16_t size_rsp = 0;
+    uint16_t err = MODBUS_ERR_NONE;
+    uint8_t exception = MODBUS_ERR_GATEWAY_TARGET;
+
+    osStatus_t ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    gw->stats.requests ++;
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+
+    uint16_t size_expect = _rsp_size(pdu, size);
+    if (size_expect == 0)
+    {
+        err = MODBUS_ERR_FC;
+        exception = MODBUS_ERR_ILLEGAL_FC;
+    }
+    else if (pdu[0] <= MODBUS_FC04_IN_REG_RD)
+    {
+        err = _gateway_read(gw, unit, pdu, size, size_expect, rsp, &size_rsp);
+    }
+    else
+    {
+        err = _gateway_forward(gw, unit, pdu, size, size_expect, rsp, &size_rsp);
+
+        /* The reads cached are out of date after any write to the unit. */
+        ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+        elab_assert(ret_os == osOK);
+        _gateway_invalidate(gw, unit);
+        ret_os = osMutexRelease(gw->mutex);
+        elab_assert(ret_os == osOK);
+    }
+
+    pch->tx_frame_data[0] = unit;
+    if (err == MODBUS_ERR_NONE)
+    {
+        pch->tx_frame_ndata_bytes = size_rsp - 1;
+    }
+    else
+    {
+        pch->tx_frame_data[1] = pdu[0] | 0x80;
+        pch->tx_frame_data[2] = exception;
+        pch->tx_frame_ndata_bytes = 1;
+    }
+    pch->error = err;
+
+    return true;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Read from the cache, or wait for the same read in flight, or else
+ *         forward the read downstream.
+ */
+static uint16_t _gateway_read(mb_gateway_t *gw, uint8_t unit,
+                                const uint8_t *pdu, uint16_t size,
+                                uint16_t size_rsp,
+                                uint8_t *rsp, uint16_t *p_size_rsp)
+{
+    uint16_t err = MODBUS_ERR_NONE;
+
+    osStatus_t ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    mb_gateway_entry_t *entry = _entry_find(gw, unit, pdu);
+    if (entry != NULL && entry->state == MB_GATEWAY_ENTRY_DONE &&
+        (elab_time_ms() - entry->time) < gw->cache_ttl_ms)
+    {
+        gw->stats.cache_hits ++;
+        memcpy(rsp, entry->rsp, entry->size_rsp);
+        *p_size_rsp = entry->size_rsp;
+        goto exit;
+    }
+
+    if (entry != NULL && entry->state == MB_GATEWAY_ENTRY_PENDING &&
+        entry->waiters < MB_GATEWAY_WAITERS_MAX)
+    {
+        gw->stats.coalesced ++;
+        entry->waiters ++;
+        ret_os = osMutexRelease(gw->mutex);
+        elab_assert(ret_os == osOK);
+
+        /* The entry is not reused until all the waiters get the response. */
+        ret_os = osSemaphoreAcquire(entry->sem, osWaitForever);
+        elab_assert(ret_os == osOK);
+
+        ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+        elab_assert(ret_os == osOK);
+        err = entry->err;
+        if (err == MODBUS_ERR_NONE)
+        {
+            memcpy(rsp, entry->rsp, entry->size_rsp);
+            *p_size_rsp = entry->size_rsp;
+        }
+        entry->waiters --;
+        goto exit;
+    }
+
+    /* Forwarded without coalescing, if no entry is free. */
+    entry = _entry_alloc(gw);
+    if (entry != NULL)
+    {
+        entry->state = MB_GATEWAY_ENTRY_PENDING;
+        entry->unit = unit;
+        memcpy(entry->key, pdu, MB_GATEWAY_KEY_SIZE);
+        entry->cached = false;
+        entry->generation = gw->route[unit].generation;
+    }
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+
+    err = _gateway_forward(gw, unit, pdu, size, size_rsp, rsp, p_size_rsp);
+
+    ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    if (entry != NULL)
+    {
+        entry->err = err;
+        entry->time = elab_time_ms();
+        if (err == MODBUS_ERR_NONE)
+        {
+            memcpy(entry->rsp, rsp, *p_size_rsp);
+            entry->size_rsp = *p_size_rsp;
+            /* The exception response is not cached, nor the one read before
+               the unit invalidated in flight, which may be out of date. */
+            entry->cached = (gw->cache_ttl_ms > 0 && rsp[0] == pdu[0] &&
+                             entry->generation == gw->route[unit].generation);
+        }
+        entry->state = MB_GATEWAY_ENTRY_DONE;
+        for (uint16_t i = 0; i < entry->waiters; i ++)
+        {
+            ret_os = osSemaphoreRelease(entry->sem);
+            elab_assert(ret_os == osOK);
+        }
+    }
+
+exit:
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+
+    return err;
+}
+
+/**
+ * @brief  Forward the request downstream, with the latency counted.
+ */
+static uint16_t _gateway_forward(mb_gateway_t *gw, uint8_t unit,
+                                    const uint8_t *pdu, uint16_t size,
+                                    uint16_t size_rsp,
+                                    uint8_t *rsp, uint16_t *p_size_rsp)
+{
+    mb_gateway_route_t *route = &gw->route[unit];
+    uint32_t time_start = elab_time_ms();
+
+    uint16_t err = mbm_pdu_request(route->pch, route->slave_node,
+                                    pdu, size, size_rsp, rsp, p_size_rsp);
+    uint32_t latency = elab_time_ms() - time_start;
+
+    osStatus_t ret_os = osMutexAcquire(gw->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    gw->stats.forwarded ++;
+    if (err != MODBUS_ERR_NONE)
+    {
+        gw->stats.errors ++;
+    }
+    gw->latency_total_ms += latency;
+    if (latency > gw->stats.latency_max_ms)
+    {
+        gw->stats.latency_max_ms = latency;
+    }
+
+    ret_os = osMutexRelease(gw->mutex);
+    elab_assert(ret_os == osOK);
+
+    return err;
+}
+
+/**
+ * @brief  Drop the cached reads of the unit, and the reads in flight are not
+ *         cached after they complete. The gateway mutex is held.
+ */
+static void _gateway_invalidate(mb_gateway_t *gw, uint8_t unit)
+{
+    gw->route[unit].generation ++;
+    for (uint32_t i = 0; i < MB_GATEWAY_ENTRY_MAX; i ++)
+    {
+        if (gw->entry[i].unit == unit)
+        {
+            gw->entry[i].cached = false;
+        }
+    }
+}
+
+/**
+ * @brief  Find the read of the same unit and PDU, the one in flight first, or
+ *         else the latest one cached. The gateway mutex is held.
+ */
+static mb_gateway_entry_t *_entry_find(mb_gateway_t *gw, uint8_t unit,
+                                        const uint8_t *pdu)
+{
+    mb_gateway_entry_t *entry = NULL;
+
+    for (uint32_t i = 0; i < MB_GATEWAY_ENTRY_MAX; i ++)
+    {
+        mb_gateway_entry_t *e = &gw->entry[i];
+        if (e->state == MB_GATEWAY_ENTRY_FREE || e->unit != unit ||
+            memcmp(e->key, pdu, MB_GATEWAY_KEY_SIZE) != 0)
+        {
+            continue;
+        }
+        if (e->state == MB_GATEWAY_ENTRY_PENDING)
+        {
+            return e;
+        }
+        if (e->cached &&
+            (entry == NULL || (int32_t)(e->time - entry->time) > 0))
+        {
+            entry = e;
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * @brief  Allocate one entry, a free one first, or else the oldest one done
+ *         and not waited for. The gateway mutex is held.
+ */
+static mb_gateway_entry_t *_entry_alloc(mb_gateway_t *gw)
+{
+    mb_gateway_entry_t *entry = NULL;
+
+    for (uint32_t i = 0; i < MB_GATEWAY_ENTRY_MAX; i ++)
+    {
+        mb_gateway_entry_t *e = &gw->entry[i];
+        if (e->state == MB_GATEWAY_ENTRY_FREE)
+        {
+            return e;
+        }
+        if (e->state == MB_GATEWAY_ENTRY_DONE && e->waiters == 0 &&
+            (entry == NULL || (int32_t)(e->time - entry->time) < 0))
+        {
+            entry = e;
+        }
+    }
+
+    return entry;
+}
+
+/**
+ * @brief  Get the size of the normal response PDU to the request PDU, which is
+ *         read on the serial line.
+ * @retval The size, or 0 if the function code is not supported.
+ */
+static uint16_t _rsp_size(const uint8_t *pdu, uint16_t size)
+{
+    if (size < MB_GATEWAY_KEY_SIZE)
+    {
+        return 0;
+    }
+
+    uint16_t start = ((uint16_t)pdu[1] << 8) + pdu[2];
+    uint16_t nbr = ((uint16_t)pdu[3] << 8) + pdu[4];
+    uint16_t size_reg = (start < MODBUS_CFG_FP_START_IX) ? 2 : 4;
+    uint16_t size_rsp = 0;
+
+    switch (pdu[0])
+    {
+        case MODBUS_FC01_COIL_RD:
+        case MODBUS_FC02_DI_RD:
+            size_rsp = 2 + (nbr + 7) / 8;
+            break;
+
+        case MODBUS_FC03_HOLDING_REG_RD:
+        case MODBUS_FC04_IN_REG_RD:
+            size_rsp = 2 + nbr * size_reg;
+            break;
+
+        case MODBUS_FC06_HOLDING_REG_WR:
+            size_rsp = 3 + size_reg;
+            break;
+
+        case MODBUS_FC05_COIL_WR:
+        case MODBUS_FC15_COIL_WR_MULTIPLE:
+        case MODBUS_FC16_HOLDING_REG_WR_MULTIPLE:
+            size_rsp = 5;
+            break;
+
+        default:
+            break;
+    }
+
+    return (size_rsp < MODBUS_CFG_BUF_SIZE - 3) ? size_rsp : 0;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
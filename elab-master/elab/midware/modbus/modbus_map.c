@@ -0,0 +1,159 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "../../common/elab_assert.h"
+#include "modbus.h"
+
+ELAB_TAG("ModbusMap");
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Exported function prototypes ----------------------------------------------*/
+mb_reg_map_t *mbs_map_find(mb_channel_t *pch, uint8_t type,
+                            uint16_t start_addr, uint16_t nbr_regs);
+uint16_t mbs_map_read(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, uint8_t *presp);
+uint16_t mbs_map_write(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, const uint8_t *pdata);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Add one register map to the Modbus slave. The requests whose
+ *         registers are all in one map are served from its array directly,
+ *         and the others fall back to the callbacks. The map is kept by the
+ *         caller, and it should not overlap with the others of the same type.
+ * @param  pch      Modbus channel handle.
+ * @param  map      The register map.
+ * @retval None.
+ */
+void mb_slave_add_map(mb_channel_t *pch, mb_reg_map_t *map)
+{
+    elab_assert(pch != NULL);
+    elab_assert(pch->m_or_s == MODBUS_SLAVE);
+    elab_assert(map != NULL && map->data != NULL);
+    elab_assert(map->type == MB_REG_MAP_HOLDING || map->type == MB_REG_MAP_INPUT);
+    elab_assert(map->nbr_regs > 0);
+    elab_assert((uint32_t)map->start_addr + map->nbr_regs - 1 <= UINT16_MAX);
+    elab_assert(map->start_addr >= MODBUS_CFG_FP_START_IX ||
+                ((uint32_t)map->start_addr + map->nbr_regs) <= MODBUS_CFG_FP_START_IX);
+
+    /* The map is linked before it is published, as the slave thread may be
+       walking the list in the meantime. */
+    map->next = pch->map;
+    elab_atomic_store(&pch->map, map);
+}
+
+/**
+ * @brief  Find the map holding all the registers of the request.
+ * @param  pch          Modbus channel handle.
+ * @param  type         MB_REG_MAP_HOLDING or MB_REG_MAP_INPUT.
+ * @param  start_addr   The start register address.
+ * @param  nbr_regs     The number of registers.
+ * @retval The map, or NULL if none.
+ */
+mb_reg_map_t *mbs_map_find(mb_channel_t *pch, uint8_t type,
+                            uint16_t start_addr, uint16_t nbr_regs)
+{
+    uint32_t end = (uint32_t)start_addr + nbr_regs;
+
+    /* Paired with the publication in mb_slave_add_map(). */
+    mb_reg_map_t *map = elab_atomic_load(&pch->map);
+    for (; map != NULL; map = map->next)
+    {
+        if (map->type == type && start_addr >= map->start_addr &&
+            end <= ((uint32_t)map->start_addr + map->nbr_regs))
+        {
+            return map;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Copy the registers from the map into the response, in big endian
+ *         for the integer ones and in the host order for the FP ones, as the
+ *         callbacks do.
+ * @param  map          The map, or NULL if the registers are not mapped.
+ * @param  start_addr   The start register address.
+ * @param  nbr_regs     The number of registers.
+ * @param  presp        The response buffer.
+ * @retval MODBUS_ERR_NONE, or MODBUS_ERR_RANGE if not mapped or not readable.
+ */
+uint16_t mbs_map_read(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, uint8_t *presp)
+{
+    if (map == NULL || (map->access & MB_REG_ACCESS_RD) == 0)
+    {
+        return MODBUS_ERR_RANGE;
+    }
+
+    if (map->read_hook != NULL)
+    {
+        map->read_hook(map, start_addr, nbr_regs);
+    }
+
+    uint16_t offset = start_addr - map->start_addr;
+    if (map->start_addr >= MODBUS_CFG_FP_START_IX)
+    {
+        memcpy(presp, &((float *)map->data)[offset], nbr_regs * sizeof(float));
+    }
+    else
+    {
+        const uint16_t *regs = &((uint16_t *)map->data)[offset];
+        for (uint16_t i = 0; i < nbr_regs; i ++)
+        {
+            *presp++ = (uint8_t)(regs[i] >> 8);
+            *presp++ = (uint8_t)(regs[i] & 0x00FF);
+        }
+    }
+
+    return MODBUS_ERR_NONE;
+}
+
+/**
+ * @brief  Copy the registers of the request into the map, all or none.
+ * @param  map          The map, or NULL if the registers are not mapped.
+ * @param  start_addr   The start register address.
+ * @param  nbr_regs     The number of registers.
+ * @param  pdata        The register data in the request.
+ * @retval MODBUS_ERR_NONE, or MODBUS_ERR_RANGE if not mapped or not writable.
+ */
+uint16_t mbs_map_write(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, const uint8_t *pdata)
+{
+    if (map == NULL || (map->access & MB_REG_ACCESS_WR) == 0)
+    {
+        return MODBUS_ERR_RANGE;
+    }
+
+    uint16_t offset = start_addr - map->start_addr;
+    if (map->start_addr >= MODBUS_CFG_FP_START_IX)
+    {
+        memcpy(&((float *)map->data)[offset], pdata, nbr_regs * sizeof(float));
+    }
+    else
+    {
+        uint16_t *regs = &((uint16_t *)map->data)[offset];
+        for (uint16_t i = 0; i < nbr_regs; i ++)
+        {
+            regs[i] = ((uint16_t)pdata[0] << 8) + pdata[1];
+            pdata += 2;
+        }
+    }
+
+    if (map->write_hook != NULL)
+    {
+        map->write_hook(map, start_addr, nbr_regs);
+    }
+
+    return MODBUS_ERR_NONE;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -4,6 +4,7 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "modbus.h"
 #include "../../common/elab_assert.h"
 
@@ -107,6 +108,7 @@ static uint16_t mbm_reg_write_n_resp(mb_channel_t *pch);
 void mb_ascii_rx_byte(mb_channel_t *pch, uint8_t rx_byte);
 bool mb_ascii_rx(mb_channel_t *pch);
 void mb_ascii_tx(mb_channel_t *pch);
+uint8_t mb_ascii_hex_to_bin(uint8_t *phex);
 #endif
 
 #if (MODBUS_CFG_RTU_EN != 0)
@@ -115,14 +117,25 @@ bool mb_rtu_rx(mb_channel_t *pch);
 void mb_rtu_tx(mb_channel_t *pch);
 #endif
 
+#if (MODBUS_CFG_TCP_EN != 0)
+bool mb_tcp_rx(mb_channel_t *pch);
+void mb_tcp_tx(mb_channel_t *pch);
+#endif
+
 static bool mbm_rx_reply(mb_channel_t *pch);
 static void mbm_tx_cmd(mb_channel_t *pch);
+static uint16_t mbm_pdu_rx_blocking(mb_channel_t *pch, uint16_t size_rsp);
 void mb_rx_byte(mb_channel_t *pch, uint8_t rx_byte);
 void mb_rx_task(mb_channel_t*pch);
 void mb_tx(mb_channel_t *pch);
 void mb_tx_byte(mb_channel_t *pch);
 uint16_t mb_rtu_tx_calc_crc(mb_channel_t *pch);
+uint16_t mb_rtu_rx_calc_crc(mb_channel_t *pch);
 uint16_t mbm_rx_blocking(mb_channel_t *pch);
+uint16_t mbm_pdu_request(mb_channel_t *pch, uint8_t slave_node,
+                            const uint8_t *p_pdu, uint16_t size,
+                            uint16_t size_rsp,
+                            uint8_t *p_rsp, uint16_t *p_size_rsp);
 
 /*
 ********************************************************************************
@@ -1577,6 +1590,183 @@ static uint16_t mbm_reg_write_n_resp(mb_channel_t *pch)
 }
 #endif
 
+/*
+********************************************************************************
+*                                             mbm_pdu_request()
+*
+* Description : Sends one request PDU to a slave unit and gets its response PDU back as it is, for the
+*               gateway. An exception response is taken as a valid response here, and it is not waited
+*               for as long as the normal one on the serial line.
+*
+* Argument(s) : pch             Is a pointer to the Modbus channel to send the request to.
+*
+*               slave_node      Is the Modbus node number of the desired slave.
+*
+*               p_pdu           Is a pointer to the request PDU, the function code and the data.
+*
+*               size            Is the size of the request PDU.
+*
+*               size_rsp        Is the expected size of the normal response PDU, which is read on the serial
+*                               line.
+*
+*               p_rsp           Is a pointer to the response PDU buffer of MODBUS_CFG_BUF_SIZE bytes.
+*
+*               p_size_rsp      Is a pointer to the size of the response PDU received.
+*
+* Return(s)   : MODBUS_ERR_NONE          If the function was sucessful.
+*               MODBUS_ERR_TIMED_OUT     If a timeout occurred before receiving a response from the slave.
+*               MODBUS_ERR_RX            If the response is broken.
+*               MODBUS_ERR_SLAVE_ADDR    If the transmitted slave address doesn't correspond to the received slave address
+*               MODBUS_ERR_FC            If the transmitted function code doesn't correspond to the received function code
+*
+* Caller(s)   : Modbus gateway.
+*
+* Note(s)     : none.
+********************************************************************************
+*/
+
+uint16_t mbm_pdu_request(mb_channel_t *pch, uint8_t slave_node,
+                            const uint8_t *p_pdu, uint16_t size,
+                            uint16_t size_rsp,
+                            uint8_t *p_rsp, uint16_t *p_size_rsp)
+{
+    elab_assert(pch != NULL);
+    elab_assert(p_pdu != NULL && p_rsp != NULL && p_size_rsp != NULL);
+    elab_assert(size > 0 && size < MODBUS_CFG_BUF_SIZE);
+    elab_assert(size_rsp > 0 && size_rsp < MODBUS_CFG_BUF_SIZE);
+
+    osStatus_t ret_os = osMutexAcquire(pch->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    MBM_TX_FRAME_NBYTES     = size - 1;
+    MBM_TX_FRAME_SLAVE_ADDR = slave_node;
+    memcpy(&pch->tx_frame_data[1], p_pdu, size);
+
+    /* Send command and wait for response from slave. */
+    mbm_tx_cmd(pch);
+    uint16_t err = mbm_pdu_rx_blocking(pch, size_rsp);
+
+    if (err == MODBUS_ERR_NONE)
+    {
+        bool ok = mbm_rx_reply(pch);
+#if (MODBUS_CFG_RTU_EN != 0)
+        /* The data is passed on, so its CRC is checked here. */
+        if (ok == true && pch->mode == MODBUS_MODE_RTU)
+        {
+            ok = (mb_rtu_rx_calc_crc(pch) == pch->rx_frame_crc);
+        }
+#endif
+        if (ok == false)
+        {
+            err = MODBUS_ERR_RX;
+        }
+        else if (pch->rx_frame_data[0] != slave_node)
+        {
+            err = MODBUS_ERR_SLAVE_ADDR;
+        }
+        else if ((pch->rx_frame_data[1] & 0x7F) != p_pdu[0])
+        {
+            err = MODBUS_ERR_FC;
+        }
+        else
+        {
+            *p_size_rsp = pch->rx_frame_ndata_bytes + 1;
+            memcpy(p_rsp, &pch->rx_frame_data[1], *p_size_rsp);
+        }
+    }
+
+    pch->rx_buff_byte_count = 0;
+    pch->p_rx_buff = &pch->rx_buff[0];
+
+    ret_os = osMutexRelease(pch->mutex);
+    elab_assert(ret_os == osOK);
+
+    return (err);
+}
+
+/*
+********************************************************************************
+*                                             mbm_pdu_rx_blocking()
+*
+* Description : Waits for the response to the request PDU. On the serial line, the address and the
+*               function code are read first. If the function code is the exception one, only the
+*               exception code and the check bytes are read after them, or else the rest of the normal
+*               response.
+*
+* Argument(s) : pch             Is a pointer to the Modbus channel to wait on.
+*
+*               size_rsp        Is the expected size of the normal response PDU.
+*
+* Return(s)   : MODBUS_ERR_NONE          If the function was sucessful.
+*               MODBUS_ERR_TIMED_OUT     If a timeout occurred before receiving a response from the slave.
+*               MODBUS_ERR_RX            If the serial read failed.
+*
+* Caller(s)   : mbm_pdu_request().
+*
+* Note(s)     : The TCP response carries its own length, so it is read as a whole.
+********************************************************************************
+*/
+
+static uint16_t mbm_pdu_rx_blocking(mb_channel_t *pch, uint16_t size_rsp)
+{
+    uint16_t size_head = 2;                     /* The address and the FC. */
+    uint16_t size_exception = 5;                /* And the code and the CRC. */
+    uint16_t size_normal = size_rsp + 3;
+    uint8_t fc = 0;
+
+#if (MODBUS_CFG_TCP_EN != 0)
+    if (pch->mode == MODBUS_MODE_TCP)
+    {
+        return mbm_rx_blocking(pch);
+    }
+#endif
+
+#if (MODBUS_CFG_ASCII_EN != 0)
+    if (pch->mode == MODBUS_MODE_ASCII)
+    {
+        /* The start char, and every byte in two hex chars. */
+        size_head = 5;
+        size_exception = MODBUS_ASCII_MIN_MSG_SIZE;
+        size_normal = MODBUS_ASCII_MIN_MSG_SIZE + (size_rsp - 2) * 2;
+    }
+#endif
+
+    pch->size_expect = size_head;
+    int32_t ret = elab_serial_read(pch->serial,
+                                    pch->rx_buff, size_head, pch->rx_timeout);
+    if (ret == size_head)
+    {
+        fc = pch->rx_buff[1];
+#if (MODBUS_CFG_ASCII_EN != 0)
+        if (pch->mode == MODBUS_MODE_ASCII)
+        {
+            fc = mb_ascii_hex_to_bin(&pch->rx_buff[3]);
+        }
+#endif
+        pch->size_expect = (fc & 0x80) ? size_exception : size_normal;
+        ret = elab_serial_read(pch->serial,
+                                &pch->rx_buff[size_head],
+                                pch->size_expect - size_head, pch->rx_timeout);
+        ret = (ret >= 0) ? (ret + size_head) : ret;
+    }
+
+#if (MODBUS_CFG_RTU_EN != 0)
+    /* Bulk-received bytes did not update the running CRC, so reset the cache. */
+    pch->rx_crc_count = 0;
+#endif
+    if (ret == ELAB_ERR_TIMEOUT || (ret >= 0 && ret < pch->size_expect))
+    {
+        return (MODBUS_ERR_TIMED_OUT);
+    }
+    if (ret < ELAB_OK)
+    {
+        return (MODBUS_ERR_RX);
+    }
+    pch->rx_buff_byte_count = ret;
+
+    return (MODBUS_ERR_NONE);
+}
+
 /*
 ********************************************************************************
 *                                             mbm_rx_reply()
@@ -1611,6 +1801,13 @@ static bool mbm_rx_reply(mb_channel_t *pch)
     }
 #endif
 
+#if (MODBUS_CFG_TCP_EN != 0)
+    if (pch->mode == MODBUS_MODE_TCP)
+    {
+        ok = mb_tcp_rx(pch);
+    }
+#endif
+
     return (ok);
 }
 
@@ -1647,6 +1844,13 @@ static void mbm_tx_cmd(mb_channel_t *pch)
         mb_rtu_tx(pch);
     }
 #endif
+
+#if (MODBUS_CFG_TCP_EN != 0)
+    if (pch->mode == MODBUS_MODE_TCP)
+    {
+        mb_tcp_tx(pch);
+    }
+#endif
 }
 
 #endif
@@ -0,0 +1,548 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
+#include "modbus.h"
+
+ELAB_TAG("ModbusPoll");
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define MBM_POLL_REGS_MAX                       (125)
+#define MBM_POLL_SLEEP_MAX                      (1000)
+
+/* Private typedef -----------------------------------------------------------*/
+/* The register range declared by the clients. */
+typedef struct mbm_poll_range
+{
+    uint8_t slave_node;
+    uint8_t fc;
+    uint16_t start_addr;
+    uint16_t nbr_regs;
+    uint32_t period_ms;
+} mbm_poll_range_t;
+
+/* The merged ranges of one slave, read in one request, and the cache. */
+typedef struct mbm_poll_block
+{
+    uint8_t slave_node;
+    uint8_t fc;
+    uint16_t start_addr;
+    uint16_t nbr_regs;
+    uint16_t err;                               /* Error of the last request */
+    bool valid;                                 /* The cache has been read */
+    uint32_t period_ms;
+    uint32_t time_next;                         /* Time of the next request */
+    uint32_t time_update;                       /* Time of the cache updated */
+    uint16_t regs[MBM_POLL_REGS_MAX];
+} mbm_poll_block_t;
+
+struct mbm_poll
+{
+    mb_channel_t *pch;
+    osThreadId_t thread;
+    osMutexId_t mutex;
+    osSemaphoreId_t sem_wake;
+    osSemaphoreId_t sem_exit;
+    bool running;
+
+    /* The ranges sorted by slave, function code and start address. */
+    mbm_poll_range_t *range;
+    uint32_t range_count;
+    uint32_t range_max;
+
+    /* The blocks are rebuilt into the backup array when ranges are added, and
+       the generation tells the polling thread its request is out of date. */
+    mbm_poll_block_t *block;
+    mbm_poll_block_t *block_bkp;
+    uint32_t block_count;
+    uint32_t generation;
+
+    mbm_poll_stats_t stats;
+    uint32_t time_start;
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void _entry_poll(void *para);
+static void _poll_rebuild(mbm_poll_t *poll);
+static mbm_poll_block_t *_poll_block_due(mbm_poll_t *poll, uint32_t time,
+                                            uint32_t *time_sleep);
+static int32_t _range_compare(const mbm_poll_range_t *a, const mbm_poll_range_t *b);
+
+/* Private variables ---------------------------------------------------------*/
+static const osMutexAttr_t mutex_attr_mbm_poll =
+{
+    "mutex_modbus_poll",
+    osMutexRecursive | osMutexPrioInherit,
+    NULL,
+    0U
+};
+
+static const osThreadAttr_t mbm_thread_poll_attr =
+{
+    .name = "mbm_thread_poll",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityAboveNormal,
+    .stack_size = 2048,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Create the polling engine on the Modbus master channel. The clients
+ *         declare their register ranges, and the engine reads them in the
+ *         fewest requests and caches the values.
+ * @param  pch          Modbus master channel handle.
+ * @param  range_max    The max number of the register ranges.
+ * @retval The polling engine handle.
+ */
+mbm_poll_t *mbm_poll_create(mb_channel_t *pch, uint32_t range_max)
+{
+    elab_assert(pch != NULL);
+    elab_assert(pch->m_or_s == MODBUS_MASTER);
+    elab_assert(range_max > 0);
+
+    mbm_poll_t *poll = elab_malloc(sizeof(mbm_poll_t));
+    elab_assert(poll != NULL);
+    memset(poll, 0, sizeof(mbm_poll_t));
+
+    poll->pch = pch;
+    poll->range_max = range_max;
+    poll->range = elab_malloc(sizeof(mbm_poll_range_t) * range_max);
+    elab_assert(poll->range != NULL);
+    poll->block = elab_malloc(sizeof(mbm_poll_block_t) * range_max);
+    elab_assert(poll->block != NULL);
+    poll->block_bkp = elab_malloc(sizeof(mbm_poll_block_t) * range_max);
+    elab_assert(poll->block_bkp != NULL);
+
+    poll->mutex = osMutexNew(&mutex_attr_mbm_poll);
+    elab_assert(poll->mutex != NULL);
+    poll->sem_wake = osSemaphoreNew(1, 0, NULL);
+    elab_assert(poll->sem_wake != NULL);
+    poll->sem_exit = osSemaphoreNew(1, 0, NULL);
+    elab_assert(poll->sem_exit != NULL);
+
+    poll->time_start = elab_time_ms();
+    poll->running = true;
+    poll->thread = osThreadNew(_entry_poll, poll, &mbm_thread_poll_attr);
+    elab_assert(poll->thread != NULL);
+
+    return poll;
+}
+
+/**
+ * @brief  Destroy the polling engine, and the Modbus channel is kept.
+ * @param  poll     The polling engine handle.
+ * @retval None.
+ */
+void mbm_poll_destroy(mbm_poll_t *poll)
+{
+    elab_assert(poll != NULL);
+
+    osStatus_t ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    poll->running = false;
+    ret_os = osMutexRelease(poll->mutex);
+    elab_assert(ret_os == osOK);
+
+    /* Wait for the polling thread finishing its current request. */
+    osSemaphoreRelease(poll->sem_wake);
+    ret_os = osSemaphoreAcquire(poll->sem_exit, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    osSemaphoreDelete(poll->sem_exit);
+    osSemaphoreDelete(poll->sem_wake);
+    osMutexDelete(poll->mutex);
+    elab_free(poll->block_bkp);
+    elab_free(poll->block);
+    elab_free(poll->range);
+    elab_free(poll);
+}
+
+/**
+ * @brief  Declare one register range to be polled. The adjacent and overlapped
+ *         ranges of the same slave and function code are merged into one
+ *         request of at most 125 registers, in the shortest period of them.
+ * @param  poll         The polling engine handle.
+ * @param  slave_node   The slave node address.
+ * @param  fc           MODBUS_FC03_HOLDING_REG_RD or MODBUS_FC04_IN_REG_RD.
+ * @param  start_addr   The start register address.
+ * @param  nbr_regs     The number of registers, [1, 125].
+ * @param  period_ms    The polling period in ms.
+ * @retval MODBUS_ERR_NONE, or MODBUS_ERR_RANGE if the ranges are full.
+ */
+uint16_t mbm_poll_add(mbm_poll_t *poll, uint8_t slave_node, uint8_t fc,
+                        uint16_t start_addr, uint16_t nbr_regs,
+                        uint32_t period_ms)
+{
+    elab_assert(poll != NULL);
+    elab_assert(slave_node > 0 && slave_node <= MODBUS_NODE_ADDR_MAX);
+    elab_assert(fc == MODBUS_FC03_HOLDING_REG_RD || fc == MODBUS_FC04_IN_REG_RD);
+    elab_assert(nbr_regs > 0 && nbr_regs <= MBM_POLL_REGS_MAX);
+    elab_assert((uint32_t)start_addr + nbr_regs - 1 <= UINT16_MAX);
+    elab_assert(period_ms > 0);
+
+    uint16_t err = MODBUS_ERR_NONE;
+    osStatus_t ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    if (poll->range_count >= poll->range_max)
+    {
+        err = MODBUS_ERR_RANGE;
+        goto exit;
+    }
+
+    /* Insert the range in the sorted order. */
+    mbm_poll_range_t range =
+    {
+        .slave_node = slave_node,
+        .fc = fc,
+        .start_addr = start_addr,
+        .nbr_regs = nbr_regs,
+        .period_ms = period_ms,
+    };
+    uint32_t i = poll->range_count;
+    while (i > 0 && _range_compare(&poll->range[i - 1], &range) > 0)
+    {
+        poll->range[i] = poll->range[i - 1];
+        i --;
+    }
+    poll->range[i] = range;
+    poll->range_count ++;
+
+    _poll_rebuild(poll);
+
+exit:
+    ret_os = osMutexRelease(poll->mutex);
+    elab_assert(ret_os == osOK);
+    if (err == MODBUS_ERR_NONE)
+    {
+        osSemaphoreRelease(poll->sem_wake);
+    }
+
+    return err;
+}
+
+/**
+ * @brief  Read the registers from the cache of the polling engine.
+ * @param  poll         The polling engine handle.
+ * @param  slave_node   The slave node address.
+ * @param  fc           MODBUS_FC03_HOLDING_REG_RD or MODBUS_FC04_IN_REG_RD.
+ * @param  start_addr   The start register address.
+ * @param  p_reg_tbl    The buffer of the register values.
+ * @param  nbr_regs     The number of registers.
+ * @param  age_ms       Output, the time in ms since the values are read. NULL
+ *                      if it is not needed.
+ * @retval MODBUS_ERR_NONE, MODBUS_ERR_RANGE if the registers are not in one
+ *         declared range, or the error of the last request if the registers
+ *         have not been read yet, which is MODBUS_ERR_NO_DATA before the first
+ *         request.
+ */
+uint16_t mbm_poll_read(mbm_poll_t *poll, uint8_t slave_node, uint8_t fc,
+                        uint16_t start_addr, uint16_t *p_reg_tbl,
+                        uint16_t nbr_regs, uint32_t *age_ms)
+{
+    elab_assert(poll != NULL);
+    elab_assert(p_reg_tbl != NULL);
+    elab_assert(nbr_regs > 0);
+
+    uint16_t err = MODBUS_ERR_RANGE;
+    uint32_t start = start_addr;
+    uint32_t end = start + nbr_regs;
+    osStatus_t ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    for (uint32_t i = 0; i < poll->block_count; i ++)
+    {
+        mbm_poll_block_t *block = &poll->block[i];
+        if (block->slave_node != slave_node || block->fc != fc ||
+            start < block->start_addr ||
+            end > ((uint32_t)block->start_addr + block->nbr_regs))
+        {
+            continue;
+        }
+
+        if (block->valid)
+        {
+            memcpy(p_reg_tbl, &block->regs[start - block->start_addr],
+                    sizeof(uint16_t) * nbr_regs);
+            if (age_ms != NULL)
+            {
+                *age_ms = elab_time_ms() - block->time_update;
+            }
+            err = MODBUS_ERR_NONE;
+        }
+        else
+        {
+            err = block->err;
+        }
+        break;
+    }
+
+    ret_os = osMutexRelease(poll->mutex);
+    elab_assert(ret_os == osOK);
+
+    return err;
+}
+
+/**
+ * @brief  Get the bus statistics of the polling engine.
+ * @param  poll     The polling engine handle.
+ * @param  stats    Output, the statistics.
+ * @retval None.
+ */
+void mbm_poll_get_stats(mbm_poll_t *poll, mbm_poll_stats_t *stats)
+{
+    elab_assert(poll != NULL);
+    elab_assert(stats != NULL);
+
+    osStatus_t ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+
+    *stats = poll->stats;
+    stats->time_total_ms = elab_time_ms() - poll->time_start;
+    stats->utilization = 0;
+    if (stats->time_total_ms > 0)
+    {
+        stats->utilization =
+            (uint16_t)((uint64_t)stats->time_busy_ms * 1000 / stats->time_total_ms);
+    }
+
+    ret_os = osMutexRelease(poll->mutex);
+    elab_assert(ret_os == osOK);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  The polling thread, sending the request of the block whose time is
+ *         the earliest.
+ * @param  para     The polling engine handle.
+ * @retval None.
+ */
+static void _entry_poll(void *para)
+{
+    mbm_poll_t *poll = (mbm_poll_t *)para;
+    uint16_t regs[MBM_POLL_REGS_MAX];
+    osStatus_t ret_os = osOK;
+
+    while (1)
+    {
+        ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+        elab_assert(ret_os == osOK);
+        if (!poll->running)
+        {
+            ret_os = osMutexRelease(poll->mutex);
+            elab_assert(ret_os == osOK);
+            break;
+        }
+
+        uint32_t time_sleep = MBM_POLL_SLEEP_MAX;
+        mbm_poll_block_t *block = _poll_block_due(poll, elab_time_ms(), &time_sleep);
+        if (block == NULL)
+        {
+            ret_os = osMutexRelease(poll->mutex);
+            elab_assert(ret_os == osOK);
+            osSemaphoreAcquire(poll->sem_wake, time_sleep);
+            continue;
+        }
+
+        uint8_t slave_node = block->slave_node;
+        uint8_t fc = block->fc;
+        uint16_t start_addr = block->start_addr;
+        uint16_t nbr_regs = block->nbr_regs;
+        uint32_t generation = poll->generation;
+        ret_os = osMutexRelease(poll->mutex);
+        elab_assert(ret_os == osOK);
+
+        /* The request is sent out of the locking, so the cache can be read in
+           the meantime. */
+        uint16_t err = MODBUS_ERR_FC;
+        uint32_t time_start = elab_time_ms();
+#if (MODBUS_CFG_FC03_EN != 0)
+        if (fc == MODBUS_FC03_HOLDING_REG_RD)
+        {
+            err = mbm_fc03_holding_reg_read(poll->pch, slave_node, start_addr,
+                                            regs, nbr_regs);
+        }
+#endif
+#if (MODBUS_CFG_FC04_EN != 0)
+        if (fc == MODBUS_FC04_IN_REG_RD)
+        {
+            err = mbm_fc04_in_reg_read(poll->pch, slave_node, start_addr,
+                                        regs, nbr_regs);
+        }
+#endif
+        uint32_t time_end = elab_time_ms();
+
+        ret_os = osMutexAcquire(poll->mutex, osWaitForever);
+        elab_assert(ret_os == osOK);
+        poll->stats.requests ++;
+        poll->stats.time_busy_ms += (time_end - time_start);
+        if (err != MODBUS_ERR_NONE)
+        {
+            poll->stats.errors ++;
+        }
+        else
+        {
+            poll->stats.regs += nbr_regs;
+        }
+
+        /* The block is dropped if the blocks have been rebuilt. */
+        if (generation == poll->generation)
+        {
+            block->err = err;
+            if (err == MODBUS_ERR_NONE)
+            {
+                memcpy(block->regs, regs, sizeof(uint16_t) * nbr_regs);
+                block->valid = true;
+                block->time_update = time_end;
+            }
+
+            /* The missed periods are skipped, without a burst of requests. */
+            block->time_next += block->period_ms;
+            if ((int32_t)(block->time_next - time_end) < 0)
+            {
+                block->time_next = time_end + block->period_ms;
+            }
+        }
+        ret_os = osMutexRelease(poll->mutex);
+        elab_assert(ret_os == osOK);
+    }
+
+    osSemaphoreRelease(poll->sem_exit);
+}
+
+/**
+ * @brief  Get the due block whose time is the earliest, in the locking.
+ * @param  poll         The polling engine handle.
+ * @param  time         The current time.
+ * @param  time_sleep   Output, the time to the next request if none is due.
+ * @retval The due block, or NULL if none.
+ */
+static mbm_poll_block_t *_poll_block_due(mbm_poll_t *poll, uint32_t time,
+                                            uint32_t *time_sleep)
+{
+    mbm_poll_block_t *block = NULL;
+    int32_t delta_min = INT32_MAX;
+
+    for (uint32_t i = 0; i < poll->block_count; i ++)
+    {
+        int32_t delta = (int32_t)(poll->block[i].time_next - time);
+        if (delta < delta_min)
+        {
+            delta_min = delta;
+            block = &poll->block[i];
+        }
+    }
+
+    if (block != NULL && delta_min > 0)
+    {
+        if ((uint32_t)delta_min < *time_sleep)
+        {
+            *time_sleep = (uint32_t)delta_min;
+        }
+        block = NULL;
+    }
+
+    return block;
+}
+
+/**
+ * @brief  Rebuild the blocks from the sorted ranges, in the locking. The cache
+ *         of the unchanged blocks is kept, and the new ones are due at once.
+ * @param  poll     The polling engine handle.
+ * @retval None.
+ */
+static void _poll_rebuild(mbm_poll_t *poll)
+{
+    mbm_poll_block_t *block = NULL;
+    uint32_t count = 0;
+    uint32_t time = elab_time_ms();
+
+    for (uint32_t i = 0; i < poll->range_count; i ++)
+    {
+        mbm_poll_range_t *range = &poll->range[i];
+        uint32_t end = (uint32_t)range->start_addr + range->nbr_regs;
+
+        /* Merge the range into the current block if it is adjacent or
+           overlapped and the block is not too long. */
+        if (block != NULL &&
+            block->slave_node == range->slave_node && block->fc == range->fc &&
+            range->start_addr <= (block->start_addr + block->nbr_regs) &&
+            (end - block->start_addr) <= MBM_POLL_REGS_MAX)
+        {
+            if (end > ((uint32_t)block->start_addr + block->nbr_regs))
+            {
+                block->nbr_regs = (uint16_t)(end - block->start_addr);
+            }
+            if (range->period_ms < block->period_ms)
+            {
+                block->period_ms = range->period_ms;
+            }
+            continue;
+        }
+
+        block = &poll->block_bkp[count ++];
+        block->slave_node = range->slave_node;
+        block->fc = range->fc;
+        block->start_addr = range->start_addr;
+        block->nbr_regs = range->nbr_regs;
+        block->period_ms = range->period_ms;
+    }
+
+    /* Keep the cache and the timing of the unchanged blocks. */
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        block = &poll->block_bkp[i];
+        block->err = MODBUS_ERR_NO_DATA;
+        block->valid = false;
+        block->time_next = time;
+        block->time_update = time;
+        for (uint32_t j = 0; j < poll->block_count; j ++)
+        {
+            mbm_poll_block_t *block_old = &poll->block[j];
+            if (block_old->slave_node == block->slave_node &&
+                block_old->fc == block->fc &&
+                block_old->start_addr == block->start_addr &&
+                block_old->nbr_regs == block->nbr_regs)
+            {
+                uint32_t period_ms = block->period_ms;
+                memcpy(block, block_old, sizeof(mbm_poll_block_t));
+                block->period_ms = period_ms;
+                break;
+            }
+        }
+    }
+
+    block = poll->block;
+    poll->block = poll->block_bkp;
+    poll->block_bkp = block;
+    poll->block_count = count;
+    poll->generation ++;
+}
+
+/**
+ * @brief  Compare two ranges by slave, function code and start address.
+ */
+static int32_t _range_compare(const mbm_poll_range_t *a, const mbm_poll_range_t *b)
+{
+    if (a->slave_node != b->slave_node)
+    {
+        return ((int32_t)a->slave_node - (int32_t)b->slave_node);
+    }
+    if (a->fc != b->fc)
+    {
+        return ((int32_t)a->fc - (int32_t)b->fc);
+    }
+
+    return ((int32_t)a->start_addr - (int32_t)b->start_addr);
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -20,6 +20,9 @@ ELAB_TAG("ModbusSlave");
 
 #if     (MODBUS_CFG_RTU_EN != 0)
 #define MODBUS_RTU_MIN_MSG_SIZE                    4
+/* The gaps waited for in the request to this node, which is known incomplete
+   by its size, to ride out the OS scheduling jitter. */
+#define MBS_RTU_GAPS_SIZED                        10
 #endif
 
 #define  MODBUS_COIL_OFF_CODE                  0x0000
@@ -110,6 +113,18 @@ void mb_rtu_rx_byte(mb_channel_t *pch, uint8_t rx_byte);
 
 static void mbs_error_resp_set(mb_channel_t *pch, uint8_t errcode);
 
+#if (MODBUS_CFG_MASTER_EN != 0)
+bool mbs_gateway_routed(mb_gateway_t *gw, uint8_t unit);
+bool mbs_gateway_handler(mb_gateway_t *gw, mb_channel_t *pch);
+#endif
+
+mb_reg_map_t *mbs_map_find(mb_channel_t *pch, uint8_t type,
+                            uint16_t start_addr, uint16_t nbr_regs);
+uint16_t mbs_map_read(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, uint8_t *presp);
+uint16_t mbs_map_write(mb_reg_map_t *map, uint16_t start_addr,
+                        uint16_t nbr_regs, const uint8_t *pdata);
+
 #if (MODBUS_CFG_FC01_EN != 0)
 static bool mbs_fc01_coil_read(mb_channel_t   *pch);
 #endif
@@ -148,6 +163,8 @@ static void mbs_ascii_task(mb_channel_t   *pch);
 
 #if (MODBUS_CFG_RTU_EN != 0)
 static void mbs_rtu_task(mb_channel_t   *pch);
+static void mbs_rtu_rx(mb_channel_t *pch);
+static uint16_t mbs_rtu_frame_size(mb_channel_t *pch);
 #endif
 
 #endif
@@ -164,33 +181,149 @@ void mb_tx_byte(mb_channel_t   *pch);
 void entry_slave_rx(void *paras)
 {
     mb_channel_t *pch = (mb_channel_t *)paras;
-    uint8_t c = 0;
+    uint8_t buff[32];
     int32_t ret = 0;
-    int32_t ret_bkp = ELAB_ERR_TIMEOUT;
-    uint32_t timeout = osWaitForever;
 
+#if (MODBUS_CFG_RTU_EN != 0)
     if (pch->mode == MODBUS_MODE_RTU)
     {
-        timeout = pch->rtu_timeout;
+        mbs_rtu_rx(pch);
+    }
+#endif
+
+    /* The ASCII frame is ended by its own characters, not by the gap. */
+    while (1)
+    {
+        ret = elab_serial_read_chunk(pch->serial, buff, sizeof(buff),
+                                        osWaitForever);
+        for (int32_t i = 0; i < ret; i ++)
+        {
+            mb_rx_byte(pch, buff[i]);
+        }
     }
+}
+
+/**
+  * @brief  The RTU frame assembler of the slave. All the bytes available are
+  *         read in one call, and the frame is ended as soon as it is complete
+  *         according to its function code, or else by the 3.5-character gap.
+  * @param  pch     Modbus channel handle.
+  * @retval None.
+  */
+#if (MODBUS_CFG_RTU_EN != 0)
+static void mbs_rtu_rx(mb_channel_t *pch)
+{
+    int32_t ret = 0;
+    uint16_t size = 0;
+    uint32_t timeout = osWaitForever;
+
+    /* Bulk-received bytes did not update the running CRC, so reset the cache. */
+    pch->rx_crc_count = 0;
 
     while (1)
     {
-        ret = elab_serial_read(pch->serial, &c, 1, timeout);
+        /* Wait for the first byte of one frame for ever, and for the others
+           in the gap. */
+        timeout = osWaitForever;
+        if (pch->rx_buff_byte_count > 0)
+        {
+            timeout = pch->rtu_timeout;
+            if (size > pch->rx_buff_byte_count)
+            {
+                timeout *= MBS_RTU_GAPS_SIZED;
+            }
+        }
+        ret = elab_serial_read_chunk(pch->serial, pch->p_rx_buff,
+                                    MODBUS_CFG_BUF_SIZE - pch->rx_buff_byte_count,
+                                    timeout);
         if (ret > 0)
         {
-            mb_rx_byte(pch, c);
+            pch->rx_count += ret;
+            pch->rx_buff_byte_count += ret;
+            pch->p_rx_buff += ret;
+
+            /* More bytes than expected are left to the gap, to be checked by
+               the CRC as one frame. */
+            size = mbs_rtu_frame_size(pch);
+            if ((size != 0 && pch->rx_buff_byte_count == size) ||
+                pch->rx_buff_byte_count >= MODBUS_CFG_BUF_SIZE)
+            {
+                mbs_rtu_task(pch);
+                size = 0;
+            }
         }
-        else if (pch->mode == MODBUS_MODE_RTU &&
-                    ret == ELAB_ERR_TIMEOUT && ret_bkp > 0)
+        else if (ret == ELAB_ERR_TIMEOUT && pch->rx_buff_byte_count > 0)
         {
-            mbs_rx_task(pch);
+            mbs_rtu_task(pch);
+            size = 0;
         }
-
-        ret_bkp = ret;
     }
 }
+#endif
+
+/**
+  * @brief  Get the size of the RTU request frame from its function code. Only
+  *         the requests to this node, the broadcast ones and the ones routed by
+  *         the gateway are sized, as the other frames on a multi-drop line may
+  *         be the replies of the other slaves, which are formatted differently.
+  * @param  pch     Modbus channel handle.
+  * @retval The frame size including the CRC, or 0 if not known yet.
+  */
+#if (MODBUS_CFG_RTU_EN != 0)
+static uint16_t mbs_rtu_frame_size(mb_channel_t *pch)
+{
+    uint8_t *pbuf = pch->rx_buff;
+    uint16_t count = pch->rx_buff_byte_count;
+    uint16_t size = 0;
+
+    if (count < 2)
+    {
+        return 0;
+    }
+    if (pbuf[0] != pch->node_addr && pbuf[0] != 0
+#if (MODBUS_CFG_MASTER_EN != 0)
+        && !mbs_gateway_routed(elab_atomic_load(&pch->gateway), pbuf[0])
+#endif
+        )
+    {
+        return 0;
+    }
+
+    switch (pbuf[1])
+    {
+        case MODBUS_FC01_COIL_RD:
+        case MODBUS_FC02_DI_RD:
+        case MODBUS_FC03_HOLDING_REG_RD:
+        case MODBUS_FC04_IN_REG_RD:
+        case MODBUS_FC05_COIL_WR:
+            size = 8;
+            break;
+
+        case MODBUS_FC06_HOLDING_REG_WR:
+            /* The FP register is written in 4 bytes. */
+            if (count >= 4)
+            {
+                uint16_t reg = ((uint16_t)pbuf[2] << 8) + pbuf[3];
+                size = (reg < MODBUS_CFG_FP_START_IX) ? 8 : 10;
+            }
+            break;
 
+        case MODBUS_FC15_COIL_WR_MULTIPLE:
+        case MODBUS_FC16_HOLDING_REG_WR_MULTIPLE:
+            /* Address, fc, start, quantity, byte count, data and CRC. */
+            if (count >= 7)
+            {
+                size = 9 + pbuf[6];
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return size;
+}
+#endif
  
 /*
 ********************************************************************************
@@ -249,6 +382,16 @@ bool mbs_handler(mb_channel_t *pch)
 {
     bool send_reply = false;
 
+#if (MODBUS_CFG_MASTER_EN != 0)
+    /* The request to the unit routed by the gateway, which may be attached
+       by another thread. */
+    mb_gateway_t *gw = elab_atomic_load(&pch->gateway);
+    if (mbs_gateway_routed(gw, MBS_RX_FRAME_ADDR))
+    {
+        return mbs_gateway_handler(gw, pch);
+    }
+#endif
+
     /* Proper node address? or a 'broadcast' address? */
     if ((MBS_RX_FRAME_ADDR == pch->node_addr) || (MBS_RX_FRAME_ADDR == 0))
     {
@@ -638,6 +781,21 @@ static bool mbs_fc03_holding_reg_read(mb_channel_t *pch)
     *presp++              =  MBS_RX_FRAME_FC;
     *presp++              = (uint8_t)nbr_bytes;               /* Set number of data bytes in response message             */
 
+    /* The registers in one map are copied at once, without the callbacks. */
+    mb_reg_map_t *map = mbs_map_find(pch, MB_REG_MAP_HOLDING, reg, nbr_regs);
+    if (map != NULL ||
+        (reg < MODBUS_CFG_FP_START_IX ?
+            pch->cb.holding_reg_read == NULL : pch->cb.holding_reg_read_fp == NULL))
+    {
+        pch->error = MODBUS_ERR_NONE;
+        if (mbs_map_read(map, reg, nbr_regs, presp) != MODBUS_ERR_NONE)
+        {
+            pch->error = MODBUS_ERR_FC03_01;
+            mbs_error_resp_set(pch, MODBUS_ERR_ILLEGAL_DATA_ADDR);
+        }
+        return (true);
+    }
+
     /* Loop through each register requested. */
     while (nbr_regs > 0)
     {
@@ -786,6 +944,22 @@ static bool mbs_fc04_input_reg_read(mb_channel_t *pch)
     *presp++              =  MBS_RX_FRAME_ADDR;                  /* Prepare response packet                                  */
     *presp++              =  MBS_RX_FRAME_FC;
     *presp++              = (uint8_t)nbr_bytes;               /* Set number of data bytes in response message             */
+
+    /* The registers in one map are copied at once, without the callbacks. */
+    mb_reg_map_t *map = mbs_map_find(pch, MB_REG_MAP_INPUT, reg, nbr_regs);
+    if (map != NULL ||
+        (reg < MODBUS_CFG_FP_START_IX ?
+            pch->cb.in_reg_read == NULL : pch->cb.in_reg_read_fp == NULL))
+    {
+        pch->error = MODBUS_ERR_NONE;
+        if (mbs_map_read(map, reg, nbr_regs, presp) != MODBUS_ERR_NONE)
+        {
+            pch->error = MODBUS_ERR_FC04_01;
+            mbs_error_resp_set(pch, MODBUS_ERR_ILLEGAL_DATA_ADDR);
+        }
+        return (true);
+    }
+
     while (nbr_regs > 0) {                                       /* Loop through each register requested.                    */
         if (reg < MODBUS_CFG_FP_START_IX)                       /* See if we want an integer register                       */
         {
@@ -1009,8 +1183,16 @@ static bool mbs_fc06_holding_reg_wr(mb_channel_t *pch)
         return (false);
     }
     
+    /* The register in a map is written without the callbacks. */
+    mb_reg_map_t *map = mbs_map_find(pch, MB_REG_MAP_HOLDING, reg, 1);
+    if (map != NULL ||
+        (reg < MODBUS_CFG_FP_START_IX ?
+            pch->cb.holding_reg_write == NULL : pch->cb.holding_reg_write_fp == NULL))
+    {
+        err = mbs_map_write(map, reg, 1, &pch->rx_frame_data[4]);
+    }
 #if (MODBUS_CFG_FP_EN != 0)
-    if (reg < MODBUS_CFG_FP_START_IX)
+    else if (reg < MODBUS_CFG_FP_START_IX)
     {
         reg_val_16 = MBS_RX_DATA_REG;
         /* Write to integer register. */
@@ -1029,10 +1211,13 @@ static bool mbs_fc06_holding_reg_wr(mb_channel_t *pch)
         pch->cb.holding_reg_write_fp(reg, reg_val_fp, &err);
     }
 #else
-    reg_val_16 = MBS_RX_DATA_REG;
-    /* Write to integer register. */
-    elab_assert(pch->cb.holding_reg_write != NULL);
-    pch->cb.holding_reg_write(reg, reg_val_16, &err);
+    else
+    {
+        reg_val_16 = MBS_RX_DATA_REG;
+        /* Write to integer register. */
+        elab_assert(pch->cb.holding_reg_write != NULL);
+        pch->cb.holding_reg_write(reg, reg_val_16, &err);
+    }
 #endif
     pch->tx_frame_ndata_bytes = 4;
     MBS_TX_FRAME_ADDR      = MBS_RX_FRAME_ADDR;                  /* Prepare response packet (duplicate Rx frame)             */
@@ -1291,7 +1476,20 @@ static bool mbs_fc16_holding_reg_write_multi(mb_channel_t *pch)
         mbs_error_resp_set(pch, MODBUS_ERR_ILLEGAL_DATA_VAL);
         return (true);                                       /* Tell caller that we need to send a response              */
     }
-    while (nbr_regs > 0) {
+
+    /* The registers in one map are written at once, without the callbacks. */
+    mb_reg_map_t *map = mbs_map_find(pch, MB_REG_MAP_HOLDING, reg, nbr_regs);
+    bool mapped = (map != NULL ||
+                    (reg < MODBUS_CFG_FP_START_IX ?
+                        pch->cb.holding_reg_write == NULL :
+                        pch->cb.holding_reg_write_fp == NULL));
+    if (mapped && mbs_map_write(map, reg, nbr_regs, prx_data) != MODBUS_ERR_NONE)
+    {
+        pch->error = MODBUS_ERR_FC16_03;
+        mbs_error_resp_set(pch, MODBUS_ERR_ILLEGAL_DATA_ADDR);
+        return (true);
+    }
+    while (!mapped && nbr_regs > 0) {
 #if (MODBUS_CFG_FP_EN != 0)
         if (reg < MODBUS_CFG_FP_START_IX) {
             reg_val_16  = ((uint16_t)*prx_data++) << 8;        /* Get MSB first.                                           */
@@ -0,0 +1,712 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "modbus.h"
+
+#if (MODBUS_CFG_TCP_EN != 0)
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../../common/elab_assert.h"
+#include "../../common/elab_common.h"
+
+ELAB_TAG("ModbusTcp");
+
+/* Private config ------------------------------------------------------------*/
+#define MB_TCP_HEADER_SIZE                      (6)     /* MBAP without unit */
+#define MB_TCP_LENGTH_MAX                       (254)   /* Unit and 253 PDU */
+#define MB_TCP_ADU_MAX                          (MB_TCP_HEADER_SIZE + MB_TCP_LENGTH_MAX)
+#define MB_TCP_EVENTS_MAX                       (16)
+#define MB_TCP_LISTEN_BACKLOG                   (8)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct mb_tcp_client
+{
+    int fd;
+    uint16_t count;                             /* Bytes in the buffer */
+    uint8_t buff[MB_TCP_ADU_MAX];
+} mb_tcp_client_t;
+
+typedef struct mb_tcp
+{
+    int fd;                                     /* Listening or connection */
+    struct sockaddr_in addr;
+    uint16_t trans_id;                          /* Transaction of the master */
+
+    /* The server thread of the slave. */
+    int fd_epoll;
+    int fd_event;                               /* Waking up on destroying */
+    osThreadId_t thread;
+    osSemaphoreId_t sem_exit;
+    mb_tcp_client_t client[MODBUS_CFG_TCP_CLIENT_MAX];
+} mb_tcp_t;
+
+/* Exported function prototypes ----------------------------------------------*/
+uint16_t mb_tcp_rx_blocking(mb_channel_t *pch);
+bool mb_tcp_rx(mb_channel_t *pch);
+void mb_tcp_tx(mb_channel_t *pch);
+void mb_tcp_destroy(mb_channel_t *pch);
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+bool mbs_handler(mb_channel_t *pch);
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static bool _tcp_send(int fd, uint16_t trans_id, mb_channel_t *pch);
+static int32_t _tcp_recv(int fd, uint8_t *buff, uint32_t size, uint32_t time_end);
+static void _tcp_nodelay(int fd);
+#if (MODBUS_CFG_MASTER_EN != 0)
+static bool _tcp_connect(mb_tcp_t *tcp, uint32_t timeout_ms);
+#endif
+#if (MODBUS_CFG_SLAVE_EN != 0)
+static void _entry_tcp_server(void *para);
+static void _tcp_accept(mb_channel_t *pch);
+static void _tcp_client_read(mb_channel_t *pch, mb_tcp_client_t *client);
+static void _tcp_client_close(mb_channel_t *pch, mb_tcp_client_t *client);
+static bool _tcp_server_handle(mb_channel_t *pch, mb_tcp_client_t *client,
+                                const uint8_t *adu, uint16_t length);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+#if (MODBUS_CFG_MASTER_EN != 0)
+static const osMutexAttr_t mutex_attr_mbm_tcp =
+{
+    "mutex_modbus_tcp",
+    osMutexRecursive | osMutexPrioInherit,
+    NULL,
+    0U
+};
+#endif
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+static const osThreadAttr_t mb_thread_tcp_attr =
+{
+    .name = "mb_thread_tcp",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityRealtime,
+    .stack_size = 4096,
+};
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief  Create the Modbus TCP channel. The master connects to the server,
+ *         and works with the same mbm_* functions as the serial ones. The
+ *         slave serves all the clients in one thread, with the callbacks set
+ *         by mb_slave_set_cb.
+ * @param  host         The server IPv4 address for the master, or the local
+ *                      address to bind for the slave, NULL for any.
+ * @param  port         The TCP port, MODBUS_TCP_PORT in general.
+ * @param  node_addr    Modbus slave node address, which MODBUS_TCP_UNIT_SELF
+ *                      and unit 0 are taken as on TCP.
+ * @param  master_slave MODBUS_MASTER or MODBUS_SLAVE.
+ * @param  rx_timeout   Modbus master rx timeout, also the time the master
+ *                      waits for connecting.
+ * @retval Modbus channel handle, or NULL if the connection or the listening
+ *         fails.
+ */
+mb_channel_t *mb_channel_create_tcp(const char *host, uint16_t port,
+                                    uint8_t node_addr, uint8_t master_slave,
+                                    uint16_t rx_timeout)
+{
+    elab_assert(master_slave == MODBUS_MASTER || master_slave == MODBUS_SLAVE);
+    elab_assert(master_slave == MODBUS_SLAVE || host != NULL);
+
+    mb_channel_t *pch = elab_malloc(sizeof(mb_channel_t));
+    elab_assert(pch != NULL);
+    memset(pch, 0, sizeof(mb_channel_t));
+    mb_tcp_t *tcp = elab_malloc(sizeof(mb_tcp_t));
+    elab_assert(tcp != NULL);
+    memset(tcp, 0, sizeof(mb_tcp_t));
+
+    pch->m_or_s = master_slave;
+    pch->mode = MODBUS_MODE_TCP;
+    pch->write_en = false;
+    pch->node_addr = node_addr;
+    pch->p_rx_buff = pch->rx_buff;
+    pch->p_tx_buff = pch->tx_buff;
+    pch->serial = NULL;
+    pch->tcp = tcp;
+
+    tcp->fd = -1;
+    tcp->fd_epoll = -1;
+    tcp->fd_event = -1;
+    for (uint32_t i = 0; i < MODBUS_CFG_TCP_CLIENT_MAX; i ++)
+    {
+        tcp->client[i].fd = -1;
+    }
+    tcp->addr.sin_family = AF_INET;
+    tcp->addr.sin_port = htons(port);
+    tcp->addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (host != NULL && inet_pton(AF_INET, host, &tcp->addr.sin_addr) != 1)
+    {
+        elog_error("Invalid host %s.", host);
+        goto exit;
+    }
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+    if (master_slave == MODBUS_MASTER)
+    {
+        pch->rx_timeout = rx_timeout;
+        if (!_tcp_connect(tcp, pch->rx_timeout))
+        {
+            goto exit;
+        }
+        pch->mutex = osMutexNew(&mutex_attr_mbm_tcp);
+        elab_assert(pch->mutex != NULL);
+    }
+#endif
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+    if (master_slave == MODBUS_SLAVE)
+    {
+        int opt = 1;
+        tcp->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        elab_assert(tcp->fd >= 0);
+        setsockopt(tcp->fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (bind(tcp->fd, (struct sockaddr *)&tcp->addr, sizeof(tcp->addr)) != 0 ||
+            listen(tcp->fd, MB_TCP_LISTEN_BACKLOG) != 0)
+        {
+            elog_error("Listening on port %u fails, errno %d.", port, errno);
+            goto exit;
+        }
+
+        tcp->fd_epoll = epoll_create1(0);
+        elab_assert(tcp->fd_epoll >= 0);
+        tcp->fd_event = eventfd(0, EFD_NONBLOCK);
+        elab_assert(tcp->fd_event >= 0);
+
+        /* The listening socket is tagged by NULL, and the event by itself. */
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL, };
+        int ret = epoll_ctl(tcp->fd_epoll, EPOLL_CTL_ADD, tcp->fd, &event);
+        elab_assert(ret == 0);
+        event.data.ptr = tcp;
+        ret = epoll_ctl(tcp->fd_epoll, EPOLL_CTL_ADD, tcp->fd_event, &event);
+        elab_assert(ret == 0);
+
+        tcp->sem_exit = osSemaphoreNew(1, 0, NULL);
+        elab_assert(tcp->sem_exit != NULL);
+        tcp->thread = osThreadNew(_entry_tcp_server, pch, &mb_thread_tcp_attr);
+        elab_assert(tcp->thread != NULL);
+    }
+#endif
+
+    return pch;
+
+exit:
+    if (tcp->fd >= 0)
+    {
+        close(tcp->fd);
+    }
+    elab_free(tcp);
+    elab_free(pch);
+
+    return NULL;
+}
+
+/**
+ * @brief  Destroy the Modbus TCP channel, called by mb_channel_destroy. The
+ *         server thread is woken up and exits before the sockets are closed.
+ * @param  pch      Modbus channel handle.
+ * @retval None.
+ */
+void mb_tcp_destroy(mb_channel_t *pch)
+{
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+    osStatus_t ret_os = osOK;
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+    if (pch->m_or_s == MODBUS_SLAVE)
+    {
+        uint64_t value = 1;
+        ssize_t ret = write(tcp->fd_event, &value, sizeof(value));
+        elab_assert(ret == sizeof(value));
+        ret_os = osSemaphoreAcquire(tcp->sem_exit, osWaitForever);
+        elab_assert(ret_os == osOK);
+        osSemaphoreDelete(tcp->sem_exit);
+
+        for (uint32_t i = 0; i < MODBUS_CFG_TCP_CLIENT_MAX; i ++)
+        {
+            if (tcp->client[i].fd >= 0)
+            {
+                close(tcp->client[i].fd);
+            }
+        }
+        close(tcp->fd_event);
+        close(tcp->fd_epoll);
+    }
+#endif
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+    if (pch->m_or_s == MODBUS_MASTER)
+    {
+        ret_os = osMutexDelete(pch->mutex);
+        elab_assert(ret_os == osOK);
+    }
+#endif
+
+    if (tcp->fd >= 0)
+    {
+        close(tcp->fd);
+    }
+    elab_free(tcp);
+    elab_free(pch);
+}
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+/**
+ * @brief  Send the request frame of the master with a new transaction ID. The
+ *         connection is set up again if it has been broken.
+ * @param  pch      Modbus channel handle.
+ * @retval None.
+ */
+void mb_tcp_tx(mb_channel_t *pch)
+{
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+
+    if (tcp->fd < 0 && !_tcp_connect(tcp, pch->rx_timeout))
+    {
+        return;
+    }
+
+    tcp->trans_id ++;
+    pch->tx_buff_byte_count = pch->tx_frame_ndata_bytes + 2 + MB_TCP_HEADER_SIZE;
+    if (!_tcp_send(tcp->fd, tcp->trans_id, pch))
+    {
+        close(tcp->fd);
+        tcp->fd = -1;
+    }
+}
+
+/**
+ * @brief  Wait for the response of the current transaction in the rx timeout.
+ *         The late responses of the former transactions are dropped.
+ * @param  pch      Modbus channel handle.
+ * @retval Error code.
+ */
+uint16_t mb_tcp_rx_blocking(mb_channel_t *pch)
+{
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+    uint32_t time_end = elab_time_ms() + pch->rx_timeout;
+
+    if (tcp->fd < 0)
+    {
+        return MODBUS_ERR_RX;
+    }
+
+    while (1)
+    {
+        int32_t ret = _tcp_recv(tcp->fd, pch->rx_buff, MB_TCP_HEADER_SIZE, time_end);
+        if (ret == MB_TCP_HEADER_SIZE)
+        {
+            uint16_t length = ((uint16_t)pch->rx_buff[4] << 8) + pch->rx_buff[5];
+            if (length < 2 || length > MB_TCP_LENGTH_MAX)
+            {
+                ret = ELAB_ERROR;
+            }
+            else
+            {
+                ret = _tcp_recv(tcp->fd, &pch->rx_buff[MB_TCP_HEADER_SIZE],
+                                length, time_end);
+                if (ret == length)
+                {
+                    ret = MB_TCP_HEADER_SIZE + length;
+                }
+                else if (ret == 0)
+                {
+                    ret = ELAB_ERR_TIMEOUT;
+                }
+            }
+        }
+
+        if (ret == 0)
+        {
+            return MODBUS_ERR_TIMED_OUT;
+        }
+        if (ret < MB_TCP_HEADER_SIZE + 2)
+        {
+            /* Broken, or timed out in the middle of a frame, and the stream
+               cannot be synchronized again. */
+            close(tcp->fd);
+            tcp->fd = -1;
+            return (ret == ELAB_ERR_TIMEOUT) ? MODBUS_ERR_TIMED_OUT : MODBUS_ERR_RX;
+        }
+
+        uint16_t trans_id = ((uint16_t)pch->rx_buff[0] << 8) + pch->rx_buff[1];
+        if (trans_id == tcp->trans_id)
+        {
+            pch->rx_buff_byte_count = (uint16_t)ret;
+            return MODBUS_ERR_NONE;
+        }
+    }
+}
+
+/**
+ * @brief  Move the unit and PDU of the received frame into the rx frame.
+ * @param  pch      Modbus channel handle.
+ * @retval True if the frame is valid.
+ */
+bool mb_tcp_rx(mb_channel_t *pch)
+{
+    uint16_t protocol = ((uint16_t)pch->rx_buff[2] << 8) + pch->rx_buff[3];
+    uint16_t length = ((uint16_t)pch->rx_buff[4] << 8) + pch->rx_buff[5];
+
+    if (protocol != 0 ||
+        pch->rx_buff_byte_count != (MB_TCP_HEADER_SIZE + length))
+    {
+        return (false);
+    }
+
+    memcpy(pch->rx_frame_data, &pch->rx_buff[MB_TCP_HEADER_SIZE], length);
+    pch->rx_frame_ndata_bytes = length - 2;
+
+    return (true);
+}
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief  Send the MBAP header and the tx frame in one system call.
+ * @param  fd       The connection.
+ * @param  trans_id The transaction ID.
+ * @param  pch      Modbus channel handle.
+ * @retval True if all sent.
+ */
+static bool _tcp_send(int fd, uint16_t trans_id, mb_channel_t *pch)
+{
+    uint16_t length = pch->tx_frame_ndata_bytes + 2;
+    uint8_t header[MB_TCP_HEADER_SIZE] =
+    {
+        (uint8_t)(trans_id >> 8), (uint8_t)(trans_id & 0xFF),
+        0, 0,
+        (uint8_t)(length >> 8), (uint8_t)(length & 0xFF),
+    };
+    struct iovec iov[2] =
+    {
+        { .iov_base = header, .iov_len = MB_TCP_HEADER_SIZE, },
+        { .iov_base = pch->tx_frame_data, .iov_len = length, },
+    };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2, };
+
+    ssize_t ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+    return (ret == (ssize_t)(MB_TCP_HEADER_SIZE + length));
+}
+
+/**
+ * @brief  Receive the given size of bytes before the end time.
+ * @param  fd       The connection.
+ * @param  buff     The buffer.
+ * @param  size     The size to receive.
+ * @param  time_end The end time in ms.
+ * @retval The size received, 0 if timed out before any byte received,
+ *         ELAB_ERR_TIMEOUT if timed out after some, or ELAB_ERROR if the
+ *         connection is broken.
+ */
+static int32_t _tcp_recv(int fd, uint8_t *buff, uint32_t size, uint32_t time_end)
+{
+    uint32_t count = 0;
+
+    while (count < size)
+    {
+        int32_t time_wait = (int32_t)(time_end - elab_time_ms());
+        struct pollfd pfd = { .fd = fd, .events = POLLIN, };
+        int ret = poll(&pfd, 1, time_wait > 0 ? time_wait : 0);
+        if (ret == 0)
+        {
+            return (count == 0) ? 0 : ELAB_ERR_TIMEOUT;
+        }
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ELAB_ERROR;
+        }
+
+        ssize_t ret_recv = recv(fd, &buff[count], size - count, 0);
+        if (ret_recv <= 0)
+        {
+            if (ret_recv < 0 && (errno == EINTR || errno == EAGAIN))
+            {
+                continue;
+            }
+            return ELAB_ERROR;
+        }
+        count += (uint32_t)ret_recv;
+    }
+
+    return (int32_t)count;
+}
+
+/**
+ * @brief  Send the small frames at once, without waiting for the ACK.
+ */
+static void _tcp_nodelay(int fd)
+{
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+}
+
+#if (MODBUS_CFG_MASTER_EN != 0)
+/**
+ * @brief  Connect the master to the server. The connection is set up without
+ *         blocking and waited for in the given time, as the channel mutex is
+ *         held by the caller and an unreachable server would otherwise stall
+ *         the master in the kernel SYN retries for minutes.
+ * @param  tcp          The TCP transport.
+ * @param  timeout_ms   The time to wait for the connection.
+ * @retval True if connected.
+ */
+static bool _tcp_connect(mb_tcp_t *tcp, uint32_t timeout_ms)
+{
+    uint32_t time_end = elab_time_ms() + timeout_ms;
+    int err = 0;
+
+    tcp->fd = socket(AF_INET, SOCK_STREAM, 0);
+    elab_assert(tcp->fd >= 0);
+    int flags = fcntl(tcp->fd, F_GETFL, 0);
+    fcntl(tcp->fd, F_SETFL, flags | O_NONBLOCK);
+
+    if (connect(tcp->fd, (struct sockaddr *)&tcp->addr, sizeof(tcp->addr)) != 0)
+    {
+        err = errno;
+    }
+    while (err == EINPROGRESS || err == EINTR)
+    {
+        int32_t time_wait = (int32_t)(time_end - elab_time_ms());
+        struct pollfd pfd = { .fd = tcp->fd, .events = POLLOUT, };
+        int ret = poll(&pfd, 1, time_wait > 0 ? time_wait : 0);
+        if (ret == 0)
+        {
+            err = ETIMEDOUT;
+        }
+        else if (ret < 0)
+        {
+            err = errno;
+        }
+        else
+        {
+            socklen_t len = sizeof(err);
+            getsockopt(tcp->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        }
+    }
+
+    if (err != 0)
+    {
+        elog_error("Connecting to port %u fails, errno %d.",
+                    ntohs(tcp->addr.sin_port), err);
+        close(tcp->fd);
+        tcp->fd = -1;
+        return false;
+    }
+    fcntl(tcp->fd, F_SETFL, flags);
+    _tcp_nodelay(tcp->fd);
+
+    return true;
+}
+#endif
+
+#if (MODBUS_CFG_SLAVE_EN != 0)
+/**
+ * @brief  The server thread of the slave, serving all the clients by epoll.
+ * @param  para     Modbus channel handle.
+ * @retval None.
+ */
+static void _entry_tcp_server(void *para)
+{
+    mb_channel_t *pch = (mb_channel_t *)para;
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+    struct epoll_event events[MB_TCP_EVENTS_MAX];
+    bool running = true;
+
+    while (running)
+    {
+        int count = epoll_wait(tcp->fd_epoll, events, MB_TCP_EVENTS_MAX, -1);
+        if (count < 0)
+        {
+            elab_assert(errno == EINTR);
+            continue;
+        }
+
+        for (int i = 0; i < count; i ++)
+        {
+            if (events[i].data.ptr == tcp)
+            {
+                running = false;
+            }
+            else if (events[i].data.ptr == NULL)
+            {
+                _tcp_accept(pch);
+            }
+            else
+            {
+                _tcp_client_read(pch, (mb_tcp_client_t *)events[i].data.ptr);
+            }
+        }
+    }
+
+    osSemaphoreRelease(tcp->sem_exit);
+}
+
+/**
+ * @brief  Accept the new client, which is closed at once if the clients are
+ *         full.
+ * @param  pch      Modbus channel handle.
+ * @retval None.
+ */
+static void _tcp_accept(mb_channel_t *pch)
+{
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+
+    int fd = accept(tcp->fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    mb_tcp_client_t *client = NULL;
+    for (uint32_t i = 0; i < MODBUS_CFG_TCP_CLIENT_MAX; i ++)
+    {
+        if (tcp->client[i].fd < 0)
+        {
+            client = &tcp->client[i];
+            break;
+        }
+    }
+    if (client == NULL)
+    {
+        elog_warn("Clients are full.");
+        close(fd);
+        return;
+    }
+
+    _tcp_nodelay(fd);
+    client->fd = fd;
+    client->count = 0;
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = client, };
+    int ret = epoll_ctl(tcp->fd_epoll, EPOLL_CTL_ADD, fd, &event);
+    elab_assert(ret == 0);
+}
+
+/**
+ * @brief  Read the client, and handle all the complete frames in its buffer.
+ *         The partial frame is kept until the rest arrives.
+ * @param  pch      Modbus channel handle.
+ * @param  client   The client.
+ * @retval None.
+ */
+static void _tcp_client_read(mb_channel_t *pch, mb_tcp_client_t *client)
+{
+    ssize_t ret = recv(client->fd, &client->buff[client->count],
+                        MB_TCP_ADU_MAX - client->count, 0);
+    if (ret <= 0)
+    {
+        if (ret < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            return;
+        }
+        _tcp_client_close(pch, client);
+        return;
+    }
+    client->count += (uint16_t)ret;
+
+    uint16_t offset = 0;
+    while ((client->count - offset) >= MB_TCP_HEADER_SIZE)
+    {
+        const uint8_t *adu = &client->buff[offset];
+        uint16_t protocol = ((uint16_t)adu[2] << 8) + adu[3];
+        uint16_t length = ((uint16_t)adu[4] << 8) + adu[5];
+        if (protocol != 0 || length < 2 || length > MB_TCP_LENGTH_MAX)
+        {
+            _tcp_client_close(pch, client);
+            return;
+        }
+        if ((client->count - offset) < (MB_TCP_HEADER_SIZE + length))
+        {
+            break;
+        }
+
+        if (!_tcp_server_handle(pch, client, adu, length))
+        {
+            _tcp_client_close(pch, client);
+            return;
+        }
+        offset += (MB_TCP_HEADER_SIZE + length);
+    }
+
+    if (offset > 0)
+    {
+        memmove(client->buff, &client->buff[offset], client->count - offset);
+        client->count -= offset;
+    }
+}
+
+/**
+ * @brief  Close the client and free its slot.
+ */
+static void _tcp_client_close(mb_channel_t *pch, mb_tcp_client_t *client)
+{
+    mb_tcp_t *tcp = (mb_tcp_t *)pch->tcp;
+
+    epoll_ctl(tcp->fd_epoll, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->count = 0;
+}
+
+/**
+ * @brief  Handle one request frame by the function code handler of the slave,
+ *         and send the response with the same transaction ID and unit.
+ * @param  pch      Modbus channel handle.
+ * @param  client   The client.
+ * @param  adu      The request frame with the MBAP header.
+ * @param  length   The length field of the MBAP header.
+ * @retval False if the response cannot be sent.
+ */
+static bool _tcp_server_handle(mb_channel_t *pch, mb_tcp_client_t *client,
+                                const uint8_t *adu, uint16_t length)
+{
+    uint16_t trans_id = ((uint16_t)adu[0] << 8) + adu[1];
+    uint8_t unit = adu[MB_TCP_HEADER_SIZE];
+
+    memcpy(pch->rx_frame_data, &adu[MB_TCP_HEADER_SIZE], length);
+    pch->rx_frame_ndata_bytes = length - 2;
+
+    /* Every request on TCP expects a response, so unit 0 is not a broadcast,
+       but addresses the server itself as MODBUS_TCP_UNIT_SELF does. */
+    if (unit == MODBUS_TCP_UNIT_SELF || unit == 0)
+    {
+        pch->rx_frame_data[0] = pch->node_addr;
+    }
+
+    if (!mbs_handler(pch))
+    {
+        return true;
+    }
+    pch->tx_frame_data[0] = unit;
+
+    /* The client not reading its responses is closed, instead of blocking the
+       other clients. */
+    return _tcp_send(client->fd, trans_id, pch);
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
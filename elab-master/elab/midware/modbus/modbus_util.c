@@ -6,10 +6,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "modbus.h"
-
-/* Private config ------------------------------------------------------------*/
-/* CRC-16 Generation Polynomial value. */
-#define MODBUS_CRC16_POLY                      0xA001
+#include "../../elib/elib_crc.h"
 
 /*
 ********************************************************************************
@@ -219,32 +216,19 @@ uint8_t  mb_ascii_tx_calc_lrc (mb_channel_t  *pch, uint16_t tx_bytes)
 #if (MODBUS_CFG_RTU_EN != 0)
 uint16_t mb_rtu_rx_calc_crc(mb_channel_t *pch)
 {
-    /* Starting address of where the CRC data starts. */
-    uint8_t *pblock = (uint8_t *)&pch->rx_frame_data[0];
     /* Include the address and function code in the CRC. */
     uint16_t length = pch->rx_frame_ndata_bytes + 2;
-    /* Initialize CRC to all ones. */
-    uint16_t crc = 0xFFFF;
-    /* Account for each byte of data. */
-    while (length > 0)
+    uint16_t crc;
+
+    /* The CRC has been updated as the bytes arrived, or calculate it now. */
+    if (pch->rx_crc_count == length)
+    {
+        crc = pch->rx_crc;
+    }
+    else
     {
-        length --;
-        crc ^= (uint16_t)*pblock++;
-        uint8_t shiftctr = 8;
-        do
-        {
-            /* Determine if the shift out of rightmost bit is 1. */
-            bool flag = (crc & 0x0001) ? true : false;
-            /* Shift CRC to the right one bit. */
-            crc >>= 1;
-            /* If (bit shifted out of rightmost bit was a 1). */
-            if (flag == true)
-            {
-                /* Exclusive OR the CRC with the generating polynomial. */
-                crc ^= MODBUS_CRC16_POLY;
-            }
-            shiftctr --;
-        } while (shiftctr > 0);
+        crc = elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT,
+                                &pch->rx_frame_data[0], length);
     }
     pch->rx_frame_crc_calc = crc;
 
@@ -273,35 +257,11 @@ uint16_t mb_rtu_rx_calc_crc(mb_channel_t *pch)
 #if (MODBUS_CFG_RTU_EN != 0)
 uint16_t mb_rtu_tx_calc_crc(mb_channel_t *pch)
 {
-    /* Starting address of where the CRC data starts. */
-    uint8_t *pblock = (uint8_t *)&pch->tx_frame_data[0];
     /* Include the address and function code in the CRC. */
     uint16_t length = pch->tx_frame_ndata_bytes + 2;
-    /* Initialize CRC to all ones. */
-    uint16_t crc = 0xFFFF;
-    /* Account for each byte of data. */
-    while (length > 0)
-    {
-        length --;
-        crc ^= (uint16_t)*pblock++;
-        uint8_t shiftctr = 8;
-        do
-        {
-            /* Determine if the shift out of rightmost bit is 1. */
-            bool flag = (crc & 0x0001) ? true : false; 
-            /* Shift CRC to the right one bit. */
-            crc >>= 1;
-            /* If (bit shifted out of rightmost bit was a 1). */
-            if (flag == true)
-            {
-                /* Exclusive OR the CRC with the generating polynomial. */
-                crc ^= MODBUS_CRC16_POLY;
-            }
-            shiftctr--;
-        } while (shiftctr > 0);
-    }
 
-    return (crc);
+    return elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT,
+                                &pch->tx_frame_data[0], length);
 }
 #endif
 
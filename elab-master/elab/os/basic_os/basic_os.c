@@ -56,9 +56,16 @@ extern "C" {
 
 /* macro -------------------------------------------------------------------- */
 #define BOS_MS_NUM_30DAY                (2592000000U)
-#define BOS_MS_NUM_15DAY                (1296000000U)
 #define BOS_STACK_MIN                   (16)        /* 16 words */
 
+#if (BOS_USE_CYCLE_COUNT != 0)
+#define BOS_CYCLE_START(_start)         ((_start) = bos_cpu_cycle())
+#define BOS_CYCLE_PAUSE(_start, _count) ((_count) += bos_cpu_cycle() - (_start))
+#else
+#define BOS_CYCLE_START(_start)         ((void)(_start))
+#define BOS_CYCLE_PAUSE(_start, _count) ((void)(_count))
+#endif
+
 /* bos task ----------------------------------------------------------------- */
 /* Basic task state */
 enum
@@ -66,7 +73,6 @@ enum
     BosTaskState_Ready = 0,
     BosTaskState_Running,
     BosTaskState_Blocked,
-    BosTaskState_Suspended,
     BosTaskState_Stop,
 
     BosTaskState_Max,
@@ -82,11 +88,25 @@ typedef struct basic_os_tag
     uint16_t stack_size;
     bool timer_cb_runing;
 
+    /* The ready tasks in every priority, in the round-robin order. */
+    bos_task_t *ready_head[BOS_MAX_PRIORITY + 1];
+    bos_task_t *ready_tail[BOS_MAX_PRIORITY + 1];
+    uint32_t ready_bitmap;
+
+    /* The blocked tasks and the running timers, sorted by the timeout time,
+       each one keeping the delta to the previous one. */
+    bos_task_t *delay_list;
+    bos_timer_t *timer_list;
+    uint32_t time_delay;                /* The time the delay list starts at */
+    uint32_t time_timer;                /* The time the timer list starts at */
+
     uint32_t time_idle_backup;
     uint32_t time;
-    uint32_t time_out_min;
-    uint32_t time_offset;
     uint32_t cpu_usage_count;
+
+#if (BOS_USE_CYCLE_COUNT != 0)
+    bos_cycle_t cycle;
+#endif
 } basic_os_t;
 
 /* public variables --------------------------------------------------------- */
@@ -107,6 +127,12 @@ static void bos_sheduler(void);
 static bool bos_check_timer(bool task_idle);
 static void _entry_idle(void *parameter);
 static void _cb_timer_tick(void *para);
+static void _ready_push(bos_task_t *task);
+static void _ready_pop(bos_task_t *task);
+static bos_task_t *_ready_highest(void);
+static void _delay_insert(bos_task_t *task, uint32_t time_ms);
+static void _timer_insert(bos_timer_t *timer, uint32_t delta);
+static void _timer_remove(bos_timer_t *timer);
 
 /* public function ---------------------------------------------------------- */
 void bos_critical_enter(void);
@@ -115,8 +141,8 @@ uint32_t get_sp_value(void);
 
 /* Default task and timer --------------------------------------------------- */
 /*  Note 1
-    Although the priority of idle task is set to be 1. But the program in 
-    bos_sheduler() makes the actual priority of idle task is 0.
+    Although the priority of idle task is set to be 1. But basic_os_init() puts
+    it into the ready list of priority 0, which makes its actual priority 0.
 */
 bos_task_export(task_timer, _entry_idle, 1, NULL);
 bos_timer_export(basic_timer, _cb_timer_tick, false, NULL);
@@ -136,9 +162,9 @@ void basic_os_init(void)
 
     /* Set the stack and its size. */
     uint32_t size = BOS_MAX_STACKS_SIZE;
-    uint32_t mod = (uint32_t)bos_stack % 8;
-    bos.stack = mod == 0 ? bos_stack : (void *)((uint32_t)bos_stack + 8 - mod);
-    size = (((uint32_t)bos.stack + size - mod) / 8) * 8 - (uint32_t)bos.stack;
+    uint32_t mod = (uintptr_t)bos_stack % 8;
+    bos.stack = mod == 0 ? bos_stack : (void *)((uintptr_t)bos_stack + 8 - mod);
+    size = (((uintptr_t)bos.stack + size - mod) / 8) * 8 - (uintptr_t)bos.stack;
     bos.stack_size = size / 4;
 
     /* Get the task table and its counting number. */
@@ -147,7 +173,7 @@ void basic_os_init(void)
     while (1)
     {
         task_temp =
-            (bos_task_rom_t *)((uint32_t)bos.task_table - sizeof(bos_task_rom_t));
+            (bos_task_rom_t *)((uintptr_t)bos.task_table - sizeof(bos_task_rom_t));
         if (task_temp->magic_head != EXPORT_ID_TASK ||
             task_temp->magic_tail != EXPORT_ID_TASK)
         {
@@ -186,7 +212,7 @@ void basic_os_init(void)
     while (1)
     {
         timer_temp =
-            (bos_timer_rom_t *)((uint32_t)bos.timer_table - sizeof(bos_timer_rom_t));
+            (bos_timer_rom_t *)((uintptr_t)bos.timer_table - sizeof(bos_timer_rom_t));
         if (timer_temp->magic_head != EXPORT_ID_TIMER ||
             timer_temp->magic_tail != EXPORT_ID_TIMER)
         {
@@ -203,6 +229,10 @@ void basic_os_init(void)
             bos.timer_table[i].magic_tail == EXPORT_ID_TIMER)
         {
             // TODO Check all timers' data is not repeated.
+            bos_timer_t *timer = (bos_timer_t *)bos.timer_table[i].data;
+            timer->id = i;
+            timer->running = 0;
+            timer->next = NULL;
             bos.timer_count ++;
         }
         else
@@ -212,8 +242,13 @@ void basic_os_init(void)
     }
 
     bos.time = 0;
-    bos.time_offset = 0;
-    bos.time_out_min = UINT32_MAX;
+    bos.time_delay = 0;
+    bos.time_timer = 0;
+    bos.delay_list = NULL;
+    bos.timer_list = NULL;
+    bos.ready_bitmap = 0;
+    memset(bos.ready_head, 0, sizeof(bos.ready_head));
+    memset(bos.ready_tail, 0, sizeof(bos.ready_tail));
     
     /* Get the highest priority task. */
     bos_current = NULL;
@@ -231,7 +266,7 @@ void basic_os_init(void)
         task_info = (bos_task_rom_t *)&bos.task_table[i];
         task_data->stack_size = i == task_id_high_prio ? remaining : BOS_STACK_MIN;
         task_data->stack = stack_current;
-        stack_current = (void *)((uint32_t)stack_current + task_data->stack_size * 4);
+        stack_current = (void *)((uintptr_t)stack_current + task_data->stack_size * 4);
 
         BOS_ASSERT(task_info->priority <= BOS_MAX_PRIORITY);
         BOS_ASSERT(task_info->priority != 0);
@@ -239,8 +274,10 @@ void basic_os_init(void)
         /* save the top of the stack in the task's attibute */
         task_data->sp = bos_cpu_stack_init(task_info);
 
-        task_data->state = BosTaskState_Ready;
+        task_data->priority = task_data == &ram_task_timer_data ?
+                                0 : task_info->priority;
         task_data->state_bkp = BosTaskState_Ready;
+        _ready_push(task_data);
     }
 
     bos_critical_exit();
@@ -269,11 +306,7 @@ void basic_os_run(void)
   */
 uint32_t bos_time(void)
 {
-    bos_critical_enter();
-    uint32_t time_offset = bos.time_offset;
-    bos_critical_exit();
-
-    return (time_offset + bos.time);
+    return bos.time;
 }
 
 /**
@@ -309,30 +342,10 @@ void bos_delay_ms(uint32_t time_ms)
     /* Never call bos_delay_ms in the idle task. */
     BOS_ASSERT(bos_current != &ram_task_timer_data);
     
-    bos_task_t *task_data = NULL;
-    uint32_t count = 0;
     bos_critical_enter();
-    bos_current->timeout = bos.time + time_ms;
+    _ready_pop(bos_current);
     bos_current->state = BosTaskState_Blocked;
-    for (uint32_t i = bos_current->task_id;;)
-    {
-        task_data = (bos_task_t *)bos.task_table[i].data;
-        if (task_data != bos_current &&
-            bos.task_table[i].priority == bos.task_table[bos_current->task_id].priority &&
-            (task_data->state == BosTaskState_Suspended ||
-            task_data->state == BosTaskState_Ready))
-        {
-            task_data->state = BosTaskState_Ready;
-            break;
-        }
-
-        count ++;
-        i = (i + 1) % bos.task_count;
-        if (count >= bos.task_count)
-        {
-            break;
-        }
-    }
+    _delay_insert(bos_current, time_ms);
     bos_critical_exit();
     
     bos_sheduler();
@@ -345,6 +358,7 @@ void bos_delay_ms(uint32_t time_ms)
 void bos_task_exit(void)
 {
     bos_critical_enter();
+    _ready_pop(bos_current);
     bos_current->state = BosTaskState_Stop;
     bos_critical_exit();
     
@@ -360,43 +374,15 @@ void bos_task_exit(void)
   */
 void bos_task_yield(void)
 {
-    bos_task_t *task_data = NULL;
-
     bos_check_timer(false);
     
+    /* Move the current task to the tail of its priority. */
     bos_critical_enter();
-    
-    /* Find the next task in the same priority with the current task. */
-    uint8_t priority_current = bos.task_table[bos_current->task_id].priority;
-    bool found = false;
-    uint32_t count = 0;
-    for (uint32_t i = bos_current->task_id;;)
-    {
-        task_data = (bos_task_t *)bos.task_table[i].data;
-        if (task_data != bos_current &&
-            bos.task_table[i].priority == priority_current &&
-            (task_data->state == BosTaskState_Suspended ||
-            task_data->state == BosTaskState_Ready))
-        {
-            task_data->state = BosTaskState_Ready;
-            bos_current->state = BosTaskState_Suspended;
-            found = true;
-            break;
-        }
-
-        count ++;
-        i = (i + 1) % bos.task_count;
-        if (count >= bos.task_count)
-        {
-            break;
-        }
-    }
+    _ready_pop(bos_current);
+    _ready_push(bos_current);
     bos_critical_exit();
 
-    if (found)
-    {
-        bos_sheduler();
-    }
+    bos_sheduler();
 }
 
 /* Soft timer --------------------------------------------------------------- */
@@ -429,20 +415,23 @@ int16_t bos_timer_get_id(const char *name)
 void bos_timer_start(uint16_t timer_id, uint32_t period)
 {
     BOS_ASSERT(timer_id < bos.timer_count);
-    BOS_ASSERT(period <= BOS_MS_NUM_30DAY);
+    BOS_ASSERT(period != 0 && period <= BOS_MS_NUM_30DAY);
 
     bos_critical_enter();
 
     bos_timer_t *timer = (bos_timer_t *)bos.timer_table[timer_id].data;
+    if (timer->running != 0)
+    {
+        _timer_remove(timer);
+    }
     timer->running = 1;
     timer->period = period;
 
-    timer->timeout = bos.time + period;
-    if (timer->timeout < bos.time_out_min)
+    if (bos.timer_list == NULL)
     {
-        bos.time_out_min = timer->timeout;
+        bos.time_timer = bos.time;
     }
-    
+    _timer_insert(timer, bos.time - bos.time_timer + period);
 
     bos_critical_exit();
 }
@@ -455,24 +444,15 @@ void bos_timer_start(uint16_t timer_id, uint32_t period)
 void bos_timer_stop(uint16_t timer_id)
 {
     BOS_ASSERT(timer_id < bos.timer_count);
-    bos_timer_t *timer = NULL;
-    uint32_t time_out_min = UINT32_MAX;
 
     bos_critical_enter();
 
-    for (uint32_t i = 0; i < bos.timer_count; i ++)
+    bos_timer_t *timer = (bos_timer_t *)bos.timer_table[timer_id].data;
+    if (timer->running != 0)
     {
-        timer = (bos_timer_t *)bos.timer_table[timer_id].data;
-        if (i == timer_id)
-        {
-            timer->running = 0;
-        }
-        else if (timer->running != 0 && time_out_min > timer->timeout)
-        {
-            time_out_min = timer->timeout;
-        }
+        _timer_remove(timer);
+        timer->running = 0;
     }
-    bos.time_out_min = time_out_min;
 
     bos_critical_exit();
 }
@@ -485,21 +465,27 @@ void bos_timer_stop(uint16_t timer_id)
   */
 void bos_timer_reset(uint16_t timer_id, uint32_t period)
 {
-    BOS_ASSERT(timer_id < bos.timer_count);
-    BOS_ASSERT(period <= BOS_MS_NUM_30DAY);
-
-    bos_critical_enter();
+    /* Starting one running timer re-starts it from now. */
+    bos_timer_start(timer_id, period);
+}
 
-    bos_timer_t *timer = (bos_timer_t *)bos.timer_table[timer_id].data;
-    timer->running = 1;
-    timer->period = period;
-    if (bos.time_out_min > timer->timeout)
-    {
-        bos.time_out_min = timer->timeout;
-    }
+#if (BOS_USE_CYCLE_COUNT != 0)
+/* Cycle counting ----------------------------------------------------------- */
+/**
+  * @brief  Get the CPU cycles of the scheduler and the timer checking, the
+  *         timer callback functions not included.
+  * @param  cycle       The cycle counting output.
+  * @retval None.
+  */
+void bos_cycle_get(bos_cycle_t *cycle)
+{
+    BOS_ASSERT(cycle != NULL);
 
+    bos_critical_enter();
+    *cycle = bos.cycle;
     bos_critical_exit();
 }
+#endif
 
 /* private function --------------------------------------------------------- */
 /**
@@ -512,102 +498,84 @@ static bool bos_check_timer(bool task_idle)
     bool ret = false;
     bos_timer_t *timer_data = NULL;
     bos_task_t *task_data = NULL;
+    uint32_t cycle = 0;
+    uint32_t cycle_start = 0;
     
     if (bos.time_idle_backup != bos.time)
     {
         bos.time_idle_backup = bos.time;
         
         bos_critical_enter();
+        BOS_CYCLE_START(cycle_start);
 
-        /* check all the task are timeout or not. */
+        /* Wake up the timeout tasks at the front of the delay list. */
         bool task_timeout = false;
-        for (uint32_t i = 0; i < bos.task_count; i ++)
+        while (bos.delay_list != NULL &&
+                (bos.time - bos.time_delay) >= bos.delay_list->timeout)
         {
-            task_data = (bos_task_t *)bos.task_table[i].data;
-            if (task_data->state == BosTaskState_Blocked)
-            {
-                if (bos.time >= task_data->timeout)
-                {
-                    task_data->state = BosTaskState_Ready;
-                    task_timeout = true;
-                }
-            }
+            task_data = bos.delay_list;
+            bos.delay_list = task_data->next;
+            bos.time_delay += task_data->timeout;
+            _ready_push(task_data);
+            task_timeout = true;
+        }
+        if (bos.delay_list != NULL)
+        {
+            bos.delay_list->timeout -= (bos.time - bos.time_delay);
         }
+        bos.time_delay = bos.time;
+
         if (task_idle && task_timeout)
         {
+            BOS_CYCLE_PAUSE(cycle_start, cycle);
             bos_critical_exit();
             bos_sheduler();
             bos_critical_enter();
+            BOS_CYCLE_START(cycle_start);
         }
-        
-        if (bos.time >= BOS_MS_NUM_15DAY)
+
+        /* Excute the timeout timers at the front of the timer list. */
+        while (bos.timer_list != NULL &&
+                (bos.time - bos.time_timer) >= bos.timer_list->timeout)
         {
-            /* Adjust all tasks' timing. */
-            for (uint32_t i = 0; i < bos.task_count; i ++)
+            timer_data = bos.timer_list;
+            bos.timer_list = timer_data->next;
+            bos.time_timer += timer_data->timeout;
+
+            const bos_timer_rom_t *timer_info = &bos.timer_table[timer_data->id];
+            if (timer_info->oneshoot == 0)
             {
-                task_data = (bos_task_t *)bos.task_table[i].data;
-                if (task_data->state == BosTaskState_Blocked)
-                {
-                    task_data->timeout -= bos.time;
-                }
+                /* Relative to the timeout time, so the period never drifts. */
+                _timer_insert(timer_data, timer_data->period);
             }
-
-            /* Adjust all timers' timing. */
-            for (uint32_t i = 0; i < bos.timer_count; i ++)
+            else
             {
-                timer_data = (bos_timer_t *)bos.timer_table[i].data;
-                if (timer_data->running != 0)
-                {
-                    timer_data->timeout -= bos.time;
-                }
+                timer_data->running = 0;
             }
 
-            bos.time_out_min -= bos.time;
-            bos.time_offset += bos.time;
-            bos.time = 0;
+            BOS_CYCLE_PAUSE(cycle_start, cycle);
+            bos.timer_cb_runing = true;
+            bos_critical_exit();
+            timer_info->func(timer_info->parameter);
+            ret = true;
+            bos_critical_enter();
+            bos.timer_cb_runing = false;
+            BOS_CYCLE_START(cycle_start);
         }
-
-        /* if any timer is timeout */
-        if (bos.time >= bos.time_out_min)
+        if (bos.timer_list != NULL)
         {
-            /* Find the time-out timers and excute the handlers. */
-            for (uint32_t i = 0; i < bos.timer_count; i ++)
-            {
-                timer_data = (bos_timer_t *)bos.timer_table[i].data;
-                if (timer_data->running != 0 && bos.time >= timer_data->timeout)
-                {
-                    bos.timer_cb_runing = true;
-                    bos_critical_exit();
-                    bos.timer_table[i].func(bos.timer_table[i].parameter);
-                    ret = true;
-                    bos_critical_enter();
-                    bos.timer_cb_runing = false;
-                    if (bos.timer_table[i].oneshoot == 0)
-                    {
-                        timer_data->timeout += timer_data->period;
-                    }
-                    else
-                    {
-                        timer_data->running = 0;
-                    }
-                }
-            }
+            bos.timer_list->timeout -= (bos.time - bos.time_timer);
+        }
+        bos.time_timer = bos.time;
 
-            /* Recalculate the minimum timeout value. */
-            if (ret)
-            {
-                uint32_t time_out_min = UINT32_MAX;
-                for (uint32_t i = 0; i < bos.timer_count; i ++)
-                {
-                    timer_data = (bos_timer_t *)bos.timer_table[i].data;
-                    if (timer_data->running != 0 && time_out_min >= timer_data->timeout)
-                    {
-                        time_out_min = timer_data->timeout;
-                    }
-                }
-                bos.time_out_min = time_out_min;
-            }
+        BOS_CYCLE_PAUSE(cycle_start, cycle);
+#if (BOS_USE_CYCLE_COUNT != 0)
+        bos.cycle.timer_last = cycle;
+        if (cycle > bos.cycle.timer_max)
+        {
+            bos.cycle.timer_max = cycle;
         }
+#endif
 
         bos_critical_exit();
     }
@@ -616,47 +584,21 @@ static bool bos_check_timer(bool task_idle)
 }
 
 /**
-  * @brief  Check all thread timers and soft-timers are timeout or not.
-  * @param  task_idle   In idle thread or not.
-  * @retval If false, not timer is timeout.
+  * @brief  Switch to the head task of the highest ready priority.
+  * @retval None.
   */
 static void bos_sheduler(void)
 {
     bos_task_t *task_data = NULL;
+    uint32_t cycle = 0;
+    uint32_t cycle_start = 0;
 
     bos_critical_enter();
+    BOS_CYCLE_START(cycle_start);
     
     if (bos_current != NULL)
     {
-        /* The actual priority of idle task is 0. */
-        bos_next = &ram_task_timer_data;
-        uint8_t priority = 0;
-        uint32_t count = 0;
-        for (uint32_t i = ((bos_current->task_id + 1) % bos.task_count); ;)
-        {
-            task_data = (bos_task_t *)bos.task_table[i].data;
-            if (task_data->state == BosTaskState_Ready &&
-                bos.task_table[i].priority > priority)
-            {
-                bos_next = task_data;
-                priority = bos.task_table[i].priority;
-            }
-
-            if (task_data->state == BosTaskState_Ready &&
-                bos.task_table[i].priority == bos.task_table[bos_current->task_id].priority &&
-                bos_next == &ram_task_timer_data)
-            {
-                bos_next = task_data;
-                priority = bos.task_table[i].priority;
-            }
-
-            count ++;
-            i = (i + 1) % bos.task_count;
-            if (count >= bos.task_count)
-            {
-                break;
-            }
-        }
+        bos_next = _ready_highest();
         
         if (bos_next != bos_current)
         {
@@ -668,44 +610,44 @@ static void bos_sheduler(void)
             if (bos_next->task_id < bos_current->task_id)
             {
                 copy_size = bos_next->stack_size * 4;
-                move_size = sp_value - STACK_SIZE_PUSH - (uint32_t)bos_current->stack;
+                move_size = sp_value - STACK_SIZE_PUSH - (uintptr_t)bos_current->stack;
                 for (uint32_t i = bos_next->task_id + 1; i < bos_current->task_id; i ++)
                 {
                     task_data = (bos_task_t *)bos.task_table[i].data;
-                    task_data->stack = (void *)((uint32_t)task_data->stack + move_size);
-                    task_data->sp = (void *)((uint32_t)task_data->sp + move_size);
+                    task_data->stack = (void *)((uintptr_t)task_data->stack + move_size);
+                    task_data->sp = (void *)((uintptr_t)task_data->sp + move_size);
                     copy_size += task_data->stack_size * 4;
                 }
-                addr_target = (uint32_t)bos_next->stack + move_size;
-                addr_source = (uint32_t)bos_next->stack;
+                addr_target = (uintptr_t)bos_next->stack + move_size;
+                addr_source = (uintptr_t)bos_next->stack;
                 
-                bos_current->stack = (void *)((uint32_t)bos_current->stack + move_size);
-                bos_current->sp = (void *)((uint32_t)sp_value - STACK_SIZE_PUSH);
+                bos_current->stack = (void *)((uintptr_t)bos_current->stack + move_size);
+                bos_current->sp = (void *)(uintptr_t)(sp_value - STACK_SIZE_PUSH);
                 
                 bos_current->stack_size -= (move_size / 4);
                 bos_next->stack_size += (move_size / 4);
-                bos_next->sp = (void *)((uint32_t)bos_next->sp + move_size);
+                bos_next->sp = (void *)((uintptr_t)bos_next->sp + move_size);
                 move_size = move_size;
             }
             /* The current task move to back. */
             else
             {
-                move_size = sp_value - STACK_SIZE_PUSH - (uint32_t)bos_current->stack;
+                move_size = sp_value - STACK_SIZE_PUSH - (uintptr_t)bos_current->stack;
                 copy_size = bos_current->stack_size * 4 - move_size;
-                addr_target = (uint32_t)bos_current->stack;
+                addr_target = (uintptr_t)bos_current->stack;
                 addr_source = (uint32_t)(sp_value - STACK_SIZE_PUSH);
                 for (uint32_t i = bos_current->task_id + 1; i < bos_next->task_id; i ++)
                 {
                     task_data = (bos_task_t *)bos.task_table[i].data;
-                    task_data->stack = (void *)((uint32_t)task_data->stack - move_size);
-                    task_data->sp = (void *)((uint32_t)task_data->sp - move_size);
+                    task_data->stack = (void *)((uintptr_t)task_data->stack - move_size);
+                    task_data->sp = (void *)((uintptr_t)task_data->sp - move_size);
                     copy_size += task_data->stack_size * 4;
                 }
                 
                 bos_current->stack_size -= (move_size / 4);
                 bos_next->stack_size += (move_size / 4);
                 bos_current->sp = bos_current->stack;
-                bos_next->stack = (void *)((uint32_t)bos_next->stack - move_size);
+                bos_next->stack = (void *)((uintptr_t)bos_next->stack - move_size);
                 move_size = move_size;
             }
 
@@ -718,10 +660,144 @@ static void bos_sheduler(void)
     {
         bos_cpu_trig_task_switch();
     }
+
+    BOS_CYCLE_PAUSE(cycle_start, cycle);
+#if (BOS_USE_CYCLE_COUNT != 0)
+    bos.cycle.sheduler_last = cycle;
+    if (cycle > bos.cycle.sheduler_max)
+    {
+        bos.cycle.sheduler_max = cycle;
+    }
+#endif
     
     bos_critical_exit();
 }
 
+/**
+  * @brief  Add the task to the tail of the ready list of its priority.
+  * @param  task        The task.
+  * @retval None.
+  */
+static void _ready_push(bos_task_t *task)
+{
+    task->state = BosTaskState_Ready;
+    task->next = NULL;
+    if (bos.ready_head[task->priority] == NULL)
+    {
+        bos.ready_head[task->priority] = task;
+        bos.ready_bitmap |= (1U << task->priority);
+    }
+    else
+    {
+        bos.ready_tail[task->priority]->next = task;
+    }
+    bos.ready_tail[task->priority] = task;
+}
+
+/**
+  * @brief  Remove the task from the head of the ready list of its priority.
+  * @param  task        The task, which is always the current one.
+  * @retval None.
+  */
+static void _ready_pop(bos_task_t *task)
+{
+    /* The running task is always the head of its priority. */
+    BOS_ASSERT(bos.ready_head[task->priority] == task);
+
+    bos.ready_head[task->priority] = task->next;
+    if (task->next == NULL)
+    {
+        bos.ready_tail[task->priority] = NULL;
+        bos.ready_bitmap &=~ (1U << task->priority);
+    }
+    task->next = NULL;
+}
+
+/**
+  * @brief  Get the head task of the highest ready priority.
+  * @retval The task.
+  */
+static bos_task_t *_ready_highest(void)
+{
+    /* The idle task in priority 0 is always ready, so is the bitmap. */
+    BOS_ASSERT(bos.ready_bitmap != 0);
+
+    return bos.ready_head[31 - BOS_CLZ(bos.ready_bitmap)];
+}
+
+/**
+  * @brief  Insert the task into the delay list by its timeout time.
+  * @param  task        The task.
+  * @param  time_ms     Delayed time in mili-seconds from now.
+  * @retval None.
+  */
+static void _delay_insert(bos_task_t *task, uint32_t time_ms)
+{
+    if (bos.delay_list == NULL)
+    {
+        bos.time_delay = bos.time;
+    }
+
+    uint32_t delta = bos.time - bos.time_delay + time_ms;
+    bos_task_t **link = &bos.delay_list;
+    while (*link != NULL && (*link)->timeout <= delta)
+    {
+        delta -= (*link)->timeout;
+        link = &(*link)->next;
+    }
+    if (*link != NULL)
+    {
+        (*link)->timeout -= delta;
+    }
+    task->timeout = delta;
+    task->next = *link;
+    *link = task;
+}
+
+/**
+  * @brief  Insert the timer into the timer list by its timeout time.
+  * @param  timer       The timer.
+  * @param  delta       The timeout time relative to the list starting time.
+  * @retval None.
+  */
+static void _timer_insert(bos_timer_t *timer, uint32_t delta)
+{
+    bos_timer_t **link = &bos.timer_list;
+    while (*link != NULL && (*link)->timeout <= delta)
+    {
+        delta -= (*link)->timeout;
+        link = &(*link)->next;
+    }
+    if (*link != NULL)
+    {
+        (*link)->timeout -= delta;
+    }
+    timer->timeout = delta;
+    timer->next = *link;
+    *link = timer;
+}
+
+/**
+  * @brief  Remove the timer from the timer list.
+  * @param  timer       The timer.
+  * @retval None.
+  */
+static void _timer_remove(bos_timer_t *timer)
+{
+    bos_timer_t **link = &bos.timer_list;
+    while (*link != timer)
+    {
+        BOS_ASSERT(*link != NULL);
+        link = &(*link)->next;
+    }
+    if (timer->next != NULL)
+    {
+        timer->next->timeout += timer->timeout;
+    }
+    *link = timer->next;
+    timer->next = NULL;
+}
+
 /**
   * @brief  The idle task entry function.
   * @param  parameter   The idle task parameter.
@@ -79,6 +79,12 @@ extern "C" {
   */
 #define BOS_USE_CPU_USAGE                       (0)
 
+/**
+  * @brief  Basic cycle counting of the scheduler and the timers configuration.
+  *         The port should provide bos_cpu_cycle().
+  */
+#define BOS_USE_CYCLE_COUNT                     (0)
+
 /* Data structure ----------------------------------------------------------- */
 enum bos_error
 {
@@ -115,23 +121,37 @@ typedef struct eos_task
 {
     void *sp;
     void *stack;
-    uint32_t timeout;
+    uint32_t timeout;               /* Delta to the previous one in delay list */
     uint32_t stack_size             : 16;
     uint32_t state                  : 4;
     uint32_t state_bkp              : 4;
     uint32_t task_id                : 8;
+    struct eos_task *next;          /* In the ready list or the delay list */
+    uint8_t priority;
 } bos_task_t;
 
 /* Timer related. */
 typedef struct eos_timer
 {
-    uint32_t timeout;
+    uint32_t timeout;               /* Delta to the previous one in timer list */
     uint32_t period;
     uint32_t id                     : 10;
     uint32_t domain                 : 8;
     uint32_t running                : 1;
+    struct eos_timer *next;
 } bos_timer_t;
 
+#if (BOS_USE_CYCLE_COUNT != 0)
+/* Cycle counting related. */
+typedef struct bos_cycle
+{
+    uint32_t sheduler_last;
+    uint32_t sheduler_max;
+    uint32_t timer_last;
+    uint32_t timer_max;
+} bos_cycle_t;
+#endif
+
 /* Task --------------------------------------------------------------------- */
 /**
   * @brief  BasicOS stack and tasks initialization.
@@ -213,6 +233,17 @@ void bos_timer_stop(uint16_t timer_id);
   */
 void bos_timer_reset(uint16_t timer_id, uint32_t period);
 
+#if (BOS_USE_CYCLE_COUNT != 0)
+/* Cycle counting ----------------------------------------------------------- */
+/**
+  * @brief  Get the CPU cycles of the scheduler and the timer checking, the
+  *         timer callback functions not included.
+  * @param  cycle       The cycle counting output.
+  * @retval None.
+  */
+void bos_cycle_get(bos_cycle_t *cycle);
+#endif
+
 /* Export ------------------------------------------------------------------- */
 /**
   * @brief  Export one BasicOS task.
@@ -265,6 +296,9 @@ void bos_timer_reset(uint16_t timer_id, uint32_t period);
 void bos_cpu_hw_init(void);
 void* bos_cpu_stack_init(bos_task_rom_t *task_info);
 void bos_cpu_trig_task_switch(void);
+#if (BOS_USE_CYCLE_COUNT != 0)
+uint32_t bos_cpu_cycle(void);
+#endif
 
 /* hook --------------------------------------------------------------------- */
 /* The idle hook function. */
@@ -280,6 +314,10 @@ void bos_port_assert(uint32_t error_id);
 #error The total number of tasks in BasicOS can NOT be larger than 32 !
 #endif
 
+#if (BOS_MAX_PRIORITY > 31)
+#error The maximum priority of BasicOS can NOT be larger than 31 !
+#endif
+
 #define EXPORT_ID_TASK                          (0xa5a5a5a5)
 #define EXPORT_ID_TIMER                         (0xbeefbeef)
 
@@ -288,16 +326,24 @@ void bos_port_assert(uint32_t error_id);
     #include <stdarg.h>
     #define BOS_SECTION(x)              __attribute__((section(x)))
     #define BOS_USED                    __attribute__((used))
+    #if defined(__CC_ARM)
+    #define BOS_CLZ(x)                  __clz(x)
+    #else
+    #define BOS_CLZ(x)                  __builtin_clz(x)
+    #endif
 
 #elif defined (__IAR_SYSTEMS_ICC__)           /* for IAR Compiler */
     #include <stdarg.h>
+    #include <intrinsics.h>
     #define BOS_SECTION(x)              @ x
     #define BOS_USED                    __root
+    #define BOS_CLZ(x)                  __CLZ(x)
 
 #elif defined (__GNUC__)                      /* GNU GCC Compiler */
     #include <stdarg.h>
     #define BOS_SECTION(x)              __attribute__((section(x)))
     #define BOS_USED                    __attribute__((used))
+    #define BOS_CLZ(x)                  __builtin_clz(x)
 #else
     #error The compiler is not supported by BasicOS !
 #endif
@@ -34,6 +34,10 @@
 /* include ------------------------------------------------------------------ */
 #include "basic_os.h"
 
+#if (BOS_USE_CYCLE_COUNT != 0)
+#error The cycle counting is not supported in Cortex-M0 which has no DWT counter !
+#endif
+
 /* public function ---------------------------------------------------------- */
 void bos_cpu_hw_init(void)
 {
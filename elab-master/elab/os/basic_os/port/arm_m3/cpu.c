@@ -39,6 +39,13 @@ void bos_cpu_hw_init(void)
 {
     /* Set PendSV to be the lowest priority. */
     *(uint32_t volatile *)0xE000ED20 |= (0xFFU << 16U);
+
+#if (BOS_USE_CYCLE_COUNT != 0)
+    /* Enable the DWT cycle counter. */
+    *(uint32_t volatile *)0xE000EDFC |= (1U << 24U);    /* DEMCR.TRCENA */
+    *(uint32_t volatile *)0xE0001004 = 0;               /* DWT_CYCCNT */
+    *(uint32_t volatile *)0xE0001000 |= (1U << 0U);     /* DWT_CTRL.CYCCNTENA */
+#endif
 }
 
 void* bos_cpu_stack_init(bos_task_rom_t *task_info)
@@ -78,4 +85,11 @@ void bos_cpu_trig_task_switch(void)
     *(uint32_t volatile *)0xE000ED04 = (1U << 28);
 }
 
+#if (BOS_USE_CYCLE_COUNT != 0)
+uint32_t bos_cpu_cycle(void)
+{
+    return *(uint32_t volatile *)0xE0001004;
+}
+#endif
+
 /* ----------------------------- end of file -------------------------------- */
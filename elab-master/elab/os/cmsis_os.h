@@ -727,6 +727,24 @@ osStatus_t osMessageQueuePut (osMessageQueueId_t mq_id, const void *msg_ptr, uin
 /// \return status code that indicates the execution status of the function.
 osStatus_t osMessageQueueGet (osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout);
 
+/// Put a number of Messages into a Queue or timeout if Queue is full (eLab extension).
+/// \param[in]     mq_id         message queue ID obtained by \ref osMessageQueueNew.
+/// \param[in]     msg_ptr       pointer to buffer with messages to put into a queue.
+/// \param[in]     msg_count     number of messages to put.
+/// \param[in]     msg_prio      message priority of all the messages.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return number of messages put, or negative status code if none is put.
+int32_t osMessageQueuePutN (osMessageQueueId_t mq_id, const void *msg_ptr, uint32_t msg_count, uint8_t msg_prio, uint32_t timeout);
+
+/// Get a number of Messages from a Queue or timeout if Queue is empty (eLab extension).
+/// \param[in]     mq_id         message queue ID obtained by \ref osMessageQueueNew.
+/// \param[out]    msg_ptr       pointer to buffer for messages to get from a queue.
+/// \param[in]     msg_count     maximum number of messages to get.
+/// \param[out]    msg_prio      pointer to buffer for message priorities or NULL.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return number of messages got once any is queued, or negative status code.
+int32_t osMessageQueueGetN (osMessageQueueId_t mq_id, void *msg_ptr, uint32_t msg_count, uint8_t *msg_prio, uint32_t timeout);
+
 /// Get maximum number of messages in a Message Queue.
 /// \param[in]     mq_id         message queue ID obtained by \ref osMessageQueueNew.
 /// \return maximum number of messages.
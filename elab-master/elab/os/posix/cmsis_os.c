@@ -19,33 +19,51 @@
 #include <assert.h>
 #include <termios.h>
 #include <semaphore.h>
+#include <pthread.h>
 #include "../cmsis_os.h"
 
-#define RTOS_TIMER_NUM_MAX                      (32)
 #define RTOS_TIMER_VALUE_MIN                    (1)
+#define RTOS_TIMER_WHEEL_BITS                   (6)
+#define RTOS_TIMER_WHEEL_SIZE                   (1 << RTOS_TIMER_WHEEL_BITS)
+#define RTOS_TIMER_WHEEL_MASK                   (RTOS_TIMER_WHEEL_SIZE - 1)
+#define RTOS_TIMER_WHEEL_LEVEL                  (4)
+#define RTOS_TIMER_WHEEL_RANGE                  (1 << (RTOS_TIMER_WHEEL_BITS *  \
+                                                        RTOS_TIMER_WHEEL_LEVEL))
+#define RTOS_MUTEX_SPIN_MAX                     (100)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RTOS_CPU_RELAX()                        __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define RTOS_CPU_RELAX()                        __asm__ __volatile__("yield")
+#else
+#define RTOS_CPU_RELAX()                        __asm__ __volatile__("" ::: "memory")
+#endif
+
+struct os_timer_data;
+struct os_mq;
+struct os_mq_cond;
 
 static int get_pthread_priority(osPriority_t prio);
 static void _thread_entry_timer(void *para);
+static void _timer_wheel_init(void);
+static void _timer_link(struct os_timer_data *timer);
+static void _timer_unlink(struct os_timer_data *timer);
+static void _timer_cascade(uint32_t level, uint32_t index);
+static uint32_t _timer_next_delta(void);
+static void _time_after_ms(clockid_t clock, struct timespec *ts, uint32_t ms);
+static void _mutex_spin_init(void);
+static int _mq_wait(struct os_mq_cond *cond, const struct timespec *ts);
+static void _mq_wait_cleanup(void *para);
+static uint32_t _mq_wake_count(struct os_mq_cond *cond, uint32_t count);
+static void _mq_wake(struct os_mq_cond *cond, uint32_t count);
+static void _mq_write(struct os_mq *mq, const uint8_t *msg, uint32_t count,
+                        uint8_t prio);
+static void _mq_read(struct os_mq *mq, uint8_t *msg, uint32_t count,
+                        uint8_t *prio);
 
 /* -----------------------------------------------------------------------------
 Data structure
 ----------------------------------------------------------------------------- */
-static const osMutexAttr_t mutex_attr_queue =
-{
-    "mutex_queue", 
-    osMutexRecursive | osMutexPrioInherit, 
-    NULL,
-    0U 
-};
-
-static const osMutexAttr_t mutex_attr_timer =
-{
-    "mutex_timer",
-    osMutexRecursive | osMutexPrioInherit,
-    NULL,
-    0U 
-};
-
 static const osMutexAttr_t mutex_attr_event_flag =
 {
     "mutex_event_flag",
@@ -63,6 +81,8 @@ enum timer_state
 
 typedef struct os_timer_data
 {
+    struct os_timer_data *next;
+    struct os_timer_data *prev;
     osTimerFunc_t func;
     osTimerType_t type;
     osTimerAttr_t attr;
@@ -70,12 +90,33 @@ typedef struct os_timer_data
     uint32_t timeout;
     uint32_t ticks;
     uint8_t state;
+    uint8_t level;
+    uint8_t index;
+    bool deleted;
 } os_timer_data_t;
 
-static os_timer_data_t timer[RTOS_TIMER_NUM_MAX];
-static uint32_t timeout_min = 0;
+/**
+ * The hierarchical timer wheel. Level 0 has one slot per tick, and every slot of
+ * level N covers the whole level N - 1. The timers in the higher levels are
+ * cascaded down when the lower level wraps around, so starting and stopping
+ * timers are O(1), whatever the number of the timers is.
+ */
+typedef struct os_timer_wheel
+{
+    os_timer_data_t *slot[RTOS_TIMER_WHEEL_LEVEL][RTOS_TIMER_WHEEL_SIZE];
+    uint64_t bitmap[RTOS_TIMER_WHEEL_LEVEL];    /* The non-empty slots */
+    uint32_t time;                              /* The next tick to expire */
+    uint32_t deadline;                          /* The tick the thread waits for */
+    os_timer_data_t *current;                   /* The timer in callback */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} os_timer_wheel_t;
 
-static osMutexId_t mutex_timer = NULL;
+static os_timer_wheel_t timer_wheel =
+{
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+static pthread_once_t timer_wheel_once = PTHREAD_ONCE_INIT;
 
 /* -----------------------------------------------------------------------------
 OS Basic
@@ -89,18 +130,9 @@ static const osThreadAttr_t thread_attr_timer =
 
 osStatus_t osKernelInitialize(void)
 {
-    for (uint32_t i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
-    {
-        timer[i].state = TIMER_STATE_UNUSED;
-    }
-
-    /* Create one thread for mutex function. */
-    mutex_timer = osMutexNew(&mutex_attr_timer);
-    assert(mutex_timer != NULL);
-
-    /* Create one thread for timer function. */
-    osThreadId_t thread = osThreadNew(_thread_entry_timer, NULL, NULL);
-    assert(thread != NULL);
+    /* The kernel may be initialized more than once, but only one thread is
+       dispatching the timers. */
+    pthread_once(&timer_wheel_once, _timer_wheel_init);
 
     return osOK;
 }
@@ -270,56 +302,86 @@ osStatus_t osThreadJoin(osThreadId_t thread_id)
 /* -----------------------------------------------------------------------------
 Message queue
 ----------------------------------------------------------------------------- */
+/**
+ * The message queue is one ring buffer protected by one mutex, and the waiting
+ * threads sleep on two semaphores out of the locking. A semaphore is only
+ * posted for the waiting threads not woken up yet, so the single put and get
+ * do not post again and again before the woken thread runs. The messages are
+ * sorted by the priority, and the ones in the same priority are FIFO. The
+ * messages in the priority 0 or the lowest queued priority are appended
+ * directly.
+ */
+typedef struct os_mq_cond
+{
+    sem_t sem;
+    pthread_mutex_t *mutex;
+    uint32_t waiting;
+    uint32_t signaled;                          /* The waiting ones woken up */
+} os_mq_cond_t;
+
 typedef struct os_mq
 {
-    osMutexId_t mutex;
-    osSemaphoreId_t sem_empty;
-    osSemaphoreId_t sem_full;
+    pthread_mutex_t mutex;
+    os_mq_cond_t not_empty;
+    os_mq_cond_t not_full;
+    const char *name;
     uint8_t *memory;
+    uint8_t *prio;
     uint32_t msg_size;
     uint32_t capacity;
     uint32_t head;
-    uint32_t tail;
-    bool empty;
-    bool full;
+    uint32_t count;
 } os_mq_t;
 
 osMessageQueueId_t osMessageQueueNew(uint32_t msg_count,
                                      uint32_t msg_size,
                                      const osMessageQueueAttr_t *attr)
 {
-    assert(attr == NULL);
     assert(msg_count != 0);
     assert(msg_size != 0);
 
     os_mq_t *mq = malloc(sizeof(os_mq_t));
     assert(mq != NULL);
 
-    mq->mutex = osMutexNew(&mutex_attr_queue);
-    assert(mq->mutex != NULL);
-    mq->sem_full = osSemaphoreNew(msg_count, msg_count, NULL);
-    assert(mq->sem_full != NULL);
-    mq->sem_empty = osSemaphoreNew(msg_count, 0, NULL);
-    assert(mq->sem_empty != NULL);
-
+    pthread_mutex_init(&mq->mutex, NULL);
+    sem_init(&mq->not_empty.sem, 0, 0);
+    sem_init(&mq->not_full.sem, 0, 0);
+    mq->not_empty.mutex = &mq->mutex;
+    mq->not_empty.waiting = 0;
+    mq->not_empty.signaled = 0;
+    mq->not_full.mutex = &mq->mutex;
+    mq->not_full.waiting = 0;
+    mq->not_full.signaled = 0;
+
+    mq->name = (attr == NULL) ? NULL : attr->name;
     mq->capacity = msg_count;
     mq->msg_size = msg_size;
     mq->memory = (uint8_t *)malloc(msg_size * msg_count);
     assert(mq->memory != NULL);
+    mq->prio = (uint8_t *)malloc(msg_count);
+    assert(mq->prio != NULL);
 
     mq->head = 0;
-    mq->tail = 0;
-    mq->empty = true;
-    mq->full = false;
+    mq->count = 0;
 
     return (osMessageQueueId_t)mq;
 }
 
+const char *osMessageQueueGetName(osMessageQueueId_t mq_id)
+{
+    os_mq_t *mq = (os_mq_t *)mq_id;
+
+    return mq->name;
+}
+
 osStatus_t osMessageQueueDelete(osMessageQueueId_t mq_id)
 {
     os_mq_t *mq = (os_mq_t *)mq_id;
 
-    osMutexDelete(mq->mutex);
+    sem_destroy(&mq->not_empty.sem);
+    sem_destroy(&mq->not_full.sem);
+    pthread_mutex_destroy(&mq->mutex);
+    free(mq->prio);
     free(mq->memory);
     free(mq);
 
@@ -330,52 +392,61 @@ osStatus_t osMessageQueueReset(osMessageQueueId_t mq_id)
 {
     os_mq_t *mq = (os_mq_t *)mq_id;
 
-    osMutexAcquire(mq->mutex, osWaitForever);
+    pthread_mutex_lock(&mq->mutex);
 
     mq->head = 0;
-    mq->tail = 0;
-    mq->empty = true;
-    mq->full = false;
+    mq->count = 0;
+    _mq_wake(&mq->not_full, _mq_wake_count(&mq->not_full, mq->not_full.waiting));
 
-    osMutexRelease(mq->mutex);
+    pthread_mutex_unlock(&mq->mutex);
 
     return osOK;
 }
 
-osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id,
-                             const void *msg_ptr,
-                             uint8_t msg_prio,
-                             uint32_t timeout)
+uint32_t osMessageQueueGetCapacity(osMessageQueueId_t mq_id)
+{
+    os_mq_t *mq = (os_mq_t *)mq_id;
+
+    return mq->capacity;
+}
+
+uint32_t osMessageQueueGetMsgSize(osMessageQueueId_t mq_id)
 {
-    (void)msg_prio;
+    os_mq_t *mq = (os_mq_t *)mq_id;
 
-    osStatus_t ret_os = osOK;
+    return mq->msg_size;
+}
 
-    if (timeout != osWaitForever)
-    {
-        assert(timeout < (1000 * 60 * 60 * 24));
-    }
+uint32_t osMessageQueueGetCount(osMessageQueueId_t mq_id)
+{
+    os_mq_t *mq = (os_mq_t *)mq_id;
 
+    pthread_mutex_lock(&mq->mutex);
+    uint32_t count = mq->count;
+    pthread_mutex_unlock(&mq->mutex);
+
+    return count;
+}
+
+uint32_t osMessageQueueGetSpace(osMessageQueueId_t mq_id)
+{
     os_mq_t *mq = (os_mq_t *)mq_id;
-    ret_os = osSemaphoreAcquire(mq->sem_full, timeout);
-    assert(ret_os == osOK);
 
-    ret_os = osMutexAcquire(mq->mutex, osWaitForever);
-    assert(ret_os == osOK);
-    assert(mq->full == false || mq->empty == false);
-    memcpy(&mq->memory[mq->head * mq->msg_size], msg_ptr, mq->msg_size);
-    mq->head = (mq->head + 1) % mq->capacity;
-    mq->empty = false;
-    if (mq->head == mq->tail)
-    {
-        mq->full = true;
-    }
-    ret_os = osMutexRelease(mq->mutex);
-    assert(ret_os == osOK);
-    ret_os = osSemaphoreRelease(mq->sem_empty);
-    assert(ret_os == osOK);
+    pthread_mutex_lock(&mq->mutex);
+    uint32_t space = mq->capacity - mq->count;
+    pthread_mutex_unlock(&mq->mutex);
 
-    return osOK;
+    return space;
+}
+
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id,
+                             const void *msg_ptr,
+                             uint8_t msg_prio,
+                             uint32_t timeout)
+{
+    int32_t ret = osMessageQueuePutN(mq_id, msg_ptr, 1, msg_prio, timeout);
+
+    return (ret == 1) ? osOK : (osStatus_t)ret;
 }
 
 osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id,
@@ -383,64 +454,179 @@ osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id,
                              uint8_t *msg_prio,
                              uint32_t timeout)
 {
-    (void)msg_prio;
+    int32_t ret = osMessageQueueGetN(mq_id, msg_ptr, 1, msg_prio, timeout);
 
-    osStatus_t ret_os = osOK;
+    return (ret == 1) ? osOK : (osStatus_t)ret;
+}
+
+int32_t osMessageQueuePutN(osMessageQueueId_t mq_id,
+                            const void *msg_ptr,
+                            uint32_t msg_count,
+                            uint8_t msg_prio,
+                            uint32_t timeout)
+{
+    assert(mq_id != NULL);
+    assert(msg_ptr != NULL);
+
+    os_mq_t *mq = (os_mq_t *)mq_id;
+    const uint8_t *msg = (const uint8_t *)msg_ptr;
+    struct timespec ts;
+    uint32_t count = 0;
+    uint32_t count_put = 0;
+    uint32_t count_wake = 0;
+    int ret = 0;
+
+    if (timeout != 0 && timeout != osWaitForever)
+    {
+        _time_after_ms(CLOCK_REALTIME, &ts, timeout);
+    }
+
+    pthread_mutex_lock(&mq->mutex);
+    while (count < msg_count)
+    {
+        if (mq->count == mq->capacity)
+        {
+            if (timeout == 0 || ret == ETIMEDOUT)
+            {
+                break;
+            }
+            _mq_wake(&mq->not_empty, _mq_wake_count(&mq->not_empty, count_wake));
+            count_wake = 0;
+            ret = _mq_wait(&mq->not_full, (timeout == osWaitForever) ? NULL : &ts);
+            continue;
+        }
 
-    if (timeout != osWaitForever)
+        /* Put as many messages as the space allows, and wake up the readers
+           once for them before waiting or after unlocking. */
+        count_put = mq->capacity - mq->count;
+        if (count_put > (msg_count - count))
+        {
+            count_put = msg_count - count;
+        }
+        _mq_write(mq, &msg[count * mq->msg_size], count_put, msg_prio);
+        count += count_put;
+        count_wake += count_put;
+    }
+    count_wake = _mq_wake_count(&mq->not_empty, count_wake);
+    pthread_mutex_unlock(&mq->mutex);
+    _mq_wake(&mq->not_empty, count_wake);
+
+    if (count == 0 && msg_count != 0)
     {
-        assert(timeout < (1000 * 60 * 60 * 24));
+        return (timeout == 0) ? osErrorResource : osErrorTimeout;
     }
 
+    return (int32_t)count;
+}
+
+int32_t osMessageQueueGetN(osMessageQueueId_t mq_id,
+                            void *msg_ptr,
+                            uint32_t msg_count,
+                            uint8_t *msg_prio,
+                            uint32_t timeout)
+{
+    assert(mq_id != NULL);
+    assert(msg_ptr != NULL);
+    assert(msg_count != 0);
+
     os_mq_t *mq = (os_mq_t *)mq_id;
-    osStatus_t ret = osSemaphoreAcquire(mq->sem_empty, timeout);
-    if (ret == osErrorTimeout)
+    struct timespec ts;
+    uint32_t count = 0;
+    int ret = 0;
+
+    if (timeout != 0 && timeout != osWaitForever)
     {
-        return osErrorTimeout;
+        _time_after_ms(CLOCK_REALTIME, &ts, timeout);
     }
 
-    ret_os = osMutexAcquire(mq->mutex, osWaitForever);
-    assert(ret_os == osOK);
-    assert(mq->full == false || mq->empty == false);
-    memcpy(msg_ptr, &mq->memory[mq->tail * mq->msg_size], mq->msg_size);
-    mq->tail = (mq->tail + 1) % mq->capacity;
-    mq->full = false;
-    if (mq->head == mq->tail)
+    pthread_mutex_lock(&mq->mutex);
+    while (mq->count == 0)
     {
-        mq->empty = true;
+        if (timeout == 0 || ret == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&mq->mutex);
+            return (timeout == 0) ? osErrorResource : osErrorTimeout;
+        }
+        ret = _mq_wait(&mq->not_empty, (timeout == osWaitForever) ? NULL : &ts);
     }
-    ret_os = osMutexRelease(mq->mutex);
-    assert(ret_os == osOK);
-    ret_os = osSemaphoreRelease(mq->sem_full);
-    assert(ret_os == osOK);
 
-    return osOK;
+    /* Get all the queued messages up to the given count at one wake-up. */
+    count = (mq->count < msg_count) ? mq->count : msg_count;
+    _mq_read(mq, (uint8_t *)msg_ptr, count, msg_prio);
+    uint32_t count_wake = _mq_wake_count(&mq->not_full, count);
+    pthread_mutex_unlock(&mq->mutex);
+    _mq_wake(&mq->not_full, count_wake);
+
+    return (int32_t)count;
 }
 
 /* -----------------------------------------------------------------------------
 Mutex
 ----------------------------------------------------------------------------- */
+/**
+ * The mutex attributes are mapped to the pthread ones, osMutexRecursive to the
+ * recursive type, osMutexPrioInherit to the priority inheritance protocol and
+ * osMutexRobust to the robust mutex. The non-recursive mutex is error-checking,
+ * so locking it again in the owner thread returns an error, not a deadlock.
+ *
+ * On multi-core hosts, the contended mutex is spun on for a while before
+ * blocking, and the spinning count adapts to the average one getting the lock.
+ */
 typedef struct os_mutex_data
 {
     osMutexAttr_t attr;
     pthread_mutex_t mutex;
+    int32_t spins;
 } os_mutex_data_t;
 
+static int32_t mutex_spin_max = 0;
+static pthread_once_t mutex_spin_once = PTHREAD_ONCE_INIT;
+
 osMutexId_t osMutexNew(const osMutexAttr_t *attr)
 {
-    (void)attr;
+    pthread_mutexattr_t mutex_attr;
+    int ret = 0;
+
+    pthread_once(&mutex_spin_once, _mutex_spin_init);
 
     os_mutex_data_t *data = malloc(sizeof(os_mutex_data_t));
     assert(data != NULL);
+    memset(data, 0, sizeof(os_mutex_data_t));
+    if (attr != NULL)
+    {
+        memcpy(&data->attr, attr, sizeof(osMutexAttr_t));
+    }
 
-    int ret = pthread_mutex_init(&data->mutex, NULL);
+    pthread_mutexattr_init(&mutex_attr);
+    ret = pthread_mutexattr_settype(&mutex_attr,
+                                    (data->attr.attr_bits & osMutexRecursive) ?
+                                        PTHREAD_MUTEX_RECURSIVE :
+                                        PTHREAD_MUTEX_ERRORCHECK);
     assert(ret == 0);
-
-    memcpy(&data->attr, attr, sizeof(osMutexAttr_t));
+    if (data->attr.attr_bits & osMutexPrioInherit)
+    {
+        ret = pthread_mutexattr_setprotocol(&mutex_attr, PTHREAD_PRIO_INHERIT);
+        assert(ret == 0);
+    }
+    if (data->attr.attr_bits & osMutexRobust)
+    {
+        ret = pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+        assert(ret == 0);
+    }
+    ret = pthread_mutex_init(&data->mutex, &mutex_attr);
+    assert(ret == 0);
+    pthread_mutexattr_destroy(&mutex_attr);
 
     return (osMutexId_t)data;
 }
 
+const char *osMutexGetName(osMutexId_t mutex_id)
+{
+    os_mutex_data_t *data = (os_mutex_data_t *)mutex_id;
+
+    return data->attr.name;
+}
+
 osStatus_t osMutexDelete(osMutexId_t mutex_id)
 {
     os_mutex_data_t *data = (os_mutex_data_t *)mutex_id;
@@ -458,17 +644,63 @@ osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
     assert(mutex_id != NULL);
 
     os_mutex_data_t *data = (os_mutex_data_t *)mutex_id;
-    assert(timeout == osWaitForever);
+    struct timespec ts;
 
-    int ret = pthread_mutex_lock(&data->mutex);
-    if (ret != 0)
+    int ret = pthread_mutex_trylock(&data->mutex);
+    if (ret == EBUSY && timeout != 0)
     {
-        return osError;
+        /* Spin for a while, in case the owner releases it soon. */
+        int32_t spin_max = data->spins * 2 + 10;
+        spin_max = (spin_max > mutex_spin_max) ? mutex_spin_max : spin_max;
+        int32_t count = 0;
+        while (count < spin_max && ret == EBUSY)
+        {
+            RTOS_CPU_RELAX();
+            ret = pthread_mutex_trylock(&data->mutex);
+            count ++;
+        }
+        if (spin_max != 0)
+        {
+            data->spins += (count - data->spins) / 8;
+        }
     }
-    else
+    if (ret == EBUSY && timeout != 0)
+    {
+        if (timeout == osWaitForever)
+        {
+            ret = pthread_mutex_lock(&data->mutex);
+        }
+        else
+        {
+            /* The timed locking of pthread mutexes is in the realtime clock. */
+            _time_after_ms(CLOCK_REALTIME, &ts, timeout);
+            ret = pthread_mutex_timedlock(&data->mutex, &ts);
+        }
+    }
+
+    if (ret == EOWNERDEAD)
+    {
+        /* The owner thread died with the robust mutex locked. */
+        pthread_mutex_consistent(&data->mutex);
+        ret = 0;
+    }
+
+    if (ret == 0)
     {
         return osOK;
     }
+    else if (ret == ETIMEDOUT)
+    {
+        return osErrorTimeout;
+    }
+    else if (ret == EBUSY || ret == EDEADLK || ret == EAGAIN)
+    {
+        return osErrorResource;
+    }
+    else
+    {
+        return osError;
+    }
 }
 
 osStatus_t osMutexRelease(osMutexId_t mutex_id)
@@ -476,7 +708,12 @@ osStatus_t osMutexRelease(osMutexId_t mutex_id)
     os_mutex_data_t *data = (os_mutex_data_t *)mutex_id;
 
     int ret = pthread_mutex_unlock(&data->mutex);
-    if (ret != 0)
+    if (ret == EPERM)
+    {
+        /* Not the owner thread. */
+        return osErrorResource;
+    }
+    else if (ret != 0)
     {
         return osError;
     }
@@ -581,71 +818,45 @@ osTimerId_t osTimerNew(osTimerFunc_t func,
 {
     assert(func != NULL);
     assert(type == osTimerOnce || type == osTimerPeriodic);
-    assert(attr != NULL);
 
-    osStatus_t ret_os = osOK;
+    pthread_once(&timer_wheel_once, _timer_wheel_init);
 
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
+    os_timer_data_t *timer = malloc(sizeof(os_timer_data_t));
+    assert(timer != NULL);
+    memset(timer, 0, sizeof(os_timer_data_t));
 
-    uint32_t i = 0;
-    for (i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
+    timer->func = func;
+    timer->type = type;
+    timer->argument = argument;
+    timer->state = (uint8_t)TIMER_STATE_IDLE;
+    if (attr != NULL)
     {
-        if (timer[i].state == (uint8_t)TIMER_STATE_UNUSED)
-        {
-            break;
-        }
+        memcpy(&timer->attr, attr, sizeof(osTimerAttr_t));
     }
-    timer[i].func = func;
-    timer[i].type = type;
-    timer[i].argument = argument;
-    timer[i].state = (uint8_t)TIMER_STATE_IDLE;
-    memcpy(&timer[i].attr, attr, sizeof(osTimerAttr_t));
 
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
-
-    return (osTimerId_t)&timer[i];
+    return (osTimerId_t)timer;
 }
 
 const char *osTimerGetName (osTimerId_t timer_id)
 {
     assert(timer_id != NULL);
-    
-    osStatus_t ret_os = osOK;
-    os_timer_data_t *timer = (os_timer_data_t *)timer_id;
-    const char *name;
-
-    /* Lock the mutex. */
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
 
-    name = timer->attr.name;
-
-    /* Unlock the mutex. */
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
+    os_timer_data_t *timer = (os_timer_data_t *)timer_id;
 
-    return name;
+    /* The name is never changed after creating. */
+    return timer->attr.name;
 }
 
 uint32_t osTimerIsRunning(osTimerId_t timer_id)
 {
     assert(timer_id != NULL);
     
-    osStatus_t ret_os = osOK;
     os_timer_data_t *timer = (os_timer_data_t *)timer_id;
     uint32_t ret = 0;
 
-    /* Lock the mutex. */
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
-
+    pthread_mutex_lock(&timer_wheel.mutex);
     ret = timer->state == TIMER_STATE_RUN ? 1 : 0;
-
-    /* Unlock the mutex. */
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
+    pthread_mutex_unlock(&timer_wheel.mutex);
 
     return ret;
 }
@@ -655,22 +866,28 @@ osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
     assert(timer_id != NULL);
     assert(ticks >= RTOS_TIMER_VALUE_MIN);
 
-    osStatus_t ret_os = osOK;
     os_timer_data_t *timer = (os_timer_data_t *)timer_id;
 
-    /* Lock the mutex. */
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
+    pthread_mutex_lock(&timer_wheel.mutex);
+    assert(timer->state != TIMER_STATE_UNUSED);
 
-    /* Start the timer. */
+    /* Restart the timer if it's running. */
+    if (timer->state == TIMER_STATE_RUN)
+    {
+        _timer_unlink(timer);
+    }
     timer->timeout = ticks + osKernelGetTickCount();
     timer->ticks = ticks;
     timer->state = TIMER_STATE_RUN;
-    timeout_min = timeout_min > timer->timeout ? timer->timeout : timeout_min;
+    _timer_link(timer);
 
-    /* Unlock the mutex. */
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
+    /* Wake up the timer thread only if the timer expires before its deadline. */
+    if ((int32_t)(timer->timeout - timer_wheel.deadline) < 0)
+    {
+        timer_wheel.deadline = timer->timeout;
+        pthread_cond_signal(&timer_wheel.cond);
+    }
+    pthread_mutex_unlock(&timer_wheel.mutex);
 
     return osOK;
 }
@@ -679,31 +896,15 @@ osStatus_t osTimerStop(osTimerId_t timer_id)
 {
     assert(timer_id != NULL);
 
-    osStatus_t ret_os = osOK;
     os_timer_data_t *timer = (os_timer_data_t *)timer_id;
 
-    /* Lock the mutex. */
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
-
-    timer->state = TIMER_STATE_IDLE;
-    if (timeout_min <= timer->timeout &&
-        timer->state == (uint8_t)TIMER_STATE_RUN)
+    pthread_mutex_lock(&timer_wheel.mutex);
+    if (timer->state == TIMER_STATE_RUN)
     {
-        timeout_min = UINT32_MAX;
-        for (uint32_t i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
-        {
-            if (timer[i].state == (uint8_t)TIMER_STATE_RUN &&
-                timeout_min > timer[i].timeout)
-            {
-                timeout_min = timer[i].timeout;
-            }
-        }
+        _timer_unlink(timer);
+        timer->state = TIMER_STATE_IDLE;
     }
-
-    /* Unlock the mutex. */
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
+    pthread_mutex_unlock(&timer_wheel.mutex);
 
     return osOK;
 }
@@ -712,31 +913,25 @@ osStatus_t osTimerDelete(osTimerId_t timer_id)
 {
     assert(timer_id != NULL);
 
-    osStatus_t ret_os = osOK;
     os_timer_data_t *timer = (os_timer_data_t *)timer_id;
 
-    /* Lock the mutex. */
-    ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-    assert(ret_os == osOK);
-
-    timer->state = TIMER_STATE_UNUSED;
-    if (timeout_min <= timer->timeout &&
-        timer->state == (uint8_t)TIMER_STATE_RUN)
+    pthread_mutex_lock(&timer_wheel.mutex);
+    if (timer->state == TIMER_STATE_RUN)
     {
-        timeout_min = UINT32_MAX;
-        for (uint32_t i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
-        {
-            if (timer[i].state == (uint8_t)TIMER_STATE_RUN &&
-                timeout_min > timer[i].timeout)
-            {
-                timeout_min = timer[i].timeout;
-            }
-        }
+        _timer_unlink(timer);
     }
+    timer->state = TIMER_STATE_UNUSED;
 
-    /* Unlock the mutex. */
-    ret_os = osMutexRelease(mutex_timer);
-    assert(ret_os == osOK);
+    /* The timer in callback is freed by the timer thread after the callback. */
+    if (timer_wheel.current == timer)
+    {
+        timer->deleted = true;
+    }
+    else
+    {
+        free(timer);
+    }
+    pthread_mutex_unlock(&timer_wheel.mutex);
 
     return osOK;
 }
@@ -905,53 +1100,354 @@ static int get_pthread_priority(osPriority_t prio)
 
 static void _thread_entry_timer(void *para)
 {
-    osStatus_t ret_os = osOK;
+    (void)para;
+
+    os_timer_data_t *timer = NULL;
+    uint32_t time_current = 0;
+    uint32_t index = 0;
+    uint32_t delta = 0;
+    struct timespec ts;
+
+    pthread_mutex_lock(&timer_wheel.mutex);
 
     while (1)
     {
-        ret_os = osMutexAcquire(mutex_timer, osWaitForever);
-        assert(ret_os == osOK);
-
-        if (timeout_min <= osKernelGetTickCount())
+        time_current = osKernelGetTickCount();
+        while ((int32_t)(time_current - timer_wheel.time) >= 0)
         {
-            for (uint32_t i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
+            /* Cascade the higher levels when the lower level wraps around. */
+            index = timer_wheel.time & RTOS_TIMER_WHEEL_MASK;
+            for (uint32_t level = 1; index == 0 && level < RTOS_TIMER_WHEEL_LEVEL;
+                    level ++)
+            {
+                index = (timer_wheel.time >> (RTOS_TIMER_WHEEL_BITS * level)) &
+                            RTOS_TIMER_WHEEL_MASK;
+                _timer_cascade(level, index);
+            }
+
+            /* Run the expired timers, and the callbacks are invoked out of the
+               lock, so the timers can be started, stopped or deleted in them. */
+            index = timer_wheel.time & RTOS_TIMER_WHEEL_MASK;
+            while ((timer = timer_wheel.slot[0][index]) != NULL)
             {
-                if (timer[i].state != TIMER_STATE_RUN)
+                _timer_unlink(timer);
+                if (timer->type == osTimerPeriodic)
                 {
-                    continue;
+                    timer->timeout += timer->ticks;
+                    _timer_link(timer);
+                }
+                else
+                {
+                    timer->state = TIMER_STATE_IDLE;
                 }
 
-                if (osKernelGetTickCount() >= timer[i].timeout)
+                timer_wheel.current = timer;
+                pthread_mutex_unlock(&timer_wheel.mutex);
+                timer->func(timer->argument);
+                pthread_mutex_lock(&timer_wheel.mutex);
+                timer_wheel.current = NULL;
+                if (timer->deleted)
                 {
-                    timer[i].func(timer[i].argument);
-                    if (timer[i].type == osTimerPeriodic)
-                    {
-                        timer[i].timeout += timer[i].ticks;
-                    }
-                    else
-                    {
-                        timer[i].state = TIMER_STATE_IDLE;
-                    }
+                    free(timer);
                 }
             }
 
-            /* Update the timeout_min. */
-            timeout_min = UINT32_MAX;
-            for (uint32_t i = 0; i < RTOS_TIMER_NUM_MAX; i ++)
+            timer_wheel.time ++;
+        }
+
+        /* Sleep until the next deadline, or any earlier timer is started. */
+        delta = _timer_next_delta();
+        if (delta == UINT32_MAX)
+        {
+            timer_wheel.deadline = timer_wheel.time + (UINT32_MAX >> 1);
+            pthread_cond_wait(&timer_wheel.cond, &timer_wheel.mutex);
+        }
+        else
+        {
+            timer_wheel.deadline = timer_wheel.time + delta;
+            delta = timer_wheel.deadline - osKernelGetTickCount();
+            if ((int32_t)delta <= 0)
             {
-                if (timeout_min > timer[i].timeout &&
-                    timer[i].state == TIMER_STATE_RUN)
-                {
-                    timeout_min = timer[i].timeout;
-                }
+                continue;
             }
+            _time_after_ms(CLOCK_MONOTONIC, &ts, delta);
+            pthread_cond_timedwait(&timer_wheel.cond, &timer_wheel.mutex, &ts);
         }
-        
-        ret_os = osMutexRelease(mutex_timer);
-        assert(ret_os == osOK);
+    }
+}
 
-        osDelay(RTOS_TIMER_VALUE_MIN);
+static void _timer_wheel_init(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_wheel.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    timer_wheel.time = osKernelGetTickCount();
+    timer_wheel.deadline = timer_wheel.time + (UINT32_MAX >> 1);
+
+    /* Create one thread for timer function. */
+    osThreadId_t thread = osThreadNew(_thread_entry_timer, NULL, NULL);
+    assert(thread != NULL);
+}
+
+/* Add the timer into the wheel slot of its timeout, in the wheel locking. */
+static void _timer_link(os_timer_data_t *timer)
+{
+    int32_t delta = (int32_t)(timer->timeout - timer_wheel.time);
+    uint32_t time = timer->timeout;
+    uint32_t level = 0;
+
+    if (delta < 0)
+    {
+        /* Expired already, in the current slot. */
+        time = timer_wheel.time;
+    }
+    else if (delta >= RTOS_TIMER_WHEEL_RANGE)
+    {
+        /* Out of the wheel range, cascaded again later. */
+        time = timer_wheel.time + RTOS_TIMER_WHEEL_RANGE - 1;
+        delta = RTOS_TIMER_WHEEL_RANGE - 1;
+    }
+    while (level < (RTOS_TIMER_WHEEL_LEVEL - 1) &&
+            delta >= (1 << (RTOS_TIMER_WHEEL_BITS * (level + 1))))
+    {
+        level ++;
     }
+
+    uint32_t index = (time >> (RTOS_TIMER_WHEEL_BITS * level)) &
+                        RTOS_TIMER_WHEEL_MASK;
+    timer->level = level;
+    timer->index = index;
+    timer->prev = NULL;
+    timer->next = timer_wheel.slot[level][index];
+    if (timer->next != NULL)
+    {
+        timer->next->prev = timer;
+    }
+    timer_wheel.slot[level][index] = timer;
+    timer_wheel.bitmap[level] |= ((uint64_t)1 << index);
+}
+
+/* Remove the timer from its wheel slot, in the wheel locking. */
+static void _timer_unlink(os_timer_data_t *timer)
+{
+    if (timer->prev != NULL)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        timer_wheel.slot[timer->level][timer->index] = timer->next;
+    }
+    if (timer->next != NULL)
+    {
+        timer->next->prev = timer->prev;
+    }
+    if (timer_wheel.slot[timer->level][timer->index] == NULL)
+    {
+        timer_wheel.bitmap[timer->level] &= ~((uint64_t)1 << timer->index);
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+/* Move all the timers in the given slot to the lower levels. */
+static void _timer_cascade(uint32_t level, uint32_t index)
+{
+    os_timer_data_t *timer = timer_wheel.slot[level][index];
+    os_timer_data_t *next = NULL;
+
+    timer_wheel.slot[level][index] = NULL;
+    timer_wheel.bitmap[level] &= ~((uint64_t)1 << index);
+    while (timer != NULL)
+    {
+        next = timer->next;
+        _timer_link(timer);
+        timer = next;
+    }
+}
+
+/* Get the ticks from the wheel time to the next expiring or cascading. */
+static uint32_t _timer_next_delta(void)
+{
+    uint32_t delta = UINT32_MAX;
+    uint32_t index = timer_wheel.time & RTOS_TIMER_WHEEL_MASK;
+    uint64_t bitmap = timer_wheel.bitmap[0];
+
+    /* The nearest non-empty slot of level 0, from the current one. */
+    if (bitmap != 0)
+    {
+        bitmap = (index == 0) ? bitmap :
+                    ((bitmap >> index) | (bitmap << (RTOS_TIMER_WHEEL_SIZE - index)));
+        delta = __builtin_ctzll(bitmap);
+    }
+
+    /* The higher levels are checked at the next level 0 wrapping around. */
+    for (uint32_t level = 1; level < RTOS_TIMER_WHEEL_LEVEL; level ++)
+    {
+        if (timer_wheel.bitmap[level] != 0)
+        {
+            if (delta > (RTOS_TIMER_WHEEL_SIZE - index))
+            {
+                delta = RTOS_TIMER_WHEEL_SIZE - index;
+            }
+            break;
+        }
+    }
+
+    return delta;
+}
+
+/* Get the time of the given clock after the given mili-seconds from now. */
+static void _time_after_ms(clockid_t clock, struct timespec *ts, uint32_t ms)
+{
+    clock_gettime(clock, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec ++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/* Spinning is only useful when the mutex owner runs on another core. */
+static void _mutex_spin_init(void)
+{
+    mutex_spin_max = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? RTOS_MUTEX_SPIN_MAX : 0;
+}
+
+/* Wait for the condition of the message queue, in the queue locking. The mutex
+   is released in waiting, and the waiting count is restored if the thread is
+   cancelled in waiting. */
+static int _mq_wait(os_mq_cond_t *cond, const struct timespec *ts)
+{
+    int ret = 0;
+
+    cond->waiting ++;
+    pthread_mutex_unlock(cond->mutex);
+    pthread_cleanup_push(_mq_wait_cleanup, cond);
+    do
+    {
+        ret = (ts == NULL) ? sem_wait(&cond->sem) : sem_timedwait(&cond->sem, ts);
+    } while (ret != 0 && errno == EINTR);
+    ret = (ret == 0) ? 0 : errno;
+    pthread_cleanup_pop(0);
+    pthread_mutex_lock(cond->mutex);
+    cond->waiting --;
+    cond->signaled -= (cond->signaled > 0) ? 1 : 0;
+
+    return ret;
+}
+
+static void _mq_wait_cleanup(void *para)
+{
+    os_mq_cond_t *cond = (os_mq_cond_t *)para;
+
+    pthread_mutex_lock(cond->mutex);
+    cond->waiting --;
+    cond->signaled -= (cond->signaled > 0) ? 1 : 0;
+    pthread_mutex_unlock(cond->mutex);
+}
+
+/* Get the count of the threads to wake up for the given number of messages or
+   slots, in the queue locking. Only the waiting threads not woken up yet are
+   counted. Any thread leaving the waiting takes one wake-up off, whether it is
+   woken up by the semaphore or by the timeout. The post left by a timed out
+   thread only wakes up another one to check the queue again. */
+static uint32_t _mq_wake_count(os_mq_cond_t *cond, uint32_t count)
+{
+    uint32_t count_idle = cond->waiting - cond->signaled;
+    count = (count > count_idle) ? count_idle : count;
+    cond->signaled += count;
+
+    return count;
+}
+
+/* Wake up the waiting threads for the given number of messages or slots. It
+   is called out of the queue locking to avoid the woken thread blocking on the
+   mutex. */
+static void _mq_wake(os_mq_cond_t *cond, uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        sem_post(&cond->sem);
+    }
+}
+
+/* Put the messages in the same priority into the queue, in the queue locking. */
+static void _mq_write(os_mq_t *mq, const uint8_t *msg, uint32_t count,
+                        uint8_t prio)
+{
+    uint32_t tail = mq->head + mq->count;
+    tail = (tail >= mq->capacity) ? (tail - mq->capacity) : tail;
+    uint32_t last = (tail == 0) ? (mq->capacity - 1) : (tail - 1);
+
+    if (mq->count == 0 || prio <= mq->prio[last])
+    {
+        /* Append the messages in at most two blocks. */
+        uint32_t count_block = mq->capacity - tail;
+        count_block = (count_block > count) ? count : count_block;
+        memcpy(&mq->memory[tail * mq->msg_size], msg, count_block * mq->msg_size);
+        memset(&mq->prio[tail], prio, count_block);
+        memcpy(mq->memory, &msg[count_block * mq->msg_size],
+                (count - count_block) * mq->msg_size);
+        memset(mq->prio, prio, count - count_block);
+        mq->count += count;
+        return;
+    }
+
+    /* Insert the messages one by one before the lower priority ones. */
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        uint32_t pos = mq->count;
+        uint32_t index = (mq->head + pos) % mq->capacity;
+        while (pos > 0)
+        {
+            uint32_t index_prev = (index + mq->capacity - 1) % mq->capacity;
+            if (mq->prio[index_prev] >= prio)
+            {
+                break;
+            }
+            memcpy(&mq->memory[index * mq->msg_size],
+                    &mq->memory[index_prev * mq->msg_size], mq->msg_size);
+            mq->prio[index] = mq->prio[index_prev];
+            index = index_prev;
+            pos --;
+        }
+        memcpy(&mq->memory[index * mq->msg_size],
+                &msg[i * mq->msg_size], mq->msg_size);
+        mq->prio[index] = prio;
+        mq->count ++;
+    }
+}
+
+/* Get the messages from the head of the queue, in the queue locking. */
+static void _mq_read(os_mq_t *mq, uint8_t *msg, uint32_t count, uint8_t *prio)
+{
+    uint32_t count_block = mq->capacity - mq->head;
+    count_block = (count_block > count) ? count : count_block;
+
+    memcpy(msg, &mq->memory[mq->head * mq->msg_size], count_block * mq->msg_size);
+    memcpy(&msg[count_block * mq->msg_size], mq->memory,
+            (count - count_block) * mq->msg_size);
+    if (prio != NULL)
+    {
+        memcpy(prio, &mq->prio[mq->head], count_block);
+        memcpy(&prio[count_block], mq->prio, count - count_block);
+    }
+
+    mq->head = (count_block == count) ? (mq->head + count) : (count - count_block);
+    mq->head = (mq->head == mq->capacity) ? 0 : mq->head;
+    mq->count -= count;
 }
 
 #endif
@@ -0,0 +1,190 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../edf/normal/elab_can.h"
+#include "../edf/driver/simulator/simu_can.h"
+
+ELAB_TAG("CanBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_CAN_BUS                       "bench_can_bus"
+#define BENCH_CAN_RECEIVER                  "bench_can_recv"
+#define BENCH_CAN_SENDER_NUM                (4)
+#define BENCH_CAN_TIMES_DEFAULT             (500)
+#define BENCH_CAN_BITRATE_DEFAULT           (500000)
+#define BENCH_CAN_PERIOD_MS                 (2)
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct bench_can_sender
+{
+    const char *name;
+    uint32_t id;
+    uint32_t times;
+    osThreadId_t thread;
+} bench_can_sender_t;
+
+/* private function prototype ----------------------------------------------- */
+static void _entry_sender(void *para);
+
+/* private variables -------------------------------------------------------- */
+static bench_can_sender_t bench_sender[BENCH_CAN_SENDER_NUM] =
+{
+    { .name = "bench_can_0", .id = 0x100, },
+    { .name = "bench_can_1", .id = 0x200, },
+    { .name = "bench_can_2", .id = 0x300, },
+    { .name = "bench_can_3", .id = 0x400, },
+};
+
+static const osThreadAttr_t thread_attr_sender =
+{
+    .name = "ThreadCanBench",
+    .attr_bits = osThreadJoinable,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Benchmark function for the simulated CAN bus. The senders in the
+  *         priority of their IDs send the frames in the same period, and the
+  *         latency of every sender and the bus load are shown.
+  * @retval None
+  */
+static int32_t test_can_bench(int32_t argc, char *argv[])
+{
+    uint32_t times = BENCH_CAN_TIMES_DEFAULT;
+    uint32_t bitrate = BENCH_CAN_BITRATE_DEFAULT;
+    if (argc >= 2)
+    {
+        times = (uint32_t)atoi(argv[1]);
+    }
+    if (argc >= 3)
+    {
+        bitrate = (uint32_t)atoi(argv[2]);
+    }
+    if (times == 0 || bitrate == 0)
+    {
+        elog_error("Invalid times or bitrate.");
+        return -1;
+    }
+
+    simu_can_bus_new(BENCH_CAN_BUS, bitrate);
+    simu_can_new(BENCH_CAN_RECEIVER, BENCH_CAN_BUS);
+    elab_device_t *dev = elab_device_find(BENCH_CAN_RECEIVER);
+    elab_assert(dev != NULL);
+    elab_device_open(dev);
+    for (uint32_t i = 0; i < BENCH_CAN_SENDER_NUM; i ++)
+    {
+        simu_can_new(bench_sender[i].name, BENCH_CAN_BUS);
+        elab_device_open(elab_device_find(bench_sender[i].name));
+    }
+
+    uint32_t time_start = osKernelGetTickCount();
+    for (uint32_t i = 0; i < BENCH_CAN_SENDER_NUM; i ++)
+    {
+        bench_sender[i].times = times;
+        bench_sender[i].thread = osThreadNew(_entry_sender, &bench_sender[i],
+                                                &thread_attr_sender);
+        elab_assert(bench_sender[i].thread != NULL);
+    }
+
+    elab_can_msg_t msg[16];
+    uint32_t count = 0;
+    while (count < times * BENCH_CAN_SENDER_NUM)
+    {
+        int32_t ret = elab_can_recv_n(dev, msg, 16, 1000);
+        if (ret <= 0)
+        {
+            elog_error("CAN bench timeout, %u frames received.", count);
+            break;
+        }
+        count += ret;
+    }
+    uint32_t time = osKernelGetTickCount() - time_start;
+    time = (time == 0) ? 1 : time;
+
+    simu_can_bus_stat_t stat_bus;
+    simu_can_node_stat_t stat_node;
+    simu_can_bus_stat(BENCH_CAN_BUS, &stat_bus);
+    printf("CAN bus %u bit/s, %u senders, %u frames each in %u ms period:\n",
+            bitrate, BENCH_CAN_SENDER_NUM, times, BENCH_CAN_PERIOD_MS);
+    for (uint32_t i = 0; i < BENCH_CAN_SENDER_NUM; i ++)
+    {
+        osThreadJoin(bench_sender[i].thread);
+        simu_can_stat(bench_sender[i].name, &stat_node);
+        uint32_t sent = (stat_node.sent == 0) ? 1 : stat_node.sent;
+        printf("    id 0x%03x: latency avg %6u us, max %6u us, lost %6u.\n",
+                bench_sender[i].id,
+                (uint32_t)(stat_node.latency_total_us / sent),
+                stat_node.latency_max_us, stat_node.arbitration_lost);
+    }
+    printf("    %u frames in %u ms, %u frames/s, bus load %u.%02u%%.\n",
+            count, time, (uint32_t)((uint64_t)count * 1000 / time),
+            stat_bus.load / 100, stat_bus.load % 100);
+
+    for (uint32_t i = 0; i < BENCH_CAN_SENDER_NUM; i ++)
+    {
+        elab_device_close(elab_device_find(bench_sender[i].name));
+        simu_can_destroy(bench_sender[i].name);
+    }
+    elab_device_close(dev);
+    simu_can_destroy(BENCH_CAN_RECEIVER);
+    simu_can_bus_destroy(BENCH_CAN_BUS);
+
+    return 0;
+}
+
+/**
+  * @brief  The sender thread, sending one frame in every period.
+  */
+static void _entry_sender(void *para)
+{
+    bench_can_sender_t *sender = (bench_can_sender_t *)para;
+    elab_device_t *dev = elab_device_find(sender->name);
+    elab_can_msg_t msg;
+
+    memset(&msg, 0, sizeof(elab_can_msg_t));
+    msg.id = sender->id;
+    msg.length = 8;
+    for (uint32_t i = 0; i < sender->times; i ++)
+    {
+        memcpy(msg.data, &i, sizeof(uint32_t));
+        while (elab_can_send(dev, &msg) != ELAB_OK)
+        {
+            osDelay(1);
+        }
+        osDelay(BENCH_CAN_PERIOD_MS);
+    }
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_can_bench,
+                    test_can_bench,
+                    simulated CAN bus latency and load benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,171 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../elib/elib_crc.h"
+
+ELAB_TAG("CrcBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_CRC_BYTES_TOTAL               (8 * 1024 * 1024)
+#define BENCH_CRC_BUFF_SIZE                 (256)
+
+/* private variables -------------------------------------------------------- */
+static const uint32_t bench_crc_size[] = { 8, 64, 256, };
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/**
+  * @brief  The reference CRC16/MODBUS calculated bit by bit, which is the way
+  *         of the former Modbus RTU code.
+  */
+static uint16_t _crc16_modbus_bitwise(const uint8_t *data, uint32_t size)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (size > 0)
+    {
+        size --;
+        crc ^= (uint16_t)*data++;
+        uint8_t shiftctr = 8;
+        do
+        {
+            bool flag = (crc & 0x0001) ? true : false;
+            crc >>= 1;
+            if (flag == true)
+            {
+                crc ^= 0xA001;
+            }
+            shiftctr --;
+        } while (shiftctr > 0);
+    }
+
+    return crc;
+}
+
+/**
+  * @brief  CRC16/MODBUS calculated byte by byte in the table.
+  */
+static uint16_t _crc16_modbus_table(const uint8_t *data, uint32_t size)
+{
+    uint16_t crc = ELIB_CRC16_MODBUS_INIT;
+
+    for (uint32_t i = 0; i < size; i ++)
+    {
+        crc = elib_crc16_modbus_byte(crc, data[i]);
+    }
+
+    return crc;
+}
+
+/**
+  * @brief  Benchmark for the given buffer size, in ns per byte of the bitwise,
+  *         table-driven and the elib_crc16_modbus ones.
+  */
+static void _bench_crc_run(const uint8_t *buff, uint32_t size)
+{
+    uint32_t times = BENCH_CRC_BYTES_TOTAL / size;
+    volatile uint16_t crc_sum = 0;
+    uint16_t crc_ref = _crc16_modbus_bitwise(buff, size);
+
+    uint64_t time_start = _time_ns();
+    for (uint32_t i = 0; i < times; i ++)
+    {
+        crc_sum += _crc16_modbus_bitwise(buff, size);
+    }
+    uint64_t time_bitwise = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < times; i ++)
+    {
+        crc_sum += _crc16_modbus_table(buff, size);
+    }
+    uint64_t time_table = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < times; i ++)
+    {
+        crc_sum += elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, buff, size);
+    }
+    uint64_t time_elib = _time_ns() - time_start;
+
+    elab_assert(crc_ref == _crc16_modbus_table(buff, size));
+    elab_assert(crc_ref == elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, buff, size));
+
+    uint64_t bytes = (uint64_t)times * size;
+    printf("    %3u bytes: bitwise %5.2f, table %5.2f, elib %5.2f ns/byte.\n",
+            size,
+            (double)time_bitwise / bytes,
+            (double)time_table / bytes,
+            (double)time_elib / bytes);
+}
+
+/**
+  * @brief  Benchmark function for the CRC16/MODBUS calculation, the former
+  *         bitwise one against the table-driven and slice-by-8 ones.
+  * @retval None
+  */
+static int32_t test_crc_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    uint8_t *buff = elab_malloc(BENCH_CRC_BUFF_SIZE);
+    elab_assert(buff != NULL);
+    for (uint32_t i = 0; i < BENCH_CRC_BUFF_SIZE; i ++)
+    {
+        buff[i] = (uint8_t)rand();
+    }
+
+    printf("CRC16/MODBUS, %u bytes each:\n", BENCH_CRC_BYTES_TOTAL);
+    for (uint32_t i = 0; i < sizeof(bench_crc_size) / sizeof(uint32_t); i ++)
+    {
+        _bench_crc_run(buff, bench_crc_size[i]);
+    }
+    elab_free(buff);
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_crc_bench,
+                    test_crc_bench,
+                    CRC16 of Modbus benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,235 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../midware/edb/edb.h"
+
+ELAB_TAG("EdbBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_EDB_SECTION_NUM               (100)
+#define BENCH_EDB_KEY_NUM                   (100)       /* In each section */
+#define BENCH_EDB_LINE_SIZE                 (48)
+#define BENCH_EDB_LINEAR_TIMES              (1000)
+#define BENCH_EDB_PATH_INI                  "/tmp/bench_edb.ini"
+#define BENCH_EDB_PATH_SNAPSHOT             "/tmp/bench_edb.bin"
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/**
+  * @brief  The reference lookup, scanning the INI text line by line and
+  *         comparing the names case insensitively, which is the way of the
+  *         former edb.
+  */
+static const char *_get_linear(const char *ini, const char *section,
+                                const char *key)
+{
+    uint32_t len_section = strlen(section);
+    uint32_t len_key = strlen(key);
+    bool in_section = false;
+
+    for (const char *p = ini; *p != 0; p = strchr(p, '\n') + 1)
+    {
+        if (*p == '[')
+        {
+            in_section = (strncasecmp(p + 1, section, len_section) == 0 &&
+                            p[len_section + 1] == ']');
+        }
+        else if (in_section && strncasecmp(p, key, len_key) == 0 &&
+                    p[len_key] == ' ')
+        {
+            return &p[len_key + 3];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Benchmark function for edb, on the INI with 10k keys, loading it or
+  *         its snapshot, and reading the keys by the names and by the handles.
+  * @retval None
+  */
+static int32_t test_edb_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    uint32_t key_num = BENCH_EDB_SECTION_NUM * BENCH_EDB_KEY_NUM;
+    uint32_t size = (BENCH_EDB_SECTION_NUM + key_num) * BENCH_EDB_LINE_SIZE;
+    char *ini = elab_malloc(size);
+    elab_assert(ini != NULL);
+
+    uint32_t len = 0;
+    for (uint32_t s = 0; s < BENCH_EDB_SECTION_NUM; s ++)
+    {
+        len += sprintf(&ini[len], "[device_%u]\n", s);
+        for (uint32_t k = 0; k < BENCH_EDB_KEY_NUM; k ++)
+        {
+            len += sprintf(&ini[len], "param_%u = %u, %u.5\n", k, s * k, k);
+        }
+    }
+    elab_assert(len < size);
+
+    uint64_t time_start = _time_ns();
+    edb_init(EDB_LOAD_MODE_STRING, ini);
+    uint64_t time_load = _time_ns() - time_start;
+
+    char (*section)[16] = elab_malloc(BENCH_EDB_SECTION_NUM * 16);
+    char (*key)[16] = elab_malloc(BENCH_EDB_KEY_NUM * 16);
+    elab_assert(section != NULL && key != NULL);
+    for (uint32_t s = 0; s < BENCH_EDB_SECTION_NUM; s ++)
+    {
+        sprintf(section[s], "device_%u", s);
+    }
+    for (uint32_t k = 0; k < BENCH_EDB_KEY_NUM; k ++)
+    {
+        sprintf(key[k], "param_%u", k);
+    }
+    volatile uint32_t sum = 0;
+
+    /* Reading all the keys by the names, twice to get the converted kept. */
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        for (uint32_t s = 0; s < BENCH_EDB_SECTION_NUM; s ++)
+        {
+            for (uint32_t k = 0; k < BENCH_EDB_KEY_NUM; k ++)
+            {
+                sum += edb_get_u32(section[s], key[k]);
+            }
+        }
+    }
+    uint64_t time_name = _time_ns() - time_start;
+
+    /* The same by the handles resolved once. */
+    edb_key_t **handle = elab_malloc(key_num * sizeof(edb_key_t *));
+    elab_assert(handle != NULL);
+    for (uint32_t s = 0; s < BENCH_EDB_SECTION_NUM; s ++)
+    {
+        for (uint32_t k = 0; k < BENCH_EDB_KEY_NUM; k ++)
+        {
+            handle[s * BENCH_EDB_KEY_NUM + k] = edb_key_find(section[s], key[k]);
+            elab_assert(handle[s * BENCH_EDB_KEY_NUM + k] != NULL);
+        }
+    }
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        for (uint32_t j = 0; j < key_num; j ++)
+        {
+            sum += edb_key_get_u32(handle[j]);
+        }
+    }
+    uint64_t time_handle = _time_ns() - time_start;
+
+    /* The sub strings. */
+    time_start = _time_ns();
+    for (uint32_t j = 0; j < key_num; j ++)
+    {
+        sum += (uint32_t)edb_key_get_sub_float(handle[j], 1);
+    }
+    uint64_t time_sub = _time_ns() - time_start;
+    elab_free(handle);
+
+    /* The linear scan, over the keys spread in the whole file. */
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_EDB_LINEAR_TIMES; i ++)
+    {
+        uint32_t s = (uint32_t)rand() % BENCH_EDB_SECTION_NUM;
+        uint32_t k = (uint32_t)rand() % BENCH_EDB_KEY_NUM;
+        elab_assert(_get_linear(ini, section[s], key[k]) != NULL);
+    }
+    uint64_t time_linear = _time_ns() - time_start;
+
+    edb_deinit();
+
+    /* Loading from the INI file, against mapping the snapshot. */
+    FILE *fp = fopen(BENCH_EDB_PATH_INI, "wb");
+    elab_assert(fp != NULL);
+    elab_assert(fwrite(ini, 1, len, fp) == len);
+    fclose(fp);
+    time_start = _time_ns();
+    edb_init(EDB_LOAD_MODE_FILE, BENCH_EDB_PATH_INI);
+    uint64_t time_load_file = _time_ns() - time_start;
+    edb_deinit();
+
+    elab_assert(edb_compile(BENCH_EDB_PATH_INI, BENCH_EDB_PATH_SNAPSHOT));
+    time_start = _time_ns();
+    elab_assert(edb_init_snapshot(BENCH_EDB_PATH_INI, BENCH_EDB_PATH_SNAPSHOT));
+    uint64_t time_load_snapshot = _time_ns() - time_start;
+    for (uint32_t s = 0; s < BENCH_EDB_SECTION_NUM; s ++)
+    {
+        for (uint32_t k = 0; k < BENCH_EDB_KEY_NUM; k ++)
+        {
+            elab_assert(edb_get_sub_u32(section[s], key[k], 0) == s * k);
+        }
+    }
+    edb_deinit();
+    remove(BENCH_EDB_PATH_INI);
+    remove(BENCH_EDB_PATH_SNAPSHOT);
+
+    elab_free(section);
+    elab_free(key);
+    elab_free(ini);
+
+    printf("edb, %u sections, %u keys:\n", BENCH_EDB_SECTION_NUM, key_num);
+    printf("    load and index: %8.3f ms.\n", (double)time_load / 1000000);
+    printf("    load file:      %8.3f ms.\n", (double)time_load_file / 1000000);
+    printf("    load snapshot:  %8.3f ms.\n",
+            (double)time_load_snapshot / 1000000);
+    printf("    get by name:    %8.1f ns/key.\n",
+            (double)time_name / (key_num * 2));
+    printf("    get by handle:  %8.1f ns/key.\n",
+            (double)time_handle / (key_num * 2));
+    printf("    sub by handle:  %8.1f ns/key.\n", (double)time_sub / key_num);
+    printf("    linear scan:    %8.1f ns/key.\n",
+            (double)time_linear / BENCH_EDB_LINEAR_TIMES);
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_edb_bench,
+                    test_edb_bench,
+                    edb lookup benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,260 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../edf/elab_device.h"
+
+ELAB_TAG("EdfBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_EDF_LOOKUP_TIMES              (100000)
+#define BENCH_EDF_NAME_SIZE                 (24)
+#define BENCH_EDF_STATE_TIMES               (1000000)
+
+/* public function prototypes ----------------------------------------------- */
+void elab_device_unregister(elab_device_t *me);
+
+/* private function prototype ----------------------------------------------- */
+static elab_err_t _enable(elab_device_t *me, bool status);
+static int32_t _read(elab_device_t *me, uint32_t pos, void *buffer, uint32_t size);
+
+/* private variables -------------------------------------------------------- */
+static const uint32_t bench_edf_num[] = { 64, 512, 4096, };
+
+static const elab_dev_ops_t bench_edf_ops =
+{
+    .enable = _enable,
+    .read = _read,
+};
+
+static const osMutexAttr_t bench_edf_mutex_attr =
+{
+    .name = "mutex_edf_bench",
+    .attr_bits = osMutexPrioInherit | osMutexRecursive,
+    .cb_mem = NULL,
+    .cb_size = 0,
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/**
+  * @brief  The reference lookup in linear scanning and mutex locking, which is
+  *         the way of the former device registry.
+  */
+static elab_device_t *_find_linear(elab_device_t **table, uint32_t num,
+                                    osMutexId_t mutex, const char *name)
+{
+    elab_device_t *me = NULL;
+
+    osMutexAcquire(mutex, osWaitForever);
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        if (strcmp(table[i]->attr.name, name) == 0)
+        {
+            me = table[i];
+            break;
+        }
+    }
+    osMutexRelease(mutex);
+
+    return me;
+}
+
+/**
+  * @brief  Benchmark for the device lookup at the given device number.
+  */
+static void _bench_edf_run(uint32_t num)
+{
+    elab_device_t *dev = elab_malloc(sizeof(elab_device_t) * num);
+    elab_assert(dev != NULL);
+    elab_device_t **table = elab_malloc(sizeof(elab_device_t *) * num);
+    elab_assert(table != NULL);
+    char (*name)[BENCH_EDF_NAME_SIZE] = elab_malloc(BENCH_EDF_NAME_SIZE * num);
+    elab_assert(name != NULL);
+    osMutexId_t mutex = osMutexNew(&bench_edf_mutex_attr);
+    elab_assert(mutex != NULL);
+
+    elab_device_attr_t attr =
+    {
+        .sole = true,
+        .type = ELAB_DEVICE_UNKNOWN,
+        .name = NULL,
+    };
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        sprintf(name[i], "bench_edf_dev_%u", i);
+        attr.name = name[i];
+        elab_device_register(&dev[i], &attr);
+        table[i] = &dev[i];
+    }
+
+    uint64_t time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_EDF_LOOKUP_TIMES; i ++)
+    {
+        elab_device_t *me = elab_device_find(name[i % num]);
+        elab_assert(me == &dev[i % num]);
+    }
+    uint64_t time_hash = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_EDF_LOOKUP_TIMES; i ++)
+    {
+        elab_device_t *me = _find_linear(table, num, mutex, name[i % num]);
+        elab_assert(me == &dev[i % num]);
+    }
+    uint64_t time_linear = _time_ns() - time_start;
+
+    printf("    %5u devices: hashed %6u ns/find, linear %8u ns/find.\n", num,
+            (uint32_t)(time_hash / BENCH_EDF_LOOKUP_TIMES),
+            (uint32_t)(time_linear / BENCH_EDF_LOOKUP_TIMES));
+
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        elab_device_unregister(&dev[i]);
+    }
+    osMutexDelete(mutex);
+    elab_free(name);
+    elab_free(table);
+    elab_free(dev);
+}
+
+/**
+  * @brief  Benchmark for the device state querying and reading dispatch.
+  */
+static void _bench_edf_state(void)
+{
+    elab_device_t dev;
+    elab_device_attr_t attr =
+    {
+        .name = "bench_edf_state",
+        .sole = true,
+        .type = ELAB_DEVICE_UNKNOWN,
+    };
+    uint8_t data = 0;
+    uint32_t count = 0;
+
+    memset(&dev, 0, sizeof(elab_device_t));
+    dev.ops = &bench_edf_ops;
+    elab_device_register(&dev, &attr);
+    elab_device_open(&dev);
+
+    uint64_t time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_EDF_STATE_TIMES; i ++)
+    {
+        if (elab_device_is_enabled(&dev))
+        {
+            count += elab_device_read(&dev, 0, &data, 1);
+        }
+    }
+    uint64_t time_atomic = _time_ns() - time_start;
+
+    /* The reference in the former way, locking the device mutex. */
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_EDF_STATE_TIMES; i ++)
+    {
+        elab_device_lock(&dev);
+        bool enabled = (dev.enable_count > 0) ? true : false;
+        elab_device_unlock(&dev);
+        if (enabled)
+        {
+            count += elab_device_read(&dev, 0, &data, 1);
+        }
+    }
+    uint64_t time_mutex = _time_ns() - time_start;
+    elab_assert(count == (BENCH_EDF_STATE_TIMES * 2));
+
+    printf("Device state query and read, %u times:\n", BENCH_EDF_STATE_TIMES);
+    printf("    atomic %6u ns/call, mutex %6u ns/call.\n",
+            (uint32_t)(time_atomic / BENCH_EDF_STATE_TIMES),
+            (uint32_t)(time_mutex / BENCH_EDF_STATE_TIMES));
+
+    elab_device_close(&dev);
+    elab_device_unregister(&dev);
+}
+
+/**
+  * @brief  Benchmark function for the device lookup by name, and the device
+  *         state querying.
+  * @retval None
+  */
+static int32_t test_edf_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Device lookup, %u times each:\n", BENCH_EDF_LOOKUP_TIMES);
+    for (uint32_t i = 0; i < sizeof(bench_edf_num) / sizeof(uint32_t); i ++)
+    {
+        _bench_edf_run(bench_edf_num[i]);
+    }
+    _bench_edf_state();
+
+    return 0;
+}
+
+/**
+  * @brief  The benchmark device enabling function.
+  */
+static elab_err_t _enable(elab_device_t *me, bool status)
+{
+    (void)me;
+    (void)status;
+
+    return ELAB_OK;
+}
+
+/**
+  * @brief  The benchmark device reading function.
+  */
+static int32_t _read(elab_device_t *me, uint32_t pos, void *buffer, uint32_t size)
+{
+    (void)me;
+    (void)pos;
+
+    memset(buffer, 0, size);
+
+    return size;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_edf_bench,
+                    test_edf_bench,
+                    device registry lookup and state query benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
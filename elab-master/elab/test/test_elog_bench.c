@@ -0,0 +1,189 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../os/cmsis_os.h"
+
+ELAB_TAG("ElogBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (ELOG_ASYNC_ENABLE != 0) && (ELAB_RTOS_CMSIS_OS_EN != 0)
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_ELOG_THREAD_NUM               (8)
+#define BENCH_ELOG_TIMES                    (2000)      /* In each thread */
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct bench_elog_result
+{
+    uint64_t time_total;
+    uint64_t time_max;
+} bench_elog_result_t;
+
+/* private variables -------------------------------------------------------- */
+static bench_elog_result_t bench_result[BENCH_ELOG_THREAD_NUM];
+
+static const osThreadAttr_t thread_attr_elog_bench =
+{
+    .name = "ThreadElogBench",
+    .attr_bits = osThreadJoinable,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/**
+  * @brief  The logging thread, recording the latency of every elog_info.
+  */
+static void _entry_elog_bench(void *para)
+{
+    bench_elog_result_t *result = (bench_elog_result_t *)para;
+    uint32_t id = (uint32_t)(result - bench_result);
+
+    result->time_total = 0;
+    result->time_max = 0;
+    for (uint32_t i = 0; i < BENCH_ELOG_TIMES; i ++)
+    {
+        uint64_t time_start = _time_ns();
+        elog_info("Thread %u, log %u, value %d.", id, i, (int32_t)(i * 7) - 100);
+        uint64_t time = _time_ns() - time_start;
+
+        result->time_total += time;
+        if (time > result->time_max)
+        {
+            result->time_max = time;
+        }
+    }
+}
+
+/**
+  * @brief  Run the logging threads, and print the average and the maximum
+  *         latency of elog_info.
+  */
+static void _bench_elog_run(const char *mode)
+{
+    osThreadId_t thread[BENCH_ELOG_THREAD_NUM];
+
+    uint64_t time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_ELOG_THREAD_NUM; i ++)
+    {
+        thread[i] = osThreadNew(_entry_elog_bench, &bench_result[i],
+                                &thread_attr_elog_bench);
+        elab_assert(thread[i] != NULL);
+    }
+    for (uint32_t i = 0; i < BENCH_ELOG_THREAD_NUM; i ++)
+    {
+        osThreadJoin(thread[i]);
+    }
+    uint64_t time_wall = _time_ns() - time_start;
+
+    uint64_t time_total = 0;
+    uint64_t time_max = 0;
+    for (uint32_t i = 0; i < BENCH_ELOG_THREAD_NUM; i ++)
+    {
+        time_total += bench_result[i].time_total;
+        if (bench_result[i].time_max > time_max)
+        {
+            time_max = bench_result[i].time_max;
+        }
+    }
+
+    fprintf(stderr, "    %-10s avg %8.1f ns, max %9.1f us, wall %8.3f ms.\n",
+            mode,
+            (double)time_total / (BENCH_ELOG_THREAD_NUM * BENCH_ELOG_TIMES),
+            (double)time_max / 1000, (double)time_wall / 1000000);
+}
+
+/**
+  * @brief  Benchmark function for elog, logging from 8 threads in the sync mode
+  *         and in the async modes, with the console redirected to /dev/null.
+  * @retval None
+  */
+static int32_t test_elog_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    elog_async_stat_t stat[2];
+
+    fflush(stdout);
+    int fd_stdout = dup(STDOUT_FILENO);
+    int fd_null = open("/dev/null", O_WRONLY);
+    elab_assert(fd_stdout >= 0 && fd_null >= 0);
+    dup2(fd_null, STDOUT_FILENO);
+    close(fd_null);
+
+    fprintf(stderr, "elog_info from %u threads, %u times each:\n",
+            BENCH_ELOG_THREAD_NUM, BENCH_ELOG_TIMES);
+    _bench_elog_run("sync");
+
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    _bench_elog_run("drop new");
+    elog_async_flush();
+    elog_async_stat(&stat[0]);
+    elog_async_stop();
+
+    elog_async_start(ELOG_ASYNC_OVERWRITE);
+    _bench_elog_run("overwrite");
+    elog_async_flush();
+    elog_async_stat(&stat[1]);
+    elog_async_stop();
+
+    fflush(stdout);
+    dup2(fd_stdout, STDOUT_FILENO);
+    close(fd_stdout);
+
+    printf("    drop new:  written %u, dropped %u.\n",
+            stat[0].written, stat[0].dropped);
+    printf("    overwrite: written %u, overwritten %u.\n",
+            stat[1].written, stat[1].overwritten);
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_elog_bench,
+                    test_elog_bench,
+                    elog latency benchmark);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
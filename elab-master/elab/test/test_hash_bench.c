@@ -0,0 +1,339 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../elib/hash_table.h"
+
+ELAB_TAG("HashBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_HASH_NAME_SIZE                (24)
+#define BENCH_HASH_LOOKUP_TIMES             (200000)
+#define BENCH_HASH_SEEK_TIMES_MAX           (32)
+
+/* private typedef ---------------------------------------------------------- */
+/* The former hash table, identifying the names by three hash values. */
+typedef struct bench_hash_old_data
+{
+    uint32_t hash_time33;
+    uint32_t hash_elf;
+    uint32_t hash_bkdr;
+    void *data;
+} bench_hash_old_data_t;
+
+typedef struct bench_hash_old
+{
+    uint32_t capacity;
+    uint32_t prime_max;
+    bench_hash_old_data_t *table;
+} bench_hash_old_t;
+
+/* private variables -------------------------------------------------------- */
+static const uint32_t bench_hash_capacity[] = { 256, 4096, };
+static const uint32_t bench_hash_load[] = { 50, 75, 90, };      /* In % */
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+static uint32_t _old_hash_time33(const char *str)
+{
+    uint32_t hash = 5381;
+
+    while (*str)
+    {
+        hash = (*str++) + (hash << 5) + hash;
+    }
+
+    return hash;
+}
+
+static uint32_t _old_hash_elf(const char *str)
+{
+    uint32_t hash = 0;
+    uint32_t x = 0;
+
+    while (*str)
+    {
+        hash = (hash << 4) + (*str++);
+        if ((x = hash & 0xF0000000L) != 0)
+        {
+            hash ^= (x >> 24);
+            hash &= ~x;
+        }
+    }
+
+    return (hash & 0x7FFFFFFF);
+}
+
+static uint32_t _old_hash_bkdr(const char *str)
+{
+    uint32_t hash = 0;
+
+    while (*str)
+    {
+        hash = hash * 131 + (*str++);
+    }
+
+    return (hash & 0x7FFFFFFF);
+}
+
+/**
+  * @brief  The former initialization, with the prime got by trial division.
+  */
+static void _old_init(bench_hash_old_t *me, bench_hash_old_data_t *table,
+                        uint32_t capacity)
+{
+    me->table = table;
+    me->capacity = capacity;
+    memset(table, 0, sizeof(bench_hash_old_data_t) * capacity);
+
+    me->prime_max = 0;
+    for (int64_t i = capacity; i > 0; i --)
+    {
+        bool is_prime = true;
+        for (uint32_t j = 2; j < capacity; j++)
+        {
+            if (i <= j)
+            {
+                break;
+            }
+            if ((i % j) == 0)
+            {
+                is_prime = false;
+                break;
+            }
+        }
+        if (is_prime)
+        {
+            me->prime_max = i;
+            break;
+        }
+    }
+}
+
+static elab_err_t _old_add(bench_hash_old_t *me, const char *name, void *data)
+{
+    uint32_t hash_time33 = _old_hash_time33(name);
+    uint32_t hash_elf = _old_hash_elf(name);
+    uint32_t hash_bkdr = _old_hash_bkdr(name);
+    uint32_t index_start = hash_time33 % me->prime_max;
+    uint32_t times_count = 0;
+
+    for (uint32_t i = 0; i < me->capacity; i ++)
+    {
+        uint32_t index = (index_start + i) % me->capacity;
+        if (me->table[index].data == NULL)
+        {
+            me->table[index].data = data;
+            me->table[index].hash_time33 = hash_time33;
+            me->table[index].hash_elf = hash_elf;
+            me->table[index].hash_bkdr = hash_bkdr;
+            return ELAB_OK;
+        }
+        if (++ times_count > BENCH_HASH_SEEK_TIMES_MAX)
+        {
+            break;
+        }
+    }
+
+    return ELAB_ERR_FULL;
+}
+
+static void *_old_get(bench_hash_old_t *me, const char *name)
+{
+    uint32_t hash_time33 = _old_hash_time33(name);
+    uint32_t hash_elf = _old_hash_elf(name);
+    uint32_t hash_bkdr = _old_hash_bkdr(name);
+    uint32_t index_start = hash_time33 % me->prime_max;
+    uint32_t times_count = 0;
+
+    for (uint32_t i = 0; i < me->capacity; i ++)
+    {
+        uint32_t index = (index_start + i) % me->capacity;
+        if (me->table[index].data == NULL)
+        {
+            continue;
+        }
+        if (me->table[index].hash_time33 == hash_time33 &&
+            me->table[index].hash_elf == hash_elf &&
+            me->table[index].hash_bkdr == hash_bkdr)
+        {
+            return me->table[index].data;
+        }
+        if (++ times_count > BENCH_HASH_SEEK_TIMES_MAX)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Benchmark for the given capacity and load, in ns per operation of
+  *         the former table and the current one.
+  */
+static void _bench_hash_run(char (*names)[BENCH_HASH_NAME_SIZE],
+                            uint32_t capacity, uint32_t load)
+{
+    uint32_t num = capacity * load / 100;
+    uint32_t added_old = 0;
+    volatile uint32_t found = 0;
+
+    /* The former one. */
+    bench_hash_old_t old;
+    bench_hash_old_data_t *table_old =
+        elab_malloc(sizeof(bench_hash_old_data_t) * capacity);
+    elab_assert(table_old != NULL);
+
+    uint64_t time_start = _time_ns();
+    _old_init(&old, table_old, capacity);
+    uint64_t time_init_old = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        added_old += (_old_add(&old, names[i], names[i]) == ELAB_OK) ? 1 : 0;
+    }
+    uint64_t time_add_old = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_HASH_LOOKUP_TIMES; i ++)
+    {
+        found += (_old_get(&old, names[i % num]) != NULL) ? 1 : 0;
+    }
+    uint64_t time_hit_old = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_HASH_LOOKUP_TIMES / 10; i ++)
+    {
+        found += (_old_get(&old, names[num + (i % capacity)]) != NULL) ? 1 : 0;
+    }
+    uint64_t time_miss_old = _time_ns() - time_start;
+    elab_free(table_old);
+
+    /* The current one, in the static mode. */
+    hash_table_t ht;
+    hash_table_data_t *table = elab_malloc(sizeof(hash_table_data_t) * capacity);
+    elab_assert(table != NULL);
+
+    time_start = _time_ns();
+    hash_table_init(&ht, table, capacity);
+    uint64_t time_init = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        elab_assert(hash_table_add(&ht, names[i], names[i]) == ELAB_OK);
+    }
+    uint64_t time_add = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_HASH_LOOKUP_TIMES; i ++)
+    {
+        found += (hash_table_get(&ht, names[i % num]) != NULL) ? 1 : 0;
+    }
+    uint64_t time_hit = _time_ns() - time_start;
+
+    time_start = _time_ns();
+    for (uint32_t i = 0; i < BENCH_HASH_LOOKUP_TIMES / 10; i ++)
+    {
+        found += (hash_table_get(&ht, names[num + (i % capacity)]) != NULL) ? 1 : 0;
+    }
+    uint64_t time_miss = _time_ns() - time_start;
+    elab_free(table);
+
+    printf("    %4u slots, %2u%% load: added %u/%u by the former one.\n",
+            capacity, load, added_old, num);
+    printf("        init %9.1f / %6.1f us, add %6.1f / %6.1f ns,\n",
+            (double)time_init_old / 1000, (double)time_init / 1000,
+            (double)time_add_old / num, (double)time_add / num);
+    printf("        hit %6.1f / %6.1f ns, miss %8.1f / %6.1f ns.\n",
+            (double)time_hit_old / BENCH_HASH_LOOKUP_TIMES,
+            (double)time_hit / BENCH_HASH_LOOKUP_TIMES,
+            (double)time_miss_old / (BENCH_HASH_LOOKUP_TIMES / 10),
+            (double)time_miss / (BENCH_HASH_LOOKUP_TIMES / 10));
+}
+
+/**
+  * @brief  Benchmark function for the hash table, the former one against the
+  *         current one, in the static mode.
+  * @retval None
+  */
+static int32_t test_hash_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    uint32_t capacity_max = bench_hash_capacity[0];
+    for (uint32_t i = 0; i < sizeof(bench_hash_capacity) / sizeof(uint32_t); i ++)
+    {
+        if (bench_hash_capacity[i] > capacity_max)
+        {
+            capacity_max = bench_hash_capacity[i];
+        }
+    }
+
+    /* The names after the loaded ones are the missing ones. */
+    char (*names)[BENCH_HASH_NAME_SIZE] =
+        elab_malloc(capacity_max * 2 * BENCH_HASH_NAME_SIZE);
+    elab_assert(names != NULL);
+    for (uint32_t i = 0; i < capacity_max * 2; i ++)
+    {
+        sprintf(names[i], "device_%u_%u", i, (uint32_t)rand() % 1000);
+    }
+
+    printf("Hash table, the former one / the current one:\n");
+    for (uint32_t i = 0; i < sizeof(bench_hash_capacity) / sizeof(uint32_t); i ++)
+    {
+        for (uint32_t j = 0; j < sizeof(bench_hash_load) / sizeof(uint32_t); j ++)
+        {
+            _bench_hash_run(names, bench_hash_capacity[i], bench_hash_load[j]);
+        }
+    }
+    elab_free(names);
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_hash_bench,
+                    test_hash_bench,
+                    Hash table benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
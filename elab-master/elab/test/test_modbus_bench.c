@@ -0,0 +1,206 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../midware/modbus/modbus.h"
+#include "../edf/driver/simulator/simu_serial.h"
+
+ELAB_TAG("ModbusBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (MODBUS_CFG_TCP_EN != 0) && \
+    (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_MB_TIME                       (1000)
+#define BENCH_MB_SLAVE                      (1)
+#define BENCH_MB_REGS                       (10)
+#define BENCH_MB_RX_TIMEOUT                 (200)
+#define BENCH_MB_SERIAL_M                   "bench_mb_m"
+#define BENCH_MB_SERIAL_S                   "bench_mb_s"
+#define BENCH_MB_TCP_HOST                   "127.0.0.1"
+#define BENCH_MB_TCP_PORT                   (15021)
+#define BENCH_MB_CLIENTS_MAX                (4)
+
+/* private function prototype ----------------------------------------------- */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+
+/* private variables -------------------------------------------------------- */
+static mb_channel_cb_t bench_mb_cb =
+{
+    .holding_reg_read = _holding_reg_read,
+};
+
+static osSemaphoreId_t sem_bench_client = NULL;
+static volatile uint32_t bench_mb_count = 0;
+static volatile uint32_t bench_mb_errors = 0;
+
+/* private functions -------------------------------------------------------- */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+
+    return reg;
+}
+
+/**
+  * @brief  Send FC03 requests on the master channel for the benchmark time.
+  */
+static void _bench_mb_requests(mb_channel_t *mbm)
+{
+    uint16_t regs[BENCH_MB_REGS];
+    uint32_t time_start = elab_time_ms();
+
+    while ((elab_time_ms() - time_start) < BENCH_MB_TIME)
+    {
+        uint16_t err = mbm_fc03_holding_reg_read(mbm, BENCH_MB_SLAVE, 0,
+                                                    regs, BENCH_MB_REGS);
+        elab_atomic_add(&bench_mb_count, 1);
+        if (err != MODBUS_ERR_NONE)
+        {
+            elab_atomic_add(&bench_mb_errors, 1);
+        }
+    }
+}
+
+/**
+  * @brief  The client thread, with its own TCP master channel.
+  */
+static void _entry_bench_client(void *para)
+{
+    (void)para;
+
+    mb_channel_t *mbm = mb_channel_create_tcp(BENCH_MB_TCP_HOST,
+                                                BENCH_MB_TCP_PORT, 0,
+                                                MODBUS_MASTER,
+                                                BENCH_MB_RX_TIMEOUT);
+    elab_assert(mbm != NULL);
+    _bench_mb_requests(mbm);
+    mb_channel_destroy(mbm);
+
+    osSemaphoreRelease(sem_bench_client);
+}
+
+/**
+  * @brief  Print the result of one case, in the wall time of all its clients.
+  */
+static void _bench_mb_print(const char *name, uint32_t time_ms)
+{
+    printf("    %-16s %8u req/s, %u errors.\n", name,
+            (uint32_t)((uint64_t)bench_mb_count * 1000 / time_ms),
+            bench_mb_errors);
+    bench_mb_count = 0;
+    bench_mb_errors = 0;
+}
+
+/**
+  * @brief  Benchmark of the RTU on the simulated serial port.
+  */
+static void _bench_mb_rtu(void)
+{
+    simu_serial_new_pair(BENCH_MB_SERIAL_M, BENCH_MB_SERIAL_S, 115200);
+    mb_channel_t *mbm = mb_channel_create(BENCH_MB_SERIAL_M, 0, MODBUS_MASTER,
+                                            BENCH_MB_RX_TIMEOUT, MODBUS_MODE_RTU);
+    mb_channel_t *mbs = mb_channel_create(BENCH_MB_SERIAL_S, BENCH_MB_SLAVE,
+                                            MODBUS_SLAVE, 20, MODBUS_MODE_RTU);
+    mb_slave_set_cb(mbs, &bench_mb_cb);
+
+    uint32_t time_start = elab_time_ms();
+    _bench_mb_requests(mbm);
+    _bench_mb_print("RTU simu_serial", elab_time_ms() - time_start);
+
+    mb_channel_destroy(mbs);
+    mb_channel_destroy(mbm);
+    simu_serial_destroy(BENCH_MB_SERIAL_S);
+    simu_serial_destroy(BENCH_MB_SERIAL_M);
+}
+
+/**
+  * @brief  Benchmark of the TCP on the loopback, with the given clients.
+  */
+static void _bench_mb_tcp(uint32_t clients)
+{
+    char name[32];
+    uint32_t time_start = elab_time_ms();
+
+    for (uint32_t i = 0; i < clients; i ++)
+    {
+        osThreadId_t thread = osThreadNew(_entry_bench_client, NULL, NULL);
+        elab_assert(thread != NULL);
+    }
+    for (uint32_t i = 0; i < clients; i ++)
+    {
+        osStatus_t ret_os = osSemaphoreAcquire(sem_bench_client, osWaitForever);
+        elab_assert(ret_os == osOK);
+    }
+
+    sprintf(name, "TCP %u client%s", clients, clients > 1 ? "s" : "");
+    _bench_mb_print(name, elab_time_ms() - time_start);
+}
+
+/**
+  * @brief  Benchmark function for the Modbus master requests, of the RTU on
+  *         the simulated serial port against the TCP on the loopback.
+  * @retval None
+  */
+static int32_t test_modbus_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Modbus FC03 of %u registers, %u ms each:\n",
+            BENCH_MB_REGS, BENCH_MB_TIME);
+    _bench_mb_rtu();
+
+    mb_channel_t *mbs = mb_channel_create_tcp(BENCH_MB_TCP_HOST,
+                                                BENCH_MB_TCP_PORT,
+                                                BENCH_MB_SLAVE, MODBUS_SLAVE, 0);
+    elab_assert(mbs != NULL);
+    mb_slave_set_cb(mbs, &bench_mb_cb);
+    sem_bench_client = osSemaphoreNew(BENCH_MB_CLIENTS_MAX, 0, NULL);
+    elab_assert(sem_bench_client != NULL);
+
+    for (uint32_t clients = 1; clients <= BENCH_MB_CLIENTS_MAX; clients *= 2)
+    {
+        _bench_mb_tcp(clients);
+    }
+
+    osSemaphoreDelete(sem_bench_client);
+    sem_bench_client = NULL;
+    mb_channel_destroy(mbs);
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_modbus_bench,
+                    test_modbus_bench,
+                    Modbus RTU and TCP benchmark);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,294 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_common.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+
+ELAB_TAG("MqBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_MQ_MSG_TOTAL                  (160000)
+#define BENCH_MQ_CAPACITY                   (256)
+#define BENCH_MQ_BATCH                      (32)
+
+/* private typedef ---------------------------------------------------------- */
+enum bench_mq_mode
+{
+    BENCH_MQ_MODE_REF = 0,                  /* Mutex and two semaphores */
+    BENCH_MQ_MODE_SINGLE,                   /* One message per call */
+    BENCH_MQ_MODE_BATCH,                    /* Batch put and get */
+
+    BENCH_MQ_MODE_MAX,
+};
+
+/* The reference queue in the former way, two semaphores and one mutex. */
+typedef struct bench_ref_mq
+{
+    osMutexId_t mutex;
+    osSemaphoreId_t sem_empty;
+    osSemaphoreId_t sem_full;
+    uint32_t buff[BENCH_MQ_CAPACITY];
+    uint32_t head;
+    uint32_t tail;
+} bench_ref_mq_t;
+
+typedef struct bench_mq
+{
+    uint8_t mode;
+    uint32_t count;
+    osMessageQueueId_t mq;
+    bench_ref_mq_t ref;
+    osSemaphoreId_t sem_done;
+} bench_mq_t;
+
+/* private variables -------------------------------------------------------- */
+static const uint32_t bench_mq_producers[] = { 1, 4, 16, };
+
+static const char *bench_mq_mode_name[BENCH_MQ_MODE_MAX] =
+{
+    "sem + mutex", "mq single", "mq batch",
+};
+
+static const osMutexAttr_t bench_mq_mutex_attr =
+{
+    .name = "mutex_mq_bench",
+    .attr_bits = osMutexPrioInherit | osMutexRecursive,
+    .cb_mem = NULL,
+    .cb_size = 0,
+};
+
+static const osThreadAttr_t bench_mq_thread_attr =
+{
+    .name = "ThreadMqBench",
+    .attr_bits = osThreadDetached,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Get the current time in nanoseconds.
+  */
+static uint64_t _time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+/**
+  * @brief  Put one message into the reference queue.
+  */
+static void _ref_put(bench_ref_mq_t *ref, uint32_t data)
+{
+    osSemaphoreAcquire(ref->sem_full, osWaitForever);
+    osMutexAcquire(ref->mutex, osWaitForever);
+    ref->buff[ref->head] = data;
+    ref->head = (ref->head + 1) % BENCH_MQ_CAPACITY;
+    osMutexRelease(ref->mutex);
+    osSemaphoreRelease(ref->sem_empty);
+}
+
+/**
+  * @brief  Get one message from the reference queue.
+  */
+static uint32_t _ref_get(bench_ref_mq_t *ref)
+{
+    osSemaphoreAcquire(ref->sem_empty, osWaitForever);
+    osMutexAcquire(ref->mutex, osWaitForever);
+    uint32_t data = ref->buff[ref->tail];
+    ref->tail = (ref->tail + 1) % BENCH_MQ_CAPACITY;
+    osMutexRelease(ref->mutex);
+    osSemaphoreRelease(ref->sem_full);
+
+    return data;
+}
+
+/**
+  * @brief  The producer thread, putting the given count of messages.
+  */
+static void _entry_producer(void *para)
+{
+    bench_mq_t *bench = (bench_mq_t *)para;
+    uint32_t data[BENCH_MQ_BATCH];
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < BENCH_MQ_BATCH; i ++)
+    {
+        data[i] = 1;
+    }
+
+    while (count < bench->count)
+    {
+        if (bench->mode == BENCH_MQ_MODE_REF)
+        {
+            _ref_put(&bench->ref, 1);
+            count ++;
+        }
+        else if (bench->mode == BENCH_MQ_MODE_SINGLE)
+        {
+            osStatus_t ret_os = osMessageQueuePut(bench->mq, &data[0], 0,
+                                                    osWaitForever);
+            elab_assert(ret_os == osOK);
+            count ++;
+        }
+        else
+        {
+            uint32_t count_put = bench->count - count;
+            count_put = (count_put > BENCH_MQ_BATCH) ? BENCH_MQ_BATCH : count_put;
+            int32_t ret = osMessageQueuePutN(bench->mq, data, count_put, 0,
+                                                osWaitForever);
+            elab_assert(ret == (int32_t)count_put);
+            count += count_put;
+        }
+    }
+
+    osSemaphoreRelease(bench->sem_done);
+}
+
+/**
+  * @brief  Benchmark for the given producer number and queue mode, and return
+  *         the time in nanoseconds per message.
+  */
+static uint32_t _bench_mq_run(uint8_t mode, uint32_t producers)
+{
+    bench_mq_t *bench = elab_malloc(sizeof(bench_mq_t));
+    elab_assert(bench != NULL);
+    memset(bench, 0, sizeof(bench_mq_t));
+
+    bench->mode = mode;
+    bench->count = BENCH_MQ_MSG_TOTAL / producers;
+    bench->sem_done = osSemaphoreNew(producers, 0, NULL);
+    elab_assert(bench->sem_done != NULL);
+    if (mode == BENCH_MQ_MODE_REF)
+    {
+        bench->ref.mutex = osMutexNew(&bench_mq_mutex_attr);
+        elab_assert(bench->ref.mutex != NULL);
+        bench->ref.sem_full = osSemaphoreNew(BENCH_MQ_CAPACITY,
+                                                BENCH_MQ_CAPACITY, NULL);
+        elab_assert(bench->ref.sem_full != NULL);
+        bench->ref.sem_empty = osSemaphoreNew(BENCH_MQ_CAPACITY, 0, NULL);
+        elab_assert(bench->ref.sem_empty != NULL);
+    }
+    else
+    {
+        bench->mq = osMessageQueueNew(BENCH_MQ_CAPACITY, sizeof(uint32_t), NULL);
+        elab_assert(bench->mq != NULL);
+    }
+
+    uint64_t time_start = _time_ns();
+    for (uint32_t i = 0; i < producers; i ++)
+    {
+        osThreadId_t thread = osThreadNew(_entry_producer, bench,
+                                            &bench_mq_thread_attr);
+        elab_assert(thread != NULL);
+    }
+
+    /* The consumer, getting all the messages. */
+    uint32_t data[BENCH_MQ_BATCH];
+    uint32_t count = 0;
+    uint32_t total = bench->count * producers;
+    while (count < total)
+    {
+        if (mode == BENCH_MQ_MODE_REF)
+        {
+            count += _ref_get(&bench->ref);
+        }
+        else if (mode == BENCH_MQ_MODE_SINGLE)
+        {
+            osStatus_t ret_os = osMessageQueueGet(bench->mq, &data[0], NULL,
+                                                    osWaitForever);
+            elab_assert(ret_os == osOK);
+            count += data[0];
+        }
+        else
+        {
+            int32_t ret = osMessageQueueGetN(bench->mq, data, BENCH_MQ_BATCH,
+                                                NULL, osWaitForever);
+            elab_assert(ret > 0);
+            for (int32_t i = 0; i < ret; i ++)
+            {
+                count += data[i];
+            }
+        }
+    }
+    uint64_t time_total = _time_ns() - time_start;
+
+    for (uint32_t i = 0; i < producers; i ++)
+    {
+        osSemaphoreAcquire(bench->sem_done, osWaitForever);
+    }
+    if (mode == BENCH_MQ_MODE_REF)
+    {
+        osSemaphoreDelete(bench->ref.sem_empty);
+        osSemaphoreDelete(bench->ref.sem_full);
+        osMutexDelete(bench->ref.mutex);
+    }
+    else
+    {
+        osMessageQueueDelete(bench->mq);
+    }
+    osSemaphoreDelete(bench->sem_done);
+    elab_free(bench);
+
+    return (uint32_t)(time_total / total);
+}
+
+/**
+  * @brief  Benchmark function for the message queue under the contention of
+  *         1, 4 and 16 producers and one consumer.
+  * @retval None
+  */
+static int32_t test_mq_bench(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    printf("Message queue, %u messages, capacity %u, batch %u:\n",
+            BENCH_MQ_MSG_TOTAL, BENCH_MQ_CAPACITY, BENCH_MQ_BATCH);
+    for (uint32_t i = 0; i < sizeof(bench_mq_producers) / sizeof(uint32_t); i ++)
+    {
+        printf("    %2u producers:", bench_mq_producers[i]);
+        for (uint8_t mode = 0; mode < BENCH_MQ_MODE_MAX; mode ++)
+        {
+            printf(" %s %5u ns/msg,", bench_mq_mode_name[mode],
+                    _bench_mq_run(mode, bench_mq_producers[i]));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_mq_bench,
+                    test_mq_bench,
+                    message queue contention benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,235 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../3rd/Shell/shell.h"
+#include "../common/elab_log.h"
+#include "../common/elab_assert.h"
+#include "../edf/normal/elab_serial.h"
+
+ELAB_TAG("SerialBench");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* private config ----------------------------------------------------------- */
+#define BENCH_SERIAL_SIZE_DEFAULT           (1024 * 1024)
+#define BENCH_SERIAL_RX_BUFSZ               (4096)
+#define BENCH_SERIAL_CHUNK                  (256)
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct bench_serial
+{
+    elab_serial_t serial;
+    const char *name;
+    osSemaphoreId_t sem_start;
+    volatile uint32_t count_remain;
+    uint8_t data;
+} bench_serial_t;
+
+/* private function prototype ----------------------------------------------- */
+static elab_err_t _enable(elab_serial_t *serial, bool status);
+static int32_t _read(elab_serial_t *serial, void *buffer, uint32_t size);
+static int32_t _write(elab_serial_t *serial, const void *buffer, uint32_t size);
+static elab_err_t _config(elab_serial_t *serial, elab_serial_config_t *config);
+static void _set_tx(elab_serial_t *serial, bool status);
+
+/* private variables -------------------------------------------------------- */
+static elab_serial_ops_t _bench_ops =
+{
+    .enable = _enable,
+    .read = _read,
+    .write = _write,
+    .set_tx = _set_tx,
+    .config = _config,
+};
+
+static bench_serial_t bench_queue =
+{
+    .name = "bench_serial_queue",
+};
+
+static bench_serial_t bench_stream =
+{
+    .name = "bench_serial_stream",
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Register the benchmark serial port in the given rx mode.
+  */
+static void _bench_serial_init(bench_serial_t *bench, uint8_t rx_mode)
+{
+    if (bench->sem_start != NULL)
+    {
+        return;
+    }
+
+    bench->sem_start = osSemaphoreNew(1, 0, NULL);
+    elab_assert(bench->sem_start != NULL);
+
+    elab_serial_attr_t attr = (elab_serial_attr_t)ELAB_SERIAL_ATTR_DEFAULT;
+    attr.rx_bufsz = BENCH_SERIAL_RX_BUFSZ;
+    attr.rx_mode = rx_mode;
+    elab_serial_register(&bench->serial, bench->name, &_bench_ops, &attr, bench);
+    elab_device_open(ELAB_DEVICE_CAST(&bench->serial));
+}
+
+/**
+  * @brief  Receive the given size of data, and return the time in ms.
+  */
+static uint32_t _bench_serial_run(bench_serial_t *bench, uint32_t size)
+{
+    elab_device_t *dev = ELAB_DEVICE_CAST(&bench->serial);
+    uint8_t buff[BENCH_SERIAL_CHUNK];
+    uint8_t data = 0;
+    uint32_t count = 0;
+
+    bench->data = 0;
+    bench->count_remain = size;
+    uint32_t time_start = osKernelGetTickCount();
+    osSemaphoreRelease(bench->sem_start);
+
+    while (count < size)
+    {
+        uint32_t size_read = size - count;
+        if (size_read > BENCH_SERIAL_CHUNK)
+        {
+            size_read = BENCH_SERIAL_CHUNK;
+        }
+        int32_t ret = elab_serial_read(dev, buff, size_read, osWaitForever);
+        elab_assert(ret == size_read);
+        for (uint32_t i = 0; i < size_read; i ++)
+        {
+            elab_assert(buff[i] == data);
+            data ++;
+        }
+        count += size_read;
+    }
+
+    return osKernelGetTickCount() - time_start;
+}
+
+/**
+  * @brief  Benchmark function for the serial rx message queue and stream buffer.
+  * @retval None
+  */
+static int32_t test_serial_bench(int32_t argc, char *argv[])
+{
+    uint32_t size = BENCH_SERIAL_SIZE_DEFAULT;
+    if (argc >= 2)
+    {
+        size = (uint32_t)atoi(argv[1]) * 1024;
+        if (size == 0)
+        {
+            elog_error("Invalid size %s KB.", argv[1]);
+            return -1;
+        }
+    }
+
+    _bench_serial_init(&bench_queue, ELAB_SERIAL_RX_MODE_QUEUE);
+    _bench_serial_init(&bench_stream, ELAB_SERIAL_RX_MODE_STREAM);
+
+    uint32_t time_queue = _bench_serial_run(&bench_queue, size);
+    uint32_t time_stream = _bench_serial_run(&bench_stream, size);
+    time_queue = (time_queue == 0) ? 1 : time_queue;
+    time_stream = (time_stream == 0) ? 1 : time_stream;
+
+    printf("Serial rx %u bytes, chunk %u bytes:\n", size, BENCH_SERIAL_CHUNK);
+    printf("    queue:  %6u ms, %8u KB/s.\n",
+            time_queue, (uint32_t)((uint64_t)size * 1000 / 1024 / time_queue));
+    printf("    stream: %6u ms, %8u KB/s.\n",
+            time_stream, (uint32_t)((uint64_t)size * 1000 / 1024 / time_stream));
+
+    return 0;
+}
+
+/**
+  * @brief  The benchmark driver enabling function.
+  */
+static elab_err_t _enable(elab_serial_t *serial, bool status)
+{
+    (void)serial;
+    (void)status;
+
+    return ELAB_OK;
+}
+
+/**
+  * @brief  The benchmark driver reading function, generating the data as fast
+  *         as possible until the expected size is reached.
+  */
+static int32_t _read(elab_serial_t *serial, void *buffer, uint32_t size)
+{
+    bench_serial_t *bench = (bench_serial_t *)serial->super.user_data;
+    uint8_t *buff = (uint8_t *)buffer;
+
+    for (uint32_t i = 0; i < size; i ++)
+    {
+        while (bench->count_remain == 0)
+        {
+            osSemaphoreAcquire(bench->sem_start, osWaitForever);
+        }
+        bench->count_remain --;
+        buff[i] = bench->data ++;
+    }
+
+    return size;
+}
+
+/**
+  * @brief  The benchmark driver writting function.
+  */
+static int32_t _write(elab_serial_t *serial, const void *buffer, uint32_t size)
+{
+    (void)buffer;
+
+    elab_serial_tx_end(serial);
+
+    return size;
+}
+
+/**
+  * @brief  The benchmark driver config function.
+  */
+static elab_err_t _config(elab_serial_t *serial, elab_serial_config_t *config)
+{
+    (void)serial;
+    (void)config;
+
+    return ELAB_OK;
+}
+
+/**
+  * @brief  The benchmark driver tx mode setting function.
+  */
+static void _set_tx(elab_serial_t *serial, bool status)
+{
+    (void)serial;
+    (void)status;
+}
+
+/**
+  * @brief  Test shell command export
+  */
+SHELL_EXPORT_CMD(SHELL_CMD_PERMISSION(0) | SHELL_CMD_TYPE(SHELL_TYPE_CMD_MAIN),
+                    test_serial_bench,
+                    test_serial_bench,
+                    serial rx queue and stream benchmark);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
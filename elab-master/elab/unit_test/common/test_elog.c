@@ -0,0 +1,557 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../../os/cmsis_os.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_elog"
+#include "../../common/elab_log.h"
+#include "../../common/elab_log_sink.h"
+
+#define ELOG_DECODE_NO_MAIN
+#include "../../../tools/elog_decode/elog_decode.c"
+
+#if (ELOG_ASYNC_ENABLE != 0) && (ELAB_RTOS_CMSIS_OS_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_ELOG_PATH                                "/tmp/ut_elog.txt"
+#define UT_ELOG_NUM_ORDER                           (50)
+#define UT_ELOG_NUM_FLOOD                           (1000)
+#define UT_ELOG_PATH_SINK                           "/tmp/ut_elog_sink.txt"
+#define UT_ELOG_RAM_SIZE                            (1024)
+#define UT_ELOG_PATH_DECODE                         "/tmp/ut_elog_decode.txt"
+
+/* Private variables ---------------------------------------------------------*/
+static int ut_stdout_bkp = -1;
+static uint32_t ut_index[UT_ELOG_NUM_FLOOD];
+static uint32_t ut_index_count = 0;
+static uint32_t ut_ram[UT_ELOG_RAM_SIZE / 4];
+static char ut_text[UT_ELOG_RAM_SIZE + 1];
+static elog_sink_ram_t ut_sink_ram;
+static const char ut_tag_cache[] = "ut_elog_cache";
+static char ut_tag_cache_name[sizeof(ut_tag_cache)];
+
+/* Private function prototypes -----------------------------------------------*/
+static void ut_stdout_redirect(void);
+static void ut_stdout_restore(void);
+static void ut_index_load(void);
+static uint32_t ut_ram_count(const char *str);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of elog.
+  */
+TEST_GROUP(elog);
+
+/**
+  * @brief  Define test fixture setup function of elog.
+  */
+TEST_SETUP(elog)
+{
+    ut_index_count = 0;
+}
+
+/**
+  * @brief  Define test fixture tear down function of elog.
+  */
+TEST_TEAR_DOWN(elog)
+{
+    elog_tag_level_set(TAG, ELOG_LEVEL_GLOBAL);
+    elog_tag_rate_set(TAG, 0, 0);
+    remove(UT_ELOG_PATH);
+    remove(UT_ELOG_PATH_SINK);
+    remove(UT_ELOG_PATH_DECODE);
+}
+
+/**
+  * @brief  The async records are written in order, and the sync path is back
+  *         after stopping.
+  */
+TEST(elog, async_order)
+{
+    elog_async_stat_t stat;
+
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    ut_stdout_redirect();
+    for (uint32_t i = 0; i < UT_ELOG_NUM_ORDER; i ++)
+    {
+        elog_info("index %u.", i);
+    }
+    elog_async_flush();
+    ut_stdout_restore();
+    elog_async_stat(&stat);
+    elog_async_stop();
+
+    ut_index_load();
+    TEST_ASSERT_EQUAL_UINT32(UT_ELOG_NUM_ORDER, ut_index_count);
+    for (uint32_t i = 0; i < UT_ELOG_NUM_ORDER; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, ut_index[i]);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(UT_ELOG_NUM_ORDER, stat.written);
+    TEST_ASSERT_EQUAL_UINT32(0, stat.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, stat.overwritten);
+}
+
+/**
+  * @brief  When the ring buffer is full, the new records are dropped, and the
+  *         kept ones are the oldest.
+  */
+TEST(elog, async_drop)
+{
+    elog_async_stat_t stat;
+
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    ut_stdout_redirect();
+    for (uint32_t i = 0; i < UT_ELOG_NUM_FLOOD; i ++)
+    {
+        elog_info("index %u.", i);
+    }
+    elog_async_flush();
+    ut_stdout_restore();
+    elog_async_stat(&stat);
+    elog_async_stop();
+
+    ut_index_load();
+    TEST_ASSERT_EQUAL_UINT32(0, stat.overwritten);
+    TEST_ASSERT_EQUAL_UINT32(UT_ELOG_NUM_FLOOD, ut_index_count + stat.dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_index[0]);
+    for (uint32_t i = 1; i < ut_index_count; i ++)
+    {
+        TEST_ASSERT_GREATER_THAN_UINT32(ut_index[i - 1], ut_index[i]);
+    }
+}
+
+/**
+  * @brief  When the ring buffer is full, the oldest records are overwritten,
+  *         and the newest one is always kept.
+  */
+TEST(elog, async_overwrite)
+{
+    elog_async_stat_t stat;
+
+    elog_async_start(ELOG_ASYNC_OVERWRITE);
+    ut_stdout_redirect();
+    for (uint32_t i = 0; i < UT_ELOG_NUM_FLOOD; i ++)
+    {
+        elog_info("index %u.", i);
+    }
+    elog_async_flush();
+    ut_stdout_restore();
+    elog_async_stat(&stat);
+    elog_async_stop();
+
+    ut_index_load();
+    TEST_ASSERT_EQUAL_UINT32(0, stat.dropped);
+    TEST_ASSERT_EQUAL_UINT32(UT_ELOG_NUM_FLOOD, ut_index_count + stat.overwritten);
+    TEST_ASSERT_EQUAL_UINT32(UT_ELOG_NUM_FLOOD - 1, ut_index[ut_index_count - 1]);
+    for (uint32_t i = 1; i < ut_index_count; i ++)
+    {
+        TEST_ASSERT_GREATER_THAN_UINT32(ut_index[i - 1], ut_index[i]);
+    }
+}
+
+/**
+  * @brief  The binary log is one frame with the format ID and the raw arguments
+  *         in the async mode, and the text log in the sync mode.
+  */
+TEST(elog, binary)
+{
+    uint8_t frame[128];
+    char line[256];
+
+    /* The sync mode. */
+    ut_stdout_redirect();
+    elog_binary(ELOG_LEVEL_INFO, "binary %d %u %s %.2f %c %lld.",
+                -5, 7U, "abc", 1.5, 'x', 123456789012LL);
+    ut_stdout_restore();
+
+    FILE *fp = fopen(UT_ELOG_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), fp));
+    fclose(fp);
+    TEST_ASSERT_NOT_NULL(strstr(line, "[I/" TAG " "));
+    TEST_ASSERT_NOT_NULL(strstr(line, "] binary -5 7 abc 1.50 x 123456789012."));
+
+    /* The async mode. */
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    ut_stdout_redirect();
+    elog_binary(ELOG_LEVEL_INFO, "binary %d %u %s %.2f %c %lld.",
+                -5, 7U, "abc", 1.5, 'x', 123456789012LL);
+    elog_async_flush();
+    ut_stdout_restore();
+    elog_async_stop();
+
+    fp = fopen(UT_ELOG_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    uint32_t size = fread(frame, 1, sizeof(frame), fp);
+    fclose(fp);
+
+    /* Find the frame of this format, as other threads may log too. */
+    const elog_fmt_t *fmt = NULL;
+    uint32_t i = 0;
+    for (; (i + ELOG_BINARY_HEAD_SIZE) <= size;
+            i += ELOG_BINARY_HEAD_SIZE + frame[i + 1])
+    {
+        TEST_ASSERT_EQUAL_HEX8(0xA5, frame[i]);
+        int16_t id;
+        memcpy(&id, &frame[i + 2], sizeof(int16_t));
+        fmt = (const elog_fmt_t *)((const char *)&elog_fmt_base + id * 4);
+        if (strcmp(fmt->tag, TAG) == 0)
+        {
+            break;
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(size, i + ELOG_BINARY_HEAD_SIZE + frame[i + 1]);
+    TEST_ASSERT_EQUAL_STRING("binary %d %u %s %.2f %c %lld.", fmt->format);
+    TEST_ASSERT_EQUAL_UINT32(ELOG_LEVEL_INFO, fmt->level);
+
+    int32_t value_s32;
+    uint32_t value_u32;
+    double value_double;
+    int64_t value_s64;
+    uint8_t *arg = &frame[i + ELOG_BINARY_HEAD_SIZE];
+    TEST_ASSERT_EQUAL_UINT8(4 + 4 + 4 + 8 + 4 + 8, frame[i + 1]);
+    memcpy(&value_s32, arg, 4);
+    TEST_ASSERT_EQUAL_INT32(-5, value_s32);
+    memcpy(&value_u32, arg + 4, 4);
+    TEST_ASSERT_EQUAL_UINT32(7, value_u32);
+    TEST_ASSERT_EQUAL_UINT8(3, arg[8]);
+    TEST_ASSERT_EQUAL_MEMORY("abc", arg + 9, 3);
+    memcpy(&value_double, arg + 12, 8);
+    TEST_ASSERT_TRUE(value_double == 1.5);
+    memcpy(&value_s32, arg + 20, 4);
+    TEST_ASSERT_EQUAL_INT32('x', value_s32);
+    memcpy(&value_s64, arg + 24, 8);
+    TEST_ASSERT_TRUE(value_s64 == 123456789012LL);
+}
+
+/**
+  * @brief  The binary frames between the text logs are decoded by elog_decode
+  *         with this ELF file, and the sync bytes in the text, like the one in
+  *         the UTF-8 yen sign, do not break them.
+  */
+TEST(elog, binary_decode)
+{
+    static char text[4096];
+
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    ut_stdout_redirect();
+    elog_info("price \xc2\xa5" "%d.", 5);
+    elog_binary(ELOG_LEVEL_INFO, "decode %d %u %s %.2f %c %lld.",
+                -5, 7U, "abc", 1.5, 'x', 123456789012LL);
+    elog_info("after \xa5 decode.");
+    elog_async_flush();
+
+    /* The sync bytes just before one frame. */
+    fputs("\xa5\xa5", stdout);
+    fflush(stdout);
+    elog_binary(ELOG_LEVEL_INFO, "decode again %s.", "xyz");
+    elog_async_flush();
+    ut_stdout_restore();
+    elog_async_stop();
+
+    FILE *in = fopen(UT_ELOG_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(in);
+    FILE *out = fopen(UT_ELOG_PATH_DECODE, "w+b");
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_EQUAL_INT(0, elog_decode("/proc/self/exe", in, out));
+    rewind(out);
+    uint32_t size = fread(text, 1, sizeof(text) - 1, out);
+    text[size] = 0;
+    fclose(out);
+    fclose(in);
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "price \xc2\xa5" "5."));
+    TEST_ASSERT_NOT_NULL(strstr(text, "[I/" TAG " "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "] decode -5 7 abc 1.50 x 123456789012.\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "after \xa5 decode."));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\xa5\xa5[I/" TAG " "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "] decode again xyz.\n"));
+}
+
+/**
+  * @brief  Every sink only gets the logs of its own level, and the RAM ring
+  *         keeps the latest logs over initializing again.
+  */
+TEST(elog, sink_level)
+{
+    memset(ut_ram, 0, sizeof(ut_ram));
+    elog_sink_ram_init(&ut_sink_ram, "ut_ram", ut_ram, sizeof(ut_ram),
+                        ELOG_LEVEL_WARNING);
+    TEST_ASSERT_EQUAL_PTR(&ut_sink_ram.super, elog_sink_find("ut_ram"));
+
+    ut_stdout_redirect();
+    elog_info("sink info.");
+    elog_warn("sink warn.");
+    ut_stdout_restore();
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("sink info."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("sink warn."));
+
+    /* The console is disabled, and the RAM sink takes the info logs now. */
+    elog_sink_t *console = elog_sink_find("console");
+    TEST_ASSERT_NOT_NULL(console);
+    elog_sink_level_set(console, 0);
+    elog_sink_level_set(&ut_sink_ram.super, ELOG_LEVEL_INFO);
+    ut_stdout_redirect();
+    elog_info("sink info.");
+    ut_stdout_restore();
+    elog_sink_level_set(console, ELOG_LEVEL_DEBUG);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("sink info."));
+    ut_index_load();
+    TEST_ASSERT_EQUAL_UINT32(0, ut_index_count);
+
+    /* The logs are kept in the buffer. */
+    elog_sink_ram_deinit(&ut_sink_ram);
+    TEST_ASSERT_NULL(elog_sink_find("ut_ram"));
+    elog_sink_ram_init(&ut_sink_ram, "ut_ram", ut_ram, sizeof(ut_ram),
+                        ELOG_LEVEL_DEBUG);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("sink warn."));
+
+    /* Only the latest logs are kept when the ring is wrapped. */
+    for (uint32_t i = 0; i < 100; i ++)
+    {
+        ut_stdout_redirect();
+        elog_debug("sink wrap %u.", i);
+        ut_stdout_restore();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("sink warn."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("sink wrap 99."));
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("sink wrap 0."));
+    elog_sink_ram_deinit(&ut_sink_ram);
+}
+
+/**
+  * @brief  The tag level is over the global level.
+  */
+TEST(elog, tag_level)
+{
+    memset(ut_ram, 0, sizeof(ut_ram));
+    elog_sink_ram_init(&ut_sink_ram, "ut_ram", ut_ram, sizeof(ut_ram),
+                        ELOG_LEVEL_DEBUG);
+
+    ut_stdout_redirect();
+    elog_tag_level_set(TAG, ELOG_LEVEL_ERROR);
+    elog_info("tag info.");
+    elog_error("tag error.");
+    elog_level_set(ELOG_LEVEL_ERROR);
+    elog_tag_level_set(TAG, ELOG_LEVEL_DEBUG);
+    elog_debug("tag debug.");
+    elog_tag_level_set(TAG, ELOG_LEVEL_GLOBAL);
+    elog_warn("tag warn.");
+    elog_level_set(ELOG_LEVEL_DEBUG);
+    ut_stdout_restore();
+    elog_sink_ram_deinit(&ut_sink_ram);
+
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("tag info."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("tag error."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("tag debug."));
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("tag warn."));
+}
+
+/**
+  * @brief  The logs of one tag over its burst are dropped.
+  */
+TEST(elog, tag_rate)
+{
+    memset(ut_ram, 0, sizeof(ut_ram));
+    elog_sink_ram_init(&ut_sink_ram, "ut_ram", ut_ram, sizeof(ut_ram),
+                        ELOG_LEVEL_DEBUG);
+
+    uint32_t dropped = elog_tag_dropped(TAG);
+    elog_tag_rate_set(TAG, 10, 5);
+    ut_stdout_redirect();
+    for (uint32_t i = 0; i < 20; i ++)
+    {
+        elog_info("rate.");
+    }
+    ut_stdout_restore();
+    TEST_ASSERT_EQUAL_UINT32(5, ut_ram_count("rate."));
+    TEST_ASSERT_EQUAL_UINT32(15, elog_tag_dropped(TAG) - dropped);
+
+    /* One more log is allowed after one interval. */
+    osDelay(150);
+    ut_stdout_redirect();
+    elog_info("rate.");
+    elog_info("rate.");
+    ut_stdout_restore();
+    TEST_ASSERT_EQUAL_UINT32(6, ut_ram_count("rate."));
+
+    elog_tag_rate_set(TAG, 0, 0);
+    ut_stdout_redirect();
+    elog_info("rate.");
+    ut_stdout_restore();
+    TEST_ASSERT_EQUAL_UINT32(7, ut_ram_count("rate."));
+    elog_sink_ram_deinit(&ut_sink_ram);
+}
+
+/**
+  * @brief  The tag resolved by its pointer follows the level set by the name
+  *         in another buffer, even if its miss is cached before.
+  */
+TEST(elog, tag_cache)
+{
+    memset(ut_ram, 0, sizeof(ut_ram));
+    elog_sink_ram_init(&ut_sink_ram, "ut_ram", ut_ram, sizeof(ut_ram),
+                        ELOG_LEVEL_DEBUG);
+    strcpy(ut_tag_cache_name, ut_tag_cache);
+
+    ut_stdout_redirect();
+    _elog_printf(ut_tag_cache, ELOG_LEVEL_INFO, "cache 1.");
+    _elog_printf(ut_tag_cache, ELOG_LEVEL_INFO, "cache 1.");
+    elog_tag_level_set(ut_tag_cache_name, ELOG_LEVEL_ERROR);
+    _elog_printf(ut_tag_cache, ELOG_LEVEL_INFO, "cache 2.");
+    _elog_printf(ut_tag_cache, ELOG_LEVEL_ERROR, "cache 3.");
+    elog_tag_level_set(ut_tag_cache_name, ELOG_LEVEL_GLOBAL);
+    _elog_printf(ut_tag_cache, ELOG_LEVEL_INFO, "cache 4.");
+    ut_stdout_restore();
+    elog_sink_ram_deinit(&ut_sink_ram);
+
+    TEST_ASSERT_EQUAL_UINT32(2, ut_ram_count("cache 1."));
+    TEST_ASSERT_EQUAL_UINT32(0, ut_ram_count("cache 2."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("cache 3."));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_ram_count("cache 4."));
+}
+
+/**
+  * @brief  The file sink gets the text logs without the color, in the sync and
+  *         the async modes.
+  */
+TEST(elog, sink_file)
+{
+    elog_sink_file_t sink;
+    char line[256];
+
+    TEST_ASSERT_EQUAL_INT(ELAB_ERR_IO,
+                    elog_sink_file_init(&sink, "ut_file", "/nonexist/ut.txt",
+                                        ELOG_LEVEL_INFO));
+    TEST_ASSERT_EQUAL_INT(ELAB_OK,
+                    elog_sink_file_init(&sink, "ut_file", UT_ELOG_PATH_SINK,
+                                        ELOG_LEVEL_INFO));
+    ut_stdout_redirect();
+    elog_info("file sync.");
+    elog_debug("file debug.");
+    elog_async_start(ELOG_ASYNC_DROP_NEW);
+    elog_info("file async.");
+    elog_async_flush();
+    elog_async_stop();
+    ut_stdout_restore();
+    elog_sink_file_deinit(&sink);
+
+    uint32_t count = 0;
+    FILE *fp = fopen(UT_ELOG_PATH_SINK, "r");
+    TEST_ASSERT_NOT_NULL(fp);
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (strstr(line, "[I/" TAG " ") == line)
+        {
+            TEST_ASSERT_NOT_NULL(strstr(line, count == 0 ?
+                                        "] file sync.\r\n" : "] file async.\r\n"));
+            count ++;
+        }
+        TEST_ASSERT_NULL(strstr(line, "file debug."));
+    }
+    fclose(fp);
+    TEST_ASSERT_EQUAL_UINT32(2, count);
+}
+
+/**
+  * @brief  Define run test cases of elog.
+  */
+TEST_GROUP_RUNNER(elog)
+{
+    RUN_TEST_CASE(elog, async_order);
+    RUN_TEST_CASE(elog, async_drop);
+    RUN_TEST_CASE(elog, async_overwrite);
+    RUN_TEST_CASE(elog, binary);
+    RUN_TEST_CASE(elog, binary_decode);
+    RUN_TEST_CASE(elog, sink_level);
+    RUN_TEST_CASE(elog, tag_level);
+    RUN_TEST_CASE(elog, tag_rate);
+    RUN_TEST_CASE(elog, tag_cache);
+    RUN_TEST_CASE(elog, sink_file);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Redirect the console into the testing file.
+  */
+static void ut_stdout_redirect(void)
+{
+    fflush(stdout);
+    ut_stdout_bkp = dup(STDOUT_FILENO);
+    int fd = open(UT_ELOG_PATH, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    elab_assert(ut_stdout_bkp >= 0 && fd >= 0);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+}
+
+/**
+  * @brief  Restore the console from the testing file.
+  */
+static void ut_stdout_restore(void)
+{
+    fflush(stdout);
+    dup2(ut_stdout_bkp, STDOUT_FILENO);
+    close(ut_stdout_bkp);
+    ut_stdout_bkp = -1;
+}
+
+/**
+  * @brief  Load the indexes of the records of this test from the testing file.
+  */
+static void ut_index_load(void)
+{
+    char line[256];
+    FILE *fp = fopen(UT_ELOG_PATH, "r");
+    TEST_ASSERT_NOT_NULL(fp);
+
+    ut_index_count = 0;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *str = strstr(line, "[I/" TAG " ");
+        uint32_t index = 0;
+        if (str != NULL && ut_index_count < UT_ELOG_NUM_FLOOD &&
+            sscanf(strchr(str, ']'), "] index %u.", &index) == 1)
+        {
+            ut_index[ut_index_count ++] = index;
+        }
+    }
+    fclose(fp);
+}
+
+/**
+  * @brief  Count the given string in the logs of the RAM sink.
+  */
+static uint32_t ut_ram_count(const char *str)
+{
+    uint32_t count = 0;
+    uint32_t len = elog_sink_ram_read(&ut_sink_ram, ut_text, UT_ELOG_RAM_SIZE);
+    ut_text[len] = 0;
+
+    for (char *p = strstr(ut_text, str); p != NULL; p = strstr(p + 1, str))
+    {
+        count ++;
+    }
+
+    return count;
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,208 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../os/cmsis_os.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_export.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_export"
+#include "../../common/elab_log.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_POLL_PERIOD                              (5)
+#define UT_POLL_TEST_TIME                           (200)
+#define UT_INIT_DELAY                               (20)
+
+/* Private function prototypes -----------------------------------------------*/
+static void ut_poll_func(void);
+static elab_export_poll_data_t *ut_poll_data_get(const char *name);
+static void ut_init_device_1(void);
+static void ut_init_driver(void);
+static void ut_init_device_2(void);
+static void ut_init_app_1(void);
+static void ut_init_app_2(void);
+static const elab_export_t *ut_init_export_get(const char *name);
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t ut_poll_count = 0;
+static volatile uint32_t ut_init_seq = 0;
+static uint32_t ut_init_device_1_seq = 0;
+static uint32_t ut_init_driver_seq = 0;
+static uint32_t ut_init_device_2_seq = 0;
+static uint32_t ut_init_app_1_seq = 0;
+static uint32_t ut_init_app_2_seq = 0;
+
+POLL_EXPORT(ut_poll_func, UT_POLL_PERIOD);
+INIT_EXPORT(ut_init_device_1, EXPORT_DEVICE);
+INIT_EXPORT(ut_init_driver, EXPORT_DRVIVER);
+INIT_EXPORT(ut_init_device_2, EXPORT_DEVICE);
+INIT_EXPORT_PARALLEL(ut_init_app_1, EXPORT_APP);
+INIT_EXPORT_PARALLEL(ut_init_app_2, EXPORT_APP);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of export.
+  */
+TEST_GROUP(export);
+
+/**
+  * @brief  Define test fixture setup function of export.
+  */
+TEST_SETUP(export)
+{
+}
+
+/**
+  * @brief  Define test fixture tear down function of export.
+  */
+TEST_TEAR_DOWN(export)
+{
+}
+
+/**
+  * @brief  The polling functions run in their periods, with the statistics.
+  */
+TEST(export, poll)
+{
+    elab_export_poll_data_t *data = ut_poll_data_get("ut_poll_func");
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(ut_poll_data_get("module_null_init"));
+
+    uint32_t count_start = ut_poll_count;
+    uint32_t count_data_start = data->count;
+    osDelay(UT_POLL_TEST_TIME);
+    uint32_t count = ut_poll_count - count_start;
+
+    TEST_ASSERT_UINT32_WITHIN(10, (UT_POLL_TEST_TIME / UT_POLL_PERIOD), count);
+    TEST_ASSERT_UINT32_WITHIN(1, count, (data->count - count_data_start));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(data->overrun, data->count);
+}
+
+/**
+  * @brief  The init functions run by level, in the link order in one level, and
+  *         with the execution time recorded.
+  */
+TEST(export, init)
+{
+    TEST_ASSERT_NOT_EQUAL(0, ut_init_driver_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_driver_seq, ut_init_device_1_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_driver_seq, ut_init_device_2_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_device_1_seq, ut_init_app_1_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_device_2_seq, ut_init_app_1_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_device_1_seq, ut_init_app_2_seq);
+    TEST_ASSERT_GREATER_THAN_UINT32(ut_init_device_2_seq, ut_init_app_2_seq);
+
+    const elab_export_t *device_1 = ut_init_export_get("ut_init_device_1");
+    const elab_export_t *device_2 = ut_init_export_get("ut_init_device_2");
+    TEST_ASSERT_NOT_NULL(device_1);
+    TEST_ASSERT_NOT_NULL(device_2);
+    TEST_ASSERT((device_1 < device_2) ==
+                    (ut_init_device_1_seq < ut_init_device_2_seq));
+
+    const elab_export_t *app = ut_init_export_get("ut_init_app_1");
+    TEST_ASSERT_NOT_NULL(app);
+    TEST_ASSERT_TRUE(app->parallel);
+    elab_export_init_data_t *data = (elab_export_init_data_t *)app->data;
+    TEST_ASSERT_UINT32_WITHIN(UT_INIT_DELAY, UT_INIT_DELAY, data->time_ms);
+}
+
+/**
+  * @brief  Define run test cases of export.
+  */
+TEST_GROUP_RUNNER(export)
+{
+    RUN_TEST_CASE(export, poll);
+    RUN_TEST_CASE(export, init);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Polling function for testing.
+  */
+static void ut_poll_func(void)
+{
+    ut_poll_count ++;
+}
+
+/**
+  * @brief  Get the polling data of the given polling function.
+  */
+static elab_export_poll_data_t *ut_poll_data_get(const char *name)
+{
+    uint32_t count = 0;
+    const elab_export_t *table = elab_export_poll_table(&count);
+
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        if (strcmp(table[i].name, name) == 0)
+        {
+            return (elab_export_poll_data_t *)table[i].data;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Init functions for testing, recording their running sequence.
+  */
+static void ut_init_device_1(void)
+{
+    ut_init_device_1_seq = elab_atomic_add(&ut_init_seq, 1);
+}
+
+static void ut_init_driver(void)
+{
+    ut_init_driver_seq = elab_atomic_add(&ut_init_seq, 1);
+}
+
+static void ut_init_device_2(void)
+{
+    ut_init_device_2_seq = elab_atomic_add(&ut_init_seq, 1);
+}
+
+static void ut_init_app_1(void)
+{
+    osDelay(UT_INIT_DELAY);
+    ut_init_app_1_seq = elab_atomic_add(&ut_init_seq, 1);
+}
+
+static void ut_init_app_2(void)
+{
+    osDelay(UT_INIT_DELAY);
+    ut_init_app_2_seq = elab_atomic_add(&ut_init_seq, 1);
+}
+
+/**
+  * @brief  Get the init export of the given init function.
+  */
+static const elab_export_t *ut_init_export_get(const char *name)
+{
+    uint32_t count = 0;
+    const elab_export_t *table = elab_export_init_table(&count);
+
+    for (uint32_t i = 0; i < count; i ++)
+    {
+        if (strcmp(table[i].name, name) == 0)
+        {
+            return &table[i];
+        }
+    }
+
+    return NULL;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
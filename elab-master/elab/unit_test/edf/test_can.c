@@ -0,0 +1,305 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../edf/normal/elab_can.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_CAN_NAME                                 "ut_can"
+#define UT_CAN_BUFF_SIZE                            (8)
+#define UT_CAN_SENT_MAX                             (32)
+#define UT_CAN_STRESS_TIMES                         (2000)
+
+/* Private function prototypes -----------------------------------------------*/
+static elab_err_t ops_enable(elab_can_t * const me, bool status);
+static elab_err_t ops_config(elab_can_t * const me, elab_can_config_t *config);
+static void ops_send(elab_can_t * const me, const elab_can_msg_t *msg);
+static void ut_can_recv(uint32_t id, bool ide);
+static void entry_can_isr(void *para);
+
+/* Private variables ---------------------------------------------------------*/
+static const struct elab_can_ops can_ops =
+{
+    .enable = ops_enable,
+    .config = ops_config,
+    .send = ops_send,
+};
+
+static const osThreadAttr_t thread_attr_can_isr =
+{
+    .name = "ThreadUtCanIsr",
+    .attr_bits = osThreadJoinable,
+    .priority = osPriorityNormal,
+    .stack_size = 2048,
+};
+
+static elab_can_t can;
+static elab_device_t *dev = NULL;
+static elab_can_msg_t msg_sent[UT_CAN_SENT_MAX];
+static uint32_t count_sent = 0;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of CAN device.
+  */
+TEST_GROUP(dev_can);
+
+/**
+  * @brief  Define test fixture setup function of CAN device.
+  */
+TEST_SETUP(dev_can)
+{
+    elab_can_attr_t attr =
+    {
+        .user_data = NULL,
+        .buff_size_send = UT_CAN_BUFF_SIZE,
+        .buff_size_recv = UT_CAN_BUFF_SIZE,
+    };
+
+    memset(&can, 0, sizeof(elab_can_t));
+    can.ops = &can_ops;
+    count_sent = 0;
+    elab_can_register(&can, UT_CAN_NAME, &attr, NULL);
+    dev = elab_device_find(UT_CAN_NAME);
+    TEST_ASSERT_EQUAL_PTR(&can, dev);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_device_open(dev));
+}
+
+/**
+  * @brief  Define test fixture tear down function of CAN device.
+  */
+TEST_TEAR_DOWN(dev_can)
+{
+    elab_device_close(dev);
+    elab_can_unregister(&can);
+    TEST_ASSERT_NULL(elab_device_find(UT_CAN_NAME));
+}
+
+/**
+  * @brief  The received messages are read in batch, and the ones over the rx
+  *         ring buffer are counted as overrun.
+  */
+TEST(dev_can, recv)
+{
+    elab_can_msg_t msg[UT_CAN_BUFF_SIZE + 2];
+    elab_can_stat_t stat;
+
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT, elab_can_recv_n(dev, msg, 1, 0));
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT, elab_can_recv_n(dev, msg, 1, 20));
+
+    ut_can_recv(0x123, false);
+    TEST_ASSERT_EQUAL_INT32(1, elab_can_recv(dev, msg));
+    TEST_ASSERT_EQUAL_UINT32(0x123, msg[0].id);
+    TEST_ASSERT_EQUAL_UINT8(0x23, msg[0].data[0]);
+
+    for (uint32_t i = 0; i < UT_CAN_BUFF_SIZE + 2; i ++)
+    {
+        ut_can_recv(i, false);
+    }
+    TEST_ASSERT_EQUAL_INT32(3, elab_can_recv_n(dev, msg, 3, 0));
+    TEST_ASSERT_EQUAL_INT32(UT_CAN_BUFF_SIZE - 3,
+                            elab_can_recv_n(dev, &msg[3], UT_CAN_BUFF_SIZE + 2, 0));
+    for (uint32_t i = 0; i < UT_CAN_BUFF_SIZE; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, msg[i].id);
+    }
+
+    elab_can_get_stat(dev, &stat);
+    TEST_ASSERT_EQUAL_UINT32(UT_CAN_BUFF_SIZE + 1, stat.recv);
+    TEST_ASSERT_EQUAL_UINT32(2, stat.overrun);
+    TEST_ASSERT_EQUAL_UINT32(0, stat.filtered);
+}
+
+/**
+  * @brief  The software filters in the list mode and the mask mode.
+  */
+TEST(dev_can, filter)
+{
+    static elab_can_filter_t filter_list[40];
+    static elab_can_filter_t filter_mask;
+    elab_can_msg_t msg[UT_CAN_BUFF_SIZE];
+    elab_can_stat_t stat;
+
+    /* The standard IDs 0x100, 0x102 ... in the list, and 0x7F0 - 0x7FF by
+       the mask. */
+    for (uint32_t i = 0; i < 40; i ++)
+    {
+        memset(&filter_list[i], 0, sizeof(elab_can_filter_t));
+        filter_list[i].id = 0x100 + i * 2;
+        filter_list[i].mode = ELAB_CAN_FILTER_MODE_LIST;
+        TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_config_filter(dev, &filter_list[i]));
+    }
+    memset(&filter_mask, 0, sizeof(elab_can_filter_t));
+    filter_mask.id = 0x7F5;
+    filter_mask.mask = 0x7F0;
+    filter_mask.mode = ELAB_CAN_FILTER_MODE_MASK;
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_config_filter(dev, &filter_mask));
+
+    ut_can_recv(0x100, false);
+    ut_can_recv(0x101, false);
+    ut_can_recv(0x14E, false);
+    ut_can_recv(0x150, false);
+    ut_can_recv(0x100, true);
+    ut_can_recv(0x7FA, false);
+    ut_can_recv(0x7FA, true);
+    ut_can_recv(0x6FA, false);
+
+    TEST_ASSERT_EQUAL_INT32(3, elab_can_recv_n(dev, msg, UT_CAN_BUFF_SIZE, 0));
+    TEST_ASSERT_EQUAL_UINT32(0x100, msg[0].id);
+    TEST_ASSERT_EQUAL_UINT32(0x14E, msg[1].id);
+    TEST_ASSERT_EQUAL_UINT32(0x7FA, msg[2].id);
+    TEST_ASSERT_EQUAL_UINT32(0, msg[2].ide);
+
+    elab_can_get_stat(dev, &stat);
+    TEST_ASSERT_EQUAL_UINT32(3, stat.recv);
+    TEST_ASSERT_EQUAL_UINT32(5, stat.filtered);
+}
+
+/**
+  * @brief  The first message is sent at once, and the next ones are sent one
+  *         by one when the sending ends.
+  */
+TEST(dev_can, send)
+{
+    elab_can_msg_t msg;
+    elab_can_stat_t stat;
+
+    memset(&msg, 0, sizeof(elab_can_msg_t));
+    msg.length = 8;
+    for (uint32_t i = 0; i < UT_CAN_BUFF_SIZE + 2; i ++)
+    {
+        msg.id = i;
+        TEST_ASSERT_EQUAL_INT(i <= UT_CAN_BUFF_SIZE ? ELAB_OK : ELAB_ERR_FULL,
+                                elab_can_send(dev, &msg));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, count_sent);
+
+    for (uint32_t i = 0; i < UT_CAN_BUFF_SIZE; i ++)
+    {
+        elab_can_isr_send_end(&can);
+        TEST_ASSERT_EQUAL_UINT32(i + 2, count_sent);
+    }
+    elab_can_isr_send_end(&can);
+    TEST_ASSERT_EQUAL_UINT32(UT_CAN_BUFF_SIZE + 1, count_sent);
+    for (uint32_t i = 0; i < count_sent; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, msg_sent[i].id);
+    }
+
+    /* The CAN bus is idle, so the next one is sent at once. */
+    msg.id = 0x55;
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(dev, &msg));
+    TEST_ASSERT_EQUAL_UINT32(UT_CAN_BUFF_SIZE + 2, count_sent);
+    TEST_ASSERT_EQUAL_UINT32(0x55, msg_sent[UT_CAN_BUFF_SIZE + 1].id);
+
+    elab_can_get_stat(dev, &stat);
+    TEST_ASSERT_EQUAL_UINT32(UT_CAN_BUFF_SIZE + 2, stat.sent);
+    TEST_ASSERT_EQUAL_UINT32(1, stat.dropped);
+}
+
+/**
+  * @brief  The messages from the ISR thread are all read in order.
+  */
+TEST(dev_can, recv_stress)
+{
+    elab_can_msg_t msg[UT_CAN_BUFF_SIZE];
+    uint32_t count = 0;
+
+    osThreadId_t thread = osThreadNew(entry_can_isr, NULL, &thread_attr_can_isr);
+    TEST_ASSERT_NOT_NULL(thread);
+    while (count < UT_CAN_STRESS_TIMES)
+    {
+        int32_t ret = elab_can_recv_n(dev, msg, UT_CAN_BUFF_SIZE, 1000);
+        TEST_ASSERT_GREATER_THAN_INT32(0, ret);
+        for (int32_t i = 0; i < ret; i ++)
+        {
+            TEST_ASSERT_EQUAL_UINT32(count, msg[i].id);
+            count ++;
+        }
+    }
+    osThreadJoin(thread);
+}
+
+/**
+  * @brief  Define run test cases of CAN device.
+  */
+TEST_GROUP_RUNNER(dev_can)
+{
+    RUN_TEST_CASE(dev_can, recv);
+    RUN_TEST_CASE(dev_can, filter);
+    RUN_TEST_CASE(dev_can, send);
+    RUN_TEST_CASE(dev_can, recv_stress);
+}
+
+/* Private functions ---------------------------------------------------------*/
+static elab_err_t ops_enable(elab_can_t * const me, bool status)
+{
+    (void)me;
+    (void)status;
+
+    return ELAB_OK;
+}
+
+static elab_err_t ops_config(elab_can_t * const me, elab_can_config_t *config)
+{
+    (void)me;
+    (void)config;
+
+    return ELAB_OK;
+}
+
+static void ops_send(elab_can_t * const me, const elab_can_msg_t *msg)
+{
+    (void)me;
+
+    if (count_sent < UT_CAN_SENT_MAX)
+    {
+        msg_sent[count_sent] = *msg;
+    }
+    count_sent ++;
+}
+
+/**
+  * @brief  Receive one message as the ISR of the CAN driver.
+  */
+static void ut_can_recv(uint32_t id, bool ide)
+{
+    elab_can_msg_t msg;
+
+    memset(&msg, 0, sizeof(elab_can_msg_t));
+    msg.id = id;
+    msg.ide = ide ? 1 : 0;
+    msg.length = 2;
+    msg.data[0] = (uint8_t)id;
+    msg.data[1] = (uint8_t)(id >> 8);
+    elab_can_isr_recv(&can, &msg);
+}
+
+/**
+  * @brief  The ISR of the CAN driver, waiting for the reader when the rx ring
+  *         buffer is full.
+  */
+static void entry_can_isr(void *para)
+{
+    (void)para;
+
+    for (uint32_t i = 0; i < UT_CAN_STRESS_TIMES; i ++)
+    {
+        while (lwrb_get_free(&can.rb_recv) < sizeof(elab_can_msg_t))
+        {
+            osDelay(1);
+        }
+        ut_can_recv(i, false);
+    }
+}
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,285 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../edf/driver/simulator/simu_can.h"
+#include "../../edf/normal/elab_can.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_SIMU_CAN_BUS                             "ut_can_bus"
+#define UT_SIMU_CAN_NODE_NUM                        (5)
+#define UT_SIMU_CAN_BITRATE                         (500000)
+#define UT_SIMU_CAN_TIMES                           (200)
+
+/* Private function prototypes -----------------------------------------------*/
+static void ut_msg_make(elab_can_msg_t *msg, uint32_t id, bool ide, bool rtr,
+                        uint8_t length);
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const ut_node_name[UT_SIMU_CAN_NODE_NUM] =
+{
+    "ut_can_0", "ut_can_1", "ut_can_2", "ut_can_3", "ut_can_4",
+};
+
+static elab_device_t *ut_node[UT_SIMU_CAN_NODE_NUM];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of the simulated CAN bus.
+  */
+TEST_GROUP(simu_can);
+
+/**
+  * @brief  Define test fixture setup function of the simulated CAN bus.
+  */
+TEST_SETUP(simu_can)
+{
+    simu_can_bus_new(UT_SIMU_CAN_BUS, UT_SIMU_CAN_BITRATE);
+    for (uint32_t i = 0; i < UT_SIMU_CAN_NODE_NUM; i ++)
+    {
+        simu_can_new(ut_node_name[i], UT_SIMU_CAN_BUS);
+        ut_node[i] = elab_device_find(ut_node_name[i]);
+        TEST_ASSERT_NOT_NULL(ut_node[i]);
+        TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_device_open(ut_node[i]));
+    }
+}
+
+/**
+  * @brief  Define test fixture tear down function of the simulated CAN bus.
+  */
+TEST_TEAR_DOWN(simu_can)
+{
+    for (uint32_t i = 0; i < UT_SIMU_CAN_NODE_NUM; i ++)
+    {
+        elab_device_close(ut_node[i]);
+        simu_can_destroy(ut_node_name[i]);
+    }
+    simu_can_bus_destroy(UT_SIMU_CAN_BUS);
+}
+
+/**
+  * @brief  The frame takes the time of its bits with the stuff bits.
+  */
+TEST(simu_can, frame_time)
+{
+    elab_can_msg_t msg;
+    simu_can_bus_stat_t stat;
+
+    /* No data: 47 bits and at most 8 stuff bits. */
+    ut_msg_make(&msg, 0x123, false, false, 0);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[0], &msg));
+    TEST_ASSERT_EQUAL_INT32(1, elab_can_recv_n(ut_node[4], &msg, 1, 100));
+    TEST_ASSERT_EQUAL_UINT32(0x123, msg.id);
+    simu_can_bus_stat(UT_SIMU_CAN_BUS, &stat);
+    TEST_ASSERT_EQUAL_UINT32(1, stat.frames);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(47, (uint32_t)stat.bits);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(47 + 8, (uint32_t)stat.bits);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)stat.bits * 2, (uint32_t)stat.time_busy_us);
+
+    /* 8 bytes of 0: 111 bits, and the stuff bits in the long runs of 0. */
+    simu_can_bus_stat_reset(UT_SIMU_CAN_BUS);
+    ut_msg_make(&msg, 0x123, false, false, 8);
+    memset(msg.data, 0, 8);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[0], &msg));
+    TEST_ASSERT_EQUAL_INT32(1, elab_can_recv_n(ut_node[4], &msg, 1, 100));
+    simu_can_bus_stat(UT_SIMU_CAN_BUS, &stat);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(111 + 64 / 5, (uint32_t)stat.bits);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(111 + 24, (uint32_t)stat.bits);
+}
+
+/**
+  * @brief  The contending frames are sent in the order of the arbitration,
+  *         and the frames of one node in its own order.
+  */
+TEST(simu_can, arbitration)
+{
+    elab_can_msg_t msg[8];
+    simu_can_bus_stat_t stat;
+    simu_can_node_stat_t stat_node;
+
+    simu_can_bus_hold(UT_SIMU_CAN_BUS, true);
+    ut_msg_make(&msg[0], 0x300, false, false, 2);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[0], &msg[0]));
+    ut_msg_make(&msg[0], 0x050, false, false, 2);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[0], &msg[0]));
+    ut_msg_make(&msg[0], 0x100, false, true, 2);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[1], &msg[0]));
+    ut_msg_make(&msg[0], (0x100 << 18) | 5, true, false, 2);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[2], &msg[0]));
+    ut_msg_make(&msg[0], 0x100, false, false, 2);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[3], &msg[0]));
+    osDelay(20);
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT, elab_can_recv_n(ut_node[4], msg, 8, 0));
+    simu_can_bus_hold(UT_SIMU_CAN_BUS, false);
+
+    uint32_t count = 0;
+    while (count < 5)
+    {
+        int32_t ret = elab_can_recv_n(ut_node[4], &msg[count], 8 - count, 100);
+        TEST_ASSERT_GREATER_THAN_INT32(0, ret);
+        count += ret;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0x100, msg[0].id);
+    TEST_ASSERT_EQUAL_UINT32(0, msg[0].rtr);
+    TEST_ASSERT_EQUAL_UINT32(0x100, msg[1].id);
+    TEST_ASSERT_EQUAL_UINT32(1, msg[1].rtr);
+    TEST_ASSERT_EQUAL_UINT32((0x100 << 18) | 5, msg[2].id);
+    TEST_ASSERT_EQUAL_UINT32(1, msg[2].ide);
+    TEST_ASSERT_EQUAL_UINT32(0x300, msg[3].id);
+    TEST_ASSERT_EQUAL_UINT32(0x050, msg[4].id);
+
+    simu_can_bus_stat(UT_SIMU_CAN_BUS, &stat);
+    TEST_ASSERT_EQUAL_UINT32(5, stat.frames);
+    TEST_ASSERT_EQUAL_UINT32(3 + 2 + 1, stat.arbitration_lost);
+    simu_can_stat(ut_node_name[0], &stat_node);
+    TEST_ASSERT_EQUAL_UINT32(2, stat_node.sent);
+    TEST_ASSERT_EQUAL_UINT32(3, stat_node.arbitration_lost);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(stat_node.latency_total_us / 2,
+                                        stat_node.latency_max_us);
+}
+
+/**
+  * @brief  The broken frames are sent again.
+  */
+TEST(simu_can, error_inject)
+{
+    elab_can_msg_t msg[2];
+    simu_can_bus_stat_t stat;
+    simu_can_node_stat_t stat_node;
+
+    simu_can_bus_error_inject(UT_SIMU_CAN_BUS, 2);
+    ut_msg_make(&msg[0], 0x200, false, false, 8);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(ut_node[0], &msg[0]));
+    TEST_ASSERT_EQUAL_INT32(1, elab_can_recv_n(ut_node[4], msg, 2, 100));
+    TEST_ASSERT_EQUAL_UINT32(0x200, msg[0].id);
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT, elab_can_recv_n(ut_node[4], msg, 2, 20));
+
+    simu_can_bus_stat(UT_SIMU_CAN_BUS, &stat);
+    TEST_ASSERT_EQUAL_UINT32(1, stat.frames);
+    TEST_ASSERT_EQUAL_UINT32(2, stat.errors);
+    simu_can_stat(ut_node_name[0], &stat_node);
+    TEST_ASSERT_EQUAL_UINT32(1, stat_node.sent);
+    TEST_ASSERT_EQUAL_UINT32(2, stat_node.errors);
+}
+
+/**
+  * @brief  The frames are sent in the real time of the bit rate, and the bus
+  *         is fully loaded by one sender.
+  */
+TEST(simu_can, bus_load)
+{
+    elab_can_msg_t msg;
+    elab_can_msg_t msg_recv[64];
+    simu_can_bus_stat_t stat;
+
+    simu_can_bus_stat_reset(UT_SIMU_CAN_BUS);
+    uint32_t time_start = osKernelGetTickCount();
+    uint32_t count_sent = 0;
+    uint32_t count_recv = 0;
+    while (count_recv < UT_SIMU_CAN_TIMES)
+    {
+        while (count_sent < UT_SIMU_CAN_TIMES)
+        {
+            ut_msg_make(&msg, count_sent, false, false, 8);
+            if (elab_can_send(ut_node[0], &msg) != ELAB_OK)
+            {
+                break;
+            }
+            count_sent ++;
+        }
+        int32_t ret = elab_can_recv_n(ut_node[4], msg_recv, 64, 100);
+        TEST_ASSERT_GREATER_THAN_INT32(0, ret);
+        for (int32_t i = 0; i < ret; i ++)
+        {
+            TEST_ASSERT_EQUAL_UINT32(count_recv, msg_recv[i].id);
+            count_recv ++;
+        }
+    }
+    uint32_t time = osKernelGetTickCount() - time_start;
+
+    simu_can_bus_stat(UT_SIMU_CAN_BUS, &stat);
+    TEST_ASSERT_EQUAL_UINT32(UT_SIMU_CAN_TIMES, stat.frames);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32((uint32_t)(stat.time_busy_us / 1000) - 2, time);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(8000, stat.load);
+}
+
+/**
+  * @brief  The bus is not locked while the frame is on it, so its statistics
+  *         are got at once even on a slow bus.
+  */
+TEST(simu_can, slow_bus)
+{
+    elab_can_msg_t msg;
+    simu_can_bus_stat_t stat;
+    simu_can_node_stat_t stat_node;
+
+    simu_can_bus_new("ut_can_bus_slow", 10000);
+    simu_can_new("ut_can_slow_0", "ut_can_bus_slow");
+    simu_can_new("ut_can_slow_1", "ut_can_bus_slow");
+    elab_device_t *dev_send = elab_device_find("ut_can_slow_0");
+    elab_device_t *dev_recv = elab_device_find("ut_can_slow_1");
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_device_open(dev_send));
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_device_open(dev_recv));
+
+    /* Over 11 ms for the frame of 8 bytes. */
+    ut_msg_make(&msg, 0x123, false, false, 8);
+    TEST_ASSERT_EQUAL_INT(ELAB_OK, elab_can_send(dev_send, &msg));
+    osDelay(2);
+    uint32_t time_start = osKernelGetTickCount();
+    simu_can_bus_stat("ut_can_bus_slow", &stat);
+    simu_can_stat("ut_can_slow_0", &stat_node);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, osKernelGetTickCount() - time_start);
+    TEST_ASSERT_EQUAL_UINT32(0, stat.frames);
+
+    TEST_ASSERT_EQUAL_INT32(1, elab_can_recv_n(dev_recv, &msg, 1, 100));
+    simu_can_bus_stat("ut_can_bus_slow", &stat);
+    TEST_ASSERT_EQUAL_UINT32(1, stat.frames);
+
+    elab_device_close(dev_send);
+    elab_device_close(dev_recv);
+    simu_can_destroy("ut_can_slow_0");
+    simu_can_destroy("ut_can_slow_1");
+    simu_can_bus_destroy("ut_can_bus_slow");
+}
+
+/**
+  * @brief  Define run test cases of the simulated CAN bus.
+  */
+TEST_GROUP_RUNNER(simu_can)
+{
+    RUN_TEST_CASE(simu_can, frame_time);
+    RUN_TEST_CASE(simu_can, arbitration);
+    RUN_TEST_CASE(simu_can, error_inject);
+    RUN_TEST_CASE(simu_can, bus_load);
+    RUN_TEST_CASE(simu_can, slow_bus);
+}
+
+/* Private functions ---------------------------------------------------------*/
+static void ut_msg_make(elab_can_msg_t *msg, uint32_t id, bool ide, bool rtr,
+                        uint8_t length)
+{
+    memset(msg, 0, sizeof(elab_can_msg_t));
+    msg->id = id;
+    msg->ide = ide ? 1 : 0;
+    msg->rtr = rtr ? 1 : 0;
+    msg->length = length;
+    for (uint32_t i = 0; i < length; i ++)
+    {
+        msg->data[i] = (uint8_t)(id + i);
+    }
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -22,6 +22,7 @@
 #define UT_DEVICE_BUFF_SIZE                         (256)
 #define UT_HEAP_SIZE                                (1024 * 10)
 #define UT_OPEN_TIMES_MAX                           (250)
+#define UT_DEVICE_NUM_MANY                          (ELAB_DEV_NUM_MAX * 8)
 
 #define UT_STR_READ                                 "dev_read_data"
 #define UT_STR_WRITE                                "dev_write_data"
@@ -142,6 +143,70 @@ TEST(edf_core, register_unregister)
     }
 }
 
+/**
+  * @brief  Register more devices than ELAB_DEV_NUM_MAX, and find them by name.
+  */
+TEST(edf_core, register_find_many)
+{
+    uint32_t count_num_init = elab_device_get_number();
+    elab_device_t *dev = elab_malloc(sizeof(elab_device_t) * UT_DEVICE_NUM_MANY);
+    TEST_ASSERT_NOT_NULL(dev);
+    char (*dev_name)[16] = elab_malloc(16 * UT_DEVICE_NUM_MANY);
+    TEST_ASSERT_NOT_NULL(dev_name);
+    elab_device_attr_t attr =
+    {
+        .sole = true,
+        .type = ELAB_DEVICE_UNKNOWN,
+        .name = NULL,
+    };
+
+    /* Register */
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i ++)
+    {
+        sprintf(dev_name[i], "dev_many_%u", i);
+        attr.name = dev_name[i];
+        elab_device_register(&dev[i], &attr);
+    }
+    TEST_ASSERT_EQUAL_UINT32((UT_DEVICE_NUM_MANY + count_num_init),
+                                elab_device_get_number());
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&dev[i], elab_device_find(dev_name[i]));
+    }
+    TEST_ASSERT_NULL(elab_device_find("dev_many_none"));
+
+    /* Unregister the even ones, and register them again. */
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i += 2)
+    {
+        elab_device_unregister(&dev[i]);
+    }
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(((i % 2) == 0) ? NULL : &dev[i],
+                                elab_device_find(dev_name[i]));
+    }
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i += 2)
+    {
+        attr.name = dev_name[i];
+        elab_device_register(&dev[i], &attr);
+    }
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&dev[i], elab_device_find(dev_name[i]));
+    }
+
+    /* Unregister */
+    for (uint32_t i = 0; i < UT_DEVICE_NUM_MANY; i ++)
+    {
+        elab_device_unregister(&dev[i]);
+        TEST_ASSERT_NULL(elab_device_find(dev_name[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
+
+    elab_free(dev_name);
+    elab_free(dev);
+}
+
 /**
   * @brief  Open & close functions for standalone device.
   */
@@ -410,6 +475,7 @@ TEST(edf_core, write_test_mode)
 TEST_GROUP_RUNNER(edf_core)
 {
     RUN_TEST_CASE(edf_core, register_unregister);
+    RUN_TEST_CASE(edf_core, register_find_many);
     RUN_TEST_CASE(edf_core, open_close_standalone);
     RUN_TEST_CASE(edf_core, open_close_non_standalone);
     RUN_TEST_CASE(edf_core, read_non_test_mode);
@@ -40,6 +40,14 @@ static int32_t ops_write(elab_serial_t *serial,
                             const void *pbuf, uint32_t size);
 static int32_t ops_write_to_self(elab_serial_t *serial,
                                     const void *pbuf, uint32_t size);
+static int32_t ops_write_append(elab_serial_t *serial,
+                                    const void *pbuf, uint32_t size);
+static int32_t ops_writev(elab_serial_t *serial,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt);
+static int32_t ops_writev_slow(elab_serial_t *serial,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt);
+static void cb_write_async(elab_device_t *me, int32_t result, void *para);
+static void cb_write_async_result(elab_device_t *me, int32_t result, void *para);
 static elab_err_t ops_config(elab_serial_t *serial, elab_serial_config_t *pcfg);
 static void ops_set_tx(elab_serial_t *serial, bool status);
 static void thread_func_read(void *paras);
@@ -72,6 +80,41 @@ static elab_serial_ops_t serial_ops_send_self =
     .set_tx = ops_set_tx,
 };
 
+static elab_serial_ops_t serial_ops_append =
+{
+    .enable = ops_enable,
+#if defined(__linux__) || defined(_WIN32)
+    .read = ops_read,
+#endif
+    .write = ops_write_append,
+    .config = ops_config,
+    .set_tx = ops_set_tx,
+};
+
+static elab_serial_ops_t serial_ops_writev =
+{
+    .enable = ops_enable,
+#if defined(__linux__) || defined(_WIN32)
+    .read = ops_read,
+#endif
+    .write = ops_write_append,
+    .writev = ops_writev,
+    .config = ops_config,
+    .set_tx = ops_set_tx,
+};
+
+static elab_serial_ops_t serial_ops_writev_slow =
+{
+    .enable = ops_enable,
+#if defined(__linux__) || defined(_WIN32)
+    .read = ops_read,
+#endif
+    .write = ops_write_append,
+    .writev = ops_writev_slow,
+    .config = ops_config,
+    .set_tx = ops_set_tx,
+};
+
 static const osThreadAttr_t thread_attr_dev_test = 
 {
     .name = "ThreadTestSerial",
@@ -95,6 +138,9 @@ static uint8_t buff_wr[UT_DEVICE_BUFF_SIZE];
 static uint32_t count_rd = 0;
 static uint32_t count_wr = 0;
 static uint32_t count_set_tx = 0;
+static uint32_t count_writev = 0;
+static uint32_t count_write_append = 0;
+static int32_t ret_write_async = 0;
 static int32_t count_open = 0;
 static int32_t ret_read_test = 0;
 static int32_t ret_write_test = 0;
@@ -104,6 +150,7 @@ static bool serial_set_tx = false;
 static osSemaphoreId_t sem_test_mode_enter = NULL;
 static osSemaphoreId_t sem_test_mode_exit = NULL;
 static osSemaphoreId_t sem_send_self = NULL;
+static osSemaphoreId_t sem_write_async = NULL;
 static elab_serial_attr_t config_set;
 static osMessageQueueId_t mq_read = NULL;
 static osThreadId_t thread_send_self = NULL;
@@ -433,6 +480,100 @@ TEST(dev_serial, read_non_test_mode)
     TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
 }
 
+/**
+  * @brief  Read functions in non-test mode, with the rx stream buffer.
+  */
+TEST(dev_serial, read_stream_mode)
+{
+    int32_t ret = 0;
+    uint32_t count = 0;
+    elab_serial_t *serial = NULL;
+    elab_device_t *dev = NULL;
+    elab_serial_attr_t config = (elab_serial_attr_t)ELAB_SERIAL_ATTR_DEFAULT;
+    uint32_t count_num_init = elab_device_get_number();
+    uint32_t time_start = 0;
+
+    serial = elab_malloc(sizeof(elab_serial_t));
+    TEST_ASSERT_NOT_NULL(serial);
+
+    /* Register non-RS485 mode serial device in rx stream mode. */
+    config.mode = ELAB_SERIAL_MODE_FULL_DUPLEX;
+    config.rx_mode = ELAB_SERIAL_RX_MODE_STREAM;
+    elab_serial_register(serial, UT_SERIAL_NAME, &serial_ops, &config, NULL);
+    dev = elab_device_find(UT_SERIAL_NAME);
+    TEST_ASSERT_NOT_NULL(dev);
+    TEST_ASSERT_EQUAL_PTR(serial, dev);
+
+    elab_device_open(dev);
+
+    /* Read the whole data, using platform device read interface. */
+    for (uint32_t i = 0; i < 100; i ++)
+    {
+        memset(buff_rd, 0, UT_DEVICE_BUFF_SIZE);
+#if !defined(__linux__) && !defined(_WIN32)
+        elab_serial_isr_rx(ELAB_SERIAL_CAST(dev), UT_STR_READ, strlen(UT_STR_READ));
+#else
+        make_data_for_reading();
+#endif
+        ret = elab_device_read(dev, 0, buff_rd, strlen(UT_STR_READ));
+        TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_READ), ret);
+        TEST_ASSERT_EQUAL_MEMORY(UT_STR_READ, buff_rd, ret);
+    }
+
+    /* Read the whole data, using serial device read interface. */
+    for (uint32_t i = 0; i < 100; i ++)
+    {
+        memset(buff_rd, 0, UT_DEVICE_BUFF_SIZE);
+#if !defined(__linux__) && !defined(_WIN32)
+        elab_serial_isr_rx(ELAB_SERIAL_CAST(dev), UT_STR_READ, strlen(UT_STR_READ));
+#else
+        make_data_for_reading();
+#endif
+        ret = elab_serial_read(dev, buff_rd, strlen(UT_STR_READ), 10);
+        TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_READ), ret);
+        TEST_ASSERT_EQUAL_MEMORY(UT_STR_READ, buff_rd, ret);
+    }
+
+    /* Read the data in chunks, using serial device chunk read interface. */
+    for (uint32_t i = 0; i < 100; i ++)
+    {
+        memset(buff_rd, 0, UT_DEVICE_BUFF_SIZE);
+#if !defined(__linux__) && !defined(_WIN32)
+        elab_serial_isr_rx(ELAB_SERIAL_CAST(dev), UT_STR_READ, strlen(UT_STR_READ));
+#else
+        make_data_for_reading();
+#endif
+        count = 0;
+        while (count < strlen(UT_STR_READ))
+        {
+            ret = elab_serial_read_chunk(dev, &buff_rd[count],
+                                            (UT_DEVICE_BUFF_SIZE - count), 10);
+            TEST_ASSERT_GREATER_THAN_INT32(0, ret);
+            count += ret;
+        }
+        TEST_ASSERT_EQUAL_UINT32(strlen(UT_STR_READ), count);
+        TEST_ASSERT_EQUAL_MEMORY(UT_STR_READ, buff_rd, count);
+    }
+
+    /* Timeout when no data is received. */
+    for (uint32_t i = 0; i < 10; i ++)
+    {
+        time_start = osKernelGetTickCount();
+        ret = elab_serial_read_chunk(dev, buff_rd, UT_DEVICE_BUFF_SIZE, 10);
+        TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT, ret);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32((time_start + 10),
+                                                osKernelGetTickCount());
+    }
+    elab_device_close(dev);
+
+    elab_serial_unregister(ELAB_SERIAL_CAST(dev));
+    dev = elab_device_find(UT_SERIAL_NAME);
+    TEST_ASSERT_NULL(dev);
+    elab_free(serial);
+
+    TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
+}
+
 /**
   * @brief  Write function in non-test mode.
   */
@@ -542,6 +683,204 @@ TEST(dev_serial, write_non_test_mode_rs485)
     TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
 }
 
+/**
+  * @brief  Serial device scatter/gather writing in non-test mode, with and
+  *         without the driver writev function.
+  */
+TEST(dev_serial, writev_non_test_mode)
+{
+    int32_t ret = 0;
+    elab_serial_t *serial = NULL;
+    elab_device_t *dev = NULL;
+    uint32_t count_num_init = elab_device_get_number();
+    elab_serial_ops_t *ops[2] = { &serial_ops_append, &serial_ops_writev, };
+    const char *str_head = "head_";
+    const char *str_body = "body_";
+    const char *str_tail = "tail";
+    elab_serial_iovec_t iov[4] =
+    {
+        { .buff = str_head, .size = strlen(str_head), },
+        { .buff = NULL, .size = 0, },
+        { .buff = str_body, .size = strlen(str_body), },
+        { .buff = str_tail, .size = strlen(str_tail), },
+    };
+
+    serial = elab_malloc(sizeof(elab_serial_t));
+    TEST_ASSERT_NOT_NULL(serial);
+
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        elab_serial_register(serial, UT_SERIAL_NAME, ops[i], NULL, NULL);
+        dev = elab_device_find(UT_SERIAL_NAME);
+        TEST_ASSERT_NOT_NULL(dev);
+        elab_device_open(dev);
+
+        for (uint32_t j = 0; j < 100; j ++)
+        {
+            memset(buff_wr, 0, UT_DEVICE_BUFF_SIZE);
+            count_wr = 0;
+            count_writev = 0;
+            count_write_append = 0;
+            ret = elab_serial_writev(dev, iov, 4);
+            TEST_ASSERT_EQUAL_INT32(strlen("head_body_tail"), ret);
+            TEST_ASSERT_EQUAL_UINT32(strlen("head_body_tail"), count_wr);
+            TEST_ASSERT_EQUAL_MEMORY("head_body_tail", buff_wr, count_wr);
+            TEST_ASSERT_EQUAL_UINT32((i == 0) ? 0 : 1, count_writev);
+            /* Merged into one driver writing without the writev function. */
+            TEST_ASSERT_EQUAL_UINT32((i == 0) ? 1 : 0, count_write_append);
+
+            /* The single buffer writing goes the same way. */
+            memset(buff_wr, 0, UT_DEVICE_BUFF_SIZE);
+            count_wr = 0;
+            ret = elab_serial_write(dev, UT_STR_WRITE, strlen(UT_STR_WRITE));
+            TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_WRITE), ret);
+            TEST_ASSERT_EQUAL_MEMORY(UT_STR_WRITE, buff_wr, ret);
+        }
+
+        elab_device_close(dev);
+        elab_serial_unregister(serial);
+        TEST_ASSERT_NULL(elab_device_find(UT_SERIAL_NAME));
+    }
+
+    elab_free(serial);
+    TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
+}
+
+/**
+  * @brief  Serial device asynchronous writing in non-test mode.
+  */
+TEST(dev_serial, write_async_non_test_mode)
+{
+    elab_err_t ret = ELAB_OK;
+    osStatus_t ret_os = osOK;
+    elab_serial_t *serial = NULL;
+    elab_device_t *dev = NULL;
+    uint32_t count_num_init = elab_device_get_number();
+    uint8_t crc[2] = { 0x12, 0x34 };
+    elab_serial_iovec_t iov[2] =
+    {
+        { .buff = UT_STR_WRITE, .size = strlen(UT_STR_WRITE), },
+        { .buff = crc, .size = 2, },
+    };
+
+    sem_write_async = osSemaphoreNew(3, 0, NULL);
+    TEST_ASSERT_NOT_NULL(sem_write_async);
+    serial = elab_malloc(sizeof(elab_serial_t));
+    TEST_ASSERT_NOT_NULL(serial);
+
+    elab_serial_register(serial, UT_SERIAL_NAME, &serial_ops_writev, NULL, NULL);
+    dev = elab_device_find(UT_SERIAL_NAME);
+    TEST_ASSERT_NOT_NULL(dev);
+    elab_device_open(dev);
+
+    memset(buff_wr, 0, UT_DEVICE_BUFF_SIZE);
+    count_wr = 0;
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        ret = elab_serial_write_async(dev, iov, 2, cb_write_async, dev);
+        TEST_ASSERT_EQUAL_INT32(ELAB_OK, ret);
+    }
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        ret_os = osSemaphoreAcquire(sem_write_async, 1000);
+        TEST_ASSERT_EQUAL_INT32(osOK, ret_os);
+        TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_WRITE) + 2, ret_write_async);
+    }
+    TEST_ASSERT_EQUAL_UINT32((strlen(UT_STR_WRITE) + 2) * 3, count_wr);
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        uint8_t *frame = &buff_wr[(strlen(UT_STR_WRITE) + 2) * i];
+        TEST_ASSERT_EQUAL_MEMORY(UT_STR_WRITE, frame, strlen(UT_STR_WRITE));
+        TEST_ASSERT_EQUAL_MEMORY(crc, &frame[strlen(UT_STR_WRITE)], 2);
+    }
+
+    elab_device_close(dev);
+    elab_serial_unregister(serial);
+    TEST_ASSERT_NULL(elab_device_find(UT_SERIAL_NAME));
+    elab_free(serial);
+    osSemaphoreDelete(sem_write_async);
+    sem_write_async = NULL;
+
+    TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
+}
+
+/**
+  * @brief  Serial device closed with asynchronous writing requests queued, and
+  *         unregistered with the tx thread running.
+  */
+TEST(dev_serial, write_async_close)
+{
+    elab_err_t ret = ELAB_OK;
+    osStatus_t ret_os = osOK;
+    elab_serial_t *serial = NULL;
+    elab_device_t *dev = NULL;
+    uint32_t count_num_init = elab_device_get_number();
+    uint32_t count_ok = 0;
+    int32_t result[4];
+    elab_serial_iovec_t iov[2] =
+    {
+        { .buff = UT_STR_WRITE, .size = strlen(UT_STR_WRITE), },
+        { .buff = "\r\n", .size = 2, },
+    };
+
+    sem_write_async = osSemaphoreNew(4, 0, NULL);
+    TEST_ASSERT_NOT_NULL(sem_write_async);
+    serial = elab_malloc(sizeof(elab_serial_t));
+    TEST_ASSERT_NOT_NULL(serial);
+
+    elab_serial_register(serial, UT_SERIAL_NAME, &serial_ops_writev_slow,
+                            NULL, NULL);
+    dev = elab_device_find(UT_SERIAL_NAME);
+    TEST_ASSERT_NOT_NULL(dev);
+    elab_device_open(dev);
+
+    memset(buff_wr, 0, UT_DEVICE_BUFF_SIZE);
+    count_wr = 0;
+    for (uint32_t i = 0; i < 4; i ++)
+    {
+        ret = elab_serial_write_async(dev, iov, 2,
+                                        cb_write_async_result, &result[i]);
+        TEST_ASSERT_EQUAL_INT32(ELAB_OK, ret);
+    }
+    elab_device_close(dev);
+
+    /* At most the request being sent is completed, and the others fail. */
+    for (uint32_t i = 0; i < 4; i ++)
+    {
+        ret_os = osSemaphoreAcquire(sem_write_async, 1000);
+        TEST_ASSERT_EQUAL_INT32(osOK, ret_os);
+    }
+    for (uint32_t i = 0; i < 4; i ++)
+    {
+        if (result[i] != ELAB_ERROR)
+        {
+            TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_WRITE) + 2, result[i]);
+            count_ok ++;
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, count_ok);
+    TEST_ASSERT_EQUAL_UINT32((strlen(UT_STR_WRITE) + 2) * count_ok, count_wr);
+
+    /* Nothing left is sent after opened again. */
+    elab_device_open(dev);
+    osDelay(50);
+    TEST_ASSERT_EQUAL_UINT32((strlen(UT_STR_WRITE) + 2) * count_ok, count_wr);
+    ret = elab_serial_write_async(dev, iov, 2, cb_write_async_result, &result[0]);
+    TEST_ASSERT_EQUAL_INT32(ELAB_OK, ret);
+    ret_os = osSemaphoreAcquire(sem_write_async, 1000);
+    TEST_ASSERT_EQUAL_INT32(osOK, ret_os);
+    TEST_ASSERT_EQUAL_INT32(strlen(UT_STR_WRITE) + 2, result[0]);
+
+    elab_device_close(dev);
+    elab_serial_unregister(serial);
+    TEST_ASSERT_NULL(elab_device_find(UT_SERIAL_NAME));
+    elab_free(serial);
+    osSemaphoreDelete(sem_write_async);
+    sem_write_async = NULL;
+
+    TEST_ASSERT_EQUAL_UINT32(count_num_init, elab_device_get_number());
+}
+
 /**
   * @brief  Write function in non-test mode.
   */
@@ -961,8 +1300,12 @@ TEST_GROUP_RUNNER(dev_serial)
     RUN_TEST_CASE(dev_serial, open_close_rs485);
     RUN_TEST_CASE(dev_serial, open_close_non_rs485);
     RUN_TEST_CASE(dev_serial, read_non_test_mode);
+    RUN_TEST_CASE(dev_serial, read_stream_mode);
     RUN_TEST_CASE(dev_serial, write_non_test_mode_non_rs485);
     RUN_TEST_CASE(dev_serial, write_non_test_mode_rs485);
+    RUN_TEST_CASE(dev_serial, writev_non_test_mode);
+    RUN_TEST_CASE(dev_serial, write_async_non_test_mode);
+    RUN_TEST_CASE(dev_serial, write_async_close);
     RUN_TEST_CASE(dev_serial, xfer_non_test_mode);
     RUN_TEST_CASE(dev_serial, send_to_self_non_test_mode);
     RUN_TEST_CASE(dev_serial, set_config_non_test_mode);
@@ -1042,6 +1385,77 @@ static int32_t ops_write_to_self(elab_serial_t *serial,
     return size;
 }
 
+/**
+  * @brief  Simulated driver writting function appending data to the buffer.
+  */
+static int32_t ops_write_append(elab_serial_t *serial,
+                                    const void *pbuf, uint32_t size)
+{
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(UT_DEVICE_BUFF_SIZE, (count_wr + size));
+
+    memcpy(&buff_wr[count_wr], pbuf, size);
+    count_wr += size;
+    count_write_append ++;
+    elab_serial_tx_end(serial);
+
+    return size;
+}
+
+/**
+  * @brief  Simulated driver scatter/gather writting function.
+  */
+static int32_t ops_writev(elab_serial_t *serial,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt)
+{
+    uint32_t size = 0;
+
+    count_writev ++;
+    for (uint32_t i = 0; i < iovcnt; i ++)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(UT_DEVICE_BUFF_SIZE,
+                                            (count_wr + iov[i].size));
+        memcpy(&buff_wr[count_wr], iov[i].buff, iov[i].size);
+        count_wr += iov[i].size;
+        size += iov[i].size;
+    }
+    elab_serial_tx_end(serial);
+
+    return size;
+}
+
+/**
+  * @brief  Simulated driver scatter/gather writting function, taking a while.
+  */
+static int32_t ops_writev_slow(elab_serial_t *serial,
+                            const elab_serial_iovec_t *iov, uint32_t iovcnt)
+{
+    osDelay(20);
+
+    return ops_writev(serial, iov, iovcnt);
+}
+
+/**
+  * @brief  Asynchronous writing completion callback for serial testing.
+  */
+static void cb_write_async(elab_device_t *me, int32_t result, void *para)
+{
+    TEST_ASSERT_EQUAL_PTR(para, me);
+
+    ret_write_async = result;
+    osSemaphoreRelease(sem_write_async);
+}
+
+/**
+  * @brief  Asynchronous writing completion callback saving the result.
+  */
+static void cb_write_async_result(elab_device_t *me, int32_t result, void *para)
+{
+    (void)me;
+
+    *(int32_t *)para = result;
+    osSemaphoreRelease(sem_write_async);
+}
+
 /**
   * @brief  Simulated driver config function for serial device testing.
   */
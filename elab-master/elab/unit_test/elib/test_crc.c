@@ -0,0 +1,137 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../elib/elib_crc.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_crc"
+#include "../../common/elab_log.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_CRC_BUFF_SIZE                            (300)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _crc16_modbus_bitwise(const uint8_t *data, uint32_t size);
+
+/* Private variables ---------------------------------------------------------*/
+static const char *ut_crc_check = "123456789";
+static uint8_t *ut_crc_buff = NULL;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of CRC.
+  */
+TEST_GROUP(crc);
+
+/**
+  * @brief  Define test fixture setup function of CRC.
+  */
+TEST_SETUP(crc)
+{
+    ut_crc_buff = elab_malloc(UT_CRC_BUFF_SIZE);
+    TEST_ASSERT_NOT_NULL(ut_crc_buff);
+    for (uint32_t i = 0; i < UT_CRC_BUFF_SIZE; i ++)
+    {
+        ut_crc_buff[i] = (uint8_t)rand();
+    }
+}
+
+/**
+  * @brief  Define test fixture tear down function of CRC.
+  */
+TEST_TEAR_DOWN(crc)
+{
+    elab_free(ut_crc_buff);
+    ut_crc_buff = NULL;
+}
+
+/**
+  * @brief  The check values of the standard CRC catalogue.
+  */
+TEST(crc, check_value)
+{
+    uint32_t len = strlen(ut_crc_check);
+
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926,
+                            elib_crc32(0, (void *)ut_crc_check, len));
+    TEST_ASSERT_EQUAL_HEX16(0x4B37,
+            elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, ut_crc_check, len));
+}
+
+/**
+  * @brief  CRC16/MODBUS in all lengths, in one piece, in pieces and byte by
+  *         byte, are all the same with the bitwise one.
+  */
+TEST(crc, crc16_modbus)
+{
+    for (uint32_t size = 0; size <= UT_CRC_BUFF_SIZE; size ++)
+    {
+        uint16_t crc_ref = _crc16_modbus_bitwise(ut_crc_buff, size);
+        TEST_ASSERT_EQUAL_HEX16(crc_ref,
+            elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, ut_crc_buff, size));
+
+        uint32_t size_first = size / 3;
+        uint16_t crc = elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT,
+                                            ut_crc_buff, size_first);
+        crc = elib_crc16_modbus(crc, &ut_crc_buff[size_first], size - size_first);
+        TEST_ASSERT_EQUAL_HEX16(crc_ref, crc);
+
+        crc = ELIB_CRC16_MODBUS_INIT;
+        for (uint32_t i = 0; i < size; i ++)
+        {
+            crc = elib_crc16_modbus_byte(crc, ut_crc_buff[i]);
+        }
+        TEST_ASSERT_EQUAL_HEX16(crc_ref, crc);
+    }
+
+    /* The CRC of the frame with its CRC appended, low byte first, is zero. */
+    uint16_t crc = elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, ut_crc_buff, 16);
+    ut_crc_buff[16] = (uint8_t)(crc & 0xFF);
+    ut_crc_buff[17] = (uint8_t)(crc >> 8);
+    TEST_ASSERT_EQUAL_HEX16(0,
+            elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, ut_crc_buff, 18));
+}
+
+/**
+  * @brief  Define run test cases of CRC.
+  */
+TEST_GROUP_RUNNER(crc)
+{
+    RUN_TEST_CASE(crc, check_value);
+    RUN_TEST_CASE(crc, crc16_modbus);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The reference CRC16/MODBUS calculated bit by bit.
+  */
+static uint16_t _crc16_modbus_bitwise(const uint8_t *data, uint32_t size)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (uint32_t i = 0; i < size; i ++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit ++)
+        {
+            crc = (crc & 0x0001) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
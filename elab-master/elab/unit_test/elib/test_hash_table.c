@@ -32,9 +32,8 @@
 
 /* Private function prototypes -----------------------------------------------*/
 static void _random_string_generate(char *string, uint32_t size);
-static uint16_t _get_max_prime(uint32_t size);
-static void _put_string_into_table(char *str);
-static elab_err_t _get_random_string_from_table(char *str);
+static char *_put_string_into_table(char *str);
+static int32_t _get_random_string_from_table(char *str);
 
 /* Private variables ---------------------------------------------------------*/
 static char *str_table[UT_HASH_TABLE_SIZE];
@@ -44,19 +43,6 @@ static hash_table_data_t *ht_data = NULL;
 static char *str_temp = NULL;
 static char *str_change = NULL;
 
-static const uint16_t prime_table[] = 
-{
-    2,3,5,7,11,13,17,19,23,29,31,37,41,43,47,53,59,61,67,71,73,79,83,89,97,101,
-    103,107,109,113,127,131,137,139,149,151,157,163,167,173,179,181,191,193,197,
-    199,211,223,227,229,233,239,241,251,257,263,269,271,277,281,283,293,307,311,
-    313,317,331,337,347,349,353,359,367,373,379,383,389,397,401,409,419,421,431,
-    433,439,443,449,457,461,463,467,479,487,491,499,503,509,521,523,541,547,557,
-    563,569,571,577,587,593,599,601,607,613,617,619,631,641,643,647,653,659,661,
-    673,677,683,691,701,709,719,727,733,739,743,751,757,761,769,773,787,797,809,
-    811,821,823,827,829,839,853,857,859,863,877,881,883,887,907,911,919,929,937,
-    941,947,953,967,971,977,983,991,997
-};
-
 /* Exported functions --------------------------------------------------------*/
 /**
   * @brief  Define test group of hash table
@@ -118,7 +104,8 @@ TEST(hash_table, init)
 
         hash_table_init(hash_table, ht_data, i);
         TEST_ASSERT_EQUAL_UINT32(i, hash_table->capacity);
-        TEST_ASSERT_EQUAL_UINT32(_get_max_prime(i), hash_table->prime_max);
+        TEST_ASSERT_EQUAL_UINT32(0, hash_table->count);
+        TEST_ASSERT_FALSE(hash_table->resizable);
 
         elab_free(ht_data);
     }
@@ -129,7 +116,8 @@ TEST(hash_table, init)
     {
         hash_table = hash_table_new(i);
         TEST_ASSERT_EQUAL_UINT32(i, hash_table->capacity);
-        TEST_ASSERT_EQUAL_UINT32(_get_max_prime(i), hash_table->prime_max);
+        TEST_ASSERT_EQUAL_UINT32(0, hash_table->count);
+        TEST_ASSERT_TRUE(hash_table->resizable);
         hash_table_destroy(hash_table);
     }
 }
@@ -156,21 +144,26 @@ TEST(hash_table, random_add_remove)
     {
         fill = ((rand() % 2) == 0) ? false : true;
 
-        /* Fill the data into the hash talbe. */
+        /* Fill the data into the hash talbe. The name is kept by the table,
+           so the copy in the string table is added. */
         if (fill && (count_fill < UT_HASH_TABLE_TEST_TIMES))
         {
             _random_string_generate(str_temp, UT_STRING_LENGTH);
             TEST_ASSERT_NULL(hash_table_get(ht, str_temp));
             TEST_ASSERT_FALSE(hash_table_existent(ht, str_temp));
-            if (hash_table_add(ht, str_temp, &payload[count_fill]) == ELAB_OK)
+            char *name = _put_string_into_table(str_temp);
+            if (name != NULL)
             {
+                TEST_ASSERT_EQUAL(ELAB_OK,
+                                    hash_table_add(ht, name, &payload[count_fill]));
 #if (UT_HASH_TABLE_PRINT_EN != 0)
                 printf("\033[0;32m" "     + %s.\n" " \033[0m", str_temp);
 #endif
-                _put_string_into_table(str_temp);
                 uint32_t *value = hash_table_get(ht, str_temp);
                 TEST_ASSERT_EQUAL_UINT32(payload[count_fill], value[0]);
                 TEST_ASSERT_TRUE(hash_table_existent(ht, str_temp));
+                TEST_ASSERT_EQUAL(ELAB_ERROR,
+                                    hash_table_add(ht, str_temp, &payload[0]));
                 count_fill ++;
 
                 memset(str_change, 0, UT_STRING_LENGTH);
@@ -186,8 +179,8 @@ TEST(hash_table, random_add_remove)
         /* Get the data from the hash talbe. */
         if (!fill && (count_remove < UT_HASH_TABLE_TEST_TIMES))
         {
-            ret = _get_random_string_from_table(str_temp);
-            if (ret == ELAB_OK)
+            int32_t index = _get_random_string_from_table(str_temp);
+            if (index >= 0)
             {
 #if (UT_HASH_TABLE_PRINT_EN != 0)
                 printf("\033[1;33m" "     - %s.\n" " \033[0m", str_temp);
@@ -199,6 +192,7 @@ TEST(hash_table, random_add_remove)
                 TEST_ASSERT(ret == ELAB_OK);
                 TEST_ASSERT_FALSE(hash_table_existent(ht, str_temp));
                 TEST_ASSERT_NULL(hash_table_get(ht, str_temp));
+                memset(str_table[index], 0, UT_STRING_LENGTH);
                 count_remove ++;
             }
         }
@@ -215,6 +209,60 @@ TEST(hash_table, random_add_remove)
     hash_table_destroy(ht);
 }
 
+/**
+  * @brief  The table from hash_table_new grows, and the static one is filled up
+  *         to its capacity.
+  */
+TEST(hash_table, capacity)
+{
+    static char names[UT_HASH_TABLE_TEST_TIMES][16];
+
+    hash_table_t *ht = hash_table_new(8);
+    for (uint32_t i = 0; i < UT_HASH_TABLE_TEST_TIMES; i ++)
+    {
+        sprintf(names[i], "name_%u", i);
+        payload[i] = i;
+        TEST_ASSERT_EQUAL(ELAB_OK, hash_table_add(ht, names[i], &payload[i]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(UT_HASH_TABLE_TEST_TIMES, ht->count);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(ht->capacity * 7 / 8, ht->count);
+    for (uint32_t i = 0; i < UT_HASH_TABLE_TEST_TIMES; i ++)
+    {
+        uint32_t *value = hash_table_get(ht, names[i]);
+        TEST_ASSERT_NOT_NULL(value);
+        TEST_ASSERT_EQUAL_UINT32(i, *value);
+        if ((i % 2) == 0)
+        {
+            TEST_ASSERT_EQUAL(ELAB_OK, hash_table_remove(ht, names[i]));
+        }
+    }
+    for (uint32_t i = 0; i < UT_HASH_TABLE_TEST_TIMES; i ++)
+    {
+        TEST_ASSERT_EQUAL((i % 2) != 0, hash_table_existent(ht, names[i]));
+    }
+    hash_table_destroy(ht);
+
+    hash_table_t ht_static;
+    hash_table_data_t data[16];
+    hash_table_init(&ht_static, data, 16);
+    for (uint32_t i = 0; i < 16; i ++)
+    {
+        TEST_ASSERT_EQUAL(ELAB_OK,
+                            hash_table_add(&ht_static, names[i], &payload[i]));
+    }
+    TEST_ASSERT_EQUAL(ELAB_ERR_FULL,
+                        hash_table_add(&ht_static, names[16], &payload[16]));
+    TEST_ASSERT_NULL(hash_table_get(&ht_static, names[16]));
+    for (uint32_t i = 0; i < 16; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&payload[i], hash_table_get(&ht_static, names[i]));
+    }
+    TEST_ASSERT_EQUAL(ELAB_OK, hash_table_remove(&ht_static, names[3]));
+    TEST_ASSERT_EQUAL(ELAB_OK,
+                        hash_table_add(&ht_static, names[16], &payload[16]));
+    TEST_ASSERT_EQUAL_PTR(&payload[16], hash_table_get(&ht_static, names[16]));
+}
+
 /**
   * @brief  Define run test cases of hash table
   */
@@ -222,35 +270,37 @@ TEST_GROUP_RUNNER(hash_table)
 {
     RUN_TEST_CASE(hash_table, init);
     RUN_TEST_CASE(hash_table, random_add_remove);
+    RUN_TEST_CASE(hash_table, capacity);
 }
 
 /* Private functions ---------------------------------------------------------*/
 /**
   * @brief  Put the string into string table.
   * @param  str     The input string.
-  * @retval none
+  * @retval The string copied, or NULL if the string table is full.
   */
-static void _put_string_into_table(char *str)
+static char *_put_string_into_table(char *str)
 {
     for (uint32_t i = 0; i < UT_HASH_TABLE_SIZE; i ++)
     {
         if (str_table[i][0] == 0)
         {
             strcpy(str_table[i], str);
-            break;
+            return str_table[i];
         }
     }
+
+    return NULL;
 }
 
 /**
-  * @brief  Get the string from string table.
+  * @brief  Get the string from string table, which is kept until removed from
+  *         the hash table.
   * @param  str     The input string.
-  * @retval See elab_err_t.
+  * @retval The index in the string table, or -1 if empty.
   */
-static elab_err_t _get_random_string_from_table(char *str)
+static int32_t _get_random_string_from_table(char *str)
 {
-    elab_err_t ret = ELAB_ERROR;
-    uint32_t size_max_not_empty = 0;
     uint32_t index_start = rand() % UT_HASH_TABLE_SIZE;
     uint32_t index = 0;
 
@@ -261,13 +311,11 @@ static elab_err_t _get_random_string_from_table(char *str)
         {
             memset(str, 0, UT_STRING_LENGTH);
             strcpy(str, str_table[index]);
-            memset(str_table[index], 0, UT_STRING_LENGTH);
-            ret = ELAB_OK;
-            break;
+            return (int32_t)index;
         }
     }
 
-    return ret;
+    return -1;
 }
 
 /**
@@ -303,31 +351,6 @@ static void _random_string_generate(char *str, uint32_t size)
     }
 }
 
-/**
-  * @brief  Get the maximum prime number in the specific range.
-  * @param  size    The given range size.
-  * @retval The maximum prime number.
-  */
-static uint16_t _get_max_prime(uint32_t size)
-{
-    elab_assert(size <= UT_HASH_TABLE_SIZE_MAX);
-
-    uint16_t prime = prime_table[0];
-    for (uint32_t i = 0; i < sizeof(prime_table) / sizeof(uint16_t); i ++)
-    {
-        if (size < prime_table[i])
-        {
-            break;
-        }
-        else
-        {
-            prime = prime_table[i];
-        }
-    }
-
-    return prime;
-}
-
 #endif
 
 /* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,344 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/edb/edb.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_edb"
+#include "../../common/elab_log.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_EDB_PATH_INI                             "/tmp/ut_edb.ini"
+#define UT_EDB_PATH_SNAPSHOT                        "/tmp/ut_edb.bin"
+
+/* Private function prototypes -----------------------------------------------*/
+#if (EDB_SNAPSHOT_EN != 0)
+static void _ini_write(const char *str);
+static void _edb_check(void);
+static void _snapshot_patch(uint32_t offset, uint32_t value, bool checksum);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static const char *ut_edb_ini =
+    "version = 3\n"
+    "; The base configuration.\n"
+    "[Base]\n"
+    "motor_ratio = 35\n"
+    "offset = -12\n"
+    "mask = 1f00\n"
+    "total = 123456789012\n"
+    "delta = -123456789012\n"
+    "enable = true\n"
+    "gain = 1.5\n"
+    "pi = 3.14159265358979\n"
+    "name = \"motor, left\"\n"
+    "motor_ratio = 99\n"
+    "\n"
+    "[Port]\n"
+    "uart1 = simu,master\n"
+    "list = 10, 20,30\n"
+    "floats = 0.5,2.25\n"
+    "\n"
+    "[base]\n"
+    "extra = 7\n";
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of edb.
+  */
+TEST_GROUP(edb);
+
+/**
+  * @brief  Define test fixture setup function of edb.
+  */
+TEST_SETUP(edb)
+{
+    edb_init(EDB_LOAD_MODE_STRING, ut_edb_ini);
+}
+
+/**
+  * @brief  Define test fixture tear down function of edb.
+  */
+TEST_TEAR_DOWN(edb)
+{
+    edb_deinit();
+}
+
+/**
+  * @brief  The typed values read by the section and key names.
+  */
+TEST(edb, get)
+{
+    char buff[32];
+
+    TEST_ASSERT_EQUAL_UINT32(35, edb_get_u32("Base", "motor_ratio"));
+    TEST_ASSERT_EQUAL_INT32(-12, edb_get_s32("Base", "offset"));
+    TEST_ASSERT_EQUAL_HEX32(0x1f00, edb_get_hex32("Base", "mask"));
+    TEST_ASSERT_TRUE(edb_get_u64("Base", "total") == 123456789012ULL);
+    TEST_ASSERT_TRUE(edb_get_s64("Base", "delta") == -123456789012LL);
+    TEST_ASSERT_TRUE(edb_get_bool("Base", "enable"));
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, edb_get_float("Base", "gain"));
+    TEST_ASSERT_TRUE(edb_get_double("Base", "pi") == 3.14159265358979);
+    TEST_ASSERT_EQUAL_UINT32(11, edb_get_string("Base", "name", buff, 32));
+    TEST_ASSERT_EQUAL_STRING("motor, left", buff);
+    TEST_ASSERT_EQUAL_UINT32(5, edb_get_string("Base", "name", buff, 6));
+    TEST_ASSERT_EQUAL_STRING("motor", buff);
+    TEST_ASSERT_TRUE(edb_str_cmp("Port", "uart1", "simu,master"));
+    TEST_ASSERT_FALSE(edb_str_cmp("Port", "uart1", "simu"));
+
+    /* The key before any section, and the one in any section. */
+    TEST_ASSERT_EQUAL_UINT32(3, edb_get_u32("", "version"));
+    TEST_ASSERT_EQUAL_UINT32(35, edb_get_u32(NULL, "motor_ratio"));
+
+    /* Case insensitive, with the first one of the duplicated keys. */
+    TEST_ASSERT_EQUAL_UINT32(35, edb_get_u32("BASE", "Motor_Ratio"));
+    TEST_ASSERT_EQUAL_UINT32(7, edb_get_u32("Base", "extra"));
+}
+
+/**
+  * @brief  The keys of the sections, in the file order, the sections with the
+  *         same name merged.
+  */
+TEST(edb, keys)
+{
+    TEST_ASSERT_EQUAL_UINT32(11, edb_get_key_num("Base"));
+    TEST_ASSERT_EQUAL_STRING("motor_ratio", edb_get_key("Base", 0));
+    TEST_ASSERT_EQUAL_STRING("motor_ratio", edb_get_key("Base", 9));
+    TEST_ASSERT_EQUAL_STRING("extra", edb_get_key("base", 10));
+    TEST_ASSERT_EQUAL_UINT32(3, edb_get_key_num("Port"));
+    TEST_ASSERT_EQUAL_STRING("floats", edb_get_key("Port", 2));
+    TEST_ASSERT_EQUAL_UINT32(1, edb_get_key_num(""));
+    TEST_ASSERT_EQUAL_UINT32(0, edb_get_key_num("None"));
+    TEST_ASSERT_EQUAL_UINT32(15, edb_get_key_num(NULL));
+    TEST_ASSERT_EQUAL_STRING("version", edb_get_key(NULL, 0));
+}
+
+/**
+  * @brief  The key handles resolved once, and converted into other types.
+  */
+TEST(edb, handle)
+{
+    TEST_ASSERT_NULL(edb_key_find("Base", "none"));
+    TEST_ASSERT_NULL(edb_key_find("None", "motor_ratio"));
+
+    edb_key_t *key = edb_key_find("Base", "gain");
+    TEST_ASSERT_NOT_NULL(key);
+    TEST_ASSERT_TRUE(key == edb_key_find("base", "GAIN"));
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        TEST_ASSERT_EQUAL_FLOAT(1.5f, edb_key_get_float(key));
+        TEST_ASSERT_EQUAL_UINT32(1, edb_key_get_u32(key));
+        TEST_ASSERT_TRUE(edb_key_get_double(key) == 1.5);
+    }
+
+    key = edb_key_find("Base", "offset");
+    TEST_ASSERT_EQUAL_INT32(-12, edb_key_get_s32(key));
+    TEST_ASSERT_TRUE(edb_key_get_s64(key) == -12);
+}
+
+/**
+  * @brief  The sub strings split by ','.
+  */
+TEST(edb, sub)
+{
+    char buff[8];
+
+    TEST_ASSERT_EQUAL_UINT32(10, edb_get_sub_u32("Port", "list", 0));
+    TEST_ASSERT_EQUAL_UINT32(20, edb_get_sub_u32("Port", "list", 1));
+    TEST_ASSERT_EQUAL_UINT32(30, edb_get_sub_u32("Port", "list", 2));
+    TEST_ASSERT_EQUAL_FLOAT(2.25f, edb_get_sub_float("Port", "floats", 1));
+    TEST_ASSERT_EQUAL_UINT32(6, edb_get_sub_string("Port", "uart1", 1, buff, 8));
+    TEST_ASSERT_EQUAL_STRING("master", buff);
+    TEST_ASSERT_EQUAL_UINT32(3, edb_get_sub_string("Port", "uart1", 1, buff, 4));
+    TEST_ASSERT_EQUAL_STRING("mas", buff);
+
+    edb_key_t *key = edb_key_find("Port", "list");
+    TEST_ASSERT_EQUAL_UINT32(3, edb_key_get_sub_num(key));
+    TEST_ASSERT_EQUAL_UINT32(0, edb_key_get_sub_string(key, 3, buff, 8));
+    TEST_ASSERT_EQUAL_STRING("", buff);
+    TEST_ASSERT_EQUAL_UINT32(1, edb_key_get_sub_num(edb_key_find("Base", "gain")));
+}
+
+#if (EDB_SNAPSHOT_EN != 0)
+/**
+  * @brief  The snapshot compiled in the first boot and mapped later, and the
+  *         INI file parsed again once the snapshot is out of date or broken.
+  */
+TEST(edb, snapshot)
+{
+    edb_deinit();
+    remove(UT_EDB_PATH_SNAPSHOT);
+    _ini_write(ut_edb_ini);
+
+    TEST_ASSERT_FALSE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    _edb_check();
+    edb_deinit();
+    TEST_ASSERT_TRUE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    _edb_check();
+    edb_deinit();
+
+    /* The INI file changed. */
+    char *ini = elab_malloc(strlen(ut_edb_ini) + 32);
+    TEST_ASSERT_NOT_NULL(ini);
+    sprintf(ini, "%sadded = 0x55\n", ut_edb_ini);
+    _ini_write(ini);
+    elab_free(ini);
+    TEST_ASSERT_FALSE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    TEST_ASSERT_EQUAL_HEX32(0x55, edb_get_hex32("Base", "added"));
+    edb_deinit();
+    TEST_ASSERT_TRUE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    TEST_ASSERT_EQUAL_HEX32(0x55, edb_get_hex32("Base", "added"));
+    edb_deinit();
+
+    /* The snapshot broken. */
+    FILE *fp = fopen(UT_EDB_PATH_SNAPSHOT, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    fseek(fp, 200, SEEK_SET);
+    int c = fgetc(fp);
+    fseek(fp, 200, SEEK_SET);
+    fputc(c ^ 0x5a, fp);
+    fclose(fp);
+    TEST_ASSERT_FALSE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    edb_deinit();
+
+    /* Compiled offline, and deployed without the INI file. */
+    _ini_write(ut_edb_ini);
+    TEST_ASSERT_TRUE(edb_compile(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    remove(UT_EDB_PATH_INI);
+    TEST_ASSERT_TRUE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    _edb_check();
+    TEST_ASSERT_FALSE(edb_compile(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    remove(UT_EDB_PATH_SNAPSHOT);
+}
+
+/**
+  * @brief  The INI file parsed again once the snapshot head is broken, or its
+  *         tables are out of the image even with the checksum matched.
+  */
+TEST(edb, snapshot_head)
+{
+    /* Field offsets in the snapshot head. */
+    static const uint32_t patch[][2] =
+    {
+        { 44, 0 },                              /* sub_num */
+        { 32, 0x10000000 },                     /* key_num */
+        { 56, 0xfffffff8 },                     /* offset_section_keys */
+        { 40, 3 },                              /* bucket_num */
+        { 68, 0x00100000 },                     /* offset_strings */
+    };
+
+    edb_deinit();
+    remove(UT_EDB_PATH_SNAPSHOT);
+    _ini_write(ut_edb_ini);
+    TEST_ASSERT_FALSE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    edb_deinit();
+
+    for (uint32_t i = 0; i < sizeof(patch) / sizeof(patch[0]); i ++)
+    {
+        /* The first one is caught by the checksum, the others by the range. */
+        _snapshot_patch(patch[i][0], patch[i][1], i != 0);
+        TEST_ASSERT_FALSE(edb_init_snapshot(UT_EDB_PATH_INI,
+                                            UT_EDB_PATH_SNAPSHOT));
+        _edb_check();
+        edb_deinit();
+    }
+    TEST_ASSERT_TRUE(edb_init_snapshot(UT_EDB_PATH_INI, UT_EDB_PATH_SNAPSHOT));
+    _edb_check();
+    remove(UT_EDB_PATH_SNAPSHOT);
+}
+#endif
+
+/**
+  * @brief  Define run test cases of edb.
+  */
+TEST_GROUP_RUNNER(edb)
+{
+    RUN_TEST_CASE(edb, get);
+    RUN_TEST_CASE(edb, keys);
+    RUN_TEST_CASE(edb, handle);
+    RUN_TEST_CASE(edb, sub);
+#if (EDB_SNAPSHOT_EN != 0)
+    RUN_TEST_CASE(edb, snapshot);
+    RUN_TEST_CASE(edb, snapshot_head);
+#endif
+}
+
+/* Private functions ---------------------------------------------------------*/
+#if (EDB_SNAPSHOT_EN != 0)
+static void _ini_write(const char *str)
+{
+    FILE *fp = fopen(UT_EDB_PATH_INI, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL(strlen(str), fwrite(str, 1, strlen(str), fp));
+    fclose(fp);
+}
+
+/**
+  * @brief  Check the values of the testing INI loaded.
+  */
+static void _edb_check(void)
+{
+    char buff[16];
+
+    TEST_ASSERT_EQUAL_UINT32(35, edb_get_u32("BASE", "Motor_Ratio"));
+    TEST_ASSERT_TRUE(edb_get_s64("Base", "delta") == -123456789012LL);
+    TEST_ASSERT_TRUE(edb_get_bool("Base", "enable"));
+    TEST_ASSERT_TRUE(edb_get_double("Base", "pi") == 3.14159265358979);
+    TEST_ASSERT_EQUAL_UINT32(11, edb_get_string("Base", "name", buff, 16));
+    TEST_ASSERT_EQUAL_STRING("motor, left", buff);
+    TEST_ASSERT_EQUAL_UINT32(3, edb_get_u32("", "version"));
+    TEST_ASSERT_EQUAL_UINT32(11, edb_get_key_num("Base"));
+    TEST_ASSERT_EQUAL_STRING("extra", edb_get_key("base", 10));
+    TEST_ASSERT_EQUAL_UINT32(20, edb_get_sub_u32("Port", "list", 1));
+    TEST_ASSERT_EQUAL_FLOAT(2.25f, edb_get_sub_float("Port", "floats", 1));
+    TEST_ASSERT_TRUE(edb_str_cmp("Port", "uart1", "simu,master"));
+}
+
+/**
+  * @brief  Patch one word in the snapshot head, with the checksum (FNV-1a of
+  *         the whole snapshot, the checksum field as 0) updated or not.
+  */
+static void _snapshot_patch(uint32_t offset, uint32_t value, bool checksum)
+{
+    FILE *fp = fopen(UT_EDB_PATH_SNAPSHOT, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    fseek(fp, 0, SEEK_END);
+    uint32_t size = (uint32_t)ftell(fp);
+    uint32_t *data = elab_malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    fseek(fp, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(size, fread(data, 1, size, fp));
+
+    data[offset / 4] = value;
+    if (checksum)
+    {
+        uint32_t hash = 2166136261U;
+        for (uint32_t i = 0; i < size / 4; i ++)
+        {
+            hash ^= (i == 3) ? 0 : data[i];
+            hash *= 16777619U;
+        }
+        data[3] = hash;
+    }
+
+    fseek(fp, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(size, fwrite(data, 1, size, fp));
+    fclose(fp);
+    elab_free(data);
+}
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,305 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../edf/driver/simulator/simu_serial.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_async"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MBM_ASYNC_SERIAL_M                       "ut_mbm_async_m"
+#define UT_MBM_ASYNC_SERIAL_S                       "ut_mbm_async_s"
+#define UT_MBM_ASYNC_SLAVE                          (2)
+#define UT_MBM_ASYNC_SLAVE_NONE                     (3)
+#define UT_MBM_ASYNC_RX_TIMEOUT                     (100)
+#define UT_MBM_ASYNC_SLAVE_TIMEOUT                  (10)
+#define UT_MBM_ASYNC_REQ_MAX                        (16)
+#define UT_MBM_ASYNC_READS                          (6)
+#define UT_MBM_ASYNC_REGS                           (16)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct ut_mbm_async_done
+{
+    uint16_t err;
+    uint32_t seq;
+} ut_mbm_async_done_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr);
+static void _async_cb(uint16_t err, void *para);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbm = NULL;
+static mb_channel_t *mbs = NULL;
+static mbm_async_t *async = NULL;
+static uint16_t ut_regs[UT_MBM_ASYNC_REGS];
+static volatile uint32_t ut_done_seq = 0;
+
+static mb_channel_cb_t cb_mbs =
+{
+    .holding_reg_read = _holding_reg_read,
+    .holding_reg_write = _holding_reg_write,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus master asynchronous requests.
+  */
+TEST_GROUP(modbus_async);
+
+/**
+  * @brief  Define test fixture setup function of Modbus master asynchronous
+  *         requests.
+  */
+TEST_SETUP(modbus_async)
+{
+    memset(ut_regs, 0, sizeof(ut_regs));
+    ut_done_seq = 0;
+
+    simu_serial_new_pair(UT_MBM_ASYNC_SERIAL_M, UT_MBM_ASYNC_SERIAL_S, 115200);
+    mbm = mb_channel_create(UT_MBM_ASYNC_SERIAL_M, 0, MODBUS_MASTER,
+                            UT_MBM_ASYNC_RX_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm);
+    mbs = mb_channel_create(UT_MBM_ASYNC_SERIAL_S, UT_MBM_ASYNC_SLAVE,
+                            MODBUS_SLAVE, UT_MBM_ASYNC_RX_TIMEOUT,
+                            MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs);
+    mb_slave_set_cb(mbs, &cb_mbs);
+    mb_slave_write_enable(mbs, true);
+
+    async = mbm_async_create(mbm, UT_MBM_ASYNC_REQ_MAX);
+    TEST_ASSERT_NOT_NULL(async);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus master
+  *         asynchronous requests.
+  */
+TEST_TEAR_DOWN(modbus_async)
+{
+    mbm_async_destroy(async);
+    mb_channel_destroy(mbs);
+    mb_channel_destroy(mbm);
+    simu_serial_destroy(UT_MBM_ASYNC_SERIAL_S);
+    simu_serial_destroy(UT_MBM_ASYNC_SERIAL_M);
+    async = NULL;
+    mbs = NULL;
+    mbm = NULL;
+}
+
+/**
+  * @brief  The requests waited for as futures.
+  */
+TEST(modbus_async, wait)
+{
+    uint16_t regs_wr[4] = { 0x1234, 0x5678, 0x9abc, 0xdef0, };
+    uint16_t regs_rd[4];
+    mbm_async_attr_t attr =
+    {
+        .slave_node = UT_MBM_ASYNC_SLAVE,
+        .fc = MODBUS_FC16_HOLDING_REG_WR_MULTIPLE,
+        .prio = MBM_ASYNC_PRIO_NORMAL,
+        .start_addr = 4,
+        .nbr = 4,
+        .p_data = regs_wr,
+    };
+    mbm_async_req_t *req_wr = mbm_async_submit(async, &attr);
+    TEST_ASSERT_NOT_NULL(req_wr);
+
+    attr.fc = MODBUS_FC03_HOLDING_REG_RD;
+    attr.p_data = regs_rd;
+    mbm_async_req_t *req_rd = mbm_async_submit(async, &attr);
+    TEST_ASSERT_NOT_NULL(req_rd);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+                                mbm_async_wait(async, req_wr, osWaitForever));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+                                mbm_async_wait(async, req_rd, osWaitForever));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, regs_rd, 4);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, &ut_regs[4], 4);
+}
+
+/**
+  * @brief  The control write in the high lane jumps ahead of the queued bulk
+  *         reads in the low lane.
+  */
+TEST(modbus_async, priority)
+{
+    uint16_t regs[UT_MBM_ASYNC_READS][UT_MBM_ASYNC_REGS];
+    ut_mbm_async_done_t done_rd[UT_MBM_ASYNC_READS];
+    ut_mbm_async_done_t done_wr;
+    uint16_t reg_val = 0x55aa;
+    mbm_async_attr_t attr =
+    {
+        .slave_node = UT_MBM_ASYNC_SLAVE,
+        .fc = MODBUS_FC03_HOLDING_REG_RD,
+        .prio = MBM_ASYNC_PRIO_LOW,
+        .start_addr = 0,
+        .nbr = UT_MBM_ASYNC_REGS,
+        .cb = _async_cb,
+    };
+
+    for (uint32_t i = 0; i < UT_MBM_ASYNC_READS; i ++)
+    {
+        attr.p_data = regs[i];
+        attr.para = &done_rd[i];
+        done_rd[i].seq = 0;
+        TEST_ASSERT_NOT_NULL(mbm_async_submit(async, &attr));
+    }
+
+    attr.fc = MODBUS_FC06_HOLDING_REG_WR;
+    attr.prio = MBM_ASYNC_PRIO_HIGH;
+    attr.start_addr = 1;
+    attr.nbr = 1;
+    attr.p_data = &reg_val;
+    attr.para = &done_wr;
+    done_wr.seq = 0;
+    TEST_ASSERT_NOT_NULL(mbm_async_submit(async, &attr));
+
+    while (ut_done_seq < (UT_MBM_ASYNC_READS + 1))
+    {
+        osDelay(10);
+    }
+
+    /* At most one read is being sent when the write is submitted. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE, done_wr.err);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, done_wr.seq);
+    TEST_ASSERT_EQUAL_UINT16(reg_val, ut_regs[1]);
+    for (uint32_t i = 0; i < UT_MBM_ASYNC_READS; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE, done_rd[i].err);
+        if (i > 0)
+        {
+            TEST_ASSERT_GREATER_THAN_UINT32(done_rd[i - 1].seq, done_rd[i].seq);
+        }
+    }
+}
+
+/**
+  * @brief  The dead slave is backed off in its own timeout, and the requests
+  *         to it fail at once without stalling the live one.
+  */
+TEST(modbus_async, dead_slave)
+{
+    uint16_t regs[UT_MBM_ASYNC_REGS];
+    mbm_async_attr_t attr =
+    {
+        .slave_node = UT_MBM_ASYNC_SLAVE_NONE,
+        .fc = MODBUS_FC03_HOLDING_REG_RD,
+        .prio = MBM_ASYNC_PRIO_NORMAL,
+        .start_addr = 0,
+        .nbr = UT_MBM_ASYNC_REGS,
+        .p_data = regs,
+    };
+
+    mbm_async_set_timeout(async, UT_MBM_ASYNC_SLAVE_NONE,
+                            UT_MBM_ASYNC_SLAVE_TIMEOUT);
+    TEST_ASSERT_TRUE(mbm_async_slave_alive(async, UT_MBM_ASYNC_SLAVE_NONE));
+
+    /* Timed out in the timeout of the slave, not the channel's. */
+    uint32_t time_start = elab_time_ms();
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        mbm_async_req_t *req = mbm_async_submit(async, &attr);
+        TEST_ASSERT_NOT_NULL(req);
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_TIMED_OUT,
+                                    mbm_async_wait(async, req, osWaitForever));
+    }
+    TEST_ASSERT_LESS_THAN_UINT32(UT_MBM_ASYNC_RX_TIMEOUT,
+                                    elab_time_ms() - time_start);
+    TEST_ASSERT_FALSE(mbm_async_slave_alive(async, UT_MBM_ASYNC_SLAVE_NONE));
+
+    /* Failed at once in the backoff time. */
+    mbm_async_req_t *req = mbm_async_submit(async, &attr);
+    TEST_ASSERT_NOT_NULL(req);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_SLAVE_DEAD,
+                                mbm_async_wait(async, req, osWaitForever));
+
+    /* Not waited for long. */
+    req = mbm_async_submit(async, &attr);
+    TEST_ASSERT_NOT_NULL(req);
+    uint16_t err = mbm_async_wait(async, req, 0);
+    if (err == MODBUS_ERR_PENDING)
+    {
+        err = mbm_async_wait(async, req, osWaitForever);
+    }
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_SLAVE_DEAD, err);
+
+    /* The live slave is not affected. */
+    attr.slave_node = UT_MBM_ASYNC_SLAVE;
+    req = mbm_async_submit(async, &attr);
+    TEST_ASSERT_NOT_NULL(req);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+                                mbm_async_wait(async, req, osWaitForever));
+}
+
+/**
+  * @brief  Define run test cases of Modbus master asynchronous requests.
+  */
+TEST_GROUP_RUNNER(modbus_async)
+{
+    RUN_TEST_CASE(modbus_async, wait);
+    RUN_TEST_CASE(modbus_async, priority);
+    RUN_TEST_CASE(modbus_async, dead_slave);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The holding registers of the simulated slave.
+  */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MBM_ASYNC_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return 0;
+    }
+
+    return ut_regs[reg];
+}
+
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MBM_ASYNC_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return;
+    }
+
+    ut_regs[reg] = reg_val_16;
+}
+
+/**
+  * @brief  The callback recording the result and the completion sequence.
+  */
+static void _async_cb(uint16_t err, void *para)
+{
+    ut_mbm_async_done_t *done = (ut_mbm_async_done_t *)para;
+
+    done->err = err;
+    done->seq = elab_atomic_add(&ut_done_seq, 1);
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
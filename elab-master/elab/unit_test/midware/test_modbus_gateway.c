@@ -0,0 +1,456 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../edf/driver/simulator/simu_serial.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_gateway"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MB_GW_UP_1_M                             "ut_mb_gw_up1_m"
+#define UT_MB_GW_UP_1_S                             "ut_mb_gw_up1_s"
+#define UT_MB_GW_UP_2_M                             "ut_mb_gw_up2_m"
+#define UT_MB_GW_UP_2_S                             "ut_mb_gw_up2_s"
+#define UT_MB_GW_DOWN_M                             "ut_mb_gw_down_m"
+#define UT_MB_GW_DOWN_S                             "ut_mb_gw_down_s"
+#define UT_MB_GW_NODE                               (1)
+#define UT_MB_GW_UNIT                               (17)
+#define UT_MB_GW_UNIT_DEAD                          (18)
+#define UT_MB_GW_SLAVE                              (7)
+#define UT_MB_GW_SLAVE_NONE                         (8)
+#define UT_MB_GW_UP_TIMEOUT                         (500)
+#define UT_MB_GW_DOWN_TIMEOUT                       (100)
+#define UT_MB_GW_SLAVE_DELAY                        (50)
+#define UT_MB_GW_TTL                                (300)
+#define UT_MB_GW_REGS                               (16)
+#define UT_MB_GW_TCP_HOST                           "127.0.0.1"
+#define UT_MB_GW_TCP_PORT                           (15021)
+
+/* Exported function prototypes ----------------------------------------------*/
+uint16_t mbm_pdu_request(mb_channel_t *pch, uint8_t slave_node,
+                            const uint8_t *p_pdu, uint16_t size,
+                            uint16_t size_rsp,
+                            uint8_t *p_rsp, uint16_t *p_size_rsp);
+
+/* Private function prototypes -----------------------------------------------*/
+static void _map_read_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs);
+static void _entry_reader(void *para);
+static void _gateway_setup(uint32_t cache_ttl_ms);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbm_up_1 = NULL;
+static mb_channel_t *mbs_up_1 = NULL;
+static mb_channel_t *mbm_up_2 = NULL;
+static mb_channel_t *mbs_up_2 = NULL;
+static mb_channel_t *mbm_down = NULL;
+static mb_channel_t *mbs_down = NULL;
+static mb_gateway_t *gw = NULL;
+static osSemaphoreId_t sem_reader = NULL;
+static uint16_t ut_regs[UT_MB_GW_REGS];
+static volatile uint32_t ut_count_read = 0;
+static volatile bool ut_slave_slow = false;
+
+static mb_reg_map_t map_down =
+{
+    .type = MB_REG_MAP_HOLDING,
+    .access = MB_REG_ACCESS_RW,
+    .start_addr = 0,
+    .nbr_regs = UT_MB_GW_REGS,
+    .data = ut_regs,
+    .read_hook = _map_read_hook,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus gateway.
+  */
+TEST_GROUP(modbus_gateway);
+
+/**
+  * @brief  Define test fixture setup function of Modbus gateway.
+  */
+TEST_SETUP(modbus_gateway)
+{
+    for (uint32_t i = 0; i < UT_MB_GW_REGS; i ++)
+    {
+        ut_regs[i] = (uint16_t)(0x0700 + i);
+    }
+    ut_count_read = 0;
+    ut_slave_slow = false;
+
+    /* The downstream slave. */
+    simu_serial_new_pair(UT_MB_GW_DOWN_M, UT_MB_GW_DOWN_S, 115200);
+    mbm_down = mb_channel_create(UT_MB_GW_DOWN_M, 0, MODBUS_MASTER,
+                                    UT_MB_GW_DOWN_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm_down);
+    mbs_down = mb_channel_create(UT_MB_GW_DOWN_S, UT_MB_GW_SLAVE, MODBUS_SLAVE,
+                                    UT_MB_GW_DOWN_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs_down);
+    mb_slave_add_map(mbs_down, &map_down);
+    mb_slave_write_enable(mbs_down, true);
+
+    /* The two upstream masters, with their slaves on the gateway. */
+    simu_serial_new_pair(UT_MB_GW_UP_1_M, UT_MB_GW_UP_1_S, 115200);
+    simu_serial_new_pair(UT_MB_GW_UP_2_M, UT_MB_GW_UP_2_S, 115200);
+    mbm_up_1 = mb_channel_create(UT_MB_GW_UP_1_M, 0, MODBUS_MASTER,
+                                    UT_MB_GW_UP_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm_up_1);
+    mbm_up_2 = mb_channel_create(UT_MB_GW_UP_2_M, 0, MODBUS_MASTER,
+                                    UT_MB_GW_UP_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm_up_2);
+    mbs_up_1 = mb_channel_create(UT_MB_GW_UP_1_S, UT_MB_GW_NODE, MODBUS_SLAVE,
+                                    UT_MB_GW_UP_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs_up_1);
+    mbs_up_2 = mb_channel_create(UT_MB_GW_UP_2_S, UT_MB_GW_NODE, MODBUS_SLAVE,
+                                    UT_MB_GW_UP_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs_up_2);
+    mb_slave_write_enable(mbs_up_1, true);
+    mb_slave_write_enable(mbs_up_2, true);
+
+    sem_reader = osSemaphoreNew(1, 0, NULL);
+    TEST_ASSERT_NOT_NULL(sem_reader);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus gateway.
+  */
+TEST_TEAR_DOWN(modbus_gateway)
+{
+    mb_channel_destroy(mbs_up_1);
+    mb_channel_destroy(mbs_up_2);
+    mb_gateway_destroy(gw);
+    mb_channel_destroy(mbm_up_1);
+    mb_channel_destroy(mbm_up_2);
+    mb_channel_destroy(mbs_down);
+    mb_channel_destroy(mbm_down);
+    simu_serial_destroy(UT_MB_GW_UP_1_S);
+    simu_serial_destroy(UT_MB_GW_UP_1_M);
+    simu_serial_destroy(UT_MB_GW_UP_2_S);
+    simu_serial_destroy(UT_MB_GW_UP_2_M);
+    simu_serial_destroy(UT_MB_GW_DOWN_S);
+    simu_serial_destroy(UT_MB_GW_DOWN_M);
+    osSemaphoreDelete(sem_reader);
+    sem_reader = NULL;
+    gw = NULL;
+}
+
+/**
+  * @brief  The reads and writes routed by the unit ID, and the failed ones
+  *         answered by the gateway.
+  */
+TEST(modbus_gateway, route)
+{
+    uint16_t regs[UT_MB_GW_REGS];
+    uint16_t regs_wr[3] = { 0x1111, 0x2222, 0x3333, };
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(0);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_1, UT_MB_GW_UNIT, 0,
+                                    regs, UT_MB_GW_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, UT_MB_GW_REGS);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc16_holding_reg_write(mbm_up_2, UT_MB_GW_UNIT, 4, regs_wr, 3));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, &ut_regs[4], 3);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm_up_1, UT_MB_GW_UNIT, 8, 0x4444));
+    TEST_ASSERT_EQUAL_UINT16(0x4444, ut_regs[8]);
+
+    /* The downstream slave absent. */
+    TEST_ASSERT_NOT_EQUAL(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_1, UT_MB_GW_UNIT_DEAD, 0, regs, 2));
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.errors);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.hit_rate);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(UT_MB_GW_DOWN_TIMEOUT,
+                                        stats.latency_max_ms);
+}
+
+/**
+  * @brief  The reads served by the cache in its TTL, and refreshed after the
+  *         writes.
+  */
+TEST(modbus_gateway, cache)
+{
+    uint16_t regs[UT_MB_GW_REGS];
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(UT_MB_GW_TTL);
+
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+            mbm_fc03_holding_reg_read(i % 2 ? mbm_up_1 : mbm_up_2,
+                                        UT_MB_GW_UNIT, 0, regs, 4));
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, 4);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_read);
+
+    /* Another range is not served by the cache. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_1, UT_MB_GW_UNIT, 1, regs, 4));
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_read);
+
+    /* The write drops the cache of the unit. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm_up_1, UT_MB_GW_UNIT, 0, 0x5555));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_2, UT_MB_GW_UNIT, 0, regs, 4));
+    TEST_ASSERT_EQUAL_UINT16(0x5555, regs[0]);
+    TEST_ASSERT_EQUAL_UINT32(3, ut_count_read);
+
+    /* Out of the TTL. */
+    osDelay(UT_MB_GW_TTL + 50);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_2, UT_MB_GW_UNIT, 0, regs, 4));
+    TEST_ASSERT_EQUAL_UINT32(4, ut_count_read);
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(7, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.cache_hits);
+    TEST_ASSERT_EQUAL_UINT32(5, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT16(2 * 1000 / 7, stats.hit_rate);
+}
+
+/**
+  * @brief  The identical reads from two upstreams at the same time are sent
+  *         downstream only once.
+  */
+TEST(modbus_gateway, coalesce)
+{
+    uint16_t regs[UT_MB_GW_REGS];
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(0);
+    ut_slave_slow = true;
+
+    osThreadId_t thread = osThreadNew(_entry_reader, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(thread);
+    osDelay(UT_MB_GW_SLAVE_DELAY / 2);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_2, UT_MB_GW_UNIT, 0,
+                                    regs, UT_MB_GW_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, UT_MB_GW_REGS);
+    TEST_ASSERT_EQUAL(osOK, osSemaphoreAcquire(sem_reader, osWaitForever));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_read);
+
+    /* Not served by any cache after it completes. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_2, UT_MB_GW_UNIT, 0,
+                                    regs, UT_MB_GW_REGS));
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_read);
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.coalesced);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.cache_hits);
+}
+
+/**
+  * @brief  The exception response of the downstream slave is passed upstream
+  *         at once, without waiting for the size of the normal one, and it is
+  *         not cached.
+  */
+TEST(modbus_gateway, exception)
+{
+    /* FC03 of 8 registers from 12, out of the map of the slave. */
+    const uint8_t pdu[] = { MODBUS_FC03_HOLDING_REG_RD, 0x00, 12, 0x00, 8, };
+    uint8_t rsp[MODBUS_CFG_BUF_SIZE];
+    uint16_t size_rsp = 0;
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(UT_MB_GW_TTL);
+
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        uint32_t time_start = osKernelGetTickCount();
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+            mbm_pdu_request(mbm_up_1, UT_MB_GW_UNIT, pdu, sizeof(pdu),
+                            2 + 8 * 2, rsp, &size_rsp));
+        TEST_ASSERT_LESS_THAN_UINT32(UT_MB_GW_DOWN_TIMEOUT,
+                                        osKernelGetTickCount() - time_start);
+        TEST_ASSERT_EQUAL_UINT16(2, size_rsp);
+        TEST_ASSERT_EQUAL_HEX8(MODBUS_FC03_HOLDING_REG_RD | 0x80, rsp[0]);
+        TEST_ASSERT_EQUAL_HEX8(MODBUS_ERR_ILLEGAL_DATA_ADDR, rsp[1]);
+    }
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.errors);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.cache_hits);
+    TEST_ASSERT_LESS_THAN_UINT32(UT_MB_GW_DOWN_TIMEOUT, stats.latency_max_ms);
+}
+
+/**
+  * @brief  The read in flight when the unit is invalidated is not cached, as
+  *         it may be read before the change.
+  */
+TEST(modbus_gateway, invalidate_in_flight)
+{
+    uint16_t regs[UT_MB_GW_REGS];
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(UT_MB_GW_TTL);
+    ut_slave_slow = true;
+
+    osThreadId_t thread = osThreadNew(_entry_reader, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(thread);
+    osDelay(UT_MB_GW_SLAVE_DELAY / 2);
+    mb_gateway_add_route(gw, UT_MB_GW_UNIT, mbm_down, UT_MB_GW_SLAVE);
+    TEST_ASSERT_EQUAL(osOK, osSemaphoreAcquire(sem_reader, osWaitForever));
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_read);
+    ut_slave_slow = false;
+
+    /* Forwarded again, and cached this time. */
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+            mbm_fc03_holding_reg_read(mbm_up_2, UT_MB_GW_UNIT, 0,
+                                        regs, UT_MB_GW_REGS));
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, UT_MB_GW_REGS);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_read);
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.cache_hits);
+}
+
+/**
+  * @brief  The requests from the TCP clients routed and cached as the serial
+  *         ones.
+  */
+TEST(modbus_gateway, tcp_upstream)
+{
+    uint16_t regs[UT_MB_GW_REGS];
+    mb_gateway_stats_t stats;
+
+    _gateway_setup(UT_MB_GW_TTL);
+    mb_channel_t *mbs_tcp = mb_channel_create_tcp(NULL, UT_MB_GW_TCP_PORT,
+                                                    UT_MB_GW_NODE,
+                                                    MODBUS_SLAVE, 0);
+    TEST_ASSERT_NOT_NULL(mbs_tcp);
+    mb_slave_write_enable(mbs_tcp, true);
+    mb_gateway_attach(gw, mbs_tcp);
+    mb_channel_t *mbm_tcp = mb_channel_create_tcp(UT_MB_GW_TCP_HOST,
+                                                    UT_MB_GW_TCP_PORT, 0,
+                                                    MODBUS_MASTER,
+                                                    UT_MB_GW_UP_TIMEOUT);
+    TEST_ASSERT_NOT_NULL(mbm_tcp);
+
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+            mbm_fc03_holding_reg_read(mbm_tcp, UT_MB_GW_UNIT, 0,
+                                        regs, UT_MB_GW_REGS));
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, UT_MB_GW_REGS);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_read);
+
+    /* The write from TCP drops the cache of the serial upstreams too. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm_tcp, UT_MB_GW_UNIT, 0, 0x6666));
+    TEST_ASSERT_EQUAL_UINT16(0x6666, ut_regs[0]);
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm_up_1, UT_MB_GW_UNIT, 0,
+                                    regs, UT_MB_GW_REGS));
+    TEST_ASSERT_EQUAL_UINT16(0x6666, regs[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_read);
+
+    mb_gateway_get_stats(gw, &stats);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.cache_hits);
+
+    mb_channel_destroy(mbm_tcp);
+    mb_channel_destroy(mbs_tcp);
+}
+
+/**
+  * @brief  Define run test cases of Modbus gateway.
+  */
+TEST_GROUP_RUNNER(modbus_gateway)
+{
+    RUN_TEST_CASE(modbus_gateway, route);
+    RUN_TEST_CASE(modbus_gateway, cache);
+    RUN_TEST_CASE(modbus_gateway, coalesce);
+    RUN_TEST_CASE(modbus_gateway, exception);
+    RUN_TEST_CASE(modbus_gateway, invalidate_in_flight);
+    RUN_TEST_CASE(modbus_gateway, tcp_upstream);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Create the gateway between the upstream slaves and the downstream.
+  */
+static void _gateway_setup(uint32_t cache_ttl_ms)
+{
+    gw = mb_gateway_create(cache_ttl_ms);
+    TEST_ASSERT_NOT_NULL(gw);
+    mb_gateway_add_route(gw, UT_MB_GW_UNIT, mbm_down, UT_MB_GW_SLAVE);
+    mb_gateway_add_route(gw, UT_MB_GW_UNIT_DEAD, mbm_down, UT_MB_GW_SLAVE_NONE);
+    mb_gateway_attach(gw, mbs_up_1);
+    mb_gateway_attach(gw, mbs_up_2);
+}
+
+/**
+  * @brief  The reader on the first upstream.
+  */
+static void _entry_reader(void *para)
+{
+    (void)para;
+    uint16_t regs[UT_MB_GW_REGS];
+
+    uint16_t err = mbm_fc03_holding_reg_read(mbm_up_1, UT_MB_GW_UNIT, 0,
+                                                regs, UT_MB_GW_REGS);
+    elab_assert(err == MODBUS_ERR_NONE);
+    elab_assert(memcmp(regs, ut_regs, sizeof(regs)) == 0);
+    osSemaphoreRelease(sem_reader);
+}
+
+/**
+  * @brief  The read hook of the downstream slave, counting the reads.
+  */
+static void _map_read_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs)
+{
+    (void)map;
+    (void)start_addr;
+    (void)nbr_regs;
+
+    ut_count_read ++;
+    if (ut_slave_slow)
+    {
+        osDelay(UT_MB_GW_SLAVE_DELAY);
+    }
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
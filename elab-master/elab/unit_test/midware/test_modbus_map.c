@@ -0,0 +1,326 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../edf/driver/simulator/simu_serial.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_map"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MB_MAP_SERIAL_M                          "ut_mb_map_m"
+#define UT_MB_MAP_SERIAL_S                          "ut_mb_map_s"
+#define UT_MB_MAP_SLAVE                             (4)
+#define UT_MB_MAP_RX_TIMEOUT                        (200)
+#define UT_MB_MAP_HOLDING_START                     (100)
+#define UT_MB_MAP_HOLDING_REGS                      (125)
+#define UT_MB_MAP_INPUT_START                       (300)
+#define UT_MB_MAP_INPUT_REGS                        (8)
+#define UT_MB_MAP_CB_REGS                           (16)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr);
+static void _map_read_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs);
+static void _map_write_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbm = NULL;
+static mb_channel_t *mbs = NULL;
+static uint16_t ut_regs_holding[UT_MB_MAP_HOLDING_REGS];
+static uint16_t ut_regs_input[UT_MB_MAP_INPUT_REGS];
+static uint16_t ut_regs_cb[UT_MB_MAP_CB_REGS];
+static uint32_t ut_count_cb = 0;
+static uint32_t ut_count_read_hook = 0;
+static uint32_t ut_count_write_hook = 0;
+static uint16_t ut_write_hook_start = 0;
+static uint16_t ut_write_hook_nbr = 0;
+
+static mb_channel_cb_t cb_mbs =
+{
+    .holding_reg_read = _holding_reg_read,
+    .holding_reg_write = _holding_reg_write,
+};
+
+static mb_reg_map_t map_holding =
+{
+    .type = MB_REG_MAP_HOLDING,
+    .access = MB_REG_ACCESS_RW,
+    .start_addr = UT_MB_MAP_HOLDING_START,
+    .nbr_regs = UT_MB_MAP_HOLDING_REGS,
+    .data = ut_regs_holding,
+    .read_hook = _map_read_hook,
+    .write_hook = _map_write_hook,
+};
+
+static mb_reg_map_t map_input =
+{
+    .type = MB_REG_MAP_INPUT,
+    .access = MB_REG_ACCESS_RD,
+    .start_addr = UT_MB_MAP_INPUT_START,
+    .nbr_regs = UT_MB_MAP_INPUT_REGS,
+    .data = ut_regs_input,
+};
+
+/* The same registers as the input ones, but only readable as holding ones. */
+static mb_reg_map_t map_holding_ro =
+{
+    .type = MB_REG_MAP_HOLDING,
+    .access = MB_REG_ACCESS_RD,
+    .start_addr = UT_MB_MAP_INPUT_START,
+    .nbr_regs = UT_MB_MAP_INPUT_REGS,
+    .data = ut_regs_input,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus slave register maps.
+  */
+TEST_GROUP(modbus_map);
+
+/**
+  * @brief  Define test fixture setup function of Modbus slave register maps.
+  */
+TEST_SETUP(modbus_map)
+{
+    for (uint32_t i = 0; i < UT_MB_MAP_HOLDING_REGS; i ++)
+    {
+        ut_regs_holding[i] = (uint16_t)(0x1000 + i);
+    }
+    for (uint32_t i = 0; i < UT_MB_MAP_INPUT_REGS; i ++)
+    {
+        ut_regs_input[i] = (uint16_t)(0xa500 + i);
+    }
+    memset(ut_regs_cb, 0, sizeof(ut_regs_cb));
+    ut_count_cb = 0;
+    ut_count_read_hook = 0;
+    ut_count_write_hook = 0;
+    ut_write_hook_start = 0;
+    ut_write_hook_nbr = 0;
+
+    simu_serial_new_pair(UT_MB_MAP_SERIAL_M, UT_MB_MAP_SERIAL_S, 115200);
+    mbm = mb_channel_create(UT_MB_MAP_SERIAL_M, 0, MODBUS_MASTER,
+                            UT_MB_MAP_RX_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm);
+    mbs = mb_channel_create(UT_MB_MAP_SERIAL_S, UT_MB_MAP_SLAVE,
+                            MODBUS_SLAVE, UT_MB_MAP_RX_TIMEOUT,
+                            MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs);
+    mb_slave_set_cb(mbs, &cb_mbs);
+    mb_slave_write_enable(mbs, true);
+
+    mb_slave_add_map(mbs, &map_holding);
+    mb_slave_add_map(mbs, &map_input);
+    mb_slave_add_map(mbs, &map_holding_ro);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus slave register
+  *         maps.
+  */
+TEST_TEAR_DOWN(modbus_map)
+{
+    mb_channel_destroy(mbs);
+    mb_channel_destroy(mbm);
+    simu_serial_destroy(UT_MB_MAP_SERIAL_S);
+    simu_serial_destroy(UT_MB_MAP_SERIAL_M);
+    mbs = NULL;
+    mbm = NULL;
+}
+
+/**
+  * @brief  The full 125 registers read from the maps, without the callbacks.
+  */
+TEST(modbus_map, read)
+{
+    uint16_t regs[UT_MB_MAP_HOLDING_REGS];
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_HOLDING_START,
+                                    regs, UT_MB_MAP_HOLDING_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs_holding, regs,
+                                    UT_MB_MAP_HOLDING_REGS);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_read_hook);
+
+    /* A part in the middle of the map. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_HOLDING_START + 10, regs, 5));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(&ut_regs_holding[10], regs, 5);
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_read_hook);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc04_in_reg_read(mbm, UT_MB_MAP_SLAVE, UT_MB_MAP_INPUT_START,
+                                regs, UT_MB_MAP_INPUT_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs_input, regs, UT_MB_MAP_INPUT_REGS);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_count_cb);
+}
+
+/**
+  * @brief  The FC06 and FC16 writes into the map, with the write hook called
+  *         once for each request.
+  */
+TEST(modbus_map, write)
+{
+    uint16_t regs_wr[4] = { 0x1234, 0x5678, 0x9abc, 0xdef0, };
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc16_holding_reg_write(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_HOLDING_START + 20, regs_wr, 4));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, &ut_regs_holding[20], 4);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_count_write_hook);
+    TEST_ASSERT_EQUAL_UINT16(UT_MB_MAP_HOLDING_START + 20, ut_write_hook_start);
+    TEST_ASSERT_EQUAL_UINT16(4, ut_write_hook_nbr);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_HOLDING_START, 0x55aa));
+    TEST_ASSERT_EQUAL_UINT16(0x55aa, ut_regs_holding[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_write_hook);
+    TEST_ASSERT_EQUAL_UINT16(1, ut_write_hook_nbr);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_count_cb);
+}
+
+/**
+  * @brief  The writes into the read-only map are rejected, and the registers
+  *         are not changed.
+  */
+TEST(modbus_map, read_only)
+{
+    uint16_t regs_wr[2] = { 0x1111, 0x2222, };
+    uint16_t regs[UT_MB_MAP_INPUT_REGS];
+
+    TEST_ASSERT_NOT_EQUAL(MODBUS_ERR_NONE,
+        mbm_fc16_holding_reg_write(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_INPUT_START, regs_wr, 2));
+    TEST_ASSERT_NOT_EQUAL(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_INPUT_START, 0x3333));
+    TEST_ASSERT_EQUAL_UINT16(0xa500, ut_regs_input[0]);
+    TEST_ASSERT_EQUAL_UINT16(0xa501, ut_regs_input[1]);
+
+    /* Still readable as holding registers. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_MAP_SLAVE, UT_MB_MAP_INPUT_START,
+                                    regs, UT_MB_MAP_INPUT_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs_input, regs, UT_MB_MAP_INPUT_REGS);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_count_cb);
+}
+
+/**
+  * @brief  The registers not in one map fall back to the callbacks.
+  */
+TEST(modbus_map, fallback)
+{
+    uint16_t regs_wr[2] = { 0xbeef, 0xcafe, };
+    uint16_t regs[UT_MB_MAP_CB_REGS];
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc16_holding_reg_write(mbm, UT_MB_MAP_SLAVE, 2, regs_wr, 2));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, &ut_regs_cb[2], 2);
+    TEST_ASSERT_EQUAL_UINT32(2, ut_count_cb);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_MAP_SLAVE, 0,
+                                    regs, UT_MB_MAP_CB_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs_cb, regs, UT_MB_MAP_CB_REGS);
+    TEST_ASSERT_EQUAL_UINT32(2 + UT_MB_MAP_CB_REGS, ut_count_cb);
+
+    /* Crossing the end of the map, served by the callbacks out of range. */
+    TEST_ASSERT_NOT_EQUAL(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_MAP_SLAVE,
+                                    UT_MB_MAP_HOLDING_START +
+                                        UT_MB_MAP_HOLDING_REGS - 2,
+                                    regs, 4));
+    TEST_ASSERT_EQUAL_UINT32(0, ut_count_read_hook);
+
+    /* No input register callback, and not mapped. */
+    TEST_ASSERT_NOT_EQUAL(MODBUS_ERR_NONE,
+        mbm_fc04_in_reg_read(mbm, UT_MB_MAP_SLAVE, 0, regs, 4));
+}
+
+/**
+  * @brief  Define run test cases of Modbus slave register maps.
+  */
+TEST_GROUP_RUNNER(modbus_map)
+{
+    RUN_TEST_CASE(modbus_map, read);
+    RUN_TEST_CASE(modbus_map, write);
+    RUN_TEST_CASE(modbus_map, read_only);
+    RUN_TEST_CASE(modbus_map, fallback);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The holding registers out of the maps.
+  */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    ut_count_cb ++;
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MB_MAP_CB_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return 0;
+    }
+
+    return ut_regs_cb[reg];
+}
+
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr)
+{
+    ut_count_cb ++;
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MB_MAP_CB_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return;
+    }
+
+    ut_regs_cb[reg] = reg_val_16;
+}
+
+/**
+  * @brief  The hooks of the holding register map.
+  */
+static void _map_read_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs)
+{
+    (void)start_addr;
+    (void)nbr_regs;
+
+    TEST_ASSERT_EQUAL_PTR(&map_holding, map);
+    ut_count_read_hook ++;
+}
+
+static void _map_write_hook(mb_reg_map_t *map,
+                            uint16_t start_addr, uint16_t nbr_regs)
+{
+    TEST_ASSERT_EQUAL_PTR(&map_holding, map);
+    ut_count_write_hook ++;
+    ut_write_hook_start = start_addr;
+    ut_write_hook_nbr = nbr_regs;
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
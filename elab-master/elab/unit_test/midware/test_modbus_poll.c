@@ -0,0 +1,259 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../edf/driver/simulator/simu_serial.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_poll"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MBM_POLL_SERIAL_M                        "ut_mbm_poll_m"
+#define UT_MBM_POLL_SERIAL_S                        "ut_mbm_poll_s"
+#define UT_MBM_POLL_SLAVE                           (2)
+#define UT_MBM_POLL_SLAVE_NONE                      (3)
+#define UT_MBM_POLL_RX_TIMEOUT                      (200)
+#define UT_MBM_POLL_PERIOD                          (50)
+#define UT_MBM_POLL_TEST_TIME                       (500)
+#define UT_MBM_POLL_WAIT_MAX                        (2000)
+#define UT_MBM_POLL_REGS                            (32)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+static uint16_t _in_reg_read(uint16_t reg, uint16_t *perr);
+static uint16_t _poll_wait(uint8_t slave_node, uint8_t fc, uint16_t start_addr,
+                            uint16_t nbr_regs, uint16_t err_expect);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbm = NULL;
+static mb_channel_t *mbs = NULL;
+static mbm_poll_t *poll = NULL;
+
+static mb_channel_cb_t cb_mbs =
+{
+    .holding_reg_read = _holding_reg_read,
+    .in_reg_read = _in_reg_read,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus master polling engine.
+  */
+TEST_GROUP(modbus_poll);
+
+/**
+  * @brief  Define test fixture setup function of Modbus master polling engine.
+  */
+TEST_SETUP(modbus_poll)
+{
+    simu_serial_new_pair(UT_MBM_POLL_SERIAL_M, UT_MBM_POLL_SERIAL_S, 115200);
+    mbm = mb_channel_create(UT_MBM_POLL_SERIAL_M, 0, MODBUS_MASTER,
+                            UT_MBM_POLL_RX_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbm);
+    mbs = mb_channel_create(UT_MBM_POLL_SERIAL_S, UT_MBM_POLL_SLAVE, MODBUS_SLAVE,
+                            UT_MBM_POLL_RX_TIMEOUT, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs);
+    mb_slave_set_cb(mbs, &cb_mbs);
+
+    poll = mbm_poll_create(mbm, 8);
+    TEST_ASSERT_NOT_NULL(poll);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus master polling
+  *         engine.
+  */
+TEST_TEAR_DOWN(modbus_poll)
+{
+    mbm_poll_destroy(poll);
+    mb_channel_destroy(mbs);
+    mb_channel_destroy(mbm);
+    simu_serial_destroy(UT_MBM_POLL_SERIAL_S);
+    simu_serial_destroy(UT_MBM_POLL_SERIAL_M);
+    poll = NULL;
+    mbs = NULL;
+    mbm = NULL;
+}
+
+/**
+  * @brief  The adjacent and overlapped ranges are merged into one request, and
+  *         the registers are read from the cache.
+  */
+TEST(modbus_poll, coalesce)
+{
+    uint16_t regs[UT_MBM_POLL_REGS];
+    uint32_t age_ms = UINT32_MAX;
+    mbm_poll_stats_t stats;
+
+    /* 100 ~ 119 of FC03 in one block, 300 ~ 303 of FC03 and 100 ~ 101 of FC04
+       in another two. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        100, 10, UT_MBM_POLL_PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        110, 5, UT_MBM_POLL_PERIOD * 2));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        105, 15, UT_MBM_POLL_PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        300, 4, UT_MBM_POLL_PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE, MODBUS_FC04_IN_REG_RD,
+                        100, 2, UT_MBM_POLL_PERIOD));
+
+    /* All the blocks are read once, and then in a few more periods. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        _poll_wait(UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD, 100, 20,
+                    MODBUS_ERR_NONE));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        _poll_wait(UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD, 300, 4,
+                    MODBUS_ERR_NONE));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        _poll_wait(UT_MBM_POLL_SLAVE, MODBUS_FC04_IN_REG_RD, 100, 2,
+                    MODBUS_ERR_NONE));
+    osDelay(UT_MBM_POLL_TEST_TIME);
+
+    /* The registers across the merged ranges. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_read(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        108, regs, 10, &age_ms));
+    for (uint32_t i = 0; i < 10; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(_holding_reg_read(108 + i, NULL), regs[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_read(poll, UT_MBM_POLL_SLAVE, MODBUS_FC04_IN_REG_RD,
+                        100, regs, 2, NULL));
+    TEST_ASSERT_EQUAL_UINT16(_in_reg_read(101, NULL), regs[1]);
+
+    /* The registers not declared. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_RANGE,
+        mbm_poll_read(poll, UT_MBM_POLL_SLAVE, MODBUS_FC03_HOLDING_REG_RD,
+                        118, regs, 4, NULL));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_RANGE,
+        mbm_poll_read(poll, UT_MBM_POLL_SLAVE, MODBUS_FC04_IN_REG_RD,
+                        300, regs, 1, NULL));
+
+    /* About three requests in every period instead of five, with one more
+       round for the first and the last partial periods. The count is bounded
+       by the time the engine has run, not by the time of the test, so a slowly
+       scheduled host only makes it smaller. */
+    mbm_poll_get_stats(poll, &stats);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(stats.time_total_ms, age_ms);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, stats.requests);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(
+        3 * (stats.time_total_ms / UT_MBM_POLL_PERIOD + 2), stats.requests);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.errors);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(stats.requests * 20, stats.regs);
+    TEST_ASSERT_GREATER_THAN_UINT16(0, stats.utilization);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT16(1000, stats.utilization);
+}
+
+/**
+  * @brief  The error of the last request is returned, if the registers have
+  *         not been read.
+  */
+TEST(modbus_poll, slave_absent)
+{
+    uint16_t regs[UT_MBM_POLL_REGS];
+    mbm_poll_stats_t stats;
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_poll_add(poll, UT_MBM_POLL_SLAVE_NONE, MODBUS_FC03_HOLDING_REG_RD,
+                        100, 10, UT_MBM_POLL_PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NO_DATA,
+        mbm_poll_read(poll, UT_MBM_POLL_SLAVE_NONE, MODBUS_FC03_HOLDING_REG_RD,
+                        100, regs, 10, NULL));
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_TIMED_OUT,
+        _poll_wait(UT_MBM_POLL_SLAVE_NONE, MODBUS_FC03_HOLDING_REG_RD, 100, 10,
+                    MODBUS_ERR_TIMED_OUT));
+    mbm_poll_get_stats(poll, &stats);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, stats.errors);
+    TEST_ASSERT_EQUAL_UINT32(stats.requests, stats.errors);
+}
+
+/**
+  * @brief  Define run test cases of Modbus master polling engine.
+  */
+TEST_GROUP_RUNNER(modbus_poll)
+{
+    RUN_TEST_CASE(modbus_poll, coalesce);
+    RUN_TEST_CASE(modbus_poll, slave_absent);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The holding register values of the simulated slave.
+  */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    if (perr != NULL)
+    {
+        *perr = MODBUS_ERR_NONE;
+    }
+
+    return (uint16_t)(reg * 3 + 1);
+}
+
+/**
+  * @brief  The input register values of the simulated slave.
+  */
+static uint16_t _in_reg_read(uint16_t reg, uint16_t *perr)
+{
+    if (perr != NULL)
+    {
+        *perr = MODBUS_ERR_NONE;
+    }
+
+    return (uint16_t)(reg ^ 0x5a5a);
+}
+
+/**
+  * @brief  Wait for the polled registers to be read with the expected result,
+  *         for at most UT_MBM_POLL_WAIT_MAX ms.
+  * @retval The last result of reading.
+  */
+static uint16_t _poll_wait(uint8_t slave_node, uint8_t fc, uint16_t start_addr,
+                            uint16_t nbr_regs, uint16_t err_expect)
+{
+    uint16_t regs[UT_MBM_POLL_REGS];
+    uint32_t time_start = osKernelGetTickCount();
+    uint16_t err = MODBUS_ERR_NO_DATA;
+
+    while (1)
+    {
+        err = mbm_poll_read(poll, slave_node, fc, start_addr, regs, nbr_regs, NULL);
+        if (err == err_expect ||
+            (osKernelGetTickCount() - time_start) >= UT_MBM_POLL_WAIT_MAX)
+        {
+            break;
+        }
+        osDelay(10);
+    }
+
+    return err;
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,274 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__) || defined(_WIN32)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../edf/driver/simulator/simu_serial.h"
+#include "../../elib/elib_crc.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_rtu_rx"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_SLAVE_EN != 0) && (MODBUS_CFG_RTU_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MBS_RTU_SERIAL                           "ut_mbs_rtu_rx"
+#define UT_MBS_RTU_SLAVE                            (5)
+#define UT_MBS_RTU_SLAVE_OTHER                      (6)
+/* The frame gap is 33 ms in 1200 baud, long enough to tell the frame ended by
+   its size from the one ended by the gap. */
+#define UT_MBS_RTU_BAUDRATE                         (1200)
+#define UT_MBS_RTU_GAP                              (33)
+#define UT_MBS_RTU_REPLY_TIMEOUT                    (200)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr);
+static uint16_t _frame_crc_append(uint8_t *frame, uint16_t size);
+static uint16_t _frame_fc03(uint8_t *frame, uint8_t node, uint16_t reg,
+                            uint16_t nbr_regs);
+static void _reply_fc03_check(uint16_t reg, uint16_t nbr_regs);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbs = NULL;
+static uint16_t ut_regs[16];
+
+static mb_channel_cb_t cb_mbs =
+{
+    .holding_reg_read = _holding_reg_read,
+    .holding_reg_write = _holding_reg_write,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus slave RTU frame receiving.
+  */
+TEST_GROUP(modbus_rtu_rx);
+
+/**
+  * @brief  Define test fixture setup function of Modbus slave RTU frame
+  *         receiving.
+  */
+TEST_SETUP(modbus_rtu_rx)
+{
+    for (uint32_t i = 0; i < 16; i ++)
+    {
+        ut_regs[i] = (uint16_t)(0x0100 + i);
+    }
+
+    simu_serial_new(UT_MBS_RTU_SERIAL, SIMU_SERIAL_MODE_SINGLE,
+                    UT_MBS_RTU_BAUDRATE);
+    mbs = mb_channel_create(UT_MBS_RTU_SERIAL, UT_MBS_RTU_SLAVE, MODBUS_SLAVE,
+                            100, MODBUS_MODE_RTU);
+    TEST_ASSERT_NOT_NULL(mbs);
+    mb_slave_set_cb(mbs, &cb_mbs);
+    mb_slave_write_enable(mbs, true);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus slave RTU frame
+  *         receiving.
+  */
+TEST_TEAR_DOWN(modbus_rtu_rx)
+{
+    mb_channel_destroy(mbs);
+    simu_serial_destroy(UT_MBS_RTU_SERIAL);
+    mbs = NULL;
+}
+
+/**
+  * @brief  The request is handled as soon as it is complete, without waiting
+  *         for the frame gap.
+  */
+TEST(modbus_rtu_rx, early_end)
+{
+    uint8_t frame[32];
+    uint16_t size = _frame_fc03(frame, UT_MBS_RTU_SLAVE, 2, 4);
+
+    uint32_t time_start = elab_time_ms();
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame, size);
+    _reply_fc03_check(2, 4);
+    TEST_ASSERT_LESS_THAN_UINT32(UT_MBS_RTU_GAP, elab_time_ms() - time_start);
+}
+
+/**
+  * @brief  The FC16 request arriving in pieces is assembled by its byte count.
+  */
+TEST(modbus_rtu_rx, split)
+{
+    uint8_t frame[32] =
+    {
+        UT_MBS_RTU_SLAVE, MODBUS_FC16_HOLDING_REG_WR_MULTIPLE,
+        0x00, 0x03, 0x00, 0x02, 0x04, 0x12, 0x34, 0x56, 0x78,
+    };
+    uint8_t reply[8];
+    uint16_t size = _frame_crc_append(frame, 11);
+
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame, 5);
+    osDelay(2);
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, &frame[5], 4);
+    osDelay(2);
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, &frame[9], size - 9);
+
+    TEST_ASSERT_EQUAL_INT32(8, simu_serial_read_tx_data(UT_MBS_RTU_SERIAL,
+                                                        reply, 8,
+                                                        UT_MBS_RTU_REPLY_TIMEOUT));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, reply, 6);
+    TEST_ASSERT_EQUAL_UINT16(0x1234, ut_regs[3]);
+    TEST_ASSERT_EQUAL_UINT16(0x5678, ut_regs[4]);
+}
+
+/**
+  * @brief  The frame to the other node on the line is ended by the gap, and
+  *         the next request to this node is still handled.
+  */
+TEST(modbus_rtu_rx, other_node)
+{
+    uint8_t frame[32];
+    uint8_t reply[16];
+
+    /* The reply of the other slave, which is not sized as a request. */
+    uint8_t frame_other[16] =
+    {
+        UT_MBS_RTU_SLAVE_OTHER, MODBUS_FC03_HOLDING_REG_RD,
+        0x04, 0x00, 0x01, 0x00, 0x02,
+    };
+    uint16_t size = _frame_crc_append(frame_other, 7);
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame_other, size);
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT,
+        simu_serial_read_tx_data(UT_MBS_RTU_SERIAL, reply, sizeof(reply),
+                                    UT_MBS_RTU_GAP * 2));
+
+    size = _frame_fc03(frame, UT_MBS_RTU_SLAVE, 0, 3);
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame, size);
+    _reply_fc03_check(0, 3);
+}
+
+/**
+  * @brief  The request with a wrong CRC is dropped without any reply.
+  */
+TEST(modbus_rtu_rx, bad_crc)
+{
+    uint8_t frame[32];
+    uint8_t reply[16];
+    uint16_t size = _frame_fc03(frame, UT_MBS_RTU_SLAVE, 0, 2);
+
+    frame[size - 1] ^= 0xff;
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame, size);
+    TEST_ASSERT_EQUAL_INT32(ELAB_ERR_TIMEOUT,
+        simu_serial_read_tx_data(UT_MBS_RTU_SERIAL, reply, sizeof(reply),
+                                    UT_MBS_RTU_GAP * 2));
+
+    frame[size - 1] ^= 0xff;
+    simu_serial_make_rx_data(UT_MBS_RTU_SERIAL, frame, size);
+    _reply_fc03_check(0, 2);
+}
+
+/**
+  * @brief  Define run test cases of Modbus slave RTU frame receiving.
+  */
+TEST_GROUP_RUNNER(modbus_rtu_rx)
+{
+    RUN_TEST_CASE(modbus_rtu_rx, early_end);
+    RUN_TEST_CASE(modbus_rtu_rx, split);
+    RUN_TEST_CASE(modbus_rtu_rx, other_node);
+    RUN_TEST_CASE(modbus_rtu_rx, bad_crc);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The holding registers of the simulated slave.
+  */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= 16)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return 0;
+    }
+
+    return ut_regs[reg];
+}
+
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= 16)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return;
+    }
+
+    ut_regs[reg] = reg_val_16;
+}
+
+/**
+  * @brief  Append the CRC to the frame, low byte first.
+  */
+static uint16_t _frame_crc_append(uint8_t *frame, uint16_t size)
+{
+    uint16_t crc = elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT, frame, size);
+
+    frame[size] = (uint8_t)(crc & 0x00ff);
+    frame[size + 1] = (uint8_t)(crc >> 8);
+
+    return size + 2;
+}
+
+/**
+  * @brief  Make the FC03 request frame.
+  */
+static uint16_t _frame_fc03(uint8_t *frame, uint8_t node, uint16_t reg,
+                            uint16_t nbr_regs)
+{
+    frame[0] = node;
+    frame[1] = MODBUS_FC03_HOLDING_REG_RD;
+    frame[2] = (uint8_t)(reg >> 8);
+    frame[3] = (uint8_t)(reg & 0x00ff);
+    frame[4] = (uint8_t)(nbr_regs >> 8);
+    frame[5] = (uint8_t)(nbr_regs & 0x00ff);
+
+    return _frame_crc_append(frame, 6);
+}
+
+/**
+  * @brief  Check the FC03 reply of the slave.
+  */
+static void _reply_fc03_check(uint16_t reg, uint16_t nbr_regs)
+{
+    uint8_t reply[64];
+    uint16_t size = 5 + nbr_regs * 2;
+
+    TEST_ASSERT_EQUAL_INT32(size, simu_serial_read_tx_data(UT_MBS_RTU_SERIAL,
+                                                    reply, size,
+                                                    UT_MBS_RTU_REPLY_TIMEOUT));
+    TEST_ASSERT_EQUAL_UINT8(UT_MBS_RTU_SLAVE, reply[0]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_FC03_HOLDING_REG_RD, reply[1]);
+    TEST_ASSERT_EQUAL_UINT8(nbr_regs * 2, reply[2]);
+    for (uint16_t i = 0; i < nbr_regs; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(ut_regs[reg + i],
+                            ((uint16_t)reply[3 + i * 2] << 8) + reply[4 + i * 2]);
+    }
+    TEST_ASSERT_EQUAL_UINT16(elib_crc16_modbus(ELIB_CRC16_MODBUS_INIT,
+                                                reply, size - 2),
+                            ((uint16_t)reply[size - 1] << 8) + reply[size - 2]);
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
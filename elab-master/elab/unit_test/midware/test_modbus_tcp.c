@@ -0,0 +1,378 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../../midware/modbus/modbus.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_modbus_tcp"
+#include "../../common/elab_log.h"
+
+#if (MODBUS_CFG_TCP_EN != 0) && \
+    (MODBUS_CFG_MASTER_EN != 0) && (MODBUS_CFG_SLAVE_EN != 0)
+
+/* Private config ------------------------------------------------------------*/
+#define UT_MB_TCP_HOST                              "127.0.0.1"
+#define UT_MB_TCP_PORT                              (15020)
+#define UT_MB_TCP_SLAVE                             (2)
+#define UT_MB_TCP_RX_TIMEOUT                        (500)
+#define UT_MB_TCP_REGS                              (32)
+#define UT_MB_TCP_CLIENTS                           (3)
+#define UT_MB_TCP_REQUESTS                          (50)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr);
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr);
+static uint16_t _in_reg_read(uint16_t reg, uint16_t *perr);
+static void _entry_client(void *para);
+static int _raw_connect(void);
+static void _raw_request(uint8_t *buff, uint16_t trans_id, uint8_t unit,
+                            uint16_t start_addr, uint16_t nbr_regs);
+
+/* Private variables ---------------------------------------------------------*/
+static mb_channel_t *mbs = NULL;
+static uint16_t ut_regs[UT_MB_TCP_REGS];
+static osSemaphoreId_t sem_client = NULL;
+static uint32_t ut_client_errors = 0;
+
+static mb_channel_cb_t cb_mbs =
+{
+    .holding_reg_read = _holding_reg_read,
+    .holding_reg_write = _holding_reg_write,
+    .in_reg_read = _in_reg_read,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of Modbus TCP.
+  */
+TEST_GROUP(modbus_tcp);
+
+/**
+  * @brief  Define test fixture setup function of Modbus TCP.
+  */
+TEST_SETUP(modbus_tcp)
+{
+    for (uint32_t i = 0; i < UT_MB_TCP_REGS; i ++)
+    {
+        ut_regs[i] = (uint16_t)(i * 7 + 3);
+    }
+
+    mbs = mb_channel_create_tcp(UT_MB_TCP_HOST, UT_MB_TCP_PORT,
+                                UT_MB_TCP_SLAVE, MODBUS_SLAVE, 0);
+    TEST_ASSERT_NOT_NULL(mbs);
+    mb_slave_set_cb(mbs, &cb_mbs);
+    mb_slave_write_enable(mbs, true);
+}
+
+/**
+  * @brief  Define test fixture tear down function of Modbus TCP.
+  */
+TEST_TEAR_DOWN(modbus_tcp)
+{
+    mb_channel_destroy(mbs);
+    mbs = NULL;
+}
+
+/**
+  * @brief  The master functions work on the TCP channel in the same way as on
+  *         the serial one.
+  */
+TEST(modbus_tcp, read_write)
+{
+    uint16_t regs_wr[4] = { 0x1111, 0x2222, 0x3333, 0x4444, };
+    uint16_t regs[UT_MB_TCP_REGS];
+
+    mb_channel_t *mbm = mb_channel_create_tcp(UT_MB_TCP_HOST, UT_MB_TCP_PORT, 0,
+                                                MODBUS_MASTER,
+                                                UT_MB_TCP_RX_TIMEOUT);
+    TEST_ASSERT_NOT_NULL(mbm);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_TCP_SLAVE, 0, regs, UT_MB_TCP_REGS));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(ut_regs, regs, UT_MB_TCP_REGS);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc16_holding_reg_write(mbm, UT_MB_TCP_SLAVE, 8, regs_wr, 4));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc06_holding_reg_write(mbm, UT_MB_TCP_SLAVE, 20, 0xabcd));
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(regs_wr, &ut_regs[8], 4);
+    TEST_ASSERT_EQUAL_UINT16(0xabcd, ut_regs[20]);
+
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc04_in_reg_read(mbm, UT_MB_TCP_SLAVE, 100, regs, 2));
+    TEST_ASSERT_EQUAL_UINT16(_in_reg_read(101, NULL), regs[1]);
+
+    /* No response to the other unit. */
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_TIMED_OUT,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_TCP_SLAVE + 1, 0, regs, 1));
+    TEST_ASSERT_EQUAL_UINT16(MODBUS_ERR_NONE,
+        mbm_fc03_holding_reg_read(mbm, UT_MB_TCP_SLAVE, 0, regs, 1));
+
+    mb_channel_destroy(mbm);
+}
+
+/**
+  * @brief  The concurrent clients are served by the only server thread.
+  */
+TEST(modbus_tcp, clients)
+{
+    osThreadId_t thread[UT_MB_TCP_CLIENTS];
+
+    ut_client_errors = 0;
+    sem_client = osSemaphoreNew(UT_MB_TCP_CLIENTS, 0, NULL);
+    TEST_ASSERT_NOT_NULL(sem_client);
+
+    for (uint32_t i = 0; i < UT_MB_TCP_CLIENTS; i ++)
+    {
+        thread[i] = osThreadNew(_entry_client, NULL, NULL);
+        TEST_ASSERT_NOT_NULL(thread[i]);
+    }
+    for (uint32_t i = 0; i < UT_MB_TCP_CLIENTS; i ++)
+    {
+        TEST_ASSERT_EQUAL(osOK, osSemaphoreAcquire(sem_client, 5000));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, ut_client_errors);
+    osSemaphoreDelete(sem_client);
+    sem_client = NULL;
+}
+
+/**
+  * @brief  The requests in one segment and the request in pieces are all
+  *         responded, with their transaction ID and unit.
+  */
+TEST(modbus_tcp, framing)
+{
+    uint8_t req[36];
+    uint8_t resp[64];
+    int fd = _raw_connect();
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(0, fd);
+
+    /* Two requests in one segment, the second to the server itself. */
+    _raw_request(&req[0], 0x1001, UT_MB_TCP_SLAVE, 2, 2);
+    _raw_request(&req[12], 0x1002, MODBUS_TCP_UNIT_SELF, 4, 1);
+    TEST_ASSERT_EQUAL_INT(24, send(fd, req, 24, 0));
+
+    /* One request in two pieces. */
+    _raw_request(&req[24], 0x1003, UT_MB_TCP_SLAVE, 6, 1);
+    TEST_ASSERT_EQUAL_INT(5, send(fd, &req[24], 5, 0));
+    osDelay(20);
+    TEST_ASSERT_EQUAL_INT(7, send(fd, &req[29], 7, 0));
+
+    /* 13 bytes for two registers, and 11 bytes for one each. */
+    uint32_t count = 0;
+    while (count < (13 + 11 + 11))
+    {
+        ssize_t ret = recv(fd, &resp[count], sizeof(resp) - count, 0);
+        TEST_ASSERT_GREATER_THAN_INT(0, ret);
+        count += ret;
+    }
+    TEST_ASSERT_EQUAL_UINT32(13 + 11 + 11, count);
+
+    TEST_ASSERT_EQUAL_HEX8(0x10, resp[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, resp[1]);
+    TEST_ASSERT_EQUAL_UINT8(7, resp[5]);
+    TEST_ASSERT_EQUAL_UINT8(UT_MB_TCP_SLAVE, resp[6]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_FC03_HOLDING_REG_RD, resp[7]);
+    TEST_ASSERT_EQUAL_UINT8(4, resp[8]);
+    TEST_ASSERT_EQUAL_UINT16(ut_regs[3], ((uint16_t)resp[11] << 8) + resp[12]);
+
+    TEST_ASSERT_EQUAL_HEX8(0x02, resp[14]);
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_TCP_UNIT_SELF, resp[19]);
+    TEST_ASSERT_EQUAL_UINT16(ut_regs[4], ((uint16_t)resp[22] << 8) + resp[23]);
+
+    TEST_ASSERT_EQUAL_HEX8(0x03, resp[25]);
+    TEST_ASSERT_EQUAL_UINT16(ut_regs[6], ((uint16_t)resp[33] << 8) + resp[34]);
+
+    close(fd);
+}
+
+/**
+  * @brief  The master gives up connecting to the server not answering in its
+  *         rx timeout, instead of waiting for the kernel SYN retries.
+  */
+TEST(modbus_tcp, connect_timeout)
+{
+    /* The server whose accept queue is full drops the later SYNs. */
+    int fd_listen = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT(0, fd_listen);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(UT_MB_TCP_PORT + 1);
+    addr.sin_addr.s_addr = inet_addr(UT_MB_TCP_HOST);
+    int opt = 1;
+    setsockopt(fd_listen, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    TEST_ASSERT_EQUAL_INT(0, bind(fd_listen, (struct sockaddr *)&addr,
+                                    sizeof(addr)));
+    TEST_ASSERT_EQUAL_INT(0, listen(fd_listen, 0));
+
+    int fd[UT_MB_TCP_CLIENTS];
+    for (uint32_t i = 0; i < UT_MB_TCP_CLIENTS; i ++)
+    {
+        fd[i] = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        TEST_ASSERT_GREATER_OR_EQUAL_INT(0, fd[i]);
+        connect(fd[i], (struct sockaddr *)&addr, sizeof(addr));
+    }
+    osDelay(50);
+
+    uint32_t time_start = elab_time_ms();
+    mb_channel_t *mbm = mb_channel_create_tcp(UT_MB_TCP_HOST,
+                                                UT_MB_TCP_PORT + 1,
+                                                UT_MB_TCP_SLAVE, MODBUS_MASTER,
+                                                200);
+    uint32_t time_cost = elab_time_ms() - time_start;
+    TEST_ASSERT_NULL(mbm);
+    TEST_ASSERT_LESS_THAN_UINT32(1000, time_cost);
+
+    for (uint32_t i = 0; i < UT_MB_TCP_CLIENTS; i ++)
+    {
+        close(fd[i]);
+    }
+    close(fd_listen);
+}
+
+/**
+  * @brief  Define run test cases of Modbus TCP.
+  */
+TEST_GROUP_RUNNER(modbus_tcp)
+{
+    RUN_TEST_CASE(modbus_tcp, read_write);
+    RUN_TEST_CASE(modbus_tcp, clients);
+    RUN_TEST_CASE(modbus_tcp, framing);
+    RUN_TEST_CASE(modbus_tcp, connect_timeout);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The registers of the simulated slave.
+  */
+static uint16_t _holding_reg_read(uint16_t reg, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MB_TCP_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return 0;
+    }
+
+    return ut_regs[reg];
+}
+
+static void _holding_reg_write(uint16_t reg, uint16_t reg_val_16, uint16_t *perr)
+{
+    *perr = MODBUS_ERR_NONE;
+    if (reg >= UT_MB_TCP_REGS)
+    {
+        *perr = MODBUS_ERR_RANGE;
+        return;
+    }
+
+    ut_regs[reg] = reg_val_16;
+}
+
+static uint16_t _in_reg_read(uint16_t reg, uint16_t *perr)
+{
+    if (perr != NULL)
+    {
+        *perr = MODBUS_ERR_NONE;
+    }
+
+    return (uint16_t)(reg ^ 0x5a5a);
+}
+
+/**
+  * @brief  The client thread, with its own master channel.
+  */
+static void _entry_client(void *para)
+{
+    (void)para;
+    uint16_t regs[UT_MB_TCP_REGS];
+
+    mb_channel_t *mbm = mb_channel_create_tcp(UT_MB_TCP_HOST, UT_MB_TCP_PORT, 0,
+                                                MODBUS_MASTER,
+                                                UT_MB_TCP_RX_TIMEOUT);
+    if (mbm == NULL)
+    {
+        elab_atomic_add(&ut_client_errors, UT_MB_TCP_REQUESTS);
+        osSemaphoreRelease(sem_client);
+        return;
+    }
+
+    for (uint32_t i = 0; i < UT_MB_TCP_REQUESTS; i ++)
+    {
+        uint16_t err = mbm_fc03_holding_reg_read(mbm, UT_MB_TCP_SLAVE, 0,
+                                                    regs, UT_MB_TCP_REGS);
+        if (err != MODBUS_ERR_NONE ||
+            memcmp(regs, ut_regs, sizeof(regs)) != 0)
+        {
+            elab_atomic_add(&ut_client_errors, 1);
+        }
+    }
+
+    mb_channel_destroy(mbm);
+    osSemaphoreRelease(sem_client);
+}
+
+/**
+  * @brief  Connect to the slave by a raw socket.
+  */
+static int _raw_connect(void)
+{
+    struct sockaddr_in addr =
+    {
+        .sin_family = AF_INET,
+        .sin_port = htons(UT_MB_TCP_PORT),
+    };
+    inet_pton(AF_INET, UT_MB_TCP_HOST, &addr.sin_addr);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+  * @brief  Build the FC03 request frame of 12 bytes.
+  */
+static void _raw_request(uint8_t *buff, uint16_t trans_id, uint8_t unit,
+                            uint16_t start_addr, uint16_t nbr_regs)
+{
+    buff[0] = (uint8_t)(trans_id >> 8);
+    buff[1] = (uint8_t)(trans_id & 0xFF);
+    buff[2] = 0;
+    buff[3] = 0;
+    buff[4] = 0;
+    buff[5] = 6;
+    buff[6] = unit;
+    buff[7] = MODBUS_FC03_HOLDING_REG_RD;
+    buff[8] = (uint8_t)(start_addr >> 8);
+    buff[9] = (uint8_t)(start_addr & 0xFF);
+    buff[10] = (uint8_t)(nbr_regs >> 8);
+    buff[11] = (uint8_t)(nbr_regs & 0xFF);
+}
+
+#endif
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
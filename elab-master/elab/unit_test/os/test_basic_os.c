@@ -0,0 +1,362 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+
+/* The ready lists, the delay list and the timer list of BasicOS are private, so
+   the source file is included here. Its port functions are the stubs below. */
+#include "../../os/basic_os/basic_os.c"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_BOS_TASK_NUMBER                          (6)
+#define UT_BOS_TIMER_NUMBER                         (3)
+#define UT_BOS_EXPIRE_MAX                           (16)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct ut_bos_timer
+{
+    uint32_t count;
+    uint32_t time_expire[UT_BOS_EXPIRE_MAX];
+} ut_bos_timer_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static void cb_ut_bos_timer(void *para);
+static void _time_goto(uint32_t time);
+static void _ready_check(uint8_t priority, const uint8_t *order, uint32_t num);
+
+/* Private variables ---------------------------------------------------------*/
+static bos_task_t ut_bos_task[UT_BOS_TASK_NUMBER];
+static bos_timer_t ut_bos_timer_data[UT_BOS_TIMER_NUMBER];
+static ut_bos_timer_t ut_bos_timer[UT_BOS_TIMER_NUMBER];
+static bos_timer_rom_t ut_bos_timer_rom[UT_BOS_TIMER_NUMBER];
+static uint32_t ut_bos_assert = 0;
+static bool ut_bos_cb_unmarked = false;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of basic_os.
+  */
+TEST_GROUP(basic_os);
+
+/**
+  * @brief  Define test fixture setup function of basic_os.
+  */
+TEST_SETUP(basic_os)
+{
+    memset(&bos, 0, sizeof(bos));
+    memset(ut_bos_task, 0, sizeof(ut_bos_task));
+    memset(ut_bos_timer_data, 0, sizeof(ut_bos_timer_data));
+    memset(ut_bos_timer, 0, sizeof(ut_bos_timer));
+    memset(ut_bos_timer_rom, 0, sizeof(ut_bos_timer_rom));
+    ut_bos_assert = 0;
+    ut_bos_cb_unmarked = false;
+    bos_current = NULL;
+    bos_next = NULL;
+
+    for (uint32_t i = 0; i < UT_BOS_TASK_NUMBER; i ++)
+    {
+        ut_bos_task[i].task_id = i;
+    }
+
+    /* The timer table as basic_os_init() gets it from the exported ones. */
+    for (uint32_t i = 0; i < UT_BOS_TIMER_NUMBER; i ++)
+    {
+        ut_bos_timer_rom[i].magic_head = EXPORT_ID_TIMER;
+        ut_bos_timer_rom[i].magic_tail = EXPORT_ID_TIMER;
+        ut_bos_timer_rom[i].func = cb_ut_bos_timer;
+        ut_bos_timer_rom[i].name = "ut_bos_timer";
+        ut_bos_timer_rom[i].parameter = &ut_bos_timer[i];
+        ut_bos_timer_rom[i].data = &ut_bos_timer_data[i];
+        ut_bos_timer_rom[i].oneshoot = false;
+        ut_bos_timer_data[i].id = i;
+    }
+    bos.timer_table = ut_bos_timer_rom;
+    bos.timer_count = UT_BOS_TIMER_NUMBER;
+}
+
+/**
+  * @brief  Define test fixture tear down function of basic_os.
+  */
+TEST_TEAR_DOWN(basic_os)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, ut_bos_assert);
+}
+
+/**
+  * @brief  The head task of the highest ready priority is picked, and the tasks
+  *         in one priority are in the round-robin order.
+  */
+TEST(basic_os, priority_order)
+{
+    const uint8_t priority[UT_BOS_TASK_NUMBER] = { 0, 3, 5, 1, 3, 5, };
+
+    for (uint32_t i = 0; i < UT_BOS_TASK_NUMBER; i ++)
+    {
+        ut_bos_task[i].priority = priority[i];
+        _ready_push(&ut_bos_task[i]);
+        TEST_ASSERT_EQUAL_UINT8(BosTaskState_Ready, ut_bos_task[i].state);
+    }
+    TEST_ASSERT_EQUAL_HEX32(0x2b, bos.ready_bitmap);
+
+    /* Yielding in priority 5 switches between the two tasks of it. */
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[2], _ready_highest());
+    _ready_pop(&ut_bos_task[2]);
+    _ready_push(&ut_bos_task[2]);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[5], _ready_highest());
+    _ready_pop(&ut_bos_task[5]);
+    _ready_push(&ut_bos_task[5]);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[2], _ready_highest());
+
+    /* Blocking the tasks one by one goes down the priorities. */
+    const uint8_t order[UT_BOS_TASK_NUMBER] = { 2, 5, 1, 4, 3, 0, };
+    for (uint32_t i = 0; i < UT_BOS_TASK_NUMBER; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&ut_bos_task[order[i]], _ready_highest());
+        _ready_pop(&ut_bos_task[order[i]]);
+    }
+    TEST_ASSERT_EQUAL_HEX32(0, bos.ready_bitmap);
+    for (uint32_t i = 0; i <= BOS_MAX_PRIORITY; i ++)
+    {
+        TEST_ASSERT_NULL(bos.ready_head[i]);
+        TEST_ASSERT_NULL(bos.ready_tail[i]);
+    }
+
+    /* The task ready again goes to the tail of its priority. */
+    _ready_push(&ut_bos_task[4]);
+    _ready_push(&ut_bos_task[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x08, bos.ready_bitmap);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[4], _ready_highest());
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[1], bos.ready_tail[3]);
+}
+
+/**
+  * @brief  The delayed tasks wake up in the order of their timeout time, the
+  *         ones with the same timeout time in the order of delaying.
+  */
+TEST(basic_os, delay_wakeup_order)
+{
+    const uint32_t delay[UT_BOS_TASK_NUMBER] = { 30, 10, 20, 10, 3, 60, };
+
+    for (uint32_t i = 0; i < UT_BOS_TASK_NUMBER; i ++)
+    {
+        ut_bos_task[i].priority = 2;
+    }
+
+    _time_goto(100);
+    for (uint32_t i = 0; i < 4; i ++)
+    {
+        _delay_insert(&ut_bos_task[i], delay[i]);
+    }
+
+    /* Every node keeps the delta to the previous one. */
+    const uint8_t order[] = { 1, 3, 2, 0, };
+    const uint32_t delta[] = { 10, 0, 10, 10, };
+    bos_task_t *task = bos.delay_list;
+    for (uint32_t i = 0; i < sizeof(order); i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&ut_bos_task[order[i]], task);
+        TEST_ASSERT_EQUAL_UINT32(delta[i], task->timeout);
+        task = task->next;
+    }
+    TEST_ASSERT_NULL(task);
+
+    /* Nobody wakes up early, and the head delta goes down with the time. */
+    _time_goto(105);
+    TEST_ASSERT_EQUAL_HEX32(0, bos.ready_bitmap);
+    TEST_ASSERT_EQUAL_UINT32(5, bos.delay_list->timeout);
+
+    /* The tasks delayed later may wake up earlier, or in the same tick. */
+    _delay_insert(&ut_bos_task[4], delay[4]);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[4], bos.delay_list);
+    _time_goto(108);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[4], _ready_highest());
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[1], bos.delay_list);
+    TEST_ASSERT_EQUAL_UINT32(2, bos.delay_list->timeout);
+
+    _time_goto(110);
+    const uint8_t ready_110[] = { 4, 1, 3, };
+    _ready_check(2, ready_110, sizeof(ready_110));
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[2], bos.delay_list);
+
+    /* The ticks missed by the idle task wake all the timeout tasks at once. */
+    _delay_insert(&ut_bos_task[5], delay[5]);
+    _time_goto(140);
+    const uint8_t ready_140[] = { 4, 1, 3, 2, 0, };
+    _ready_check(2, ready_140, sizeof(ready_140));
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[5], bos.delay_list);
+    TEST_ASSERT_EQUAL_UINT32(30, bos.delay_list->timeout);
+    TEST_ASSERT_NULL(bos.delay_list->next);
+
+    _time_goto(170);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[5], bos.ready_tail[2]);
+    TEST_ASSERT_NULL(bos.delay_list);
+}
+
+/**
+  * @brief  The timers expire at their timeout time, the periodic ones never
+  *         drifting even if the ticks are checked late.
+  */
+TEST(basic_os, timer_expiry)
+{
+    ut_bos_timer_rom[1].oneshoot = true;
+
+    _time_goto(3);
+    bos_timer_start(0, 10);
+    bos_timer_start(1, 25);
+    bos_timer_start(2, 7);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_bos_timer_data[1].running);
+
+    /* Checked in every tick. */
+    for (uint32_t time = 4; time <= 33; time ++)
+    {
+        _time_goto(time);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, ut_bos_timer[0].count);
+    TEST_ASSERT_EQUAL_UINT32(13, ut_bos_timer[0].time_expire[0]);
+    TEST_ASSERT_EQUAL_UINT32(23, ut_bos_timer[0].time_expire[1]);
+    TEST_ASSERT_EQUAL_UINT32(33, ut_bos_timer[0].time_expire[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_bos_timer[1].count);
+    TEST_ASSERT_EQUAL_UINT32(28, ut_bos_timer[1].time_expire[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_bos_timer_data[1].running);
+    TEST_ASSERT_EQUAL_UINT32(4, ut_bos_timer[2].count);
+    TEST_ASSERT_EQUAL_UINT32(31, ut_bos_timer[2].time_expire[3]);
+    TEST_ASSERT_FALSE(ut_bos_cb_unmarked);
+
+    /* Stopping the timer in the middle of the list keeps the later ones. */
+    bos_timer_stop(2);
+    TEST_ASSERT_EQUAL_UINT32(0, ut_bos_timer_data[2].running);
+
+    /* Checked late, the missed periods are all called back at once, and the
+       next timeout time is still in the period from the starting time. */
+    _time_goto(58);
+    TEST_ASSERT_EQUAL_UINT32(5, ut_bos_timer[0].count);
+    TEST_ASSERT_EQUAL_UINT32(58, ut_bos_timer[0].time_expire[4]);
+    _time_goto(62);
+    TEST_ASSERT_EQUAL_UINT32(5, ut_bos_timer[0].count);
+    _time_goto(63);
+    TEST_ASSERT_EQUAL_UINT32(6, ut_bos_timer[0].count);
+    TEST_ASSERT_EQUAL_UINT32(4, ut_bos_timer[2].count);
+    TEST_ASSERT_EQUAL_UINT32(1, ut_bos_timer[1].count);
+
+    /* Starting the running timer again starts it from now. */
+    _time_goto(65);
+    bos_timer_reset(0, 4);
+    _time_goto(68);
+    TEST_ASSERT_EQUAL_UINT32(6, ut_bos_timer[0].count);
+    _time_goto(69);
+    TEST_ASSERT_EQUAL_UINT32(7, ut_bos_timer[0].count);
+    bos_timer_stop(0);
+    TEST_ASSERT_NULL(bos.timer_list);
+    _time_goto(100);
+    TEST_ASSERT_EQUAL_UINT32(7, ut_bos_timer[0].count);
+}
+
+/**
+  * @brief  Define run test cases of basic_os
+  */
+TEST_GROUP_RUNNER(basic_os)
+{
+    RUN_TEST_CASE(basic_os, priority_order);
+    RUN_TEST_CASE(basic_os, delay_wakeup_order);
+    RUN_TEST_CASE(basic_os, timer_expiry);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Set the BasicOS time and check the delay list and the timer list as
+  *         the idle task does.
+  */
+static void _time_goto(uint32_t time)
+{
+    bos.time = time;
+    bos_check_timer(false);
+}
+
+/**
+  * @brief  Check the ready list of the given priority is in the given order.
+  */
+static void _ready_check(uint8_t priority, const uint8_t *order, uint32_t num)
+{
+    bos_task_t *task = bos.ready_head[priority];
+
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&ut_bos_task[order[i]], task);
+        task = task->next;
+    }
+    TEST_ASSERT_NULL(task);
+    TEST_ASSERT_EQUAL_PTR(&ut_bos_task[order[num - 1]], bos.ready_tail[priority]);
+}
+
+/**
+  * @brief  Callback function for timer testing.
+  */
+static void cb_ut_bos_timer(void *para)
+{
+    ut_bos_timer_t *timer = (ut_bos_timer_t *)para;
+
+    if (!bos.timer_cb_runing)
+    {
+        ut_bos_cb_unmarked = true;
+    }
+    if (timer->count < UT_BOS_EXPIRE_MAX)
+    {
+        timer->time_expire[timer->count] = bos.time;
+    }
+    timer->count ++;
+}
+
+/* BasicOS port stubs --------------------------------------------------------*/
+void bos_critical_enter(void)
+{
+}
+
+void bos_critical_exit(void)
+{
+}
+
+void bos_port_assert(uint32_t error_id)
+{
+    ut_bos_assert = error_id;
+}
+
+uint32_t get_sp_value(void)
+{
+    return 0;
+}
+
+void bos_cpu_hw_init(void)
+{
+}
+
+void *bos_cpu_stack_init(bos_task_rom_t *task_info)
+{
+    (void)task_info;
+
+    return NULL;
+}
+
+void bos_cpu_trig_task_switch(void)
+{
+}
+
+void bos_hook_idle(void)
+{
+}
+
+void bos_hook_start(void)
+{
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
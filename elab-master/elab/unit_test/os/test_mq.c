@@ -22,6 +22,7 @@
 /* Private config ------------------------------------------------------------*/
 #define UT_SIMU_MQ_BUFF_SIZE                        (256)
 #define UT_SIMU_MQ_TIMES                            (1000)
+#define UT_MQ_BATCH_CAPACITY                        (16)
 
 #define UT_STR_READ                                 "dev_read_data"
 #define UT_STR_WRITE                                "dev_write_data"
@@ -123,12 +124,119 @@ TEST(mq, rx_tx_cross_thread)
     TEST_ASSERT(ret_os == osOK);
 }
 
+/**
+  * @brief  Messages in different priorities, and the no-wait and timeout cases.
+  */
+TEST(mq, priority_timeout)
+{
+    osMessageQueueId_t mq_prio = osMessageQueueNew(8, sizeof(uint32_t), NULL);
+    TEST_ASSERT_NOT_NULL(mq_prio);
+    TEST_ASSERT_EQUAL_UINT32(8, osMessageQueueGetCapacity(mq_prio));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(uint32_t), osMessageQueueGetMsgSize(mq_prio));
+
+    /* Empty queue. */
+    uint32_t data = 0;
+    uint8_t prio = 0;
+    uint32_t time_start = osKernelGetTickCount();
+    TEST_ASSERT(osMessageQueueGet(mq_prio, &data, NULL, 0) == osErrorResource);
+    TEST_ASSERT(osMessageQueueGet(mq_prio, &data, NULL, 20) == osErrorTimeout);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(20, osKernelGetTickCount() - time_start);
+
+    /* The higher priority first, and FIFO in the same priority. */
+    const uint32_t data_put[] = { 0, 1, 10, 2, 11, 20, 3, 12, };
+    const uint8_t prio_put[] = { 0, 0, 1, 0, 1, 2, 0, 1, };
+    const uint32_t data_get[] = { 20, 10, 11, 12, 0, 1, 2, 3, };
+    for (uint32_t i = 0; i < 8; i ++)
+    {
+        TEST_ASSERT(osMessageQueuePut(mq_prio, &data_put[i], prio_put[i], 0) == osOK);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, osMessageQueueGetCount(mq_prio));
+    TEST_ASSERT_EQUAL_UINT32(0, osMessageQueueGetSpace(mq_prio));
+
+    /* Full queue. */
+    time_start = osKernelGetTickCount();
+    TEST_ASSERT(osMessageQueuePut(mq_prio, &data, 0, 0) == osErrorResource);
+    TEST_ASSERT(osMessageQueuePut(mq_prio, &data, 0, 20) == osErrorTimeout);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(20, osKernelGetTickCount() - time_start);
+
+    for (uint32_t i = 0; i < 8; i ++)
+    {
+        TEST_ASSERT(osMessageQueueGet(mq_prio, &data, &prio, 0) == osOK);
+        TEST_ASSERT_EQUAL_UINT32(data_get[i], data);
+        TEST_ASSERT_EQUAL_UINT32((data_get[i] / 10), prio);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, osMessageQueueGetCount(mq_prio));
+
+    TEST_ASSERT(osMessageQueueDelete(mq_prio) == osOK);
+}
+
+/**
+  * @brief  Messages put and got in batches, wrapping around the ring buffer.
+  */
+TEST(mq, batch)
+{
+    osMessageQueueId_t mq_batch = osMessageQueueNew(UT_MQ_BATCH_CAPACITY, 1, NULL);
+    TEST_ASSERT_NOT_NULL(mq_batch);
+
+    uint8_t data[UT_MQ_BATCH_CAPACITY * 2];
+    uint8_t prio[UT_MQ_BATCH_CAPACITY * 2];
+    uint8_t data_expected = 0;
+    uint8_t data_next = 0;
+    for (uint32_t i = 0; i < UT_SIMU_MQ_TIMES; i ++)
+    {
+        /* Put more than the space, and only the space is filled. */
+        uint32_t count = (rand() % UT_MQ_BATCH_CAPACITY) + 1;
+        uint32_t space = osMessageQueueGetSpace(mq_batch);
+        for (uint32_t m = 0; m < count; m ++)
+        {
+            data[m] = data_next + m;
+        }
+        int32_t ret = osMessageQueuePutN(mq_batch, data, count, 0, 0);
+        if (space == 0)
+        {
+            TEST_ASSERT_EQUAL_INT32(osErrorResource, ret);
+            ret = 0;
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_INT32(((count < space) ? count : space), ret);
+        }
+        data_next += ret;
+
+        /* Get what in the queue at most. */
+        uint32_t queued = osMessageQueueGetCount(mq_batch);
+        count = (rand() % UT_MQ_BATCH_CAPACITY) + 1;
+        ret = osMessageQueueGetN(mq_batch, data, count, prio, 0);
+        TEST_ASSERT_EQUAL_INT32(((count < queued) ? count : queued), ret);
+        for (int32_t m = 0; m < ret; m ++)
+        {
+            TEST_ASSERT_EQUAL_UINT8(data_expected, data[m]);
+            TEST_ASSERT_EQUAL_UINT8(0, prio[m]);
+            data_expected ++;
+        }
+    }
+
+    /* The batch of the higher priority is inserted before the queued ones. */
+    osMessageQueueReset(mq_batch);
+    uint8_t data_low[2] = { 1, 2, };
+    uint8_t data_high[3] = { 3, 4, 5, };
+    const uint8_t data_order[5] = { 3, 4, 5, 1, 2, };
+    TEST_ASSERT_EQUAL_INT32(2, osMessageQueuePutN(mq_batch, data_low, 2, 0, 0));
+    TEST_ASSERT_EQUAL_INT32(3, osMessageQueuePutN(mq_batch, data_high, 3, 1, 0));
+    TEST_ASSERT_EQUAL_INT32(5, osMessageQueueGetN(mq_batch, data, 8, NULL, 0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data_order, data, 5);
+
+    TEST_ASSERT(osMessageQueueDelete(mq_batch) == osOK);
+}
+
 /**
   * @brief  Define run test cases of device core
   */
 TEST_GROUP_RUNNER(mq)
 {
     RUN_TEST_CASE(mq, rx_tx_cross_thread);
+    RUN_TEST_CASE(mq, priority_timeout);
+    RUN_TEST_CASE(mq, batch);
 }
 
 /* Private functions ---------------------------------------------------------*/
@@ -35,6 +35,7 @@ typedef struct ut_mutex
 
 /* Private function prototypes -----------------------------------------------*/
 static void entry_mutex_test(void *paras);
+static void entry_mutex_hold(void *paras);
 
 /* Private variables ---------------------------------------------------------*/
 static uint8_t *shared_data = NULL;
@@ -42,6 +43,7 @@ static osMutexId_t mutex = NULL;
 static ut_mutex_t *ut_mutex[UT_MUTEX_TEST_NUMBER];
 static osSemaphoreId_t sem_one_time = NULL;
 static uint64_t flag_mutex_tested = 0;
+static osSemaphoreId_t sem_hold = NULL;
 
 static const osMutexAttr_t mutex_attr =
 {
@@ -51,6 +53,14 @@ static const osMutexAttr_t mutex_attr =
     0U 
 };
 
+static const osMutexAttr_t mutex_attr_normal =
+{
+    "ut_mutex_normal", 
+    osMutexPrioInherit, 
+    NULL, 
+    0U 
+};
+
 /* Exported functions --------------------------------------------------------*/
 /**
   * @brief  Define test group of mutex.
@@ -136,12 +146,78 @@ TEST(mutex, test)
     }
 }
 
+/**
+  * @brief  Mutex recursion, timeout and error cases.
+  */
+TEST(mutex, recursive_timeout)
+{
+    osStatus_t ret_os = osOK;
+    uint32_t time_start = 0;
+
+    TEST_ASSERT_EQUAL_STRING("ut_mutex", osMutexGetName(mutex));
+
+    /* Recursive locking. */
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        ret_os = osMutexAcquire(mutex, (i == 0) ? osWaitForever : 0);
+        TEST_ASSERT(ret_os == osOK);
+    }
+    for (uint32_t i = 0; i < 3; i ++)
+    {
+        ret_os = osMutexRelease(mutex);
+        TEST_ASSERT(ret_os == osOK);
+    }
+    TEST_ASSERT(osMutexRelease(mutex) == osErrorResource);
+
+    /* The non-recursive mutex can not be locked again by the owner. */
+    osMutexId_t mutex_normal = osMutexNew(&mutex_attr_normal);
+    TEST_ASSERT_NOT_NULL(mutex_normal);
+    TEST_ASSERT(osMutexAcquire(mutex_normal, osWaitForever) == osOK);
+    TEST_ASSERT(osMutexAcquire(mutex_normal, 0) == osErrorResource);
+    TEST_ASSERT(osMutexAcquire(mutex_normal, 10) == osErrorResource);
+    TEST_ASSERT(osMutexRelease(mutex_normal) == osOK);
+    TEST_ASSERT(osMutexDelete(mutex_normal) == osOK);
+
+    /* The default attributes. */
+    osMutexId_t mutex_default = osMutexNew(NULL);
+    TEST_ASSERT_NOT_NULL(mutex_default);
+    TEST_ASSERT(osMutexAcquire(mutex_default, 0) == osOK);
+    TEST_ASSERT(osMutexRelease(mutex_default) == osOK);
+    TEST_ASSERT(osMutexDelete(mutex_default) == osOK);
+
+    /* Locked by another thread. */
+    sem_hold = osSemaphoreNew(1, 0, NULL);
+    TEST_ASSERT_NOT_NULL(sem_hold);
+    osThreadId_t thread = osThreadNew(entry_mutex_hold, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(thread);
+    ret_os = osSemaphoreAcquire(sem_hold, osWaitForever);
+    TEST_ASSERT(ret_os == osOK);
+
+    TEST_ASSERT(osMutexAcquire(mutex, 0) == osErrorResource);
+    time_start = osKernelGetTickCount();
+    TEST_ASSERT(osMutexAcquire(mutex, 20) == osErrorTimeout);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(20, osKernelGetTickCount() - time_start);
+    TEST_ASSERT(osMutexRelease(mutex) == osErrorResource);
+
+    /* The holder releases it in 20 ms. */
+    osSemaphoreRelease(sem_hold);
+    time_start = osKernelGetTickCount();
+    TEST_ASSERT(osMutexAcquire(mutex, 1000) == osOK);
+    TEST_ASSERT_LESS_THAN_UINT32(1000, osKernelGetTickCount() - time_start);
+    TEST_ASSERT(osMutexRelease(mutex) == osOK);
+
+    osThreadJoin(thread);
+    osSemaphoreDelete(sem_hold);
+    sem_hold = NULL;
+}
+
 /**
   * @brief  Define run test cases of mutex
   */
 TEST_GROUP_RUNNER(mutex)
 {
     RUN_TEST_CASE(mutex, test);
+    RUN_TEST_CASE(mutex, recursive_timeout);
 }
 
 /* Private functions ---------------------------------------------------------*/
@@ -180,6 +256,25 @@ static void entry_mutex_test(void *paras)
     }
 }
 
+/**
+  * @brief  Entry function holding the mutex until being informed.
+  */
+static void entry_mutex_hold(void *paras)
+{
+    (void)paras;
+
+    osStatus_t ret_os = osMutexAcquire(mutex, osWaitForever);
+    elab_assert(ret_os == osOK);
+    osSemaphoreRelease(sem_hold);
+
+    /* Wait until the main thread informs, and release it 20 ms later. */
+    osDelay(50);
+    osSemaphoreAcquire(sem_hold, osWaitForever);
+    osDelay(20);
+    ret_os = osMutexRelease(mutex);
+    elab_assert(ret_os == osOK);
+}
+
 #endif
 
 /* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,268 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+#if defined(__linux__)
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../os/cmsis_os.h"
+#include "../../3rd/Unity/unity.h"
+#include "../../3rd/Unity/unity_fixture.h"
+#include "../../common/elab_common.h"
+#include "../../common/elab_assert.h"
+
+#define TAG                         "ut_timer"
+#include "../../common/elab_log.h"
+
+/* Private config ------------------------------------------------------------*/
+#define UT_TIMER_NUMBER                             (500)
+#define UT_TIMER_PERIOD                             (10)
+#define UT_TIMER_TEST_TIME                          (500)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct ut_timer
+{
+    osTimerId_t timer;
+    uint32_t count;
+    uint32_t time_expire;
+    uint32_t count_stop;
+    bool delete_self;
+} ut_timer_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static void cb_timer(void *para);
+static void cb_timer_slow(void *para);
+
+/* Private variables ---------------------------------------------------------*/
+static ut_timer_t *ut_timer = NULL;
+static volatile bool slow_running = false;
+static volatile uint32_t slow_overlap = 0;
+
+static const osTimerAttr_t timer_attr =
+{
+    .name = "ut_timer",
+    .attr_bits = 0,
+    .cb_mem = NULL,
+    .cb_size = 0,
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Define test group of timer.
+  */
+TEST_GROUP(timer);
+
+/**
+  * @brief  Define test fixture setup function of timer.
+  */
+TEST_SETUP(timer)
+{
+    ut_timer = elab_malloc(sizeof(ut_timer_t) * UT_TIMER_NUMBER);
+    TEST_ASSERT_NOT_NULL(ut_timer);
+    memset(ut_timer, 0, sizeof(ut_timer_t) * UT_TIMER_NUMBER);
+}
+
+/**
+  * @brief  Define test fixture tear down function of timer.
+  */
+TEST_TEAR_DOWN(timer)
+{
+    elab_free(ut_timer);
+    ut_timer = NULL;
+}
+
+/**
+  * @brief  One-shot timers in different levels of the timer wheel.
+  */
+TEST(timer, once)
+{
+    const uint32_t ticks[] = { 1, 5, 63, 64, 65, 200, 1000, };
+    const uint32_t num = sizeof(ticks) / sizeof(uint32_t);
+    uint32_t time_start = osKernelGetTickCount();
+
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        ut_timer[i].timer = osTimerNew(cb_timer, osTimerOnce, &ut_timer[i],
+                                        &timer_attr);
+        TEST_ASSERT_NOT_NULL(ut_timer[i].timer);
+        TEST_ASSERT_EQUAL_STRING("ut_timer", osTimerGetName(ut_timer[i].timer));
+        TEST_ASSERT_EQUAL_UINT32(0, osTimerIsRunning(ut_timer[i].timer));
+        osTimerStart(ut_timer[i].timer, ticks[i]);
+        TEST_ASSERT_EQUAL_UINT32(1, osTimerIsRunning(ut_timer[i].timer));
+    }
+
+    osDelay(ticks[num - 1] + 50);
+    for (uint32_t i = 0; i < num; i ++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, ut_timer[i].count);
+        TEST_ASSERT_EQUAL_UINT32(0, osTimerIsRunning(ut_timer[i].timer));
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32((time_start + ticks[i]),
+                                            ut_timer[i].time_expire);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32((time_start + ticks[i] + 20),
+                                            ut_timer[i].time_expire);
+        osTimerDelete(ut_timer[i].timer);
+    }
+}
+
+/**
+  * @brief  Hundreds of periodic timers running together.
+  */
+TEST(timer, periodic_many)
+{
+    for (uint32_t i = 0; i < UT_TIMER_NUMBER; i ++)
+    {
+        ut_timer[i].timer = osTimerNew(cb_timer, osTimerPeriodic, &ut_timer[i],
+                                        &timer_attr);
+        TEST_ASSERT_NOT_NULL(ut_timer[i].timer);
+        osTimerStart(ut_timer[i].timer, UT_TIMER_PERIOD);
+    }
+
+    osDelay(UT_TIMER_TEST_TIME);
+    for (uint32_t i = 0; i < UT_TIMER_NUMBER; i ++)
+    {
+        osTimerStop(ut_timer[i].timer);
+        TEST_ASSERT_EQUAL_UINT32(0, osTimerIsRunning(ut_timer[i].timer));
+    }
+    for (uint32_t i = 0; i < UT_TIMER_NUMBER; i ++)
+    {
+        uint32_t count = ut_timer[i].count;
+        TEST_ASSERT_UINT32_WITHIN(5, (UT_TIMER_TEST_TIME / UT_TIMER_PERIOD), count);
+    }
+
+    /* No callback after stopping. */
+    osDelay(UT_TIMER_PERIOD * 5);
+    for (uint32_t i = 0; i < UT_TIMER_NUMBER; i ++)
+    {
+        uint32_t count = ut_timer[i].count;
+        TEST_ASSERT_UINT32_WITHIN(5, (UT_TIMER_TEST_TIME / UT_TIMER_PERIOD), count);
+        osTimerDelete(ut_timer[i].timer);
+    }
+}
+
+/**
+  * @brief  Timers stopped, restarted and deleted in their own callbacks.
+  */
+TEST(timer, stop_delete_in_callback)
+{
+    for (uint32_t i = 0; i < 2; i ++)
+    {
+        ut_timer[i].timer = osTimerNew(cb_timer, osTimerPeriodic, &ut_timer[i],
+                                        &timer_attr);
+        TEST_ASSERT_NOT_NULL(ut_timer[i].timer);
+        ut_timer[i].count_stop = 3;
+        ut_timer[i].delete_self = (i == 1) ? true : false;
+        osTimerStart(ut_timer[i].timer, UT_TIMER_PERIOD);
+    }
+
+    osDelay(UT_TIMER_PERIOD * 10);
+    TEST_ASSERT_EQUAL_UINT32(3, ut_timer[0].count);
+    TEST_ASSERT_EQUAL_UINT32(3, ut_timer[1].count);
+    TEST_ASSERT_EQUAL_UINT32(0, osTimerIsRunning(ut_timer[0].timer));
+
+    /* Restart the stopped timer, and it is stopped in the callback again. */
+    ut_timer[0].count_stop = 5;
+    osTimerStart(ut_timer[0].timer, UT_TIMER_PERIOD);
+    osDelay(UT_TIMER_PERIOD * 10);
+    TEST_ASSERT_EQUAL_UINT32(5, ut_timer[0].count);
+    osTimerDelete(ut_timer[0].timer);
+}
+
+/**
+  * @brief  The callbacks are run one by one in the only timer thread, even if
+  *         the kernel is initialized again, and the slow callback delays the
+  *         next periods of its own timer.
+  */
+TEST(timer, callback_serial)
+{
+    const uint32_t ticks[] = { 100, 50, 25, 12, 6, };
+    const uint32_t num = sizeof(ticks) / sizeof(uint32_t);
+
+    osKernelInitialize();
+    slow_running = false;
+    slow_overlap = 0;
+
+    /* Every timer expiring earlier than the ones before wakes the timer
+       thread up again. */
+    for (uint32_t i = 1; i <= num; i ++)
+    {
+        ut_timer[i].timer = osTimerNew(cb_timer, osTimerOnce, &ut_timer[i],
+                                        &timer_attr);
+        TEST_ASSERT_NOT_NULL(ut_timer[i].timer);
+        osTimerStart(ut_timer[i].timer, ticks[i - 1]);
+        osDelay(1);
+    }
+    ut_timer[0].timer = osTimerNew(cb_timer_slow, osTimerPeriodic, &ut_timer[0],
+                                    &timer_attr);
+    TEST_ASSERT_NOT_NULL(ut_timer[0].timer);
+    osTimerStart(ut_timer[0].timer, 2);
+
+    osDelay(UT_TIMER_PERIOD * 20);
+    osTimerStop(ut_timer[0].timer);
+    osDelay(UT_TIMER_PERIOD * 2);
+    for (uint32_t i = 0; i <= num; i ++)
+    {
+        osTimerDelete(ut_timer[i].timer);
+    }
+
+    TEST_ASSERT_GREATER_THAN_UINT32(0, ut_timer[0].count);
+    TEST_ASSERT_EQUAL_UINT32(0, slow_overlap);
+}
+
+/**
+  * @brief  Define run test cases of timer
+  */
+TEST_GROUP_RUNNER(timer)
+{
+    RUN_TEST_CASE(timer, once);
+    RUN_TEST_CASE(timer, periodic_many);
+    RUN_TEST_CASE(timer, stop_delete_in_callback);
+    RUN_TEST_CASE(timer, callback_serial);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Callback function for timer testing.
+  */
+static void cb_timer(void *para)
+{
+    ut_timer_t *ut_timer = (ut_timer_t *)para;
+
+    ut_timer->count ++;
+    ut_timer->time_expire = osKernelGetTickCount();
+    if (ut_timer->count_stop != 0 && ut_timer->count >= ut_timer->count_stop)
+    {
+        if (ut_timer->delete_self)
+        {
+            osTimerDelete(ut_timer->timer);
+        }
+        else
+        {
+            osTimerStop(ut_timer->timer);
+        }
+    }
+}
+
+/**
+  * @brief  Callback function longer than its timer period.
+  */
+static void cb_timer_slow(void *para)
+{
+    ut_timer_t *ut_timer = (ut_timer_t *)para;
+
+    if (slow_running)
+    {
+        slow_overlap ++;
+    }
+    slow_running = true;
+    osDelay(UT_TIMER_PERIOD);
+    ut_timer->count ++;
+    slow_running = false;
+}
+
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -10,12 +10,23 @@ main.c \
 ../../elab/edf/driver/simulator/*.c \
 ../../elab/midware/modbus/*.c \
 ../../elab/midware/esig_captor/*.c \
+../../elab/midware/edb/*.c \
 ../../elab/edf/normal/*.c \
 ../../elab/unit_test/edf/*.c \
 ../../elab/unit_test/os/*.c \
+../../elab/unit_test/common/*.c \
 ../../elab/unit_test/elib/*.c \
 ../../elab/unit_test/midware/*.c \
 ../../elab/test/test_elog.c \
+../../elab/test/test_serial_bench.c \
+../../elab/test/test_edf_bench.c \
+../../elab/test/test_mq_bench.c \
+../../elab/test/test_crc_bench.c \
+../../elab/test/test_modbus_bench.c \
+../../elab/test/test_edb_bench.c \
+../../elab/test/test_hash_bench.c \
+../../elab/test/test_elog_bench.c \
+../../elab/test/test_can_bench.c \
 ../../elab/3rd/Shell/*.c \
 ../../elab/3rd/mqtt/common/*.c \
 ../../elab/3rd/mqtt/mqtt/*.c \
@@ -26,8 +37,10 @@ main.c \
 ../../elab/3rd/qpc/ports/posix/qf_port.c \
 ../../elab/3rd/qpc/qpc_export.c \
 ../../elab/3rd/Unity/*.c \
+../../elab/3rd/lwrb/*.c \
 ../../elab/os/posix/cmsis_os.c \
 -I ../.. \
+-I ../../elab/3rd \
 -I . \
 -o build/shell \
 -l pthread
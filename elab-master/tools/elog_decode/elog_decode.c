@@ -0,0 +1,723 @@
+/*
+ * eLab Project
+ * Copyright (c) 2023, EventOS Team, <event-os@outlook.com>
+ */
+
+/*
+ * The host side decoder of the elog binary log. The binary frames in the log
+ * stream are decoded by the formats in the ELF file of the firmware, and the
+ * other bytes are passed through as they are.
+ *
+ * Usage: elog_decode <elf file> [log file]. The log is read from stdin if no
+ * log file is given.
+ *
+ * One frame is taken only if its size is in the record size, its head check
+ * is right and its ID is one format in the elog_fmt section. Otherwise the sync
+ * byte is passed through as the text, like the one in "\xc2\xa5", and the
+ * decoding goes on from the next byte.
+ *
+ * Built with ELOG_DECODE_NO_MAIN, elog_decode() is linked into the unit test.
+ */
+
+/* includes ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <elf.h>
+
+/* private config ----------------------------------------------------------- */
+#define ELOG_BINARY_SYNC                    (0xA5)
+#define ELOG_BINARY_HEAD_SIZE               (9)
+#define ELOG_BINARY_SIZE_MAX                (112)   /* ELOG_ASYNC_TEXT_SIZE */
+#define ELOG_FMT_BASE                       "elog_fmt_base"
+#define ELOG_SPEC_SIZE                      (32)
+#define ELOG_LINE_SIZE                      (1024)
+
+/* private typedef ---------------------------------------------------------- */
+typedef struct elf_section
+{
+    uint32_t type;
+    uint64_t flags;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint64_t entsize;
+} elf_section_t;
+
+typedef struct elf_reloc
+{
+    uint64_t addr;
+    uint64_t value;
+} elf_reloc_t;
+
+typedef struct elog_fmt_section
+{
+    uint64_t addr_base;                 /* elog_fmt_base */
+    uint64_t addr;
+    uint64_t size;
+} elog_fmt_section_t;
+
+typedef struct elog_fmt_info
+{
+    const char *tag;
+    const char *format;
+    uint8_t level;
+} elog_fmt_info_t;
+
+typedef struct elf_file
+{
+    uint8_t *data;
+    uint64_t size;
+    bool is_64;
+    uint32_t size_ptr;
+    uint32_t machine;
+    uint32_t count_section;
+    elf_reloc_t *reloc;
+    uint32_t count_reloc;
+} elf_file_t;
+
+/* private variables -------------------------------------------------------- */
+static const char elog_level_lable[] =
+{
+    ' ', 'E', 'W', 'I', 'D',
+};
+
+/* private functions -------------------------------------------------------- */
+/**
+  * @brief  Read one little endian value.
+  */
+static uint64_t _read_le(const uint8_t *data, uint32_t size)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < size; i ++)
+    {
+        value |= ((uint64_t)data[i] << (i * 8));
+    }
+
+    return value;
+}
+
+/**
+  * @brief  Get the section header of the given index.
+  */
+static void _elf_section(elf_file_t *elf, uint32_t index, elf_section_t *section)
+{
+    if (elf->is_64)
+    {
+        Elf64_Ehdr *head = (Elf64_Ehdr *)elf->data;
+        Elf64_Shdr *shdr = (Elf64_Shdr *)&elf->data[head->e_shoff +
+                                                    index * head->e_shentsize];
+        section->type = shdr->sh_type;
+        section->flags = shdr->sh_flags;
+        section->addr = shdr->sh_addr;
+        section->offset = shdr->sh_offset;
+        section->size = shdr->sh_size;
+        section->link = shdr->sh_link;
+        section->entsize = shdr->sh_entsize;
+    }
+    else
+    {
+        Elf32_Ehdr *head = (Elf32_Ehdr *)elf->data;
+        Elf32_Shdr *shdr = (Elf32_Shdr *)&elf->data[head->e_shoff +
+                                                    index * head->e_shentsize];
+        section->type = shdr->sh_type;
+        section->flags = shdr->sh_flags;
+        section->addr = shdr->sh_addr;
+        section->offset = shdr->sh_offset;
+        section->size = shdr->sh_size;
+        section->link = shdr->sh_link;
+        section->entsize = shdr->sh_entsize;
+    }
+}
+
+/**
+  * @brief  Get the file data at the given address of the firmware.
+  * @retval The data, or NULL if the address is not in the file.
+  */
+static const uint8_t *_elf_data(elf_file_t *elf, uint64_t addr, uint64_t size)
+{
+    elf_section_t section;
+
+    for (uint32_t i = 0; i < elf->count_section; i ++)
+    {
+        _elf_section(elf, i, &section);
+        if ((section.flags & SHF_ALLOC) != 0 && section.type != SHT_NOBITS &&
+            addr >= section.addr && (addr + size) <= (section.addr + section.size))
+        {
+            return &elf->data[section.offset + addr - section.addr];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief  Read one pointer at the given address, with the relative relocation
+  *         of the position independent executable applied.
+  * @retval False if the address is not in the file.
+  */
+static bool _elf_pointer(elf_file_t *elf, uint64_t addr, uint64_t *value)
+{
+    for (uint32_t i = 0; i < elf->count_reloc; i ++)
+    {
+        if (elf->reloc[i].addr == addr)
+        {
+            *value = elf->reloc[i].value;
+            return true;
+        }
+    }
+
+    const uint8_t *data = _elf_data(elf, addr, elf->size_ptr);
+    if (data == NULL)
+    {
+        return false;
+    }
+    *value = _read_le(data, elf->size_ptr);
+
+    return true;
+}
+
+/**
+  * @brief  Get the string at the given address.
+  */
+static const char *_elf_string(elf_file_t *elf, uint64_t addr)
+{
+    return (const char *)_elf_data(elf, addr, 1);
+}
+
+/**
+  * @brief  Find the symbol address by its name in the symbol tables.
+  * @retval False if not found.
+  */
+static bool _elf_symbol(elf_file_t *elf, const char *name, uint64_t *addr)
+{
+    elf_section_t section, strtab;
+
+    for (uint32_t i = 0; i < elf->count_section; i ++)
+    {
+        _elf_section(elf, i, &section);
+        if (section.type != SHT_SYMTAB && section.type != SHT_DYNSYM)
+        {
+            continue;
+        }
+        _elf_section(elf, section.link, &strtab);
+        for (uint64_t j = 0; j < section.size / section.entsize; j ++)
+        {
+            const uint8_t *sym = &elf->data[section.offset + j * section.entsize];
+            uint32_t name_offset;
+            uint64_t value;
+            if (elf->is_64)
+            {
+                name_offset = ((Elf64_Sym *)sym)->st_name;
+                value = ((Elf64_Sym *)sym)->st_value;
+            }
+            else
+            {
+                name_offset = ((Elf32_Sym *)sym)->st_name;
+                value = ((Elf32_Sym *)sym)->st_value;
+            }
+            if (strcmp((const char *)&elf->data[strtab.offset + name_offset],
+                        name) == 0)
+            {
+                *addr = value;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+  * @brief  Load the relative relocations, which keep the pointers of the
+  *         position independent executable in their addends.
+  */
+static void _elf_reloc_load(elf_file_t *elf)
+{
+    elf_section_t section;
+    uint32_t type_relative = 0;
+
+    if (elf->machine == EM_X86_64)
+    {
+        type_relative = R_X86_64_RELATIVE;
+    }
+    else if (elf->machine == EM_AARCH64)
+    {
+        type_relative = R_AARCH64_RELATIVE;
+    }
+    else
+    {
+        /* The 32-bit MCUs are linked to the fixed addresses. */
+        return;
+    }
+
+    for (uint32_t i = 0; i < elf->count_section; i ++)
+    {
+        _elf_section(elf, i, &section);
+        if (section.type != SHT_RELA || !elf->is_64)
+        {
+            continue;
+        }
+        for (uint64_t j = 0; j < section.size / sizeof(Elf64_Rela); j ++)
+        {
+            Elf64_Rela *rela =
+                (Elf64_Rela *)&elf->data[section.offset + j * sizeof(Elf64_Rela)];
+            if (ELF64_R_TYPE(rela->r_info) != type_relative)
+            {
+                continue;
+            }
+            if ((elf->count_reloc % 1024) == 0)
+            {
+                elf->reloc = realloc(elf->reloc,
+                                (elf->count_reloc + 1024) * sizeof(elf_reloc_t));
+            }
+            elf->reloc[elf->count_reloc].addr = rela->r_offset;
+            elf->reloc[elf->count_reloc].value = rela->r_addend;
+            elf->count_reloc ++;
+        }
+    }
+}
+
+/**
+  * @brief  Load the ELF file.
+  * @retval False if it is not one supported ELF file.
+  */
+static bool _elf_load(elf_file_t *elf, const char *path)
+{
+    memset(elf, 0, sizeof(elf_file_t));
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    elf->size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    elf->data = malloc(elf->size);
+    bool ret = (elf->data != NULL &&
+                fread(elf->data, 1, elf->size, fp) == elf->size);
+    fclose(fp);
+
+    if (!ret || elf->size < sizeof(Elf32_Ehdr) ||
+        memcmp(elf->data, ELFMAG, SELFMAG) != 0 ||
+        elf->data[EI_DATA] != ELFDATA2LSB)
+    {
+        return false;
+    }
+
+    elf->is_64 = (elf->data[EI_CLASS] == ELFCLASS64);
+    elf->size_ptr = elf->is_64 ? 8 : 4;
+    if (elf->is_64)
+    {
+        elf->machine = ((Elf64_Ehdr *)elf->data)->e_machine;
+        elf->count_section = ((Elf64_Ehdr *)elf->data)->e_shnum;
+    }
+    else
+    {
+        elf->machine = ((Elf32_Ehdr *)elf->data)->e_machine;
+        elf->count_section = ((Elf32_Ehdr *)elf->data)->e_shnum;
+    }
+    _elf_reloc_load(elf);
+
+    return true;
+}
+
+/**
+  * @brief  Read one argument from the frame.
+  * @retval False if the frame has no more data.
+  */
+static bool _arg_read(const uint8_t *arg, uint32_t size, uint32_t *pos,
+                        uint32_t size_arg, uint64_t *value)
+{
+    if ((*pos + size_arg) > size)
+    {
+        return false;
+    }
+    *value = _read_le(&arg[*pos], size_arg);
+    *pos += size_arg;
+
+    return true;
+}
+
+/**
+  * @brief  Format the arguments by the format, in the same order and the same
+  *         sizes as they are encoded in the firmware.
+  */
+static void _format(elf_file_t *elf, char *line, uint32_t size_line,
+                    const char *format, const uint8_t *arg, uint32_t size)
+{
+    uint32_t len = 0;
+    uint32_t pos = 0;
+    const char *p = format;
+
+#define LINE_PRINTF(...)                                                       \
+    do                                                                         \
+    {                                                                          \
+        int ret = snprintf(&line[len], size_line - len, __VA_ARGS__);          \
+        len += (ret > 0) ? ret : 0;                                            \
+        len = (len >= size_line) ? (size_line - 1) : len;                      \
+    } while (0)
+
+    while (*p != 0)
+    {
+        if (*p != '%')
+        {
+            LINE_PRINTF("%c", *p ++);
+            continue;
+        }
+
+        /* The flags, the width and the precision, without the length. */
+        char spec[ELOG_SPEC_SIZE];
+        uint32_t len_spec = 0;
+        uint64_t value = 0;
+        bool valid = true;
+        spec[len_spec ++] = *p ++;
+        for (; *p != 0; p ++)
+        {
+            if (*p == '*')
+            {
+                valid = valid && _arg_read(arg, size, &pos, 4, &value);
+                len_spec += snprintf(&spec[len_spec], ELOG_SPEC_SIZE - len_spec - 4,
+                                        "%d", (int32_t)value);
+            }
+            else if (strchr("-+ #0123456789.", *p) != NULL)
+            {
+                if (len_spec < (ELOG_SPEC_SIZE - 4))
+                {
+                    spec[len_spec ++] = *p;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        uint32_t size_int = 4;
+        for (; *p != 0; p ++)
+        {
+            if (*p == 'l')
+            {
+                size_int = (size_int == 4) ? elf->size_ptr : 8;
+            }
+            else if (*p == 'j')
+            {
+                size_int = 8;
+            }
+            else if (*p == 'z' || *p == 't')
+            {
+                size_int = elf->size_ptr;
+            }
+            else if (*p != 'h' && *p != 'L')
+            {
+                break;
+            }
+        }
+        if (*p == 0)
+        {
+            break;
+        }
+
+        char conversion = *p ++;
+        if (conversion == '%')
+        {
+            LINE_PRINTF("%%");
+        }
+        else if (strchr("diuxXoc", conversion) != NULL)
+        {
+            if (valid && _arg_read(arg, size, &pos, size_int, &value))
+            {
+                bool is_signed = (conversion == 'd' || conversion == 'i');
+                if (is_signed && size_int == 4)
+                {
+                    value = (uint64_t)(int64_t)(int32_t)value;
+                }
+                if (conversion == 'c')
+                {
+                    spec[len_spec ++] = 'c';
+                    spec[len_spec] = 0;
+                    LINE_PRINTF(spec, (int)value);
+                }
+                else
+                {
+                    spec[len_spec ++] = 'l';
+                    spec[len_spec ++] = 'l';
+                    spec[len_spec ++] = conversion;
+                    spec[len_spec] = 0;
+                    LINE_PRINTF(spec, value);
+                }
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (strchr("fFeEgGaA", conversion) != NULL)
+        {
+            if (valid && _arg_read(arg, size, &pos, 8, &value))
+            {
+                double value_double;
+                memcpy(&value_double, &value, sizeof(double));
+                spec[len_spec ++] = conversion;
+                spec[len_spec] = 0;
+                LINE_PRINTF(spec, value_double);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (conversion == 's')
+        {
+            if (valid && pos < size && (pos + 1 + arg[pos]) <= size)
+            {
+                char str[256];
+                uint32_t len_str = arg[pos ++];
+                memcpy(str, &arg[pos], len_str);
+                str[len_str] = 0;
+                pos += len_str;
+                spec[len_spec ++] = 's';
+                spec[len_spec] = 0;
+                LINE_PRINTF(spec, str);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (conversion == 'p')
+        {
+            if (valid && _arg_read(arg, size, &pos, elf->size_ptr, &value))
+            {
+                LINE_PRINTF("0x%llx", (unsigned long long)value);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else
+        {
+            valid = false;
+        }
+
+        /* The arguments not recorded. */
+        if (!valid)
+        {
+            LINE_PRINTF("?");
+        }
+    }
+
+#undef LINE_PRINTF
+}
+
+/**
+  * @brief  Find the elog_fmt section by the elog_fmt_base in it.
+  * @retval False if not found.
+  */
+static bool _fmt_section_load(elf_file_t *elf, elog_fmt_section_t *fmt)
+{
+    elf_section_t section;
+
+    if (!_elf_symbol(elf, ELOG_FMT_BASE, &fmt->addr_base))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < elf->count_section; i ++)
+    {
+        _elf_section(elf, i, &section);
+        if ((section.flags & SHF_ALLOC) != 0 && section.type != SHT_NOBITS &&
+            fmt->addr_base >= section.addr &&
+            fmt->addr_base < (section.addr + section.size))
+        {
+            fmt->addr = section.addr;
+            fmt->size = section.size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+  * @brief  Get the check byte of the frame head, the same as the firmware.
+  */
+static uint8_t _head_check(const uint8_t *head)
+{
+    uint8_t check = ELOG_BINARY_SYNC;
+
+    for (uint32_t i = 1; i < (ELOG_BINARY_HEAD_SIZE - 1); i ++)
+    {
+        check = (uint8_t)((check << 1) | (check >> 7)) ^ head[i];
+    }
+
+    return check;
+}
+
+/**
+  * @brief  Get the format of the ID, which should be one in the elog_fmt section
+  *         with its tag and format strings in the file.
+  * @retval False if the ID is not one format.
+  */
+static bool _fmt_get(elf_file_t *elf, const elog_fmt_section_t *fmt, int16_t id,
+                        elog_fmt_info_t *info)
+{
+    uint64_t addr = fmt->addr_base + (int64_t)id * 4;
+    uint64_t addr_tag = 0;
+    uint64_t addr_format = 0;
+
+    /* The tag and format pointers, and the level. */
+    if (addr < fmt->addr ||
+        (addr + 2 * elf->size_ptr + 4) > (fmt->addr + fmt->size))
+    {
+        return false;
+    }
+    const uint8_t *level = _elf_data(elf, addr + 2 * elf->size_ptr, 4);
+    if (level == NULL || level[0] >= sizeof(elog_level_lable) ||
+        !_elf_pointer(elf, addr, &addr_tag) ||
+        !_elf_pointer(elf, addr + elf->size_ptr, &addr_format))
+    {
+        return false;
+    }
+    info->tag = _elf_string(elf, addr_tag);
+    info->format = _elf_string(elf, addr_format);
+    info->level = level[0];
+
+    return (info->tag != NULL && info->format != NULL);
+}
+
+/**
+  * @brief  Check the frame head by its size, its check byte and its ID.
+  */
+static bool _head_valid(elf_file_t *elf, const elog_fmt_section_t *fmt,
+                        const uint8_t *head)
+{
+    elog_fmt_info_t info;
+
+    return (head[1] <= ELOG_BINARY_SIZE_MAX &&
+            head[ELOG_BINARY_HEAD_SIZE - 1] == _head_check(head) &&
+            _fmt_get(elf, fmt, (int16_t)_read_le(&head[2], 2), &info));
+}
+
+/**
+  * @brief  Read the stream until there are the given bytes in the buffer.
+  * @retval False if the stream ends before.
+  */
+static bool _fill(FILE *in, uint8_t *buff, uint32_t *count, uint32_t size)
+{
+    while (*count < size)
+    {
+        int ch = fgetc(in);
+        if (ch == EOF)
+        {
+            return false;
+        }
+        buff[(*count) ++] = (uint8_t)ch;
+    }
+
+    return true;
+}
+
+/**
+  * @brief  Decode one valid binary frame into the text log.
+  */
+static void _decode_frame(elf_file_t *elf, const elog_fmt_section_t *fmt,
+                            const uint8_t *head, const uint8_t *arg, FILE *out)
+{
+    char line[ELOG_LINE_SIZE];
+    elog_fmt_info_t info;
+    uint32_t time = (uint32_t)_read_le(&head[4], 4);
+
+    _fmt_get(elf, fmt, (int16_t)_read_le(&head[2], 2), &info);
+    _format(elf, line, sizeof(line), info.format, arg, head[1]);
+    fprintf(out, "[%c/%s %u] %s\n", elog_level_lable[info.level], info.tag,
+            time, line);
+}
+
+/* public functions --------------------------------------------------------- */
+/**
+  * @brief  Decode the log stream by the formats in the ELF file.
+  * @param  path_elf    The ELF file of the firmware.
+  * @param  in          The log stream.
+  * @param  out         The decoded text.
+  * @retval 0 if decoded, or 1 if the ELF file is not supported.
+  */
+int elog_decode(const char *path_elf, FILE *in, FILE *out)
+{
+    elf_file_t elf;
+    elog_fmt_section_t fmt;
+
+    if (!_elf_load(&elf, path_elf))
+    {
+        fprintf(stderr, "%s is not one little endian ELF file.\n", path_elf);
+        free(elf.data);
+        return 1;
+    }
+    if (!_fmt_section_load(&elf, &fmt))
+    {
+        fprintf(stderr, "No %s in %s.\n", ELOG_FMT_BASE, path_elf);
+        free(elf.reloc);
+        free(elf.data);
+        return 1;
+    }
+
+    /* The bytes are looked ahead for one whole frame, and the ones out of the
+       frames are passed through. */
+    uint8_t buff[ELOG_BINARY_HEAD_SIZE + 256];
+    uint32_t count = 0;
+    while (_fill(in, buff, &count, 1))
+    {
+        uint32_t used = 1;
+        if (buff[0] == ELOG_BINARY_SYNC &&
+            _fill(in, buff, &count, ELOG_BINARY_HEAD_SIZE) &&
+            _head_valid(&elf, &fmt, buff) &&
+            _fill(in, buff, &count, ELOG_BINARY_HEAD_SIZE + buff[1]))
+        {
+            _decode_frame(&elf, &fmt, buff, &buff[ELOG_BINARY_HEAD_SIZE], out);
+            used = ELOG_BINARY_HEAD_SIZE + buff[1];
+        }
+        else
+        {
+            /* The text, or the sync byte not starting one valid frame. */
+            fputc(buff[0], out);
+        }
+        count -= used;
+        memmove(buff, &buff[used], count);
+    }
+
+    free(elf.reloc);
+    free(elf.data);
+
+    return 0;
+}
+
+#ifndef ELOG_DECODE_NO_MAIN
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <elf file> [log file]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *fp = (argc >= 3) ? fopen(argv[2], "rb") : stdin;
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open %s.\n", argv[2]);
+        return 1;
+    }
+    int ret = elog_decode(argv[1], fp, stdout);
+    if (fp != stdin)
+    {
+        fclose(fp);
+    }
+
+    return ret;
+}
+#endif
+
+/* ----------------------------- end of file -------------------------------- */
@@ -0,0 +1,5 @@
+mkdir build
+
+gcc -std=gnu99 -O2 -Wall \
+elog_decode.c \
+-o build/elog_decode